@@ -23,6 +23,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -102,6 +103,23 @@ enum
  */
 typedef ssize_t (*eml_writer_fn)(eml_level_t lvl, const char* line, size_t n, void* user);
 
+/**
+ * @brief Scatter-gather writer callback (see emlog_set_writer_iov()).
+ *
+ * Receives the pieces the line was built from, in order, without the
+ * trailing newline: usually the header and the message (@p iovcnt == 2),
+ * a single piece for replayed lines. The buffers belong to the logger
+ * and are only valid during the call.
+ *
+ * @param lvl Log level for the line.
+ * @param iov Line pieces.
+ * @param iovcnt Number of pieces (at least 1).
+ * @param user User-provided context pointer passed to emlog_set_writer_iov().
+ * @return ssize_t Number of bytes written or negative on error.
+ */
+typedef ssize_t (*eml_writer_iov_fn)(eml_level_t lvl, const struct iovec* iov, int iovcnt,
+                                     void* user);
+
 /**
  * @brief Initialize the global logger state.
  *
@@ -129,6 +147,128 @@ void emlog_init(int min_level, bool timestamps);
  */
 void emlog_set_level(eml_level_t min_level);
 
+/**
+ * @name Component override table limits
+ * Capacity of the per-component level table used by
+ * emlog_set_component_level(). Names longer than
+ * EMLOG_COMPONENT_NAME_MAX - 1 bytes are rejected.
+ */
+/*@{*/
+#define EMLOG_MAX_COMPONENTS     64
+#define EMLOG_COMPONENT_NAME_MAX 32
+/*@}*/
+
+/**
+ * @brief Override the minimum log level for a single component.
+ *
+ * Messages whose component string equals @p comp are filtered against
+ * @p min_level instead of the global level set by emlog_set_level(), so
+ * e.g. "net" can run at DBG while everything else stays at WRN. Pass a
+ * negative @p min_level to drop the override and follow the global level
+ * again.
+ *
+ * Lookups on the logging path are lock-free (a hash of the component name
+ * probed into a fixed open-addressing table) and happen before any
+ * timestamp or message formatting work. Updates are serialized internally
+ * and are expected to be rare.
+ *
+ * @param comp Component/tag name (must not be NULL).
+ * @param min_level Minimum level for @p comp, or negative to clear it.
+ * @return eml_err_t EML_OK on success, EML_BAD_INPUT for a NULL or too long
+ *         name, EML_TEMP_RESOURCE when EMLOG_MAX_COMPONENTS is exhausted.
+ */
+eml_err_t emlog_set_component_level(const char* comp, int min_level);
+
+/**
+ * @brief Return the per-component override installed for @p comp.
+ *
+ * @param comp Component/tag name (NULL is treated as "no override").
+ * @return int Override level, or -1 when @p comp follows the global level.
+ */
+int emlog_get_component_level(const char* comp);
+
+/**
+ * @brief Override the global minimum level for the calling thread only.
+ *
+ * The thread level replaces G.min_level (emlog_set_level()) in the
+ * filter for lines logged by this thread; component overrides still take
+ * precedence. While any thread holds a level below the global one, the
+ * inline EML_* check is relaxed process-wide so that thread's statements
+ * reach the precise filter; other threads pay one extra compare per
+ * statement at the relaxed level. The override is released automatically
+ * when the thread exits.
+ *
+ * @param level New level for this thread, or -1 to follow the global level.
+ * @return eml_err_t EML_OK, or EML_BAD_INPUT for a level above EML_LEVEL_CRIT.
+ */
+eml_err_t emlog_thread_set_level(int level);
+
+/**
+ * @brief Current per-thread override (-1 when the thread follows the global level).
+ */
+int emlog_thread_get_level(void);
+
+/**
+ * @brief Scoped elevation: set the thread level and return a restore token.
+ *
+ * @code
+ * int tok = emlog_thread_push_level(EML_LEVEL_DBG);
+ * handle_canary_request(req);
+ * emlog_thread_pop_level(tok);
+ * @endcode
+ *
+ * @param level Level for the scope.
+ * @return int Token to pass to emlog_thread_pop_level().
+ */
+int emlog_thread_push_level(eml_level_t level);
+
+/**
+ * @brief Restore the thread level saved by emlog_thread_push_level().
+ *
+ * @param token Value returned by the matching push.
+ */
+void emlog_thread_pop_level(int token);
+
+/**
+ * @brief Keep only 1 in @p n lines of @p level.
+ *
+ * The decision is taken before timestamps or message formatting, using a
+ * per-thread xorshift generator, or the thread's sample key when one is
+ * set (see emlog_set_sample_key()). Lines from call sites forced on with
+ * emlog_callsite_enable() are never sampled.
+ *
+ * @param level Level the rate applies to.
+ * @param n Keep one line in @p n (0 or 1 keeps every line).
+ * @return eml_err_t EML_OK, or EML_BAD_INPUT for an unknown level.
+ */
+eml_err_t emlog_set_sampling(eml_level_t level, unsigned n);
+
+/**
+ * @brief Per-component sampling rate; overrides emlog_set_sampling().
+ *
+ * @param comp Component/tag name (non-empty, < EMLOG_COMPONENT_NAME_MAX).
+ * @param n Keep one line in @p n (0 falls back to the per-level rate).
+ * @return eml_err_t EML_OK, EML_BAD_INPUT or EML_TEMP_RESOURCE (table full).
+ */
+eml_err_t emlog_set_component_sampling(const char* comp, unsigned n);
+
+/**
+ * @brief Switch the calling thread to consistent sampling keyed on @p id.
+ *
+ * While a key is set every sampling decision on this thread depends only
+ * on @p id and the rate, so all lines of one request (id) are either kept
+ * or dropped together, and a request kept at 1-in-100 is also kept at
+ * 1-in-10.
+ *
+ * @param id Caller-supplied request/trace identifier.
+ */
+void emlog_set_sample_key(uint64_t id);
+
+/**
+ * @brief Return the calling thread to random sampling.
+ */
+void emlog_clear_sample_key(void);
+
 /**
  * @brief Enable or disable ISO8601 timestamps in emitted lines.
  *
@@ -140,77 +280,1477 @@ void emlog_enable_timestamps(bool on);
  * @brief Install a custom writer callback.
  *
  * Passing NULL for @p fn restores the default behavior which writes to
- * stdout (info and below) and stderr (errors and above).
+ * stdout (info and below) and stderr (warnings and above), or to the
+ * descriptors chosen with emlog_set_fd().
  *
  * @param fn Writer callback or NULL to restore default.
  * @param user User data pointer passed to the writer when invoked.
  */
 void emlog_set_writer(eml_writer_fn fn, void* user);
 
+/**
+ * @brief Install a scatter-gather writer callback.
+ *
+ * Like emlog_set_writer(), but the callback gets the header and message
+ * as an iovec array instead of a contiguous copy, so a writer that
+ * ends in writev() (or sendmsg()) moves the line without any
+ * intermediate buffer. Installing either kind of writer replaces the
+ * other; passing NULL for @p fn restores the default behavior.
+ *
+ * @param fn Writer callback or NULL to restore default.
+ * @param user User data pointer passed to the writer when invoked.
+ */
+void emlog_set_writer_iov(eml_writer_iov_fn fn, void* user);
+
 /**
  * @brief Control whether the logger flushes stdio buffers before using writev.
  *
- * When true (default) the logger will call fflush() on the destination
- * FILE* before issuing a writev() syscall. This avoids interleaving when
- * other code may be using stdio on the same stream (safe but slower).
- * When false the logger will write directly via writev() (faster but
- * may interleave with stdio-buffered output).
+ * When true the logger will call fflush() on stdout or stderr before
+ * issuing a writev() syscall to descriptor 1 or 2. This avoids
+ * interleaving when other code may be using stdio on the same stream
+ * (safe but slower). When false (default) the logger will write directly
+ * via writev() (faster but may interleave with stdio-buffered output).
+ * Descriptors installed with emlog_set_fd() other than 1 and 2 are never
+ * flushed.
  */
 void emlog_set_writev_flush(bool on);
 
+/** @name Level masks for emlog_set_fd() */
+/*@{*/
+#define EML_LEVEL_MASK(l)      (1u << (unsigned)(l)) /**< Bit for one level */
+#define EML_LEVEL_MASK_ALL     0x1fu                 /**< Every level */
+#define EML_LEVEL_MASK_FROM(l) (EML_LEVEL_MASK_ALL & ~(EML_LEVEL_MASK(l) - 1u)) /**< l and above */
+/*@}*/
+
 /**
- * @brief Core printf-style logger.
+ * @brief Route the default writer's output for a set of levels to @p fd.
  *
- * The logger is thread-safe and will drop messages whose level is below
- * the current minimum. The @p comp argument is an optional component/tag
- * string; pass NULL or "-" if not applicable.
+ * The default writer issues one writev() per line straight to the
+ * descriptor (a file, pipe or socket) and never touches a FILE* stream.
+ * The library does not take ownership: the caller keeps @p fd open
+ * while it is installed and closes it afterwards. Passing a negative
+ * @p fd restores stdout (DBG/INFO) or stderr (WARN and above) for the
+ * masked levels. Has no effect while a custom writer is installed.
  *
- * @note This function is declared with a printf attribute so format
- *       string mismatches are detected at compile time when supported.
+ * @code
+ * emlog_set_fd(EML_LEVEL_MASK_ALL, log_fd);
+ * emlog_set_fd(EML_LEVEL_MASK(EML_LEVEL_ERROR) | EML_LEVEL_MASK(EML_LEVEL_CRIT), alert_fd);
+ * @endcode
  *
- * @param level Log level for this message.
- * @param comp Component/tag string (may be NULL).
- * @param fmt printf-style format string followed by arguments.
+ * @param level_mask OR of EML_LEVEL_MASK() bits.
+ * @param fd Target descriptor, or negative for the default.
+ * @return eml_err_t EML_OK, or EML_BAD_INPUT for an empty or unknown mask.
  */
-void emlog_log(eml_level_t level, const char* comp, const char* fmt, ...)
-    __attribute__((format(printf, 3, 4)));
+eml_err_t emlog_set_fd(unsigned level_mask, int fd);
 
 /**
- * @brief Log a message that includes formatted errno text.
+ * @brief Descriptor the default writer currently uses for @p level.
  *
- * This composes the formatted message from @p fmt and appends the
- * strerror() text for @p err. It is safe to call from signal handlers as
- * long as the C library implementations used are async-signal-safe for
- * the invoked routines (most are not); prefer using it from normal code.
+ * @return int File descriptor, or -1 for an unknown level.
+ */
+int emlog_get_fd(eml_level_t level);
+
+/**
+ * @brief Hand lines bound for pipe @p fd to the kernel with vmsplice().
  *
- * @param level Log level.
- * @param comp Optional component/tag.
- * @param err errno value to format (e.g., errno).
- * @param fmt printf-style format string and args.
+ * Lines the default writer would write to @p fd are instead appended to
+ * one of two page-aligned buffers, each as large as the pipe. A full
+ * buffer is passed with vmsplice(SPLICE_F_GIFT), so the kernel takes
+ * the pages rather than copying them, and the other buffer is filled
+ * next. A buffer is refilled only after the one spliced after it has
+ * been accepted whole, which takes every one of the pipe's slots, so
+ * the reader has consumed every page of the older buffer by then.
+ *
+ * Buffered text is copied out with write() when it is @p flush_ms old,
+ * when an ERROR or CRIT line arrives, on emlog_pipe_flush() and at
+ * exit. If the pipe is resized beyond the buffers, the path turns
+ * itself off. Descriptors that are not this pipe keep using writev().
+ * Lines may split across two splices, so other writers to the same pipe
+ * can interleave mid-line. Linux only.
+ *
+ * @param fd Pipe write end, or negative to flush and turn the path off.
+ * @param flush_ms Longest a partial buffer waits (0 = 100).
+ * @return eml_err_t EML_OK, EML_BAD_INPUT (not a pipe), EML_TEMP_RESOURCE
+ *         (no memory or thread) or EML_NOT_FOUND (no vmsplice here).
  */
-void emlog_log_errno(eml_level_t level, const char* comp, int err, const char* fmt, ...)
-    __attribute__((format(printf, 4, 5)));
+eml_err_t emlog_set_pipe_splice(int fd, unsigned flush_ms);
 
-/* Short logging macros for easy call-sites. These forward to emlog_log().
- * Example: EML_INFO("main", "listening on %d", port);
+/**
+ * @brief Copy out whatever the pipe splice path has buffered.
  */
-#define EML_DBG(tag, ...)   emlog_log(EML_LEVEL_DBG, tag, __VA_ARGS__)
-#define EML_INFO(tag, ...)  emlog_log(EML_LEVEL_INFO, tag, __VA_ARGS__)
-#define EML_WARN(tag, ...)  emlog_log(EML_LEVEL_WARN, tag, __VA_ARGS__)
-#define EML_ERROR(tag, ...) emlog_log(EML_LEVEL_ERROR, tag, __VA_ARGS__)
-#define EML_CRIT(tag, ...)  emlog_log(EML_LEVEL_CRIT, tag, __VA_ARGS__)
+void emlog_pipe_flush(void);
 
 /**
- * @brief Helper that logs errno using the current global errno value.
+ * @brief Bytes the pipe splice path has moved so far.
  *
- * Usage: EML_PERR("mod", "failed to open %s", path);
+ * @param spliced Receives bytes passed with vmsplice() (may be NULL).
+ * @param copied Receives bytes flushed with write() (may be NULL).
+ */
+void emlog_pipe_splice_stats(uint64_t* spliced, uint64_t* copied);
+
+/** @brief What the default writer does when a descriptor's overflow buffer is full. */
+typedef enum
+{
+    EML_OVERFLOW_DROP_NEWEST = 0, /**< Discard the line being written (default). */
+    EML_OVERFLOW_DROP_OLDEST,     /**< Discard buffered lines, oldest first. */
+    EML_OVERFLOW_BLOCK            /**< Wait for the descriptor, then drop the newest. */
+} eml_overflow_policy_t;
+
+typedef struct eml_overflow_stats
+{
+    uint64_t partial;       /**< Short writes that were continued */
+    uint64_t deferred;      /**< Lines (or line tails) parked on EAGAIN */
+    uint64_t dropped;       /**< Lines discarded by the policy */
+    uint64_t dropped_bytes; /**< Bytes of those lines */
+    uint64_t blocked;       /**< Times EML_OVERFLOW_BLOCK waited */
+    uint64_t errors;        /**< Lines lost to write errors other than EAGAIN */
+    uint64_t pending;       /**< Bytes buffered right now */
+} eml_overflow_stats_t;
+
+/**
+ * @brief Configure the default writer's per-descriptor overflow buffer.
+ *
+ * A short writev() is always continued, so a line is never cut off.
+ * When a non-blocking descriptor returns EAGAIN, the rest of the line
+ * is parked in a buffer of up to @p bytes for that descriptor and later
+ * lines queue behind it. A helper thread poll()s the descriptor and
+ * writes the buffer out once it becomes writable; every logging call to
+ * the descriptor also tries first. When the buffer is full, @p policy
+ * decides which line is dropped; with EML_OVERFLOW_BLOCK the caller
+ * waits up to @p block_ms for room and drops the new line if none
+ * appears. The wait happens after the logger lock is released, so only
+ * threads logging to that descriptor wait; lines written outside a
+ * logging call (timer summaries) are dropped instead of waiting. The remainder of a line that was already partly
+ * written is always kept. Drops are counted, see emlog_overflow_stats().
+ * Blocking descriptors never return EAGAIN, so only non-blocking ones
+ * use the buffer. The default is 64 KiB with EML_OVERFLOW_DROP_NEWEST.
+ *
+ * @param bytes Buffer size per descriptor (0 = drop on EAGAIN).
+ * @param policy What to drop when the buffer is full.
+ * @param block_ms Longest EML_OVERFLOW_BLOCK waits for room
+ *                 (0 = EMLOG_OVERFLOW_BLOCK_MS).
+ * @return eml_err_t EML_OK or EML_BAD_INPUT for an unknown policy.
+ */
+#ifndef EMLOG_OVERFLOW_BLOCK_MS
+#    define EMLOG_OVERFLOW_BLOCK_MS 1000u /**< Default EML_OVERFLOW_BLOCK wait */
+#endif
+
+eml_err_t emlog_set_overflow(size_t bytes, eml_overflow_policy_t policy, unsigned block_ms);
+
+/**
+ * @brief Read the default writer's overflow counters.
+ */
+void emlog_overflow_stats(eml_overflow_stats_t* out);
+
+/**
+ * @brief Write out buffered overflow bytes, waiting up to one second per
+ *        descriptor; whatever still does not fit is counted as dropped.
+ *
+ * Registered with atexit() the first time a line is parked.
+ */
+void emlog_overflow_flush(void);
+
+/**
+ * @brief Collapse runs of identical lines ("last message repeated N times").
+ *
+ * When enabled, each thread remembers a hash of its last emitted line
+ * (component, level and formatted message). Identical lines arriving
+ * within @p window_ms of the first one are counted instead of written;
+ * a single "last message repeated N times" line is emitted when a
+ * different line arrives, when the window expires (a background timer
+ * reports a run that went quiet), when the thread exits or when
+ * emlog_dedup_flush() is called. Disabled by default.
+ *
+ * @param on true to enable suppression.
+ * @param window_ms Maximum age of a run before it is summarized (0 = 1000).
+ */
+void emlog_set_dedup(bool on, unsigned window_ms);
+
+/**
+ * @brief Emit the pending "repeated" summary of the calling thread, if any.
+ */
+void emlog_dedup_flush(void);
+
+/**
+ * @brief Apply a key=value configuration file once.
+ *
+ * Recognized keys (one per line, '#' starts a comment):
+ *   - level = DBG|INFO|WARN|ERROR|CRIT (or 0..4)
+ *   - timestamps = on|off
+ *   - writev_flush = on|off
+ *   - component.NAME = <level>|inherit
+ *
+ * The whole file is parsed before anything is applied, so a malformed
+ * file changes nothing. Component overrides installed by a previous load
+ * and missing from this one are cleared. Keys that are absent leave the
+ * corresponding setting untouched.
+ *
+ * @param path Configuration file path.
+ * @return eml_err_t EML_OK, EML_NOT_FOUND (cannot open) or EML_BAD_INPUT.
+ */
+eml_err_t emlog_config_load(const char* path);
+
+/**
+ * @brief Load @p path and re-apply it whenever it changes (Linux inotify).
+ *
+ * Starts a watcher thread that sleeps in poll(2) on an inotify descriptor
+ * watching the file's directory, so in-place writes and atomic
+ * rename-over saves are both seen. Reloads run on the watcher thread and
+ * go through the same setters as application code; logging threads never
+ * wait for a reload.
+ *
+ * @param path Configuration file path.
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_CONFLICT (already watching)
+ *         or EML_TEMP_UNAVAILABLE (no inotify / thread creation failed).
+ */
+eml_err_t emlog_config_watch(const char* path);
+
+/**
+ * @brief Stop the watcher started by emlog_config_watch() and join it.
+ */
+void emlog_config_unwatch(void);
+
+/**
+ * @name Shared-memory control page
+ * Layout of /dev/shm/emlog.NAME, shared by every process attached with
+ * emlog_shm_attach() and edited by the emlogctl tool. @c seq is both a
+ * seqlock (odd while a writer is updating) and the futex word attached
+ * processes sleep on; writers bump it and issue FUTEX_WAKE.
+ */
+/*@{*/
+#define EMLOG_SHM_MAGIC    0x474c4d45u /**< "EMLG" */
+#define EMLOG_SHM_VERSION  1u
+#define EMLOG_SHM_NAME_MAX 64  /**< Longest page name accepted */
+#define EMLOG_SHM_LEVEL    0x1u /**< @c level is set */
+#define EMLOG_SHM_TS       0x2u /**< @c timestamps is set */
+
+#ifndef EMLOG_SHM_MODE
+#    define EMLOG_SHM_MODE 0600u /**< Permissions of a page created by emlog */
+#endif
+
+typedef struct eml_shm_page
+{
+    uint32_t magic;      /**< EMLOG_SHM_MAGIC once initialized */
+    uint32_t version;    /**< EMLOG_SHM_VERSION */
+    uint32_t seq;        /**< Seqlock / futex word */
+    uint32_t flags;      /**< EMLOG_SHM_LEVEL | EMLOG_SHM_TS */
+    int32_t  level;      /**< Global minimum level */
+    int32_t  timestamps; /**< 0 or 1 */
+    uint32_t ncomp;      /**< Valid entries in @c comp */
+    struct
+    {
+        char    name[EMLOG_COMPONENT_NAME_MAX];
+        int32_t level;
+    } comp[EMLOG_MAX_COMPONENTS]; /**< Component overrides */
+} eml_shm_page_t;
+/*@}*/
+
+/**
+ * @brief Follow the shared control page /dev/shm/emlog.@p name.
+ *
+ * Maps (creating it if needed) the page and starts a thread that sleeps
+ * on its futex word. Whenever a writer (emlogctl, emlog_shm_set_*())
+ * publishes a change, every attached process wakes, takes a consistent
+ * snapshot and applies it: the global level, timestamps and component
+ * overrides. There are no signals, sockets or timers involved. Component
+ * overrides the page no longer lists are cleared; removing the global
+ * level or timestamps from the page leaves the current values in place.
+ *
+ * Whoever can write the page controls this process's levels, so it is
+ * created with mode EMLOG_SHM_MODE (owner only); see
+ * emlog_shm_attach_mode() to share it with a group.
+ *
+ * emlog_init() attaches automatically when EMLOG_SHM=NAME is set in the
+ * environment, with the octal mode in EMLOG_SHM_MODE when that is set.
+ *
+ * @param name Page name ([A-Za-z0-9_.-], < EMLOG_SHM_NAME_MAX bytes).
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_CONFLICT (already attached),
+ *         EML_PERM or EML_TEMP_UNAVAILABLE.
+ */
+eml_err_t emlog_shm_attach(const char* name);
+
+/**
+ * @brief emlog_shm_attach() with explicit page permissions.
+ *
+ * A page this process owns is set to @p mode, whether it was just
+ * created or already existed. A page owned by another user is refused
+ * with EML_PERM unless that user is root, so nobody else can plant a
+ * page for this process to follow.
+ *
+ * @param name Page name, as for emlog_shm_attach().
+ * @param mode Permission bits (0 = EMLOG_SHM_MODE); must include 0600
+ *             and nothing outside 0777.
+ * @return eml_err_t as emlog_shm_attach().
+ */
+eml_err_t emlog_shm_attach_mode(const char* name, unsigned mode);
+
+/**
+ * @brief Stop following the shared control page and unmap it.
+ */
+void emlog_shm_detach(void);
+
+/**
+ * @brief Publish a global level on page @p name (-1 removes it).
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_PERM or EML_TEMP_UNAVAILABLE.
+ */
+eml_err_t emlog_shm_set_level(const char* name, int level);
+
+/**
+ * @brief Publish a component override on page @p name (-1 removes it).
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_TEMP_RESOURCE (page full),
+ *         EML_PERM or EML_TEMP_UNAVAILABLE.
+ */
+eml_err_t emlog_shm_set_component_level(const char* name, const char* comp, int level);
+
+/**
+ * @brief Publish the timestamp switch on page @p name (-1 removes it).
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_PERM or EML_TEMP_UNAVAILABLE.
+ */
+eml_err_t emlog_shm_set_timestamps(const char* name, int on);
+
+/**
+ * @brief Copy a consistent snapshot of page @p name into @p out.
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_NOT_FOUND, EML_PERM or
+ *         EML_TRY_AGAIN (no consistent snapshot within about a second).
+ */
+eml_err_t emlog_shm_read(const char* name, eml_shm_page_t* out);
+
+/** @brief Bytes kept per line captured by emlog_set_backtrace(). */
+#define EMLOG_BACKTRACE_LINE_MAX 256
+
+/**
+ * @brief Keep recent below-level lines in a per-thread ring; flush on ERROR.
+ *
+ * Lines at or above @p capture_level that the level filters would drop are
+ * formatted into a bounded ring owned by the calling thread instead of
+ * being discarded. When the same thread logs EML_LEVEL_ERROR or above, the
+ * ring is written first between "backtrace" marker lines, then cleared.
+ * Captured lines are truncated to EMLOG_BACKTRACE_LINE_MAX bytes.
+ *
+ * @param capture_level Lowest level kept in the ring.
+ * @param lines Ring capacity per thread (0 disables capture).
+ * @return eml_err_t EML_OK, or EML_BAD_INPUT for an unknown level.
+ */
+eml_err_t emlog_set_backtrace(eml_level_t capture_level, unsigned lines);
+
+/**
+ * @name Flight recorder ring
+ *
+ * A process-wide, overwrite-oldest ring of recent lines that also keeps
+ * levels the output does not write. Writers reserve space with one
+ * atomic fetch-add on @c head, copy the line and then publish the
+ * record by storing its position in the record header, so logging
+ * threads never lock. The ring lives in a shared mapping laid out as
+ * below, which an outside reader can decode:
+ *
+ *     eml_ring_hdr_t | data[size]
+ *
+ * Records start on 16-byte boundaries of the data area (position
+ * modulo @c size): an eml_ring_rec_t followed by the text, padded to 16.
+ * A record is valid when its @c pos equals its own absolute position
+ * and it lies within the last @c size bytes before @c head. Records
+ * still being written or already overwritten fail that test and are
+ * skipped.
+ */
+/*@{*/
+#define EMLOG_RING_MAGIC     0x474e4952474c4d45ull /**< "EMLGRING" */
+#define EMLOG_RING_VERSION   1u
+#define EMLOG_RING_REC_MAGIC 0x5245u /**< "ER" */
+#define EMLOG_RING_LINE_MAX  4096    /**< Longer lines are truncated */
+#define EMLOG_RING_NAME_MAX  64      /**< Longest shm_name accepted */
+
+typedef struct eml_ring_hdr
+{
+    uint64_t magic;       /**< EMLOG_RING_MAGIC once initialized */
+    uint32_t version;     /**< EMLOG_RING_VERSION */
+    uint32_t hdr_bytes;   /**< Offset of the data area */
+    uint64_t size;        /**< Data bytes, a power of two */
+    uint64_t head;        /**< Bytes reserved so far (atomic) */
+    uint64_t pid;         /**< Process that opened the ring last */
+    uint64_t reserved[3]; /**< Zero */
+} eml_ring_hdr_t;
+
+typedef struct eml_ring_rec
+{
+    uint64_t pos;   /**< Absolute position of this record, stored last */
+    uint32_t len;   /**< Text bytes that follow */
+    uint16_t level; /**< eml_level_t of the line */
+    uint16_t magic; /**< EMLOG_RING_REC_MAGIC */
+} eml_ring_rec_t;
+
+typedef struct eml_ring_cfg
+{
+    size_t      bytes;    /**< Data area, rounded up to a power of two (0 = 4 MiB) */
+    eml_level_t level;    /**< Lowest level kept, even below the output level */
+    const char* shm_name; /**< Back the ring with /dev/shm/emlog-ring.NAME (NULL = memfd) */
+    int         crash_fd; /**< Dump here on SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT (0 = off) */
+} eml_ring_cfg_t;
+/*@}*/
+
+/**
+ * @brief Start recording lines into the flight recorder ring.
+ *
+ * Every line at or above @c level is copied into the ring, whether or
+ * not the level filters let it through to the writer. With @c shm_name
+ * the ring is a /dev/shm file that outlives the process; reopening a
+ * file of the same size appends to what it holds. Otherwise it lives in
+ * a memfd, which core dumps include by default (coredump_filter bit 1).
+ * Opening again replaces the current ring.
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_PERM or EML_TEMP_RESOURCE.
+ */
+eml_err_t emlog_ring_open(const eml_ring_cfg_t* cfg);
+
+/**
+ * @brief Stop recording and unmap the ring (a /dev/shm file is kept).
+ */
+void emlog_ring_close(void);
+
+/**
+ * @brief Write the lines held in the ring to @p fd, oldest first.
+ *
+ * Async-signal-safe: no locks or allocation, so it can run from a crash
+ * handler or watchdog. Lines overwritten while being copied are skipped.
+ *
+ * @return eml_err_t EML_OK, EML_NOT_FOUND (no ring) or EML_TEMP_UNAVAILABLE
+ *         (write failed).
+ */
+eml_err_t emlog_ring_dump(int fd);
+
+/**
+ * @brief Decode a ring image (header and data area) copied from a /dev/shm
+ *        file or a core dump and write its lines to @p fd.
+ *
+ * @return ssize_t Lines written, or -1 when @p image is not a complete ring.
+ */
+ssize_t emlog_ring_extract(const void* image, size_t len, int fd);
+
+/**
+ * @name Rotating file sink
+ * A built-in writer for emlog_set_writer() that appends to a file kept
+ * open with O_APPEND and rotates it by size and/or age. Renaming,
+ * reopening and retention cleanup run on a background thread; logging
+ * threads only ever see an atomic descriptor swap.
+ */
+/*@{*/
+typedef struct eml_file_sink eml_file_sink_t;
+
+typedef struct eml_file_sink_cfg
+{
+    const char* path;        /**< Active log file */
+    uint64_t    max_bytes;   /**< Rotate once the file reaches this size (0 = never) */
+    unsigned    interval_s;  /**< Rotate every interval_s seconds (0 = never) */
+    unsigned    keep;        /**< Rotated files kept as path.1 .. path.keep (0 = none) */
+    unsigned    mode;        /**< Creation mode (0 = 0644) */
+} eml_file_sink_cfg_t;
+/*@}*/
+
+/**
+ * @brief Open a rotating file sink and start its rotation thread.
+ *
+ * @code
+ * eml_file_sink_cfg_t cfg = {.path = "/var/log/app.log", .max_bytes = 64u << 20, .keep = 5};
+ * eml_file_sink_t*    sink;
+ * if(emlog_file_sink_open(&cfg, &sink) == EML_OK)
+ *     emlog_set_writer(emlog_file_sink_write, sink);
+ * @endcode
+ *
+ * @param cfg Sink configuration (path is copied).
+ * @param out Receives the sink handle.
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_PERM, EML_TEMP_RESOURCE or
+ *         EML_FATAL_IO.
+ */
+eml_err_t emlog_file_sink_open(const eml_file_sink_cfg_t* cfg, eml_file_sink_t** out);
+
+/**
+ * @brief eml_writer_fn that appends @p line plus a newline to the sink.
+ *
+ * @param user The eml_file_sink_t* passed to emlog_set_writer().
+ */
+ssize_t emlog_file_sink_write(eml_level_t lvl, const char* line, size_t n, void* user);
+
+/**
+ * @brief eml_writer_iov_fn variant of emlog_file_sink_write().
+ *
+ * Appends the pieces plus a newline with one writev() and no copy.
+ *
+ * @param user The eml_file_sink_t* passed to emlog_set_writer_iov().
+ */
+ssize_t emlog_file_sink_write_iov(eml_level_t lvl, const struct iovec* iov, int iovcnt,
+                                  void* user);
+
+/**
+ * @brief Ask the rotation thread to rotate now (returns immediately).
+ */
+void emlog_file_sink_rotate(eml_file_sink_t* sink);
+
+/**
+ * @brief eml_sink_sync_fn that fdatasync()s the sink's current file.
+ *
+ * @param user The eml_file_sink_t* registered as the sink's user.
+ */
+int emlog_file_sink_sync(void* user);
+
+/**
+ * @brief Stop the rotation thread, close the file and free the sink.
+ *
+ * Uninstall the sink with emlog_set_writer(NULL, NULL) first.
+ */
+void emlog_file_sink_close(eml_file_sink_t* sink);
+
+/**
+ * @name Memory-mapped append-only sink
+ * A writer for emlog_set_writer() whose hot path is an atomic fetch-add
+ * plus a memcpy into a shared file mapping. The file is a sequence of
+ * 8-byte aligned records:
+ *
+ *     uint32_t header;          // payload length | flag bits
+ *     char     payload[length]; // the line including its '\n'
+ *     // zero padding up to the next multiple of 8
+ *
+ * A header of 0 marks the end of the data written so far. A header
+ * without EMLOG_MMAP_COMMITTED is a reserved record whose copy has not
+ * finished (or was interrupted); its length is valid, so readers can
+ * skip it. Records flagged EMLOG_MMAP_PAD fill the space that would
+ * otherwise straddle a segment boundary and carry no data.
  */
-#define EML_PERR(tag, fmt, ...)                                         \
-    do                                                                  \
-    {                                                                   \
-        int __e = errno;                                                \
-        emlog_log_errno(EML_LEVEL_ERROR, tag, __e, fmt, ##__VA_ARGS__); \
-    } while(0)
+/*@{*/
+#define EMLOG_MMAP_COMMITTED 0x80000000u /**< Record payload is complete */
+#define EMLOG_MMAP_PAD       0x40000000u /**< Filler record, no payload */
+#define EMLOG_MMAP_LEN_MASK  0x3fffffffu /**< Payload length bits */
+
+typedef struct eml_mmap_sink eml_mmap_sink_t;
+
+typedef struct eml_mmap_sink_cfg
+{
+    const char* path;          /**< Log file (appended to when it exists) */
+    size_t      segment_bytes; /**< Mapping/preallocation unit (0 = 16 MiB) */
+    unsigned    sync_ms;       /**< Writeback interval (0 = 1000) */
+    unsigned    mode;          /**< Creation mode (0 = 0644) */
+} eml_mmap_sink_cfg_t;
+/*@}*/
+
+/**
+ * @brief Open a memory-mapped sink and start its helper thread.
+ *
+ * The helper preallocates (fallocate) and maps the next segment before
+ * writers reach it, starts writeback of written ranges every sync_ms,
+ * and unmaps segments writers have left behind. On close the file is
+ * truncated to the end of the last record.
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_PERM, EML_TEMP_RESOURCE or
+ *         EML_FATAL_IO.
+ */
+eml_err_t emlog_mmap_sink_open(const eml_mmap_sink_cfg_t* cfg, eml_mmap_sink_t** out);
+
+/**
+ * @brief eml_writer_fn that appends @p line plus a newline as one record.
+ *
+ * @param user The eml_mmap_sink_t* passed to emlog_set_writer().
+ */
+ssize_t emlog_mmap_sink_write(eml_level_t lvl, const char* line, size_t n, void* user);
+
+/**
+ * @brief Number of lines dropped (record too large or mapping failure).
+ */
+uint64_t emlog_mmap_sink_dropped(const eml_mmap_sink_t* sink);
+
+/**
+ * @brief Stop the helper, unmap, trim the file and free the sink.
+ *
+ * Uninstall the sink with emlog_set_writer(NULL, NULL) first.
+ */
+void emlog_mmap_sink_close(eml_mmap_sink_t* sink);
+
+/**
+ * @name Compressing file sink
+ *
+ * Lines are gathered into blocks that a background thread compresses
+ * with the built-in LZ4-format block compressor and appends as frames:
+ *
+ *     uint32_t magic;    // EMLOG_LZ_MAGIC
+ *     uint32_t flags;    // EMLOG_LZ_STORED: data is the raw block
+ *     uint32_t raw_len;  // bytes after decompression
+ *     uint32_t data_len; // bytes of data that follow the header
+ *     uint32_t check;    // FNV-1a 32 of the raw block
+ *     uint8_t  data[data_len];
+ *
+ * All fields are little-endian. Each frame decodes on its own, so a
+ * file cut short by a crash loses at most its last frame. The
+ * emlogcat tool turns such files back into text.
+ */
+/*@{*/
+#define EMLOG_LZ_MAGIC     0x5a4c4d45u /**< "EMLZ" */
+#define EMLOG_LZ_STORED    0x1u        /**< Block did not compress */
+#define EMLOG_LZ_HEADER    20u         /**< Frame header bytes */
+#define EMLOG_LZ_BLOCK_MAX (4u << 20)  /**< Largest block_bytes accepted */
+
+typedef struct eml_lz_sink eml_lz_sink_t;
+
+typedef struct eml_lz_sink_cfg
+{
+    const char* path;        /**< Output file (appended to) */
+    size_t      block_bytes; /**< Uncompressed block size (0 = 64 KiB) */
+    unsigned    blocks;      /**< Blocks in flight (0 = 4, minimum 2) */
+    unsigned    flush_ms;    /**< Compress a partial block after this (0 = 1000) */
+    unsigned    mode;        /**< Creation mode (0 = 0644) */
+} eml_lz_sink_cfg_t;
+/*@}*/
+
+/**
+ * @brief Worst-case compressed size for @p n input bytes.
+ */
+size_t emlog_lz_bound(size_t n);
+
+/**
+ * @brief Compress @p n bytes into the LZ4 block format.
+ *
+ * @return size_t Compressed size, or 0 when @p cap is too small
+ *         (emlog_lz_bound(n) always suffices).
+ */
+size_t emlog_lz_compress(const void* src, size_t n, void* dst, size_t cap);
+
+/**
+ * @brief Decompress an LZ4 block.
+ *
+ * @return ssize_t Decompressed size, or -1 when the input is corrupt or
+ *         does not fit in @p cap.
+ */
+ssize_t emlog_lz_decompress(const void* src, size_t n, void* dst, size_t cap);
+
+/**
+ * @brief FNV-1a 32 checksum used in frame headers.
+ */
+uint32_t emlog_lz_check(const void* p, size_t n);
+
+/**
+ * @brief Open a compressing sink and start its compressor thread.
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_PERM, EML_TEMP_RESOURCE or
+ *         EML_FATAL_IO.
+ */
+eml_err_t emlog_lz_sink_open(const eml_lz_sink_cfg_t* cfg, eml_lz_sink_t** out);
+
+/**
+ * @brief eml_writer_fn that appends @p line plus a newline to the open block.
+ *
+ * Only a memcpy under a short mutex; when every block is waiting for
+ * the compressor the line is dropped and counted.
+ */
+ssize_t emlog_lz_sink_write(eml_level_t lvl, const char* line, size_t n, void* user);
+
+/**
+ * @brief Lines dropped because no block was free.
+ */
+uint64_t emlog_lz_sink_dropped(const eml_lz_sink_t* sink);
+
+/**
+ * @brief Compress what is buffered, stop the thread and free the sink.
+ *
+ * Uninstall the sink (emlog_set_writer(NULL, NULL) or
+ * emlog_sink_remove()) first.
+ */
+void emlog_lz_sink_close(eml_lz_sink_t* sink);
+
+/**
+ * @name Direct-I/O file sink
+ * Appends lines to a file opened with O_DIRECT so log volume does not
+ * push other data out of the page cache. Lines are packed back to back
+ * into aligned blocks; a background thread writes each full block at
+ * its file offset. A partial tail is written zero-padded to
+ * EMLOG_DIRECT_ALIGN after flush_ms and on close, then the file is
+ * truncated back to its real length; the tail stays in memory and is
+ * rewritten in place as it grows. A crash between the two steps can
+ * leave up to EMLOG_DIRECT_ALIGN - 1 NUL bytes at the end of the file.
+ */
+/*@{*/
+#define EMLOG_DIRECT_ALIGN 4096u /**< Buffer, offset and length alignment */
+
+typedef struct eml_direct_sink eml_direct_sink_t;
+
+typedef struct eml_direct_sink_cfg
+{
+    const char* path;        /**< Log file (appended to) */
+    size_t      block_bytes; /**< Write unit, a multiple of EMLOG_DIRECT_ALIGN (0 = 64 KiB) */
+    unsigned    blocks;      /**< Blocks in flight (0 = 4, minimum 2) */
+    unsigned    flush_ms;    /**< Write a partial tail after this (0 = 1000) */
+    unsigned    mode;        /**< Creation mode (0 = 0644) */
+    bool        buffered;    /**< Skip O_DIRECT and use the page cache (for comparison) */
+} eml_direct_sink_cfg_t;
+/*@}*/
+
+/**
+ * @brief Open a direct-I/O sink and start its writer thread.
+ *
+ * When the file system refuses O_DIRECT the sink falls back to buffered
+ * writes; emlog_direct_sink_is_direct() tells which one is in use.
+ *
+ * @code
+ * eml_direct_sink_cfg_t cfg = {.path = "/var/log/app.log", .blocks = 16};
+ * eml_direct_sink_t*    ds;
+ * if(emlog_direct_sink_open(&cfg, &ds) == EML_OK)
+ *     emlog_set_writer(emlog_direct_sink_write, ds);
+ * @endcode
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, EML_PERM, EML_TEMP_RESOURCE or
+ *         EML_FATAL_IO.
+ */
+eml_err_t emlog_direct_sink_open(const eml_direct_sink_cfg_t* cfg, eml_direct_sink_t** out);
+
+/**
+ * @brief eml_writer_fn that appends @p line plus a newline.
+ *
+ * Lines may span blocks. A line is dropped and counted when the writer
+ * thread is so far behind that not enough free blocks remain for it.
+ *
+ * @param user The eml_direct_sink_t* passed to emlog_set_writer().
+ */
+ssize_t emlog_direct_sink_write(eml_level_t lvl, const char* line, size_t n, void* user);
+
+/**
+ * @brief Number of lines dropped because no block was free.
+ */
+uint64_t emlog_direct_sink_dropped(const eml_direct_sink_t* sink);
+
+/**
+ * @brief Whether the file is really open with O_DIRECT.
+ */
+bool emlog_direct_sink_is_direct(const eml_direct_sink_t* sink);
+
+/**
+ * @brief Write what is buffered, trim the file, stop the thread and free
+ * the sink.
+ *
+ * Uninstall the sink (emlog_set_writer(NULL, NULL) or
+ * emlog_sink_remove()) first.
+ */
+void emlog_direct_sink_close(eml_direct_sink_t* sink);
+
+/**
+ * @name Sink registry
+ *
+ * Up to EMLOG_MAX_SINKS writers can receive every line at once, each
+ * with its own level mask and format. Lines are formatted once; every
+ * sink gets a pointer into the same buffer. While at least one sink is
+ * registered the sinks replace the writer installed with
+ * emlog_set_writer() and the default descriptors; removing the last
+ * sink restores them.
+ *
+ * Isolation depends on how a sink is delivered to:
+ * - A sink with @c queue_len > 0 gets its own thread and a bounded queue
+ *   of shared references to the formatted line. It never holds up the
+ *   logging threads or the other sinks: when it falls behind, only its
+ *   own queue fills, and lines that do not fit are counted as dropped
+ *   for that sink alone.
+ * - A sink with @c queue_len == 0 is called by the logging thread itself,
+ *   after the logger lock is released and before the logging call
+ *   returns. Calls are serialized per sink, and each thread's lines
+ *   arrive in the order it logged them. While a call runs, only threads
+ *   logging lines in the sink's @c level_mask wait for it; other
+ *   threads and sinks carry on. A call that takes longer than @c budget_ms benches the
+ *   sink for EMLOG_SINK_BENCH_MS: its lines are dropped and counted
+ *   instead of written, then it is called again. This bounds how often
+ *   a slow sink stalls its callers, not how long one call can take; a
+ *   writer that can block indefinitely must be queued. Lines a sink
+ *   logs from inside its own call are not passed back to it.
+ */
+/*@{*/
+#define EMLOG_MAX_SINKS 8
+
+#ifndef EMLOG_SINK_BUDGET_MS
+#    define EMLOG_SINK_BUDGET_MS 100u /**< Default @c budget_ms of a synchronous sink */
+#endif
+
+#ifndef EMLOG_SINK_BENCH_MS
+#    define EMLOG_SINK_BENCH_MS 1000u /**< How long an over-budget sink is skipped */
+#endif
+
+#define EML_SINK_FMT_LINE 0u /**< Header and message */
+#define EML_SINK_FMT_MSG  1u /**< Message only */
+
+/** @brief One formatted line and the pieces it was built from. */
+typedef struct eml_record
+{
+    eml_level_t level;   /**< Line level */
+    const char* comp;    /**< Component, or NULL */
+    const char* file;    /**< Call-site file, or NULL when unknown */
+    const char* func;    /**< Call-site function, or NULL */
+    unsigned    line;    /**< Call-site line (0 when unknown) */
+    uint64_t    tid;     /**< Logging thread id */
+    uint64_t    ts_ns;   /**< CLOCK_REALTIME ns when the line reached the sinks */
+    const char* text;    /**< Full line without '\n' */
+    size_t      hdr_len; /**< Header bytes at the start of @c text */
+    size_t      len;     /**< Bytes in @c text */
+} eml_record_t;
+
+/** @brief Structured sink callback; return < 0 on failure. */
+typedef ssize_t (*eml_record_fn)(const eml_record_t* rec, void* user);
+
+/**
+ * @brief Optional batch boundary for a sink.
+ *
+ * Called after each line for a synchronous sink, and whenever an async
+ * sink's queue runs empty, so a batching writer can buffer lines and
+ * send them together without adding latency when the logger is idle.
+ */
+typedef void (*eml_sink_flush_fn)(void* user);
+
+/** @brief Make everything the sink has written so far durable; return < 0 on failure. */
+typedef int (*eml_sink_sync_fn)(void* user);
+
+/**
+ * @brief Group-commit durability policy for a sink (all zero = none).
+ *
+ * A sink with @c fn set gets a syncer thread that calls it (typically an
+ * fdatasync()) when any trigger fires:
+ * - @c every_ms after the oldest unsynced line was written
+ * - once @c every_bytes are unsynced
+ * - as soon as a line in @c level_mask is written
+ *
+ * A call covers every line written before it started, so concurrent
+ * callers share one sync instead of issuing one each, and writers never
+ * wait for a sync in progress. With @c wait set, a caller that logs a
+ * @c level_mask line returns only after a sync covering it has finished.
+ * This applies to synchronous sinks only; a queued sink triggers the
+ * sync but never holds up the caller.
+ */
+typedef struct eml_sync_policy
+{
+    eml_sink_sync_fn fn;          /**< Sync hook, NULL for no policy */
+    unsigned         every_ms;    /**< Age limit of unsynced lines (0 = off) */
+    uint64_t         every_bytes; /**< Unsynced byte limit (0 = off) */
+    unsigned         level_mask;  /**< Sync right away for these levels (EML_LEVEL_MASK_FROM) */
+    bool             wait;        /**< Callers of @c level_mask lines wait for their sync */
+} eml_sync_policy_t;
+
+typedef struct eml_sink_cfg
+{
+    eml_writer_fn     fn;         /**< Writer (receives the line without '\n') */
+    eml_record_fn     record;     /**< Structured writer, used instead of @c fn */
+    eml_sink_flush_fn flush;      /**< Batch boundary hook (may be NULL) */
+    void*             user;       /**< Passed to @c fn, @c record and @c flush */
+    unsigned          level_mask; /**< EML_LEVEL_MASK() bits (0 = all levels) */
+    unsigned          format;     /**< EML_SINK_FMT_* */
+    unsigned          queue_len;  /**< 0 = synchronous, else async queue depth */
+    unsigned          budget_ms;  /**< Synchronous call limit (0 = EMLOG_SINK_BUDGET_MS) */
+    eml_sync_policy_t durability; /**< Group-commit policy (zero = none) */
+} eml_sink_cfg_t;
+
+typedef struct eml_sink_stats
+{
+    uint64_t written;     /**< Lines the writer accepted */
+    uint64_t errors;      /**< Lines the writer returned < 0 for */
+    uint64_t dropped;     /**< Lines lost to a full queue, a bench or allocation failure */
+    uint64_t overruns;    /**< Synchronous calls that took longer than the budget */
+    uint64_t syncs;       /**< Durability hook calls */
+    uint64_t sync_errors; /**< Durability hook failures */
+} eml_sink_stats_t;
+/*@}*/
+
+/**
+ * @brief Register a sink.
+ *
+ * Exactly one of @c fn and @c record must be set; @c format only
+ * applies to @c fn.
+ *
+ * @param cfg Sink description (copied).
+ * @param id Receives the handle for emlog_sink_remove()/emlog_sink_stats().
+ * @return eml_err_t EML_OK, EML_BAD_INPUT (also for durability triggers
+ *         without a hook, or a hook without triggers), or EML_TEMP_RESOURCE
+ *         when all EMLOG_MAX_SINKS slots are taken or a thread cannot start.
+ */
+eml_err_t emlog_sink_add(const eml_sink_cfg_t* cfg, int* id);
+
+/**
+ * @brief Unregister a sink; an async sink drains its queue first.
+ *
+ * A synchronous sink is released once the lines already handed to it
+ * have been written, so this must not be called from a sink callback.
+ *
+ * A sink with a durability policy gets a final sync before it is
+ * released.
+ *
+ * @return eml_err_t EML_OK, or EML_NOT_FOUND for an unknown id.
+ */
+eml_err_t emlog_sink_remove(int id);
+
+/**
+ * @brief Read a sink's counters.
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT, or EML_NOT_FOUND.
+ */
+eml_err_t emlog_sink_stats(int id, eml_sink_stats_t* out);
+
+/**
+ * @brief eml_writer_fn that writes the line plus a newline to a descriptor.
+ *
+ * Pass the descriptor as @p user: @c (void*)(intptr_t)STDERR_FILENO.
+ */
+ssize_t emlog_fd_sink_write(eml_level_t lvl, const char* line, size_t n, void* user);
+
+/**
+ * @brief eml_sink_sync_fn for emlog_fd_sink_write(): fdatasync() the descriptor.
+ *
+ * @code
+ * eml_sink_cfg_t sc = {.fn = emlog_fd_sink_write, .user = (void*)(intptr_t)fd,
+ *                      .durability = {.fn = emlog_fd_sink_sync, .every_ms = 200,
+ *                                     .level_mask = EML_LEVEL_MASK_FROM(EML_LEVEL_ERROR),
+ *                                     .wait = true}};
+ * @endcode
+ */
+int emlog_fd_sink_sync(void* user);
+
+/**
+ * @name journald sink
+ *
+ * Sends each record to journald using its native protocol over an
+ * AF_UNIX datagram socket, so fields arrive structured instead of being
+ * parsed out of captured text: MESSAGE (the message without emlog's
+ * header), PRIORITY, SYSLOG_IDENTIFIER, TID, EMLOG_COMPONENT and, for
+ * EML_* call sites, CODE_FILE, CODE_LINE and CODE_FUNC. The datagram is
+ * gathered with sendmsg() from iovecs pointing at the record's pieces.
+ * A record too large for one datagram is written to a sealed memfd
+ * whose descriptor is passed instead (Linux only).
+ */
+/*@{*/
+#define EMLOG_JOURNAL_SOCKET "/run/systemd/journal/socket"
+
+typedef struct eml_journal_sink eml_journal_sink_t;
+
+typedef struct eml_journal_sink_cfg
+{
+    const char* socket_path;  /**< NULL = EMLOG_JOURNAL_SOCKET */
+    const char* identifier;   /**< SYSLOG_IDENTIFIER (NULL = program name) */
+    size_t      max_datagram; /**< Larger records go through a memfd (0 = no limit) */
+} eml_journal_sink_cfg_t;
+/*@}*/
+
+/**
+ * @brief Create a journald sink.
+ *
+ * Register it with emlog_sink_add() using emlog_journal_sink_record as
+ * the @c record callback.
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT (path too long) or
+ *         EML_TEMP_RESOURCE.
+ */
+eml_err_t emlog_journal_sink_open(const eml_journal_sink_cfg_t* cfg, eml_journal_sink_t** out);
+
+/**
+ * @brief eml_record_fn that sends @p rec to journald.
+ *
+ * @return ssize_t Bytes sent, or -1 (errno set) when the journal is not
+ *         reachable or the record cannot be sent.
+ */
+ssize_t emlog_journal_sink_record(const eml_record_t* rec, void* user);
+
+/**
+ * @brief Close the socket and free the sink (remove it from the registry first).
+ */
+void emlog_journal_sink_close(eml_journal_sink_t* sink);
+
+/**
+ * @name syslog sink
+ *
+ * Formats records as RFC 5424 messages and sends them to a local syslog
+ * daemon (rsyslog, syslog-ng) over a Unix datagram socket:
+ *
+ *     <PRI>1 TIMESTAMP HOST APP PROCID MSGID - MSG
+ *
+ * PRI is derived from the configured facility and the level (DBG=7,
+ * INFO=6, WARN=4, ERROR=3, CRIT=2), MSGID is the component and MSG the
+ * message without emlog's header. The "<PRI>1 " and " HOST APP PROCID "
+ * parts are built once at open. Records are buffered and sent with one
+ * sendmmsg() per batch; register the sink with emlog_syslog_sink_flush
+ * as the flush hook and a queue_len so batches form under load.
+ */
+/*@{*/
+#define EMLOG_SYSLOG_SOCKET    "/dev/log"
+#define EMLOG_SYSLOG_BATCH_MAX 64
+
+typedef struct eml_syslog_sink eml_syslog_sink_t;
+
+typedef struct eml_syslog_sink_cfg
+{
+    const char* socket_path; /**< NULL = EMLOG_SYSLOG_SOCKET */
+    const char* hostname;    /**< HOSTNAME (NULL = gethostname()) */
+    const char* app_name;    /**< APP-NAME (NULL = program name) */
+    unsigned    facility;    /**< Facility code 1..23 (0 = 1, user) */
+    unsigned    batch;       /**< Records per send (0 = 32, max EMLOG_SYSLOG_BATCH_MAX) */
+} eml_syslog_sink_cfg_t;
+/*@}*/
+
+/**
+ * @brief Create a syslog sink.
+ *
+ * The daemon does not need to be running yet: the socket is (re)connected
+ * lazily, at most every 100 ms, and never blocks the caller.
+ *
+ * @code
+ * eml_syslog_sink_t* ss;
+ * emlog_syslog_sink_open(NULL, &ss);
+ * eml_sink_cfg_t sc = {.record = emlog_syslog_sink_record,
+ *                      .flush  = emlog_syslog_sink_flush,
+ *                      .user   = ss, .queue_len = 1024};
+ * emlog_sink_add(&sc, &id);
+ * @endcode
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT or EML_TEMP_RESOURCE.
+ */
+eml_err_t emlog_syslog_sink_open(const eml_syslog_sink_cfg_t* cfg, eml_syslog_sink_t** out);
+
+/** @brief eml_record_fn that queues @p rec in the current batch. */
+ssize_t emlog_syslog_sink_record(const eml_record_t* rec, void* user);
+
+/** @brief eml_sink_flush_fn that sends the current batch. */
+void emlog_syslog_sink_flush(void* user);
+
+/**
+ * @brief Records sent / dropped (daemon unreachable or socket full).
+ */
+uint64_t emlog_syslog_sink_sent(const eml_syslog_sink_t* sink);
+uint64_t emlog_syslog_sink_dropped(const eml_syslog_sink_t* sink);
+
+/**
+ * @brief Send what is still buffered, close the socket and free the sink.
+ *
+ * Remove the sink from the registry first.
+ */
+void emlog_syslog_sink_close(eml_syslog_sink_t* sink);
+
+/**
+ * @name Batch sink
+ *
+ * Collects records and hands them to one callback in batches, so a
+ * writer that forwards lines to another process pays one call (and one
+ * syscall) per batch instead of per line. A batch is handed over when
+ * it holds @c max_records records, when the next record would push it
+ * past @c max_bytes, or @c linger_ms after its first record arrived,
+ * whichever comes first. Each record's text and component are copied
+ * into the batch; @c file and @c func point at the call site's static
+ * strings.
+ */
+/*@{*/
+typedef struct eml_batch_sink eml_batch_sink_t;
+
+/**
+ * @brief Batch writer callback.
+ *
+ * Runs without the sink's lock, one batch at a time and in order, so
+ * records keep collecting in a second buffer while it works. It may log
+ * through emlog; those lines are not passed back to its own batch sink
+ * (they count as dropped there).
+ *
+ * @param recs Records in logging order; valid only during the call.
+ * @param n Number of records (at least 1).
+ * @param user User pointer from eml_batch_sink_cfg_t.
+ * @return ssize_t Negative when the batch could not be delivered.
+ */
+typedef ssize_t (*eml_batch_fn)(const eml_record_t* recs, size_t n, void* user);
+
+typedef struct eml_batch_sink_cfg
+{
+    eml_batch_fn fn;          /**< Receives each batch */
+    void*        user;        /**< Passed to @c fn */
+    unsigned     max_records; /**< Records per batch (0 = 64) */
+    size_t       max_bytes;   /**< Copied text per batch (0 = 64 KiB) */
+    unsigned     linger_ms;   /**< Age of the oldest buffered record (0 = 50 ms) */
+} eml_batch_sink_cfg_t;
+/*@}*/
+
+/**
+ * @brief Create a batch sink and its linger thread.
+ *
+ * Register it with emlog_sink_add() using emlog_batch_sink_record as the
+ * @c record callback. A record larger than @c max_bytes is passed on by
+ * itself without being copied.
+ *
+ * @code
+ * eml_batch_sink_cfg_t bc = {.fn = forward, .user = conn, .max_records = 256};
+ * eml_batch_sink_t*    bs;
+ * emlog_batch_sink_open(&bc, &bs);
+ * eml_sink_cfg_t sc = {.record = emlog_batch_sink_record, .user = bs};
+ * emlog_sink_add(&sc, &id);
+ * @endcode
+ *
+ * @return eml_err_t EML_OK, EML_BAD_INPUT or EML_TEMP_RESOURCE.
+ */
+eml_err_t emlog_batch_sink_open(const eml_batch_sink_cfg_t* cfg, eml_batch_sink_t** out);
+
+/** @brief eml_record_fn that appends @p rec to the current batch. */
+ssize_t emlog_batch_sink_record(const eml_record_t* rec, void* user);
+
+/**
+ * @brief Hand over the current batch now.
+ *
+ * Usable as the eml_sink_flush_fn of a queued sink, which then sends
+ * whenever its queue runs dry instead of waiting out @c linger_ms.
+ */
+void emlog_batch_sink_flush(void* user);
+
+/**
+ * @brief Batches handed over / records in batches the callback failed.
+ */
+uint64_t emlog_batch_sink_batches(const eml_batch_sink_t* sink);
+uint64_t emlog_batch_sink_failed(const eml_batch_sink_t* sink);
+
+/**
+ * @brief Hand over what is still buffered, stop the thread and free the sink.
+ *
+ * Remove the sink from the registry first.
+ */
+void emlog_batch_sink_close(eml_batch_sink_t* sink);
+
+/**
+ * @brief Core printf-style logger.
+ *
+ * The logger is thread-safe and will drop messages whose level is below
+ * the current minimum. The @p comp argument is an optional component/tag
+ * string; pass NULL or "-" if not applicable.
+ *
+ * @note This function is declared with a printf attribute so format
+ *       string mismatches are detected at compile time when supported.
+ *
+ * @param level Log level for this message.
+ * @param comp Component/tag string (may be NULL).
+ * @param fmt printf-style format string followed by arguments.
+ */
+void emlog_log(eml_level_t level, const char* comp, const char* fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Log a message that includes formatted errno text.
+ *
+ * This composes the formatted message from @p fmt and appends the
+ * strerror() text for @p err. It is safe to call from signal handlers as
+ * long as the C library implementations used are async-signal-safe for
+ * the invoked routines (most are not); prefer using it from normal code.
+ *
+ * @param level Log level.
+ * @param comp Optional component/tag.
+ * @param err errno value to format (e.g., errno).
+ * @param fmt printf-style format string and args.
+ */
+void emlog_log_errno(eml_level_t level, const char* comp, int err, const char* fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+/**
+ * @brief Compile-time minimum level for the EML_* convenience macros.
+ *
+ * Call sites below this level expand to an expression that is never
+ * evaluated: neither emlog_log() nor any of the macro arguments are
+ * executed, and the optimizer drops the call site (including its format
+ * string) from the object file. Arguments are still type-checked, so a
+ * stripped call site cannot bit-rot.
+ *
+ * The value is numeric so it can be tested by the preprocessor:
+ * 0 = DBG (default, nothing stripped), 1 = INFO, 2 = WARN, 3 = ERROR,
+ * 4 = CRIT, 5 = strip every macro call site. The CMake cache variable of
+ * the same name sets it for the library and every target linking it.
+ * Direct emlog_log() calls are not affected.
+ */
+#ifndef EMLOG_COMPILE_MIN_LEVEL
+#    define EMLOG_COMPILE_MIN_LEVEL 0
+#endif
+
+/**
+ * @brief Lowest level any runtime filter currently accepts (read-only).
+ *
+ * Maintained by the library as the minimum of the global level and every
+ * per-component override. The EML_* macros compare against it inline so a
+ * disabled statement costs one relaxed load and one predictable branch:
+ * its arguments are not evaluated and the library is not entered. Never
+ * write to it; use emlog_set_level() and friends.
+ */
+extern int emlog__active_level;
+
+/**
+ * @brief Out-of-line slow path used by the EML_* macros (do not call directly).
+ *
+ * Behaves like emlog_log(); it is marked cold and noinline so compilers
+ * keep the enabled-path call out of the caller's hot code.
+ */
+void emlog__emit(eml_level_t level, const char* comp, const char* fmt, ...)
+    __attribute__((format(printf, 3, 4), cold, noinline));
+
+/**
+ * @brief Static control block describing one EML_* call site.
+ *
+ * On ELF targets built with GCC or Clang every EML_* macro expansion
+ * emits one of these into the "emlog_callsites" section. The library
+ * finds them at load time and keeps @c enabled in sync with the runtime
+ * level, so a disabled statement costs a single byte load. Sites can also
+ * be switched on individually with emlog_callsite_enable() without
+ * touching the global level. All fields except @c enabled and @c flags
+ * are immutable; both of those are owned by the library.
+ */
+typedef struct eml_callsite
+{
+    const char*   file;    /**< __FILE__ of the call site */
+    const char*   func;    /**< __func__ of the enclosing function */
+    const char*   fmt;     /**< Format string, or NULL when not a literal */
+    const char*   comp;    /**< Component, or NULL when not a literal */
+    void*         slot;    /**< Library-private: resolved component entry */
+    unsigned      gen;     /**< Library-private: table generation of a miss */
+    unsigned      line;    /**< __LINE__ of the call site */
+    unsigned char level;   /**< eml_level_t of the statement */
+    unsigned char enabled; /**< Non-zero when the statement must run */
+    unsigned char flags;   /**< Library-private state bits */
+} eml_callsite_t;
+
+/**
+ * @brief Force matching call sites on, regardless of runtime levels.
+ *
+ * @p spec has the form "FILE_GLOB[:LINE[-LINE]]". The glob is matched
+ * with fnmatch() against the recorded __FILE__ and against every suffix
+ * following a '/', so "net/\*.c:120-200" selects lines 120..200 of every
+ * .c file in a "net" directory. The rule also applies to call sites of
+ * modules loaded later (e.g. via dlopen()).
+ *
+ * @param spec Call-site selector.
+ * @return int Number of currently known call sites matched, or -1 (errno
+ *         set to EINVAL or ENOMEM) when @p spec is malformed or cannot be
+ *         recorded.
+ */
+int emlog_callsite_enable(const char* spec);
+
+/**
+ * @brief Undo emlog_callsite_enable() for matching call sites.
+ *
+ * Matching sites fall back to the regular level filters.
+ *
+ * @param spec Call-site selector (same syntax as emlog_callsite_enable()).
+ * @return int Number of call sites matched, or -1 on error.
+ */
+int emlog_callsite_disable(const char* spec);
+
+/**
+ * @brief Register a module's call-site section (called from emlog.h).
+ *
+ * Every translation unit including emlog.h registers the section of its
+ * own module from a constructor; duplicate registrations are ignored.
+ */
+void emlog__callsites_register(eml_callsite_t* start, eml_callsite_t* stop);
+
+/** @brief Call-site aware slow path of the EML_* macros (do not call directly). */
+void emlog__emit_site(eml_callsite_t* cs, const char* comp, const char* fmt, ...)
+    __attribute__((format(printf, 3, 4), cold, noinline));
+
+/** @brief Call-site aware slow path of EML_PERR() (do not call directly). */
+void emlog__emit_errno_site(eml_callsite_t* cs, const char* comp, int err, const char* fmt, ...)
+    __attribute__((format(printf, 4, 5), cold, noinline));
+
+/* Internal helpers behind the EML_* macros (do not use directly). */
+#define EML__ENABLED(lvl) \
+    __builtin_expect((int)(lvl) >= __atomic_load_n(&emlog__active_level, __ATOMIC_RELAXED), 0)
+#define EML__STRIP(lvl, tag, ...) ((void)(0 && (emlog_log(lvl, tag, __VA_ARGS__), 0)))
+#define EML__FIRST(...)           EML__FIRST_(__VA_ARGS__, 0)
+#define EML__FIRST_(a, ...)       a
+
+#if defined(__ELF__) && (defined(__GNUC__) || defined(__clang__)) && !defined(EMLOG_NO_CALLSITES)
+#    define EMLOG_HAVE_CALLSITES 1
+#    ifdef __cplusplus
+#        define EML__CS_LIT(f) (__builtin_constant_p(f) ? (f) : nullptr)
+#    else
+#        define EML__CS_LIT(f) \
+            __builtin_choose_expr(__builtin_constant_p(f), (f), (const char*)0)
+#    endif
+/* Sites start enabled so a statement reached before its module registered
+ * still goes through the precise filters in the library. The explicit
+ * alignment stops the compiler from padding large statics to 32 bytes,
+ * which would leave holes between the section's entries. */
+#    define EML__CS_ATTR \
+        __attribute__((section("emlog_callsites"), used, aligned(__alignof__(eml_callsite_t))))
+#    define EML__CS_DEFINE(name, lvl, tag, f)                                     \
+        static eml_callsite_t EML__CS_ATTR name = {                               \
+            __FILE__, __func__, EML__CS_LIT(f), EML__CS_LIT(tag), 0, 0, __LINE__, \
+            (unsigned char)(lvl), 1, 0}
+#    define EML__LOG(lvl, tag, ...)                                                   \
+        do                                                                            \
+        {                                                                             \
+            EML__CS_DEFINE(eml__cs, lvl, tag, EML__FIRST(__VA_ARGS__));               \
+            if(__builtin_expect(__atomic_load_n(&eml__cs.enabled, __ATOMIC_RELAXED), 0)) \
+                emlog__emit_site(&eml__cs, tag, __VA_ARGS__);                         \
+        } while(0)
+
+extern eml_callsite_t __start_emlog_callsites[] __attribute__((weak, visibility("hidden")));
+extern eml_callsite_t __stop_emlog_callsites[] __attribute__((weak, visibility("hidden")));
+
+/* One constructor per translation unit hands this module's section to the
+ * library; the linker-provided bounds are per module (hidden), and the
+ * library drops duplicates. */
+static void __attribute__((constructor, used)) emlog__register_module_callsites(void)
+{
+    emlog__callsites_register(__start_emlog_callsites, __stop_emlog_callsites);
+}
+#else
+#    define EML__LOG(lvl, tag, ...) \
+        ((void)(EML__ENABLED(lvl) && (emlog__emit(lvl, tag, __VA_ARGS__), 0)))
+#endif
+
+/* Short logging macros for easy call-sites. These check the runtime level
+ * (or their call-site switch) inline and only then evaluate their arguments
+ * and call into the library.
+ * Example: EML_INFO("main", "listening on %d", port);
+ */
+#if EMLOG_COMPILE_MIN_LEVEL <= 0
+#    define EML_DBG(tag, ...) EML__LOG(EML_LEVEL_DBG, tag, __VA_ARGS__)
+#else
+#    define EML_DBG(tag, ...) EML__STRIP(EML_LEVEL_DBG, tag, __VA_ARGS__)
+#endif
+#if EMLOG_COMPILE_MIN_LEVEL <= 1
+#    define EML_INFO(tag, ...) EML__LOG(EML_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#    define EML_INFO(tag, ...) EML__STRIP(EML_LEVEL_INFO, tag, __VA_ARGS__)
+#endif
+#if EMLOG_COMPILE_MIN_LEVEL <= 2
+#    define EML_WARN(tag, ...) EML__LOG(EML_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#    define EML_WARN(tag, ...) EML__STRIP(EML_LEVEL_WARN, tag, __VA_ARGS__)
+#endif
+#if EMLOG_COMPILE_MIN_LEVEL <= 3
+#    define EML_ERROR(tag, ...) EML__LOG(EML_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#    define EML_ERROR(tag, ...) EML__STRIP(EML_LEVEL_ERROR, tag, __VA_ARGS__)
+#endif
+#if EMLOG_COMPILE_MIN_LEVEL <= 4
+#    define EML_CRIT(tag, ...) EML__LOG(EML_LEVEL_CRIT, tag, __VA_ARGS__)
+#else
+#    define EML_CRIT(tag, ...) EML__STRIP(EML_LEVEL_CRIT, tag, __VA_ARGS__)
+#endif
+
+/**
+ * @brief Per-call-site token bucket used by the EML_*_RL macros.
+ *
+ * Zero-initialized static storage is a full bucket. The state is a single
+ * "theoretical arrival time" updated with compare-and-swap (GCRA), so the
+ * check is lock-free. The remaining fields let the library's summary
+ * timer report a count after the flood stops; the limiter must therefore
+ * have static storage. The component is copied, so the caller's string
+ * may change or go away once the call returns. Fields are owned by the
+ * library.
+ */
+typedef struct eml_ratelimit
+{
+    uint64_t              tat;        /**< Theoretical arrival time (CLOCK_MONOTONIC ns) */
+    uint64_t              suppressed; /**< Lines dropped since the last summary */
+    uint64_t              due;        /**< When the timer writes the summary */
+    struct eml_ratelimit* next;       /**< Timer list link */
+    eml_callsite_t*       cs;         /**< Call site named by the summary */
+    char                  comp[EMLOG_COMPONENT_NAME_MAX]; /**< Component of the summary */
+    int                   level;      /**< Level of the summary */
+    int                   queued;     /**< On the timer list */
+} eml_ratelimit_t;
+
+/**
+ * @brief Token-bucket check behind the EML_*_RL macros (do not call directly).
+ *
+ * Admits at most @p burst lines back to back and @p rate lines per second
+ * on average. Dropped lines are only counted; when a line is admitted
+ * after drops, a single summary line carrying the suppressed count is
+ * logged first at the same level and component. A count that no
+ * admitted line claims is logged by a background timer once the bucket
+ * has refilled, so the end of a flood is reported too.
+ *
+ * @return int Non-zero when the caller should log its line.
+ */
+int emlog__ratelimit(eml_ratelimit_t* rl, unsigned rate, unsigned burst, eml_callsite_t* cs,
+                     eml_level_t level, const char* comp);
+
+#if defined(EMLOG_HAVE_CALLSITES)
+#    define EML__LOG_RL(lvl, tag, rate, burst, ...)                                      \
+        do                                                                               \
+        {                                                                                \
+            EML__CS_DEFINE(eml__cs, lvl, tag, EML__FIRST(__VA_ARGS__));                  \
+            static eml_ratelimit_t eml__rl;                                              \
+            if(__builtin_expect(__atomic_load_n(&eml__cs.enabled, __ATOMIC_RELAXED), 0) && \
+               emlog__ratelimit(&eml__rl, rate, burst, &eml__cs, lvl, tag))               \
+                emlog__emit_site(&eml__cs, tag, __VA_ARGS__);                            \
+        } while(0)
+#else
+#    define EML__LOG_RL(lvl, tag, rate, burst, ...)                                 \
+        do                                                                          \
+        {                                                                           \
+            static eml_ratelimit_t eml__rl;                                         \
+            if(EML__ENABLED(lvl) && emlog__ratelimit(&eml__rl, rate, burst, 0, lvl, tag)) \
+                emlog__emit(lvl, tag, __VA_ARGS__);                                 \
+        } while(0)
+#endif
+#define EML__STRIP_RL(lvl, tag, rate, burst, ...) \
+    ((void)(0 && ((void)(rate), (void)(burst), emlog_log(lvl, tag, __VA_ARGS__), 0)))
+
+/* Rate-limited variants: EML_WARN_RL("net", 10, 20, "peer %s reset", ip)
+ * logs at most 10 lines/s per call site with bursts of up to 20. Excess
+ * lines are dropped before their arguments are evaluated; the next line
+ * that gets through is preceded by one "suppressed" summary line, or the
+ * summary is logged on its own once the flood has stopped. */
+#if EMLOG_COMPILE_MIN_LEVEL <= 0
+#    define EML_DBG_RL(tag, rate, burst, ...) \
+        EML__LOG_RL(EML_LEVEL_DBG, tag, rate, burst, __VA_ARGS__)
+#else
+#    define EML_DBG_RL(tag, rate, burst, ...) \
+        EML__STRIP_RL(EML_LEVEL_DBG, tag, rate, burst, __VA_ARGS__)
+#endif
+#if EMLOG_COMPILE_MIN_LEVEL <= 1
+#    define EML_INFO_RL(tag, rate, burst, ...) \
+        EML__LOG_RL(EML_LEVEL_INFO, tag, rate, burst, __VA_ARGS__)
+#else
+#    define EML_INFO_RL(tag, rate, burst, ...) \
+        EML__STRIP_RL(EML_LEVEL_INFO, tag, rate, burst, __VA_ARGS__)
+#endif
+#if EMLOG_COMPILE_MIN_LEVEL <= 2
+#    define EML_WARN_RL(tag, rate, burst, ...) \
+        EML__LOG_RL(EML_LEVEL_WARN, tag, rate, burst, __VA_ARGS__)
+#else
+#    define EML_WARN_RL(tag, rate, burst, ...) \
+        EML__STRIP_RL(EML_LEVEL_WARN, tag, rate, burst, __VA_ARGS__)
+#endif
+#if EMLOG_COMPILE_MIN_LEVEL <= 3
+#    define EML_ERROR_RL(tag, rate, burst, ...) \
+        EML__LOG_RL(EML_LEVEL_ERROR, tag, rate, burst, __VA_ARGS__)
+#else
+#    define EML_ERROR_RL(tag, rate, burst, ...) \
+        EML__STRIP_RL(EML_LEVEL_ERROR, tag, rate, burst, __VA_ARGS__)
+#endif
+#if EMLOG_COMPILE_MIN_LEVEL <= 4
+#    define EML_CRIT_RL(tag, rate, burst, ...) \
+        EML__LOG_RL(EML_LEVEL_CRIT, tag, rate, burst, __VA_ARGS__)
+#else
+#    define EML_CRIT_RL(tag, rate, burst, ...) \
+        EML__STRIP_RL(EML_LEVEL_CRIT, tag, rate, burst, __VA_ARGS__)
+#endif
+
+/**
+ * @brief Helper that logs errno using the current global errno value.
+ *
+ * Usage: EML_PERR("mod", "failed to open %s", path);
+ * Stripped like EML_ERROR() when EMLOG_COMPILE_MIN_LEVEL is above 3.
+ */
+#if EMLOG_COMPILE_MIN_LEVEL <= 3 && defined(EMLOG_HAVE_CALLSITES)
+#    define EML_PERR(tag, fmt, ...)                                                      \
+        do                                                                               \
+        {                                                                                \
+            int __e = errno;                                                             \
+            EML__CS_DEFINE(eml__cs, EML_LEVEL_ERROR, tag, fmt);                          \
+            if(__builtin_expect(__atomic_load_n(&eml__cs.enabled, __ATOMIC_RELAXED), 0)) \
+                emlog__emit_errno_site(&eml__cs, tag, __e, fmt, ##__VA_ARGS__);          \
+        } while(0)
+#elif EMLOG_COMPILE_MIN_LEVEL <= 3
+#    define EML_PERR(tag, fmt, ...)                                             \
+        do                                                                      \
+        {                                                                       \
+            int __e = errno;                                                    \
+            if(EML__ENABLED(EML_LEVEL_ERROR))                                   \
+                emlog_log_errno(EML_LEVEL_ERROR, tag, __e, fmt, ##__VA_ARGS__); \
+        } while(0)
+#else
+#    define EML_PERR(tag, fmt, ...) \
+        ((void)(0 && (emlog_log_errno(EML_LEVEL_ERROR, tag, errno, fmt, ##__VA_ARGS__), 0)))
+#endif
 
 /**
  * @brief Map a POSIX errno value to a canonical eml_err_t category.
@@ -10,17 +10,31 @@
 #include "emlog.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
 #include <limits.h>
+#include <poll.h>
 #include <pthread.h>
+#include <sched.h>
+#include <signal.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/uio.h>
+#include <sys/un.h>
 #include <time.h>
 #include <unistd.h>
 
 #if defined(__linux__)
+#    include <linux/futex.h>
+#    include <sys/file.h>
+#    include <sys/inotify.h>
+#    include <sys/ioctl.h>
 #    include <sys/syscall.h>
 #endif
 
@@ -29,22 +43,31 @@
 /* Global runtime state (protected by mutex) */
 static struct
 {
-    eml_level_t     min_level;    /**< Minimum level to emit */
-    int             use_ts;       /**< Whether timestamps are enabled */
-    pthread_mutex_t mu;           /**< Mutex protecting the struct */
-    eml_writer_fn   writer;       /**< Optional custom writer */
-    void*           writer_ud;    /**< User data passed to writer */
-    int             writev_flush; /**< Whether to fflush before writev */
-    unsigned        init_gen;     /**< Counts successful init calls */
-    int             initialized;  /**< Tracks whether init ran at least once */
+    atomic_int        min_level;    /**< Minimum level to emit (read lock-free) */
+    int               use_ts;       /**< Whether timestamps are enabled */
+    pthread_mutex_t   mu;           /**< Mutex protecting the struct */
+    eml_writer_fn     writer;       /**< Optional custom writer */
+    eml_writer_iov_fn writer_iov;   /**< Optional scatter-gather writer */
+    void*             writer_ud;    /**< User data passed to writer */
+    int               writev_flush; /**< Whether to fflush before writev */
+    atomic_int        fd[EML_LEVEL_CRIT + 1]; /**< Default-writer target per level */
+    int               dedup;        /**< Collapse repeated lines per thread */
+    uint64_t          dedup_win_ns; /**< Maximum age of a collapsed run */
+    unsigned          init_gen;     /**< Counts successful init calls */
+    int               initialized;  /**< Tracks whether init ran at least once */
 } G = {.min_level    = EML_LEVEL_INFO,
        .use_ts       = 1,
        .mu           = PTHREAD_MUTEX_INITIALIZER,
        .writer       = NULL,
+       .writer_iov   = NULL,
        .writer_ud    = NULL,
        /* default: fastest path, do NOT fflush before writev. The
         * caller controls this via emlog_set_writev_flush(). */
        .writev_flush = 0,
+       .fd           = {STDOUT_FILENO, STDOUT_FILENO, STDERR_FILENO, STDERR_FILENO,
+                        STDERR_FILENO},
+       .dedup        = 0,
+       .dedup_win_ns = 1000000000ull,
        .init_gen     = 0,
        .initialized  = 0};
 
@@ -102,6 +125,752 @@ EML_THREAD_LOCAL static time_t ts_cache_sec_tls        = 0;
 EML_THREAD_LOCAL static char   ts_cache_prefix_tls[32] = "";
 EML_THREAD_LOCAL static char   ts_cache_tz_tls[8]      = "+00:00";
 
+/* ------------------------------------------------------------------
+ * Summary timer
+ *
+ * Rate limiters that hold a suppressed count sit on T.rl until the
+ * next admitted line claims the count or their deadline passes, in
+ * which case a detached thread writes the summary itself. Open dedup
+ * runs are tracked on dedup_open (G.mu) instead; T.dedup_due only
+ * tells the thread when the earliest window ends. The thread is
+ * started on demand and exits once nothing is pending. T.mu only
+ * guards the fields below and the queued limiters' summary fields;
+ * the counts themselves stay atomic. Lock order is G.mu, then T.mu.
+ * ------------------------------------------------------------------ */
+static struct
+{
+    pthread_mutex_t  mu;        /**< Guards the fields below */
+    pthread_cond_t   cv;        /**< Signalled when a deadline moves */
+    eml_ratelimit_t* rl;        /**< Limiters with a pending summary */
+    uint64_t         dedup_due; /**< Earliest dedup window end, 0 = none */
+    int              running;   /**< Timer thread alive */
+} T = {.mu = PTHREAD_MUTEX_INITIALIZER, .cv = PTHREAD_COND_INITIALIZER};
+
+/* ------------------------------------------------------------------
+ * Repeated-message suppression state
+ *
+ * Each thread tracks the hash of the last line it emitted and how many
+ * identical lines it has swallowed since. Everything is thread-local
+ * and only touched with G.mu held, so no extra synchronization is
+ * needed. A run with a pending count is also linked on dedup_open so
+ * the summary timer can report it when its window ends; the thread-exit
+ * destructor reports and unlinks it before the thread-local storage
+ * goes away. The component is copied because the caller's pointer may
+ * not outlive the run.
+ * ------------------------------------------------------------------ */
+struct dedup_state
+{
+    uint64_t            hash;     /**< Hash of the last emitted line (0 = none) */
+    uint64_t            first_ns; /**< CLOCK_MONOTONIC time the run started */
+    unsigned long long  count;    /**< Identical lines suppressed so far */
+    uint64_t            tid;      /**< Thread the run belongs to */
+    struct dedup_state* next;     /**< dedup_open link while count > 0 */
+    eml_level_t         level;    /**< Level of the suppressed line */
+    char                comp[EMLOG_COMPONENT_NAME_MAX];
+};
+
+EML_THREAD_LOCAL static struct dedup_state dedup_tls;
+static struct dedup_state*                 dedup_open; /**< Runs with a pending count (G.mu) */
+static pthread_key_t                       dedup_key;
+static pthread_once_t                      dedup_key_once = PTHREAD_ONCE_INIT;
+
+/* ------------------------------------------------------------------
+ * Per-thread level state
+ *
+ * thread_level_tls replaces G.min_level for the owning thread (-1 =
+ * none). thread_levels[] counts threads holding each override so
+ * refresh_active_level_locked() can fold the lowest one into
+ * emlog__active_level. The key's value mirrors the override (level + 1)
+ * so the exit destructor can release the count.
+ * ------------------------------------------------------------------ */
+EML_THREAD_LOCAL static int thread_level_tls = -1;
+static atomic_uint          thread_levels[EML_LEVEL_CRIT + 1];
+static pthread_key_t        thread_level_key;
+static pthread_once_t       thread_level_once = PTHREAD_ONCE_INIT;
+
+/* ------------------------------------------------------------------
+ * Backtrace ring state
+ *
+ * With capture enabled, lines in [bt_level, effective level) are
+ * formatted (header included) into a per-thread ring instead of being
+ * dropped. The ring is private to its thread, so capture takes no lock;
+ * it is flushed under G.mu just before that thread writes an ERROR+
+ * line. Rings are sized lazily and freed by a pthread key destructor.
+ * ------------------------------------------------------------------ */
+struct bt_entry
+{
+    eml_level_t level;
+    unsigned    len;
+    char        line[EMLOG_BACKTRACE_LINE_MAX];
+};
+
+struct bt_ring
+{
+    unsigned        cap;   /**< Number of entries */
+    unsigned        head;  /**< Next slot to overwrite */
+    unsigned        count; /**< Valid entries (<= cap) */
+    struct bt_entry e[];
+};
+
+static atomic_int                       bt_level = -1; /**< Capture threshold, -1 = off */
+static atomic_uint                      bt_lines;      /**< Ring capacity */
+EML_THREAD_LOCAL static struct bt_ring* bt_tls;
+static pthread_key_t                    bt_key;
+static pthread_once_t                   bt_key_once = PTHREAD_ONCE_INIT;
+
+/** admit() verdicts */
+enum
+{
+    ADMIT_DROP = 0, /**< Line is discarded */
+    ADMIT_WRITE,    /**< Line is formatted and written */
+    ADMIT_CAPTURE,  /**< Line goes to the thread's backtrace ring */
+    ADMIT_RING      /**< Line only goes to the flight recorder ring */
+};
+
+/* ------------------------------------------------------------------
+ * Flight recorder ring
+ *
+ * R.hdr points at the shared mapping while a ring is open. Writers pin
+ * it with R.inflight, as file sink writers pin their descriptor, so
+ * emlog_ring_close() unmaps only once the count drains. ring_level
+ * gates both the below-level capture in admit() and the copy of
+ * written lines in write_line_iov(). A writer preempted for a whole lap
+ * of the ring can garble the record that reused its slot; readers
+ * reject it unless its position checks out.
+ * ------------------------------------------------------------------ */
+#define RING_NSIGS 5
+
+static atomic_int ring_level = -1; /**< Lowest level recorded, -1 = off */
+
+static struct
+{
+    pthread_mutex_t          ctl;             /**< Serialises open/close */
+    _Atomic(eml_ring_hdr_t*) hdr;             /**< Mapping, NULL when closed */
+    atomic_uint              inflight;        /**< Writers and dumps using hdr */
+    size_t                   map_len;         /**< Bytes mapped */
+    int                      fd;              /**< Backing descriptor, -1 for anonymous */
+    int                      crash_fd;        /**< Crash dump target, 0 = off */
+    struct sigaction         old[RING_NSIGS]; /**< Handlers replaced by ours */
+} R = {.ctl = PTHREAD_MUTEX_INITIALIZER, .fd = -1};
+
+static const int ring_sigs[RING_NSIGS] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+
+EML_THREAD_LOCAL static int ring_mute_tls; /**< Set while replaying backtrace lines */
+
+/* ------------------------------------------------------------------
+ * Configuration file state
+ *
+ * cfg_mu serializes loads (application thread, file watcher or shm
+ * watcher) and guards, per source, the list of component overrides
+ * that source installed, so a reload can clear the ones that
+ * disappeared. The watcher thread only ever blocks
+ * in poll(); settings are applied through the public setters, which
+ * take ctl_mu or G.mu for a few stores, never across file I/O.
+ * ------------------------------------------------------------------ */
+struct cfg_file
+{
+    int      level;        /**< -1 = key absent */
+    int      use_ts;       /**< -1 = key absent */
+    int      writev_flush; /**< -1 = key absent */
+    unsigned ncomp;
+    struct
+    {
+        char name[EMLOG_COMPONENT_NAME_MAX];
+        int  level; /**< Override, or -1 for "inherit" */
+    } comp[EMLOG_MAX_COMPONENTS];
+};
+
+struct cfg_owner
+{
+    char     names[EMLOG_MAX_COMPONENTS][EMLOG_COMPONENT_NAME_MAX];
+    unsigned n;
+};
+
+static pthread_mutex_t  cfg_mu = PTHREAD_MUTEX_INITIALIZER;
+static struct cfg_owner cfg_file_owned; /**< Overrides installed by emlog_config_load() */
+#if defined(__linux__)
+static struct cfg_owner cfg_shm_owned; /**< Overrides installed from the shm page */
+#endif
+
+static struct
+{
+    pthread_mutex_t mu;         /**< Guards start/stop */
+    pthread_t       th;         /**< Watcher thread */
+    int             running;    /**< Whether th is live */
+    int             ino_fd;     /**< inotify descriptor */
+    int             stop_fd[2]; /**< Self-pipe used to wake and stop th */
+    char            path[PATH_MAX];
+    char            base[NAME_MAX + 1];
+} W = {.mu = PTHREAD_MUTEX_INITIALIZER, .ino_fd = -1, .stop_fd = {-1, -1}};
+
+/* ------------------------------------------------------------------
+ * Shared-memory control page state
+ *
+ * S.page maps /dev/shm/emlog.NAME. The watcher thread sleeps in
+ * FUTEX_WAIT on page->seq; writers in any process bump seq around
+ * their update (seqlock) and wake every waiter, so a change reaches
+ * all attached processes without signals or polling. The watcher
+ * mirrors the page into the process-local state the hot path reads
+ * (G.min_level, the component table, emlog__active_level and the call
+ * site bytes) through cfg_apply_locked().
+ * ------------------------------------------------------------------ */
+#if defined(__linux__)
+static struct
+{
+    pthread_mutex_t mu;   /**< Guards attach/detach */
+    eml_shm_page_t* page; /**< Mapped page, NULL while detached */
+    int             fd;   /**< Page descriptor */
+    pthread_t       th;   /**< Watcher thread */
+    atomic_int      stop; /**< Set by emlog_shm_detach() */
+} S = {.mu = PTHREAD_MUTEX_INITIALIZER, .page = NULL, .fd = -1};
+#endif
+
+/* ------------------------------------------------------------------
+ * Rotating file sink
+ *
+ * Writers load fd and append with writev(); the rotation thread renames
+ * the file, opens its replacement and publishes it with one atomic
+ * exchange. The old descriptor is closed only after the in-flight
+ * counter drains, so a writer that loaded it just before the swap
+ * finishes its write into the rotated file. Writers never take a lock:
+ * a size trigger sets `pending` and pokes the thread through a pipe.
+ * ------------------------------------------------------------------ */
+struct eml_file_sink
+{
+    atomic_int       fd;        /**< Current descriptor */
+    atomic_int       inflight;  /**< Writers between fd load and write end */
+    atomic_int       pending;   /**< Rotation requested */
+    atomic_int       stop;      /**< Thread shutdown */
+    atomic_int       durable;   /**< emlog_file_sink_sync() is in use */
+    _Atomic uint64_t bytes;     /**< Size of the current file */
+    uint64_t         max_bytes; /**< Size trigger (0 = off) */
+    unsigned         interval;  /**< Time trigger in seconds (0 = off) */
+    unsigned         keep;      /**< Retained rotations */
+    unsigned         mode;      /**< Creation mode */
+    int              wake[2];   /**< Self-pipe: [0] polled by the thread */
+    pthread_t        th;        /**< Rotation thread */
+    char             path[PATH_MAX];
+};
+
+/* ------------------------------------------------------------------
+ * Memory-mapped sink
+ *
+ * The file is divided into fixed segments, each mapped separately so a
+ * mapping never moves under a writer. Writers reserve [off, off+rec)
+ * with one fetch-add on `tail`, pin the segment through its `writers`
+ * count, write the header (length), copy the payload and publish the
+ * COMMITTED bit with a release store. A reservation that straddles a
+ * segment boundary is turned into PAD records on both sides and
+ * retried. The helper thread maps ahead, starts writeback and retires
+ * old segments: it clears `base` first and only unmaps when no writer
+ * pinned the segment in the meantime (both sides use seq_cst).
+ * ------------------------------------------------------------------ */
+#define MM_MAX_SEGS 4096
+
+struct mm_seg
+{
+    _Atomic(char*) base;    /**< Mapping, NULL when unmapped */
+    atomic_uint    writers; /**< Writers currently copying into it */
+};
+
+struct eml_mmap_sink
+{
+    _Atomic uint64_t tail;      /**< Next free file offset */
+    _Atomic uint64_t dropped;   /**< Lines that could not be stored */
+    size_t           seg_bytes; /**< Segment size (page multiple) */
+    unsigned         sync_ms;   /**< Writeback interval */
+    int              fd;        /**< Log file */
+    int              wake[2];   /**< Self-pipe poked when a segment fills up */
+    atomic_int       stop;      /**< Helper shutdown */
+    pthread_t        th;        /**< Helper thread */
+    pthread_mutex_t  map_mu;    /**< Serializes map/retire */
+    uint64_t         synced;    /**< Writeback issued up to here (helper only) */
+    size_t           retired;   /**< Segments below this index are unmapped */
+    struct mm_seg    seg[MM_MAX_SEGS];
+};
+
+/* ------------------------------------------------------------------
+ * Sink registry
+ *
+ * sinks[] and sink_count are guarded by G.mu, which every call to
+ * write_line_iov() already holds, so fan-out needs no extra locking.
+ * A line is assembled once into a reference-counted sink_rec, so it is
+ * never copied or reformatted per sink. Each async queue holds one
+ * reference, and the sink's thread drops it after calling the writer.
+ *
+ * Synchronous sinks are never called under G.mu. Fan-out lists them
+ * on the line and appends it to the thread's deferred list; the thread
+ * calls them once it has released G.mu, one sink at a time under that
+ * sink's cmu. A slow or hung sink therefore only holds up the threads
+ * whose lines it receives, and only while they wait for that sink. A
+ * call that overruns its budget benches the sink (its lines dropped)
+ * so those threads do not queue behind it line after line.
+ *
+ * deliver() publishes the call site and component of the line being
+ * written in line_ctx_tls, so record sinks receive them alongside the
+ * text without widening every write_line_iov() caller.
+ * ------------------------------------------------------------------ */
+struct sink_rec
+{
+    atomic_uint      refs;                           /**< Producer plus one per queued reference */
+    struct sink_rec* next;                           /**< Next line deferred by the same thread */
+    int              wait;                           /**< Caller may wait on a durability policy */
+    int              nsync;                          /**< Entries used in sync[] */
+    struct sink*     sync[EMLOG_MAX_SINKS];          /**< Synchronous sinks still to call */
+    eml_record_t     rec;                            /**< Points into comp/data below */
+    char             comp[EMLOG_COMPONENT_NAME_MAX]; /**< Copy of rec.comp */
+    char             data[];
+};
+
+struct line_ctx
+{
+    const eml_callsite_t* cs;   /**< Call site, or NULL */
+    const char*           comp; /**< Component, or NULL */
+};
+
+EML_THREAD_LOCAL static struct line_ctx line_ctx_tls;
+
+struct sink
+{
+    eml_sink_cfg_t     cfg;     /**< Copy of the registration */
+    _Atomic uint64_t   written; /**< Lines accepted by the writer */
+    _Atomic uint64_t   errors;  /**< Writer failures */
+    _Atomic uint64_t   dropped; /**< Queue full / benched / no memory */
+    _Atomic uint64_t   overrun; /**< Synchronous calls over budget */
+    uint64_t           budget;  /**< Synchronous call limit, ns */
+    uint64_t           bench;   /**< CLOCK_MONOTONIC ns until which lines are dropped (cmu) */
+    uint64_t           cowed;   /**< Synchronous lines handed out (G.mu) */
+    pthread_mutex_t    cmu;     /**< Held across a synchronous call; guards cdone */
+    pthread_cond_t     ccv;     /**< Signalled when cdone advances with cwait set */
+    uint64_t           cdone;   /**< Synchronous lines called (or dropped) */
+    int                cwait;   /**< emlog_sink_remove() is waiting on cdone */
+    pthread_mutex_t    qmu;     /**< Guards the queue fields below */
+    pthread_cond_t     qcv;     /**< Signalled on push and stop */
+    struct sink_rec**  q;       /**< Ring of queue_len references */
+    uint64_t           qhead;   /**< Lines popped so far */
+    uint64_t           qtail;   /**< Lines pushed so far */
+    int                stop;    /**< Drain and exit */
+    pthread_t          th;      /**< Worker (async sinks only) */
+    pthread_mutex_t    smu;     /**< Guards the group-commit fields below */
+    pthread_cond_t     scv;     /**< Wakes the syncer */
+    pthread_cond_t     sdcv;    /**< Broadcast when sdone advances */
+    uint64_t           sseq;    /**< Bytes written so far */
+    uint64_t           sdone;   /**< Bytes covered by the last finished sync */
+    uint64_t           sreq;    /**< Bytes a level trigger asked to cover */
+    uint64_t           sdirty;  /**< CLOCK_MONOTONIC ns when sdone fell behind */
+    int                swait;   /**< Callers between registering and waking */
+    int                sstop;   /**< Final sync and exit */
+    pthread_t          sth;     /**< Syncer (durability.fn only) */
+    _Atomic uint64_t   syncs;   /**< Hook calls */
+    _Atomic uint64_t   serrs;   /**< Hook failures */
+};
+
+static struct sink* sinks[EMLOG_MAX_SINKS];
+static int          sink_count;
+
+/* Group commit: deliver() arms durable_arm_tls while it holds G.mu, and
+ * fan-out stamps it on the line. A synchronous sink that must make this
+ * caller wait records (sink, byte position) here and bumps the sink's
+ * swait, and deliver() waits once the deferred sink calls are done, so
+ * a sync in progress never blocks other loggers. */
+struct durable_wait
+{
+    struct sink* s;   /**< Sink to wait on */
+    uint64_t     seq; /**< sdone must reach this */
+};
+
+EML_THREAD_LOCAL static struct durable_wait durable_tls[EMLOG_MAX_SINKS];
+EML_THREAD_LOCAL static int                 durable_ntls;
+EML_THREAD_LOCAL static int                 durable_arm_tls;
+
+/* Lines this thread still owes to synchronous sinks, oldest first. Every
+ * path that writes lines under G.mu runs them after unlocking. */
+EML_THREAD_LOCAL static struct sink_rec* sink_defer_tls;
+EML_THREAD_LOCAL static struct sink_rec* sink_defer_last_tls;
+EML_THREAD_LOCAL static int              sink_running_tls; /**< In sink_run_deferred() */
+EML_THREAD_LOCAL static struct sink*     sink_self_tls;    /**< Sink being called */
+
+/* ------------------------------------------------------------------
+ * journald sink
+ *
+ * Stateless apart from the socket: every record becomes one datagram of
+ * KEY=value lines (or KEY\n<le64 length><bytes>\n when the value holds a
+ * newline) sent to the unconnected journal socket, so a journald
+ * restart needs no reconnect.
+ * ------------------------------------------------------------------ */
+#define JOURNAL_IOV_MAX 32
+
+#ifndef MSG_NOSIGNAL
+#    define MSG_NOSIGNAL 0
+#endif
+
+struct eml_journal_sink
+{
+    int                fd;        /**< AF_UNIX datagram socket */
+    size_t             max_dgram; /**< memfd threshold (0 = on EMSGSIZE only) */
+    struct sockaddr_un addr;      /**< Journal socket */
+    socklen_t          addrlen;   /**< Bytes of addr in use */
+    size_t             ident_len; /**< Bytes of ident in use */
+    char               ident[96]; /**< Prebuilt "SYSLOG_IDENTIFIER=...\n" */
+};
+
+/* ------------------------------------------------------------------
+ * syslog sink
+ *
+ * Records are rendered into `arena` back to back and described by one
+ * iovec each; a flush hands them all to sendmmsg() on a connected,
+ * non-blocking datagram socket. A daemon restart surfaces as
+ * ECONNREFUSED/ENOTCONN: the socket is reopened once on the spot and
+ * afterwards no more often than SYSLOG_RETRY_NS, dropping (and
+ * counting) what cannot be sent meanwhile.
+ * ------------------------------------------------------------------ */
+#define SYSLOG_ARENA    (64u * 1024u)
+#define SYSLOG_RETRY_NS 100000000ull
+
+struct eml_syslog_sink
+{
+    pthread_mutex_t    mu;                          /**< Guards everything below */
+    int                fd;                          /**< Connected socket, -1 when down */
+    uint64_t           retry_ns;                    /**< No reconnect before this */
+    struct sockaddr_un addr;                        /**< Daemon socket */
+    socklen_t          addrlen;                     /**< Bytes of addr in use */
+    unsigned           batch;                       /**< Flush threshold */
+    unsigned           n;                           /**< Records buffered */
+    size_t             used;                        /**< Arena bytes in use */
+    _Atomic uint64_t   sent;                        /**< Records delivered */
+    _Atomic uint64_t   dropped;                     /**< Records lost */
+    size_t             pri_len[EML_LEVEL_CRIT + 1]; /**< Bytes of pri[l] */
+    char               pri[EML_LEVEL_CRIT + 1][12]; /**< "<PRI>1 " per level */
+    size_t             mid_len;                     /**< Bytes of mid */
+    char               mid[352];                    /**< " HOST APP PROCID " */
+    struct iovec       iov[EMLOG_SYSLOG_BATCH_MAX]; /**< One per buffered record */
+    char               arena[SYSLOG_ARENA];         /**< Rendered records */
+};
+
+/* ------------------------------------------------------------------
+ * Batch sink
+ *
+ * Records are copied into `recs`/`arena` under `mu`. A batch that is
+ * due is swapped with the spare buffers and handed to the callback with
+ * `mu` released, so new records keep collecting while it runs; `busy`
+ * keeps callback calls one at a time and in order. The linger thread
+ * sleeps until a batch has a first record and hands it over when it is
+ * `linger_ns` old, so an idle logger never sits on lines for long.
+ *
+ * batch_self_tls marks a thread inside the callback: lines it logs are
+ * not passed back to the same batch sink, which would otherwise wait
+ * for its own callback to return once the batch filled up.
+ * ------------------------------------------------------------------ */
+struct eml_batch_sink
+{
+    pthread_mutex_t  mu;        /**< Guards everything below */
+    pthread_cond_t   cv;        /**< Wakes the linger thread */
+    pthread_cond_t   idle;      /**< Broadcast when a callback returns */
+    eml_batch_fn     fn;        /**< Batch callback */
+    void*            user;      /**< Passed to fn */
+    unsigned         max;       /**< Records per batch */
+    size_t           cap;       /**< Bytes of arena */
+    uint64_t         linger_ns; /**< Age limit of a batch */
+    unsigned         n;         /**< Records buffered */
+    size_t           used;      /**< Arena bytes in use */
+    uint64_t         first_ns;  /**< CLOCK_MONOTONIC ns of recs[0] */
+    int              stop;      /**< Flush and exit */
+    int              busy;      /**< A callback is running */
+    pthread_t        th;        /**< Linger thread */
+    _Atomic uint64_t batches;   /**< Batches handed over */
+    _Atomic uint64_t failed;    /**< Records in batches fn rejected */
+    eml_record_t*    recs;      /**< max entries */
+    char*            arena;     /**< Copied text and components */
+    eml_record_t*    out_recs;  /**< Spare recs, or the batch fn is reading */
+    char*            out_arena; /**< Spare arena, paired with out_recs */
+};
+
+EML_THREAD_LOCAL static struct eml_batch_sink* batch_self_tls;
+
+/* ------------------------------------------------------------------
+ * Compressing file sink
+ *
+ * `nblk` buffers of `block` bytes cycle between three states: free
+ * (on the free stack), open (`cur`, being filled by writers) and full
+ * (on the FIFO the compressor drains). Writers only memcpy under `mu`;
+ * the compressor thread owns `out` and `tab` and is the only one that
+ * writes the file, one frame per write().
+ * ------------------------------------------------------------------ */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITS 5  /**< The block format ends with at least 5 literals */
+#define LZ_MF_LIMIT  12 /**< No match may start in the last 12 bytes */
+
+struct eml_lz_sink
+{
+    pthread_mutex_t  mu;       /**< Guards buffer states below */
+    pthread_cond_t   cv;       /**< Signals the compressor */
+    char**           buf;      /**< nblk block buffers */
+    size_t*          len;      /**< Bytes used per buffer */
+    unsigned*        freel;    /**< Free stack */
+    unsigned*        fullq;    /**< Full FIFO (ring of nblk) */
+    unsigned         nblk;     /**< Number of buffers */
+    unsigned         nfree;    /**< Entries on the free stack */
+    unsigned         fhead;    /**< Next full entry to compress */
+    unsigned         nfull;    /**< Entries on the full FIFO */
+    int              cur;      /**< Open buffer, -1 when none */
+    int              stop;     /**< Drain and exit */
+    size_t           block;    /**< Buffer size */
+    unsigned         flush_ms; /**< Partial-block flush interval */
+    int              fd;       /**< Output file */
+    pthread_t        th;       /**< Compressor thread */
+    _Atomic uint64_t dropped;  /**< Lines with no free buffer */
+    unsigned char*   out;      /**< Frame staging (compressor only) */
+    uint32_t*        tab;      /**< Match finder (compressor only) */
+};
+
+/* ------------------------------------------------------------------
+ * Direct-I/O file sink
+ *
+ * Same free/open/full buffer cycle as the compressing sink, except that
+ * blocks are filled to the last byte (lines span them) so that block k
+ * always lands at base + k * block. Only the writer thread touches the
+ * file: it owns `off` (where the open buffer starts) and `tail_done`
+ * (how much of it is already on disk), and writes a partial tail only
+ * when no full block is queued ahead of it.
+ * ------------------------------------------------------------------ */
+#ifndef O_DIRECT
+#    define O_DIRECT 0
+#endif
+
+struct eml_direct_sink
+{
+    pthread_mutex_t  mu;        /**< Guards buffer states below */
+    pthread_cond_t   cv;        /**< Signals the writer */
+    char**           buf;       /**< nblk aligned block buffers */
+    size_t*          len;       /**< Bytes used per buffer */
+    unsigned*        freel;     /**< Free stack */
+    unsigned*        fullq;     /**< Full FIFO (ring of nblk) */
+    unsigned         nblk;      /**< Number of buffers */
+    unsigned         nfree;     /**< Entries on the free stack */
+    unsigned         fhead;     /**< Next full entry to write */
+    unsigned         nfull;     /**< Entries on the full FIFO */
+    int              cur;       /**< Open buffer, -1 when none */
+    int              stop;      /**< Drain and exit */
+    size_t           block;     /**< Buffer size */
+    unsigned         flush_ms;  /**< Partial-tail write interval */
+    int              fd;        /**< Output file */
+    int              direct;    /**< fd really has O_DIRECT */
+    pthread_t        th;        /**< Writer thread */
+    _Atomic uint64_t dropped;   /**< Lines with no free buffer */
+    off_t            off;       /**< File offset of the open buffer (writer only) */
+    size_t           tail_done; /**< Bytes of it already written (writer only) */
+    char*            tail;      /**< Aligned copy of a partial tail (writer only) */
+};
+
+/* ------------------------------------------------------------------
+ * Pipe splice output
+ *
+ * Lines for P.fd are copied into buf[cur]; a buffer is exactly one
+ * pipe capacity (cap bytes, cap / page size slots) and is spliced only
+ * when completely full, so each splice occupies every slot. Once
+ * buf[cur] has been accepted whole, nothing older can still be in the
+ * pipe and buf[cur ^ 1] is safe to overwrite: that is the only point
+ * where the buffers swap. Partial flushes go through write(), which
+ * copies, so the same buffer simply restarts at 0.
+ *
+ * A reader that stalls is never waited for indefinitely under G.mu:
+ * write() goes through write_fd_locked(), so EAGAIN parks bytes in the
+ * overflow buffer, and vmsplice() waits at most PIPE_STALL_MS before
+ * the rest of its buffer is parked too. While bytes are parked for
+ * P.fd, or pages of either buffer may still sit in the pipe, splicing
+ * is paused and lines take the writev() path behind them; it resumes
+ * once nothing is parked and the pipe is empty.
+ *
+ * fd, cur, pos and stop are guarded by G.mu (write_line_iov() already
+ * holds it); ctl serialises enable/disable so the flusher can be
+ * joined without G.mu held.
+ * ------------------------------------------------------------------ */
+#if defined(__linux__)
+#    define PIPE_STALL_MS 100u
+
+static struct
+{
+    pthread_mutex_t  ctl;      /**< Serialises emlog_set_pipe_splice() */
+    pthread_cond_t   cv;       /**< Wakes the flusher (waits on G.mu) */
+    int              fd;       /**< Pipe in splice mode, -1 when off */
+    size_t           cap;      /**< Bytes per buffer (pipe capacity) */
+    char*            buf[2];   /**< Page-aligned buffers, one mapping */
+    int              cur;      /**< Buffer being filled */
+    size_t           pos;      /**< Bytes used in buf[cur] */
+    int              cont;     /**< buf[cur] starts in the middle of a line */
+    int              paused;   /**< Lines bypass the buffers until the pipe empties */
+    unsigned         flush_ms; /**< Partial-buffer age limit */
+    int              stop;     /**< Flusher exit request */
+    int              running;  /**< Whether th is live */
+    pthread_t        th;       /**< Flusher thread */
+    _Atomic uint64_t spliced;  /**< Bytes passed with vmsplice() */
+    _Atomic uint64_t copied;   /**< Bytes flushed with write() */
+} P = {.ctl = PTHREAD_MUTEX_INITIALIZER, .cv = PTHREAD_COND_INITIALIZER, .fd = -1};
+#endif
+
+/* ------------------------------------------------------------------
+ * Default writer overflow
+ *
+ * A descriptor that returns EAGAIN gets a slot holding the unwritten
+ * bytes at buf[off, off + len); a slot with len == 0 is free. Parked
+ * bytes always end on a line boundary, and `mid` records that the first
+ * parked line already went out in part, so a policy never drops it.
+ * Everything here is guarded by G.mu; the drainer thread runs only
+ * while some slot is in use.
+ *
+ * EML_OVERFLOW_BLOCK never waits with G.mu held. A line that finds its
+ * slot full is copied to the logging thread's ovf_wait_tls, and later
+ * lines of that call for the same descriptor queue behind it; deliver()
+ * then waits on O.room after releasing G.mu, so only threads logging to
+ * the stalled descriptor wait, and for at most block_ms. Writes made
+ * outside a logging call (timer summaries) cannot wait and drop instead.
+ * ------------------------------------------------------------------ */
+#define OVF_SLOTS (EML_LEVEL_CRIT + 1)
+
+struct ovf_slot
+{
+    int    fd;   /**< Descriptor the bytes are for */
+    char*  buf;  /**< Parked bytes (kept for reuse when empty) */
+    size_t size; /**< Bytes allocated for buf */
+    size_t off;  /**< Start of the unwritten bytes */
+    size_t len;  /**< Unwritten bytes, 0 = slot free */
+    int    mid;  /**< buf[off] continues a partly written line */
+};
+
+static struct
+{
+    struct ovf_slot       slot[OVF_SLOTS]; /**< One per descriptor with parked bytes */
+    size_t                cap;             /**< Parked-byte limit per descriptor */
+    eml_overflow_policy_t policy;          /**< What to drop when full */
+    unsigned              block_ms;        /**< EML_OVERFLOW_BLOCK wait limit */
+    int                   running;         /**< Whether the drainer is live */
+    int                   hooked;          /**< atexit() registered */
+    _Atomic uint64_t      partial;         /**< Short writes continued */
+    _Atomic uint64_t      deferred;        /**< Lines parked */
+    _Atomic uint64_t      dropped;         /**< Lines dropped by the policy */
+    _Atomic uint64_t      dropped_bytes;   /**< Bytes of those lines */
+    _Atomic uint64_t      blocked;         /**< EML_OVERFLOW_BLOCK waits */
+    _Atomic uint64_t      errors;          /**< Lines lost to write errors */
+    pthread_cond_t        room;            /**< Broadcast when parked bytes leave (G.mu) */
+} O = {.cap = 64u * 1024u, .policy = EML_OVERFLOW_DROP_NEWEST, .room = PTHREAD_COND_INITIALIZER};
+
+struct ovf_wait
+{
+    int    fd;   /**< Descriptor the lines are for */
+    char*  buf;  /**< Copied lines, freed after the wait */
+    size_t len;  /**< Bytes in buf */
+    size_t size; /**< Bytes allocated for buf */
+};
+
+EML_THREAD_LOCAL static struct ovf_wait ovf_wait_tls[OVF_SLOTS];
+EML_THREAD_LOCAL static int             ovf_nwait_tls;
+EML_THREAD_LOCAL static int             ovf_arm_tls;
+
+/* ------------------------------------------------------------------
+ * Per-component level table
+ *
+ * A fixed-size, open-addressing hash table mapping component names to
+ * an override level. It is read on every log call, so readers never
+ * lock: a slot is published by storing its hash last (release), and a
+ * reader that observes a non-zero hash (acquire) is guaranteed to see
+ * the name written before it. Slots are never freed; clearing an
+ * override only resets its level to COMP_INHERIT, so a published name
+ * is immutable for the lifetime of the process.
+ *
+ * Writers (emlog_set_component_level) are serialized by ctl_mu, which
+ * is independent from G.mu so reconfiguring a component never waits on
+ * an in-flight writer callback.
+ *
+ * Because slots are immutable, a macro call site whose component is a
+ * literal caches the slot it resolved to (or, on a miss, the value of
+ * comp_gen at the time) so its later calls skip hashing and comparing
+ * the name. comp_gen is bumped after each new slot is published, which
+ * invalidates every cached miss.
+ * ------------------------------------------------------------------ */
+#define COMP_INHERIT (-1)
+#define COMP_MASK    ((uint64_t)EMLOG_MAX_COMPONENTS - 1u)
+
+#if (EMLOG_MAX_COMPONENTS & (EMLOG_MAX_COMPONENTS - 1)) != 0
+#    error "EMLOG_MAX_COMPONENTS must be a power of two"
+#endif
+
+struct comp_slot
+{
+    _Atomic uint64_t hash;                           /**< 0 = empty, published last */
+    atomic_int       level;                          /**< Override or COMP_INHERIT */
+    atomic_uint      sample;                         /**< 1-in-N override, 0 = per-level */
+    unsigned         len;                            /**< strlen(name) */
+    char             name[EMLOG_COMPONENT_NAME_MAX]; /**< Immutable once published */
+};
+
+static struct comp_slot comp_tab[EMLOG_MAX_COMPONENTS];
+static atomic_uint      comp_active;  /**< Number of slots holding an override */
+static atomic_uint      comp_sampled; /**< Number of slots holding a sampling rate */
+static atomic_uint      comp_gen;     /**< Bumped each time a slot is published */
+
+/* ------------------------------------------------------------------
+ * Sampling state
+ *
+ * level_sample[] holds the 1-in-N rate per level (0/1 = keep all). The
+ * per-thread generator is seeded lazily; the sample key, when set,
+ * replaces it so decisions become a pure function of (key, N).
+ * ------------------------------------------------------------------ */
+static atomic_uint               level_sample[EML_LEVEL_CRIT + 1];
+EML_THREAD_LOCAL static uint64_t sample_rng_tls;
+EML_THREAD_LOCAL static uint64_t sample_key_tls;
+EML_THREAD_LOCAL static int      sample_key_set_tls;
+
+/* ------------------------------------------------------------------
+ * Exported fast-path level
+ *
+ * emlog__active_level is the lowest level any filter currently lets
+ * through: the minimum of G.min_level, every component override, every
+ * per-thread override and the backtrace capture level.
+ * The EML_* macros compare against it inline (one relaxed load) before
+ * evaluating their arguments or calling into the library, so it must
+ * never be higher than what the precise filters in emit_va() accept.
+ * It is only ever written by refresh_active_level_locked() with ctl_mu
+ * held, which serializes every configuration change that feeds it.
+ * ------------------------------------------------------------------ */
+int                    emlog__active_level = EML_LEVEL_INFO;
+static pthread_mutex_t ctl_mu              = PTHREAD_MUTEX_INITIALIZER;
+
+/* ------------------------------------------------------------------
+ * Call-site registry
+ *
+ * Every EML_* expansion owns a static eml_callsite_t placed in the
+ * "emlog_callsites" section; each module hands its section bounds to
+ * emlog__callsites_register() from a constructor emitted by emlog.h.
+ * The macros only test the site's `enabled` byte, which we keep equal
+ * to (forced || level >= emlog__active_level). Rewriting the bytes is
+ * O(number of sites), so it only happens when the active level actually
+ * changes or when a rule is added. Rules are remembered so modules that
+ * register later (dlopen) pick them up. Everything here is guarded by
+ * ctl_mu.
+ * ------------------------------------------------------------------ */
+#define CS_FORCED 0x1u
+
+struct cs_module
+{
+    eml_callsite_t* start;
+    eml_callsite_t* stop;
+};
+
+struct cs_rule
+{
+    char*    glob; /**< fnmatch() pattern for the file */
+    unsigned lo;   /**< First line (inclusive) */
+    unsigned hi;   /**< Last line (inclusive) */
+    int      on;   /**< 1 = force on, 0 = release */
+};
+
+static struct cs_module* cs_mods;
+static size_t            cs_nmods;
+static struct cs_rule*   cs_rules;
+static size_t            cs_nrules;
+static int               cs_synced_level = -1; /**< Level the site bytes reflect */
+
 /* --------------------------------------------------------------------------
  * Static function declarations (private helpers)
  *
@@ -120,14 +889,15 @@ EML_THREAD_LOCAL static char   ts_cache_tz_tls[8]      = "+00:00";
  */
 static const char* lvl_str(eml_level_t l);
 
-/** @brief Choose default FILE stream for a level (stdout/stderr).
- * 
- * Logs at DBG/INF go to stdout, others to stderr.
- * 
+/** @brief Descriptor the default writer uses for a level.
+ *
+ * Logs at DBG/INF go to stdout, others to stderr, unless emlog_set_fd()
+ * routed the level elsewhere.
+ *
  * @param l Log level
- * @return FILE* stdout for DBG/INF, stderr for WRN/ERR/CRT
+ * @return int Target file descriptor
  */
-static FILE* default_stream(eml_level_t l);
+static int default_fd(eml_level_t l);
 
 /** @brief Format current time as ISO8601 into buffer.
  * 
@@ -148,377 +918,5378 @@ static void fmt_time_iso8601(char* out, size_t n, unsigned* msec_out);
  */
 static eml_level_t parse_level(const char* s);
 
-/** @brief Core varargs logger implementation (expects mutex to be held).
- * 
- * Formats and emits a log line if the level is >= current min_level.
- * 
- * @param level Log level
- * @param comp Component name (nullable)
- * @param fmt Printf-style format string
- * @param ap   va_list of arguments
+/** @brief Strict level parser for configuration values.
+ *
+ * Accepts short (DBG, INF, ...) and long (debug, info, warning, ...)
+ * names case-insensitively, and the digits 0..4.
+ *
+ * @return int 0 on success, -1 for an unknown value
  */
-static void vlog(eml_level_t level, const char* comp, const char* fmt, va_list ap);
+static int parse_level_strict(const char* s, int* out);
 
-/* --------------------------------------------------------------------------
- * Public API implementations
+/** @brief Parse @p path into @p cfg without applying anything.
  *
- * These definitions are placed before the static implementations so the file
- * reads as: helpers declarations -> public API -> private helpers. Each
- * public function has a brief Doxygen comment matching the header to keep
- * docs consistent for readers of the .c file.
- * -------------------------------------------------------------------------- */
+ * @return eml_err_t EML_OK, EML_NOT_FOUND or EML_BAD_INPUT
+ */
+static eml_err_t cfg_parse(const char* path, struct cfg_file* cfg);
 
-void emlog_init(int min_level, bool timestamps)
-{
-    pthread_mutex_lock(&G.mu);
-    eml_level_t new_level;
-    if(min_level < 0)
-    {
-        const char* env = getenv("EMLOG_LEVEL");
-        new_level       = parse_level(env);
-    }
-    else
-    {
-        new_level = (eml_level_t)min_level;
-    }
-    int new_use_ts = timestamps ? 1 : 0;
-    int need_tz    = new_use_ts && (!G.initialized || !G.use_ts);
+/** @brief Apply a parsed configuration on behalf of @p owner (cfg_mu held). */
+static void cfg_apply_locked(const struct cfg_file* cfg, struct cfg_owner* owner);
 
-    G.min_level = new_level;
-    G.use_ts    = new_use_ts;
-    if(need_tz) tzset();
-    G.initialized = 1;
-    ++G.init_gen;
-    pthread_mutex_unlock(&G.mu);
-    EML_INFO(LOG_TAG, "Initialized emlog (level=%s, timestamps=%s)", lvl_str(new_level),
-             new_use_ts ? "enabled" : "disabled");
-}
+/** @brief Parse on/off, true/false, yes/no or 1/0.
+ *
+ * @return int 0 on success, -1 for an unknown value
+ */
+static int parse_bool(const char* s, int* out);
 
-void emlog_set_level(eml_level_t min_level)
-{
-    pthread_mutex_lock(&G.mu);
-    G.min_level = min_level;
-    pthread_mutex_unlock(&G.mu);
-}
+/** @brief Strip leading/trailing blanks and line endings in place. */
+static char* trim(char* s);
 
-void emlog_enable_timestamps(bool on)
-{
-    pthread_mutex_lock(&G.mu);
-    G.use_ts = on ? 1 : 0;
-    pthread_mutex_unlock(&G.mu);
-}
+#if defined(__linux__)
+/** @brief Watcher thread: reload W.path on every matching inotify event. */
+static void* cfg_watch_main(void* arg);
+#endif
 
-void emlog_set_writer(eml_writer_fn fn, void* user)
-{
-    pthread_mutex_lock(&G.mu);
-    G.writer    = fn;
-    G.writer_ud = user;
-    pthread_mutex_unlock(&G.mu);
-}
+#if defined(__linux__)
+/** @brief Map /dev/shm/emlog.@p name, creating and initializing it when
+ * @p create is set.
+ *
+ * @param name Page name
+ * @param create Whether a missing page is created
+ * @param fd_out Receives the page descriptor
+ * @param err_out Receives the failure reason
+ * @return eml_shm_page_t* Mapped page, or NULL on failure
+ */
+static eml_shm_page_t* shm_map(const char* name, int create, unsigned mode, int* fd_out,
+                               eml_err_t* err_out);
 
-void emlog_set_writev_flush(bool on)
-{
-    pthread_mutex_lock(&G.mu);
-    G.writev_flush = on ? 1 : 0;
-    pthread_mutex_unlock(&G.mu);
-}
+/** @brief Copy a consistent snapshot of @p pg (seqlock read side).
+ *
+ * Gives up after about a second if the sequence stays odd (a writer died
+ * mid-update; the next writer repairs it) or once S.stop is set.
+ *
+ * @param seq_out Receives the (even) sequence number the snapshot matches
+ * @return int 0 on success, -1 when no consistent snapshot was taken
+ */
+static int shm_snapshot(eml_shm_page_t* pg, eml_shm_page_t* out, uint32_t* seq_out);
 
-void emlog_log(eml_level_t level, const char* comp, const char* fmt, ...)
-{
-    pthread_mutex_lock(&G.mu);
-    va_list ap;
-    va_start(ap, fmt);
-    vlog(level, comp, fmt, ap);
-    va_end(ap);
+/** @brief Map @p name, take the writer lock and open a seqlock update.
+ *
+ * @return eml_shm_page_t* Page ready for editing, or NULL (see @p err_out)
+ */
+static eml_shm_page_t* shm_write_begin(const char* name, int* fd_out, eml_err_t* err_out);
+
+/** @brief Close the update, wake every attached process and unmap. */
+static void shm_write_end(eml_shm_page_t* pg, int fd);
+
+/** @brief Watcher thread: mirror each published page change locally. */
+static void* shm_watch_main(void* arg);
+#endif
+
+/** @brief Call a sink's writer with its format and update its counters. */
+static void sink_call(struct sink* s, const eml_record_t* rec);
+
+/** @brief Drop one reference to @p r, freeing it on the last one. */
+static void sink_rec_put(struct sink_rec* r);
+
+/** @brief Worker body for an async sink: pop, write, release. */
+static void* sink_worker_main(void* arg);
+
+/** @brief Hand one line to every registered sink (G.mu held).
+ *
+ * Async sinks get it queued; for synchronous ones the line joins the
+ * thread's deferred list for sink_run_deferred().
+ */
+static void sink_fanout_locked(eml_level_t level, const struct iovec* iov, int iovcnt);
+
+/** @brief Call synchronous sink @p s on @p r (G.mu not held), unless benched. */
+static void sink_call_sync(struct sink* s, struct sink_rec* r);
+
+/** @brief Call the synchronous sinks owed by this thread (G.mu not held).
+ *
+ * Lines logged from inside a sink are appended to the list and handled
+ * by the outermost call.
+ */
+static void sink_run_deferred(void);
+
+/** @brief Account @p bytes written at @p level against the sink's policy.
+ *
+ * @param may_wait Whether the caller is a logging thread that can wait
+ *        (it must then run sink_durable_wait())
+ */
+static void sink_sync_note(struct sink* s, eml_level_t level, size_t bytes, int may_wait);
+
+/** @brief Syncer thread: one durability hook call per due group. */
+static void* sink_syncer_main(void* arg);
+
+/** @brief Block until every sync registered by this thread has finished. */
+static void sink_durable_wait(void);
+
+/** @brief Final sync and join the syncer, if the sink has one. */
+static void sink_stop_syncer(struct sink* s);
+
+/** @brief Release a sink whose threads have exited. */
+static void sink_free(struct sink* s);
+
+/** @brief CLOCK_MONOTONIC in nanoseconds. */
+static uint64_t mono_ns(void);
+
+/** @brief Append "KEY=value\n" (or the binary form) to @p iov.
+ *
+ * @param lenbuf 8 bytes that hold the length for the binary form
+ */
+static int journal_field(struct iovec* iov, int n, const char* key, const char* val, size_t len,
+                         unsigned char* lenbuf);
+
+/** @brief Send one prepared record: datagram first, memfd when too large. */
+static ssize_t journal_send(struct eml_journal_sink* s, struct iovec* iov, int n, size_t total);
+
+/** @brief (Re)open the syslog socket unless still backing off (mu held).
+ *
+ * @return int 1 when connected
+ */
+static int syslog_connect_locked(struct eml_syslog_sink* s);
+
+/** @brief Send the buffered batch and reset it (mu held). */
+static void syslog_flush_locked(struct eml_syslog_sink* s);
+
+/** @brief Hand the buffered batch to the callback and reset it (mu held).
+ *
+ * Drops mu around the callback; records arriving meanwhile go to the
+ * spare buffers.
+ */
+static void batch_flush_locked(struct eml_batch_sink* s);
+
+/** @brief Run the callback on @p n records with mu dropped, after any
+ * callback still running (mu held).
+ *
+ * @return ssize_t The callback's result
+ */
+static ssize_t batch_call_locked(struct eml_batch_sink* s, const eml_record_t* recs, size_t n);
+
+/** @brief Linger thread body for an eml_batch_sink. */
+static void* batch_sink_main(void* arg);
+
+/** @brief Compressor thread body for an eml_lz_sink. */
+static void* lz_sink_main(void* arg);
+
+/** @brief Greedy LZ4-format compressor over one block using @p tab. */
+static size_t lz_compress_tab(const unsigned char* src, size_t n, unsigned char* dst, size_t cap,
+                              uint32_t* tab);
+
+/** @brief Compress buffer @p i and append it as one frame. */
+static void lz_write_frame(struct eml_lz_sink* s, unsigned i);
+
+/** @brief Store @p v little-endian at @p p. */
+static void lz_put32(unsigned char* p, uint32_t v);
+
+/** @brief Unaligned native-endian 32-bit load (hashing and match checks only). */
+static uint32_t lz_read32(const unsigned char* p);
+
+/** @brief Emit 255-continuation bytes for an overlong length field.
+ *
+ * @return int 0, or -1 when @p oend is reached
+ */
+static int lz_put_len(unsigned char** op, unsigned char* oend, size_t len);
+
+#if defined(__linux__)
+/** @brief Copy one line into the splice buffers, splicing full ones (G.mu held). */
+static void pipe_append_locked(eml_level_t level, const struct iovec* iov, int iovcnt);
+
+/** @brief vmsplice() the full buffer and swap (G.mu held).
+ *
+ * Falls back to write() and turns the path off when the pipe has grown
+ * beyond P.cap.
+ */
+static void pipe_splice_full_locked(void);
+
+/** @brief write() the partial buffer and restart it at 0 (G.mu held).
+ *
+ * Pauses splicing when part of it had to be parked.
+ */
+static void pipe_drain_locked(void);
+
+/** @brief write() @p n buffered bytes to P.fd, parking what EAGAIN leaves.
+ *
+ * The first line (when @p cont) and an unterminated last line are
+ * always kept; the policy applies to the whole lines in between.
+ */
+static void pipe_write_locked(const char* p, size_t n, int cont);
+
+/** @brief Whether lines for P.fd may use the buffers, resuming a paused
+ *         path once nothing is parked and the pipe is empty (G.mu held).
+ */
+static int pipe_ready_locked(void);
+
+/** @brief Flusher thread: drain a partial buffer flush_ms after it starts. */
+static void* pipe_flush_main(void* arg);
+#endif
+
+/** @brief writev() a line to @p fd, continuing short writes and parking
+ *         the rest on EAGAIN (G.mu held; @p v is consumed).
+ *
+ * @param cont The bytes continue a line whose start already went out or
+ *             was parked, so the policy must not drop them.
+ */
+static void write_fd_locked(int fd, struct iovec* v, int cnt, int cont);
+
+/** @brief Slot holding parked bytes for @p fd, or NULL. */
+static struct ovf_slot* ovf_find_locked(int fd);
+
+/** @brief write() parked bytes until EAGAIN; a hard error discards them. */
+static void ovf_drain_locked(struct ovf_slot* o);
+
+/** @brief Park @p n unwritten bytes of one or more lines, applying the
+ *         policy when full.
+ *
+ * @param mid The first line's first bytes were already written.
+ */
+static void ovf_park_locked(int fd, const struct iovec* v, int cnt, size_t n, int mid);
+
+/** @brief Discard parked lines, oldest first, until @p n more bytes fit. */
+static void ovf_drop_oldest_locked(struct ovf_slot* o, size_t n);
+
+/** @brief Count discarded bytes as @p counter lines and free the slot. */
+static void ovf_discard_locked(struct ovf_slot* o, _Atomic uint64_t* counter);
+
+/** @brief Queue lines for ovf_block_wait() (G.mu held); drops them when
+ *         the thread already holds a full buffer's worth for @p fd.
+ *
+ * @return int 1 when queued or dropped, 0 when @p fd has no queue and
+ *         @p create is 0.
+ */
+static int ovf_defer_locked(int fd, const struct iovec* v, int cnt, size_t n, int create);
+
+/** @brief Write the lines ovf_defer_locked() queued once their descriptors
+ *         have room, waiting up to block_ms each (G.mu not held). */
+static void ovf_block_wait(void);
+
+/** @brief Drainer thread: poll() descriptors with parked bytes for POLLOUT. */
+static void* ovf_drain_main(void* arg);
+
+/** @brief Writer thread body for an eml_direct_sink. */
+static void* direct_sink_main(void* arg);
+
+/** @brief pwrite() all of @p n bytes at @p off, retrying short writes.
+ *
+ * @return int 0, or -1 on error
+ */
+static int direct_pwrite(int fd, const char* p, size_t n, off_t off);
+
+/** @brief Write the first @p len bytes of the open buffer, padded, then
+ * trim the file to its real end (writer thread only).
+ */
+static void direct_write_tail(struct eml_direct_sink* s, size_t len);
+
+/** @brief Rotation thread body for an eml_file_sink. */
+static void* sink_rotate_main(void* arg);
+
+/** @brief Rename, reopen, swap and prune one sink (rotation thread only). */
+static void sink_rotate(struct eml_file_sink* s);
+
+/** @brief Preallocate and map segment @p idx if needed (map_mu held).
+ *
+ * @return char* Segment base, or NULL on failure
+ */
+static char* mm_map_locked(struct eml_mmap_sink* s, size_t idx);
+
+/** @brief Store a committed PAD record covering @p len bytes at @p p. */
+static void mm_pad(char* p, size_t len);
+
+/** @brief Helper thread body for an eml_mmap_sink. */
+static void* mm_helper_main(void* arg);
+
+/** @brief Find the end of the records already in @p fd (open-time scan). */
+static uint64_t mm_scan_end(int fd, uint64_t size);
+
+/** @brief Hash a component name for the override table.
+ *
+ * 64-bit FNV-1a; never returns 0 so 0 can mark an empty slot. The name
+ * length is computed in the same pass so lookups never call strlen().
+ *
+ * @param comp NUL-terminated component name
+ * @param len_out Receives strlen(comp)
+ * @return uint64_t Non-zero hash value
+ */
+static inline uint64_t comp_hash(const char* comp, size_t* len_out);
+
+/** @brief Locate the table slot holding @p comp.
+ *
+ * Lock-free; safe to call concurrently with emlog_set_component_level().
+ *
+ * @param comp Component name (non-NULL)
+ * @param h Precomputed comp_hash(comp)
+ * @param len Length of @p comp
+ * @return struct comp_slot* Matching slot, or NULL when not present
+ */
+static inline struct comp_slot* comp_find(const char* comp, uint64_t h, size_t len);
+
+/** @brief Find or claim the table slot for @p comp (ctl_mu held).
+ *
+ * @return struct comp_slot* Slot, or NULL when the table is full
+ */
+static struct comp_slot* comp_claim_locked(const char* comp, uint64_t h, size_t len);
+
+/** @brief Resolve @p comp through the call site's cached slot.
+ *
+ * Falls back to comp_hash() + comp_find() when @p cs is NULL or its
+ * component is not the literal @p comp, and refreshes the cache on the
+ * way out.
+ *
+ * @param cs Call site, or NULL for the string API
+ * @param comp Component name (non-NULL)
+ * @return struct comp_slot* Matching slot, or NULL when not present
+ */
+static inline struct comp_slot* comp_lookup(eml_callsite_t* cs, const char* comp);
+
+/** @brief Lock-free admission filter shared by every entry point.
+ *
+ * Applies, in order: forced call sites, the effective minimum level
+ * (component override, else the thread override, else G.min_level) and, when @p sample is set, the
+ * component or per-level sampling rate. Lines below the effective level
+ * but at or above the backtrace threshold are routed to the ring, else
+ * to the flight recorder when it keeps their level. Runs before any
+ * timestamp or formatting work; the component name is hashed at most
+ * once.
+ *
+ * @param cs Call site (nullable)
+ * @param level Line level
+ * @param comp Component name (nullable)
+ * @param sample Whether sampling applies (summary lines are never sampled)
+ * @return int ADMIT_DROP, ADMIT_WRITE, ADMIT_CAPTURE or ADMIT_RING
+ */
+static int admit(eml_callsite_t* cs, eml_level_t level, const char* comp, int sample);
+
+/** @brief Route an admitted line: capture or record it, or write it
+ * (flushing the backtrace ring first for ERROR+ lines).
+ */
+static void deliver(int verdict, eml_callsite_t* cs, eml_level_t level, const char* comp,
+                    const char* fmt, va_list ap);
+
+/** @brief Format a line into the calling thread's backtrace ring (no lock). */
+static void bt_capture(eml_level_t level, const char* comp, const char* fmt, va_list ap);
+
+/** @brief Write and clear the calling thread's backtrace ring (G.mu held). */
+static void bt_flush_locked(eml_level_t level, const char* comp);
+
+/** @brief Whether the flight recorder keeps lines of @p level. */
+static int ring_keeps(eml_level_t level);
+
+/** @brief Format a below-level line straight into the flight recorder. */
+static void ring_capture(eml_level_t level, const char* comp, const char* fmt, va_list ap);
+
+/** @brief Reserve, fill and publish one record (lock-free). */
+static void ring_append(eml_level_t level, const struct iovec* iov, int iovcnt);
+
+/** @brief Copy @p n bytes to/from absolute position @p at, wrapping at the end. */
+static void ring_copy_in(unsigned char* data, uint64_t mask, uint64_t at, const void* src,
+                         size_t n);
+static void ring_copy_out(void* dst, const unsigned char* data, uint64_t mask, uint64_t at,
+                          size_t n);
+
+/** @brief Write the valid records of a ring to @p fd (async-signal-safe).
+ *
+ * @param live Other threads may still append: re-check each copy.
+ * @return ssize_t Lines written, or -1 when @p fd failed.
+ */
+static ssize_t ring_walk(const eml_ring_hdr_t* h, const unsigned char* data, int fd, int live);
+
+/** @brief Unpublish and unmap the ring, restore signal handlers (R.ctl held). */
+static void ring_close_locked(void);
+
+/** @brief Fatal-signal handler: dump to R.crash_fd, then re-raise. */
+static void ring_crash_handler(int sig);
+
+/** @brief Emit one line from an iovec array (writev or custom writer). */
+static void write_line_iov(eml_level_t level, struct iovec* iov, int iovcnt);
+
+/** @brief pthread_once callback creating thread_level_key. */
+static void thread_level_make_key(void);
+
+/** @brief pthread key destructor: release an override left at thread exit. */
+static void thread_level_exit(void* arg);
+
+/** @brief Keep-one-in-@p n draw (TLS xorshift, or the thread's sample key). */
+static int sample_draw(unsigned n);
+
+/** @brief Recompute and publish emlog__active_level (ctl_mu held).
+ *
+ * Must be called after any change to a value that feeds the fast-path
+ * level so the inline macro check never rejects a line that the precise
+ * filters would accept.
+ */
+static void refresh_active_level_locked(void);
+
+/** @brief Set or clear a call site's forced-on bit (ctl_mu held). */
+static void cs_set_forced(eml_callsite_t* cs, int on);
+
+/** @brief Recompute one call site's `enabled` byte (ctl_mu held). */
+static void cs_sync_site(eml_callsite_t* cs, int active);
+
+/** @brief Parse "GLOB[:LINE[-LINE]]" into @p r; returns 0 or -1 (errno set). */
+static int cs_parse_spec(const char* spec, int on, struct cs_rule* r);
+
+/** @brief Whether call site @p cs is selected by rule @p r. */
+static int cs_match(const eml_callsite_t* cs, const struct cs_rule* r);
+
+/** @brief Record a rule and apply it to every registered site.
+ *
+ * @return int Number of sites matched, or -1 on error.
+ */
+static int cs_apply_spec(const char* spec, int on);
+
+/** @brief Lock-free filter + locked emission shared by the public entry points.
+ *
+ * Applies the precise level filter (component overrides included) before
+ * taking G.mu, then formats and writes the line via vlog(). Call sites
+ * forced on with emlog_callsite_enable() bypass the level filter.
+ *
+ * @param cs Originating call site (nullable)
+ * @param level Log level
+ * @param comp Component name (nullable)
+ * @param fmt Printf-style format string
+ * @param ap   va_list of arguments
+ */
+static void emit_va(eml_callsite_t* cs, eml_level_t level, const char* comp, const char* fmt,
+                    va_list ap);
+
+/** @brief Varargs writer for internal summary lines (level-filtered, never sampled). */
+static void emit(eml_callsite_t* cs, eml_level_t level, const char* comp, const char* fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+/** @brief Write a limiter's "suppressed" summary line. */
+static void rl_summary(eml_callsite_t* cs, eml_level_t level, const char* comp,
+                       unsigned long long dropped);
+
+/** @brief Put @p rl on the summary timer, due at @p due (mono_ns()). */
+static void rl_queue(eml_ratelimit_t* rl, eml_callsite_t* cs, eml_level_t level, const char* comp,
+                     uint64_t due);
+
+/** @brief Make the summary timer wake by @p due for dedup runs (G.mu held). */
+static void summary_arm_dedup(uint64_t due);
+
+/** @brief Start the summary timer thread unless it runs (T.mu held). */
+static void summary_start_locked(void);
+
+/** @brief Summary timer thread: writes counts nobody claimed in time. */
+static void* summary_main(void* arg);
+
+/** @brief Shared implementation of emlog_log_errno() and EML_PERR(). */
+static void log_errno_va(eml_callsite_t* cs, eml_level_t level, const char* comp, int err,
+                         const char* fmt, va_list ap);
+
+/** @brief Build the "<ts> <lvl> [tid] [comp] " line header.
+ *
+ * @return int Header length (0 on formatting failure)
+ */
+static int format_header(char* head, size_t n, const char* ts, eml_level_t level, uint64_t tid,
+                         const char* comp);
+
+/** @brief Decide whether a formatted line repeats the previous one (G.mu held).
+ *
+ * Updates the calling thread's run state; when the line differs or the
+ * window expired, the pending "repeated" summary is written first.
+ *
+ * @return int Non-zero when the line must be suppressed
+ */
+static int dedup_check(eml_level_t level, const char* comp, const char* msg, size_t msglen,
+                       const char* ts, uint64_t tid);
+
+/** @brief Write the pending "repeated" summary of @p d and unlink it (G.mu held). */
+static void dedup_flush_locked(struct dedup_state* d, const char* ts);
+
+/** @brief Summary timer: report the runs whose window has ended. */
+static void dedup_expire(void);
+
+/** @brief pthread key destructor: summarize a run left open at thread exit. */
+static void dedup_thread_exit(void* arg);
+
+/** @brief Core varargs logger implementation (expects mutex to be held).
+ * 
+ * Formats and emits a log line; callers have already filtered it.
+ * 
+ * @param level Log level
+ * @param comp Component name (nullable)
+ * @param fmt Printf-style format string
+ * @param ap   va_list of arguments
+ */
+static void vlog(eml_level_t level, const char* comp, const char* fmt, va_list ap);
+
+/* --------------------------------------------------------------------------
+ * Public API implementations
+ *
+ * These definitions are placed before the static implementations so the file
+ * reads as: helpers declarations -> public API -> private helpers. Each
+ * public function has a brief Doxygen comment matching the header to keep
+ * docs consistent for readers of the .c file.
+ * -------------------------------------------------------------------------- */
+
+void emlog_init(int min_level, bool timestamps)
+{
+    pthread_mutex_lock(&G.mu);
+    eml_level_t new_level;
+    if(min_level < 0)
+    {
+        const char* env = getenv("EMLOG_LEVEL");
+        new_level       = parse_level(env);
+    }
+    else
+    {
+        new_level = (eml_level_t)min_level;
+    }
+    int new_use_ts = timestamps ? 1 : 0;
+    int need_tz    = new_use_ts && (!G.initialized || !G.use_ts);
+
+    G.use_ts = new_use_ts;
+    if(need_tz) tzset();
+    G.initialized = 1;
+    ++G.init_gen;
     pthread_mutex_unlock(&G.mu);
+
+    pthread_mutex_lock(&ctl_mu);
+    atomic_store_explicit(&G.min_level, (int)new_level, memory_order_release);
+    refresh_active_level_locked();
+    pthread_mutex_unlock(&ctl_mu);
+    EML_INFO(LOG_TAG, "Initialized emlog (level=%s, timestamps=%s)", lvl_str(new_level),
+             new_use_ts ? "enabled" : "disabled");
+
+    const char* shm = getenv("EMLOG_SHM");
+    if(shm && *shm)
+    {
+        const char* env  = getenv("EMLOG_SHM_MODE");
+        unsigned    mode = env ? (unsigned)strtoul(env, NULL, 8) : 0u;
+        eml_err_t   rc   = emlog_shm_attach_mode(shm, mode);
+        if(rc != EML_OK && rc != EML_CONFLICT)
+            EML_WARN(LOG_TAG, "cannot attach control page %s (%d)", shm, (int)rc);
+    }
+}
+
+void emlog_set_level(eml_level_t min_level)
+{
+    pthread_mutex_lock(&ctl_mu);
+    atomic_store_explicit(&G.min_level, (int)min_level, memory_order_release);
+    refresh_active_level_locked();
+    pthread_mutex_unlock(&ctl_mu);
+}
+
+eml_err_t emlog_set_component_level(const char* comp, int min_level)
+{
+    if(!comp) return EML_BAD_INPUT;
+    size_t   len;
+    uint64_t h = comp_hash(comp, &len);
+    if(len == 0 || len >= EMLOG_COMPONENT_NAME_MAX) return EML_BAD_INPUT;
+    int lvl = min_level < 0 ? COMP_INHERIT : min_level;
+
+    pthread_mutex_lock(&ctl_mu);
+    struct comp_slot* slot = comp_find(comp, h, len);
+    if(!slot)
+    {
+        if(lvl == COMP_INHERIT)
+        {
+            pthread_mutex_unlock(&ctl_mu);
+            return EML_OK; /* nothing to clear */
+        }
+        slot = comp_claim_locked(comp, h, len);
+        if(!slot)
+        {
+            pthread_mutex_unlock(&ctl_mu);
+            return EML_TEMP_RESOURCE;
+        }
+    }
+
+    int prev = atomic_exchange_explicit(&slot->level, lvl, memory_order_release);
+    if(prev == COMP_INHERIT && lvl != COMP_INHERIT)
+        atomic_fetch_add_explicit(&comp_active, 1u, memory_order_release);
+    else if(prev != COMP_INHERIT && lvl == COMP_INHERIT)
+        atomic_fetch_sub_explicit(&comp_active, 1u, memory_order_release);
+    refresh_active_level_locked();
+    pthread_mutex_unlock(&ctl_mu);
+    return EML_OK;
+}
+
+int emlog_get_component_level(const char* comp)
+{
+    if(!comp) return COMP_INHERIT;
+    size_t            len;
+    uint64_t          h    = comp_hash(comp, &len);
+    struct comp_slot* slot = comp_find(comp, h, len);
+    return slot ? atomic_load_explicit(&slot->level, memory_order_acquire) : COMP_INHERIT;
+}
+
+eml_err_t emlog_thread_set_level(int level)
+{
+    if(level > EML_LEVEL_CRIT) return EML_BAD_INPUT;
+    if(level < 0) level = -1;
+    int old = thread_level_tls;
+    if(old == level) return EML_OK;
+
+    pthread_once(&thread_level_once, thread_level_make_key);
+    pthread_mutex_lock(&ctl_mu);
+    if(old >= 0) atomic_fetch_sub_explicit(&thread_levels[old], 1u, memory_order_release);
+    if(level >= 0) atomic_fetch_add_explicit(&thread_levels[level], 1u, memory_order_release);
+    thread_level_tls = level;
+    refresh_active_level_locked();
+    pthread_mutex_unlock(&ctl_mu);
+    pthread_setspecific(thread_level_key, level >= 0 ? (void*)(intptr_t)(level + 1) : NULL);
+    return EML_OK;
+}
+
+int emlog_thread_get_level(void)
+{
+    return thread_level_tls;
+}
+
+int emlog_thread_push_level(eml_level_t level)
+{
+    int prev = thread_level_tls;
+    emlog_thread_set_level((int)level);
+    return prev;
+}
+
+void emlog_thread_pop_level(int token)
+{
+    emlog_thread_set_level(token);
+}
+
+eml_err_t emlog_set_sampling(eml_level_t level, unsigned n)
+{
+    if((unsigned)level > EML_LEVEL_CRIT) return EML_BAD_INPUT;
+    atomic_store_explicit(&level_sample[level], n > 1 ? n : 0u, memory_order_relaxed);
+    return EML_OK;
+}
+
+eml_err_t emlog_set_component_sampling(const char* comp, unsigned n)
+{
+    if(!comp) return EML_BAD_INPUT;
+    size_t   len;
+    uint64_t h = comp_hash(comp, &len);
+    if(len == 0 || len >= EMLOG_COMPONENT_NAME_MAX) return EML_BAD_INPUT;
+    n = n > 1 ? n : 0u;
+
+    pthread_mutex_lock(&ctl_mu);
+    struct comp_slot* slot = comp_find(comp, h, len);
+    if(!slot)
+    {
+        if(!n)
+        {
+            pthread_mutex_unlock(&ctl_mu);
+            return EML_OK;
+        }
+        slot = comp_claim_locked(comp, h, len);
+        if(!slot)
+        {
+            pthread_mutex_unlock(&ctl_mu);
+            return EML_TEMP_RESOURCE;
+        }
+    }
+
+    unsigned prev = atomic_exchange_explicit(&slot->sample, n, memory_order_release);
+    if(!prev && n)
+        atomic_fetch_add_explicit(&comp_sampled, 1u, memory_order_release);
+    else if(prev && !n)
+        atomic_fetch_sub_explicit(&comp_sampled, 1u, memory_order_release);
+    pthread_mutex_unlock(&ctl_mu);
+    return EML_OK;
+}
+
+void emlog_set_sample_key(uint64_t id)
+{
+    sample_key_tls     = id;
+    sample_key_set_tls = 1;
+}
+
+void emlog_clear_sample_key(void)
+{
+    sample_key_set_tls = 0;
+}
+
+eml_err_t emlog_config_load(const char* path)
+{
+    if(!path) return EML_BAD_INPUT;
+    struct cfg_file* cfg = malloc(sizeof *cfg);
+    if(!cfg) return EML_TEMP_RESOURCE;
+    eml_err_t rc = cfg_parse(path, cfg);
+    if(rc == EML_OK)
+    {
+        pthread_mutex_lock(&cfg_mu);
+        cfg_apply_locked(cfg, &cfg_file_owned);
+        pthread_mutex_unlock(&cfg_mu);
+    }
+    free(cfg);
+    return rc;
+}
+
+eml_err_t emlog_config_watch(const char* path)
+{
+#if defined(__linux__)
+    if(!path || !*path || strlen(path) >= sizeof W.path) return EML_BAD_INPUT;
+
+    pthread_mutex_lock(&W.mu);
+    if(W.running)
+    {
+        pthread_mutex_unlock(&W.mu);
+        return EML_CONFLICT;
+    }
+
+    /* split into directory (watched) and base name (matched) */
+    char        dir[PATH_MAX];
+    const char* slash = strrchr(path, '/');
+    const char* base  = slash ? slash + 1 : path;
+    size_t      dlen  = slash ? (size_t)(slash - path) : 0;
+    if(!*base || strlen(base) >= sizeof W.base)
+    {
+        pthread_mutex_unlock(&W.mu);
+        return EML_BAD_INPUT;
+    }
+    if(slash && dlen == 0) dlen = 1; /* "/file" watches "/" */
+    memcpy(dir, slash ? path : ".", slash ? dlen : 1);
+    dir[slash ? dlen : 1] = '\0';
+    strcpy(W.path, path);
+    strcpy(W.base, base);
+
+    W.ino_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if(W.ino_fd < 0 ||
+       inotify_add_watch(W.ino_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0 ||
+       pipe2(W.stop_fd, O_CLOEXEC) < 0)
+    {
+        if(W.ino_fd >= 0) close(W.ino_fd);
+        W.ino_fd = -1;
+        pthread_mutex_unlock(&W.mu);
+        return EML_TEMP_UNAVAILABLE;
+    }
+
+    /* initial load: a missing file is fine, it may be created later */
+    eml_err_t rc = emlog_config_load(path);
+    if(rc == EML_NOT_FOUND) rc = EML_OK;
+
+    if(pthread_create(&W.th, NULL, cfg_watch_main, NULL) != 0)
+    {
+        close(W.ino_fd);
+        close(W.stop_fd[0]);
+        close(W.stop_fd[1]);
+        W.ino_fd     = -1;
+        W.stop_fd[0] = W.stop_fd[1] = -1;
+        pthread_mutex_unlock(&W.mu);
+        return EML_TEMP_UNAVAILABLE;
+    }
+    W.running = 1;
+    pthread_mutex_unlock(&W.mu);
+    return rc;
+#else
+    (void)path;
+    return EML_TEMP_UNAVAILABLE;
+#endif
+}
+
+void emlog_config_unwatch(void)
+{
+#if defined(__linux__)
+    pthread_mutex_lock(&W.mu);
+    if(!W.running)
+    {
+        pthread_mutex_unlock(&W.mu);
+        return;
+    }
+    char b = 0;
+    while(write(W.stop_fd[1], &b, 1) < 0 && errno == EINTR)
+    {
+    }
+    pthread_join(W.th, NULL);
+    close(W.ino_fd);
+    close(W.stop_fd[0]);
+    close(W.stop_fd[1]);
+    W.ino_fd     = -1;
+    W.stop_fd[0] = W.stop_fd[1] = -1;
+    W.running    = 0;
+    pthread_mutex_unlock(&W.mu);
+#endif
+}
+
+eml_err_t emlog_shm_attach(const char* name)
+{
+    return emlog_shm_attach_mode(name, 0);
+}
+
+eml_err_t emlog_shm_attach_mode(const char* name, unsigned mode)
+{
+#if defined(__linux__)
+    if(!mode) mode = EMLOG_SHM_MODE;
+    if((mode & ~0777u) || (mode & 0600u) != 0600u) return EML_BAD_INPUT;
+    pthread_mutex_lock(&S.mu);
+    if(S.page)
+    {
+        pthread_mutex_unlock(&S.mu);
+        return EML_CONFLICT;
+    }
+    eml_err_t       rc;
+    eml_shm_page_t* pg = shm_map(name, 1, mode, &S.fd, &rc);
+    if(!pg)
+    {
+        pthread_mutex_unlock(&S.mu);
+        return rc;
+    }
+    /* the page decides our levels: only follow one we or root own */
+    struct stat st;
+    if(fstat(S.fd, &st) < 0 || (st.st_uid != geteuid() && st.st_uid != 0) ||
+       (st.st_uid == geteuid() && (st.st_mode & 0777u) != mode && fchmod(S.fd, (mode_t)mode) < 0))
+    {
+        munmap(pg, sizeof *pg);
+        close(S.fd);
+        S.fd = -1;
+        pthread_mutex_unlock(&S.mu);
+        return EML_PERM;
+    }
+    S.page = pg;
+    atomic_store_explicit(&S.stop, 0, memory_order_relaxed);
+    if(pthread_create(&S.th, NULL, shm_watch_main, pg) != 0)
+    {
+        munmap(pg, sizeof *pg);
+        close(S.fd);
+        S.page = NULL;
+        S.fd   = -1;
+        pthread_mutex_unlock(&S.mu);
+        return EML_TEMP_UNAVAILABLE;
+    }
+    pthread_mutex_unlock(&S.mu);
+    return EML_OK;
+#else
+    (void)name;
+    (void)mode;
+    return EML_TEMP_UNAVAILABLE;
+#endif
+}
+
+void emlog_shm_detach(void)
+{
+#if defined(__linux__)
+    pthread_mutex_lock(&S.mu);
+    if(!S.page)
+    {
+        pthread_mutex_unlock(&S.mu);
+        return;
+    }
+    /* the wake also reaches other processes' watchers; they find seq
+     * unchanged and go back to sleep */
+    atomic_store_explicit(&S.stop, 1, memory_order_release);
+    syscall(SYS_futex, &S.page->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    pthread_join(S.th, NULL);
+    munmap(S.page, sizeof *S.page);
+    close(S.fd);
+    S.page = NULL;
+    S.fd   = -1;
+    pthread_mutex_unlock(&S.mu);
+#endif
+}
+
+eml_err_t emlog_shm_set_level(const char* name, int level)
+{
+#if defined(__linux__)
+    if(level > EML_LEVEL_CRIT) return EML_BAD_INPUT;
+    int             fd;
+    eml_err_t       rc;
+    eml_shm_page_t* pg = shm_write_begin(name, &fd, &rc);
+    if(!pg) return rc;
+    if(level < 0)
+        pg->flags &= ~EMLOG_SHM_LEVEL;
+    else
+    {
+        pg->level  = level;
+        pg->flags |= EMLOG_SHM_LEVEL;
+    }
+    shm_write_end(pg, fd);
+    return EML_OK;
+#else
+    (void)name;
+    (void)level;
+    return EML_TEMP_UNAVAILABLE;
+#endif
+}
+
+eml_err_t emlog_shm_set_component_level(const char* name, const char* comp, int level)
+{
+#if defined(__linux__)
+    if(!comp || !*comp || strlen(comp) >= EMLOG_COMPONENT_NAME_MAX || level > EML_LEVEL_CRIT)
+        return EML_BAD_INPUT;
+    int             fd;
+    eml_err_t       rc;
+    eml_shm_page_t* pg = shm_write_begin(name, &fd, &rc);
+    if(!pg) return rc;
+
+    unsigned n = pg->ncomp < EMLOG_MAX_COMPONENTS ? pg->ncomp : EMLOG_MAX_COMPONENTS;
+    unsigned i = 0;
+    while(i < n && strcmp(pg->comp[i].name, comp))
+        ++i;
+    rc = EML_OK;
+    if(level < 0)
+    {
+        if(i < n) /* remove: move the last entry into the hole */
+        {
+            pg->comp[i] = pg->comp[n - 1];
+            pg->ncomp   = n - 1;
+        }
+    }
+    else if(i < n)
+        pg->comp[i].level = level;
+    else if(n < EMLOG_MAX_COMPONENTS)
+    {
+        memset(pg->comp[n].name, 0, sizeof pg->comp[n].name);
+        memcpy(pg->comp[n].name, comp, strlen(comp));
+        pg->comp[n].level = level;
+        pg->ncomp         = n + 1;
+    }
+    else
+        rc = EML_TEMP_RESOURCE;
+    shm_write_end(pg, fd);
+    return rc;
+#else
+    (void)name;
+    (void)comp;
+    (void)level;
+    return EML_TEMP_UNAVAILABLE;
+#endif
+}
+
+eml_err_t emlog_shm_set_timestamps(const char* name, int on)
+{
+#if defined(__linux__)
+    int             fd;
+    eml_err_t       rc;
+    eml_shm_page_t* pg = shm_write_begin(name, &fd, &rc);
+    if(!pg) return rc;
+    if(on < 0)
+        pg->flags &= ~EMLOG_SHM_TS;
+    else
+    {
+        pg->timestamps  = on ? 1 : 0;
+        pg->flags      |= EMLOG_SHM_TS;
+    }
+    shm_write_end(pg, fd);
+    return EML_OK;
+#else
+    (void)name;
+    (void)on;
+    return EML_TEMP_UNAVAILABLE;
+#endif
+}
+
+eml_err_t emlog_shm_read(const char* name, eml_shm_page_t* out)
+{
+#if defined(__linux__)
+    if(!out) return EML_BAD_INPUT;
+    int             fd;
+    eml_err_t       rc;
+    eml_shm_page_t* pg = shm_map(name, 0, 0, &fd, &rc);
+    if(!pg) return rc;
+    uint32_t seq;
+    int      ok = shm_snapshot(pg, out, &seq) == 0;
+    munmap(pg, sizeof *pg);
+    close(fd);
+    return ok ? EML_OK : EML_TRY_AGAIN;
+#else
+    (void)name;
+    (void)out;
+    return EML_TEMP_UNAVAILABLE;
+#endif
+}
+
+eml_err_t emlog_file_sink_open(const eml_file_sink_cfg_t* cfg, eml_file_sink_t** out)
+{
+    if(!cfg || !out || !cfg->path || !*cfg->path) return EML_BAD_INPUT;
+    if(strlen(cfg->path) + 16 >= PATH_MAX) return EML_BAD_INPUT; /* room for ".N" */
+
+    struct eml_file_sink* s = calloc(1, sizeof *s);
+    if(!s) return EML_TEMP_RESOURCE;
+    strcpy(s->path, cfg->path);
+    s->max_bytes = cfg->max_bytes;
+    s->interval  = cfg->interval_s;
+    s->keep      = cfg->keep;
+    s->mode      = cfg->mode ? cfg->mode : 0644u;
+
+    int fd = open(s->path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, (mode_t)s->mode);
+    if(fd < 0)
+    {
+        eml_err_t rc = (errno == EACCES || errno == EPERM) ? EML_PERM : EML_FATAL_IO;
+        free(s);
+        return rc;
+    }
+    struct stat st;
+    atomic_store(&s->bytes, fstat(fd, &st) == 0 ? (uint64_t)st.st_size : 0u);
+    atomic_store(&s->fd, fd);
+
+    if(pipe(s->wake) < 0)
+    {
+        close(fd);
+        free(s);
+        return EML_TEMP_RESOURCE;
+    }
+    for(int i = 0; i < 2; ++i)
+    {
+        fcntl(s->wake[i], F_SETFD, FD_CLOEXEC);
+        fcntl(s->wake[i], F_SETFL, O_NONBLOCK);
+    }
+    if(pthread_create(&s->th, NULL, sink_rotate_main, s) != 0)
+    {
+        close(s->wake[0]);
+        close(s->wake[1]);
+        close(fd);
+        free(s);
+        return EML_TEMP_RESOURCE;
+    }
+    *out = s;
+    return EML_OK;
+}
+
+ssize_t emlog_file_sink_write(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct eml_file_sink* s = (struct eml_file_sink*)user;
+    if(!s) return -1;
+
+    char         nl     = '\n';
+    struct iovec iov[2] = {{(void*)(uintptr_t)line, n}, {&nl, 1}};
+    atomic_fetch_add(&s->inflight, 1);
+    ssize_t w = writev(atomic_load(&s->fd), iov, 2);
+    atomic_fetch_sub(&s->inflight, 1);
+
+    if(w > 0)
+    {
+        uint64_t size = atomic_fetch_add_explicit(&s->bytes, (uint64_t)w, memory_order_relaxed) +
+                        (uint64_t)w;
+        if(s->max_bytes && size >= s->max_bytes) emlog_file_sink_rotate(s);
+    }
+    return w;
+}
+
+ssize_t emlog_file_sink_write_iov(eml_level_t lvl, const struct iovec* iov, int iovcnt,
+                                  void* user)
+{
+    (void)lvl;
+    struct eml_file_sink* s = (struct eml_file_sink*)user;
+    if(!s || iovcnt < 1) return -1;
+
+    char         nl = '\n';
+    struct iovec v[16];
+    int          cnt = 0;
+    for(int i = 0; i < iovcnt && cnt < (int)(sizeof v / sizeof v[0]) - 1; ++i)
+        v[cnt++] = iov[i];
+    v[cnt].iov_base = &nl;
+    v[cnt].iov_len  = 1;
+    ++cnt;
+
+    atomic_fetch_add(&s->inflight, 1);
+    ssize_t w = writev(atomic_load(&s->fd), v, cnt);
+    atomic_fetch_sub(&s->inflight, 1);
+
+    if(w > 0)
+    {
+        uint64_t size = atomic_fetch_add_explicit(&s->bytes, (uint64_t)w, memory_order_relaxed) +
+                        (uint64_t)w;
+        if(s->max_bytes && size >= s->max_bytes) emlog_file_sink_rotate(s);
+    }
+    return w;
+}
+
+void emlog_file_sink_rotate(eml_file_sink_t* sink)
+{
+    if(!sink) return;
+    if(atomic_exchange(&sink->pending, 1)) return; /* already requested */
+    char b = 0;
+    (void)!write(sink->wake[1], &b, 1);            /* non-blocking poke */
+}
+
+int emlog_file_sink_sync(void* user)
+{
+    struct eml_file_sink* s = (struct eml_file_sink*)user;
+    if(!s) return -1;
+    /* pinned like a writer, so rotation cannot close the descriptor under us */
+    atomic_store(&s->durable, 1);
+    atomic_fetch_add(&s->inflight, 1);
+#if defined(__linux__)
+    int rc = fdatasync(atomic_load(&s->fd));
+#else
+    int rc = fsync(atomic_load(&s->fd));
+#endif
+    atomic_fetch_sub(&s->inflight, 1);
+    return rc;
+}
+
+void emlog_file_sink_close(eml_file_sink_t* sink)
+{
+    if(!sink) return;
+    atomic_store(&sink->stop, 1);
+    char b = 0;
+    (void)!write(sink->wake[1], &b, 1);
+    pthread_join(sink->th, NULL);
+    close(sink->wake[0]);
+    close(sink->wake[1]);
+    close(atomic_load(&sink->fd));
+    free(sink);
+}
+
+eml_err_t emlog_mmap_sink_open(const eml_mmap_sink_cfg_t* cfg, eml_mmap_sink_t** out)
+{
+    if(!cfg || !out || !cfg->path || !*cfg->path) return EML_BAD_INPUT;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t segb = cfg->segment_bytes ? cfg->segment_bytes : (size_t)16 << 20;
+    segb        = (segb + page - 1) / page * page;
+    if(segb > EMLOG_MMAP_LEN_MASK) return EML_BAD_INPUT;
+
+    struct eml_mmap_sink* s = calloc(1, sizeof *s);
+    if(!s) return EML_TEMP_RESOURCE;
+    s->seg_bytes = segb;
+    s->sync_ms   = cfg->sync_ms ? cfg->sync_ms : 1000u;
+    pthread_mutex_init(&s->map_mu, NULL);
+
+    s->fd = open(cfg->path, O_RDWR | O_CREAT | O_CLOEXEC, (mode_t)(cfg->mode ? cfg->mode : 0644u));
+    if(s->fd < 0)
+    {
+        eml_err_t rc = (errno == EACCES || errno == EPERM) ? EML_PERM : EML_FATAL_IO;
+        free(s);
+        return rc;
+    }
+    struct stat st;
+    if(fstat(s->fd, &st) < 0) goto io_fail;
+    uint64_t end = mm_scan_end(s->fd, (uint64_t)st.st_size);
+    atomic_store(&s->tail, end);
+    s->synced  = end;
+    s->retired = (size_t)(end / segb);
+
+    pthread_mutex_lock(&s->map_mu);
+    char* first = mm_map_locked(s, (size_t)(end / segb));
+    pthread_mutex_unlock(&s->map_mu);
+    if(!first || pipe(s->wake) < 0) goto io_fail;
+    for(int i = 0; i < 2; ++i)
+    {
+        fcntl(s->wake[i], F_SETFD, FD_CLOEXEC);
+        fcntl(s->wake[i], F_SETFL, O_NONBLOCK);
+    }
+    if(pthread_create(&s->th, NULL, mm_helper_main, s) != 0)
+    {
+        close(s->wake[0]);
+        close(s->wake[1]);
+        goto io_fail;
+    }
+    *out = s;
+    return EML_OK;
+
+io_fail:
+    for(size_t i = 0; i < MM_MAX_SEGS; ++i)
+    {
+        char* b = atomic_load(&s->seg[i].base);
+        if(b) munmap(b, segb);
+    }
+    close(s->fd);
+    pthread_mutex_destroy(&s->map_mu);
+    free(s);
+    return EML_FATAL_IO;
+}
+
+ssize_t emlog_mmap_sink_write(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct eml_mmap_sink* s = (struct eml_mmap_sink*)user;
+    if(!s) return -1;
+    size_t segb = s->seg_bytes;
+    size_t rec  = (4u + n + 1u + 7u) & ~(size_t)7u;
+    if(rec > segb)
+    {
+        atomic_fetch_add_explicit(&s->dropped, 1u, memory_order_relaxed);
+        return -1;
+    }
+
+    for(;;)
+    {
+        uint64_t off = atomic_fetch_add_explicit(&s->tail, rec, memory_order_relaxed);
+        size_t   idx = (size_t)(off / segb);
+        size_t   in  = (size_t)(off % segb);
+        if(idx + 1 >= MM_MAX_SEGS)
+        {
+            atomic_fetch_add_explicit(&s->dropped, 1u, memory_order_relaxed);
+            return -1;
+        }
+
+        struct mm_seg* g = &s->seg[idx];
+        atomic_fetch_add(&g->writers, 1u);
+        char* base = atomic_load(&g->base);
+        if(!base)
+        {
+            /* helper fell behind (or retired it): map it ourselves */
+            pthread_mutex_lock(&s->map_mu);
+            base = mm_map_locked(s, idx);
+            pthread_mutex_unlock(&s->map_mu);
+            if(!base)
+            {
+                atomic_fetch_sub(&g->writers, 1u);
+                atomic_fetch_add_explicit(&s->dropped, 1u, memory_order_relaxed);
+                return -1;
+            }
+        }
+
+        if(in + rec > segb)
+        {
+            /* straddles the boundary: pad both pieces and retry */
+            mm_pad(base + in, segb - in);
+            atomic_fetch_sub(&g->writers, 1u);
+            struct mm_seg* g2 = &s->seg[idx + 1];
+            atomic_fetch_add(&g2->writers, 1u);
+            char* b2 = atomic_load(&g2->base);
+            if(!b2)
+            {
+                pthread_mutex_lock(&s->map_mu);
+                b2 = mm_map_locked(s, idx + 1);
+                pthread_mutex_unlock(&s->map_mu);
+            }
+            if(b2) mm_pad(b2, in + rec - segb);
+            atomic_fetch_sub(&g2->writers, 1u);
+            continue;
+        }
+
+        uint32_t* hdr = (uint32_t*)(void*)(base + in);
+        uint32_t  len = (uint32_t)(n + 1u);
+        __atomic_store_n(hdr, len, __ATOMIC_RELAXED); /* reserved */
+        memcpy(base + in + 4, line, n);
+        base[in + 4 + n] = '\n';
+        __atomic_store_n(hdr, len | EMLOG_MMAP_COMMITTED, __ATOMIC_RELEASE);
+        atomic_fetch_sub(&g->writers, 1u);
+
+        if(in < segb - segb / 4 && in + rec >= segb - segb / 4)
+        {
+            char b = 0; /* three quarters full: let the helper map ahead */
+            (void)!write(s->wake[1], &b, 1);
+        }
+        return (ssize_t)len;
+    }
+}
+
+uint64_t emlog_mmap_sink_dropped(const eml_mmap_sink_t* sink)
+{
+    return sink ? atomic_load_explicit(&sink->dropped, memory_order_relaxed) : 0u;
+}
+
+void emlog_mmap_sink_close(eml_mmap_sink_t* sink)
+{
+    if(!sink) return;
+    atomic_store(&sink->stop, 1);
+    char b = 0;
+    (void)!write(sink->wake[1], &b, 1);
+    pthread_join(sink->th, NULL);
+    close(sink->wake[0]);
+    close(sink->wake[1]);
+
+    for(size_t i = 0; i < MM_MAX_SEGS; ++i)
+    {
+        char* base = atomic_load(&sink->seg[i].base);
+        if(base) munmap(base, sink->seg_bytes);
+    }
+    /* drop the preallocated zero tail so the file ends at the last record */
+    uint64_t end = atomic_load(&sink->tail);
+    uint64_t cap = (uint64_t)(MM_MAX_SEGS - 1) * sink->seg_bytes;
+    if(ftruncate(sink->fd, (off_t)(end < cap ? end : cap)) < 0)
+    {
+        /* the zero tail is harmless to readers: a 0 header ends the scan */
+    }
+    close(sink->fd);
+    pthread_mutex_destroy(&sink->map_mu);
+    free(sink);
+}
+
+eml_err_t emlog_sink_add(const eml_sink_cfg_t* cfg, int* id)
+{
+    if(!cfg || !id || !cfg->fn == !cfg->record || (cfg->level_mask & ~EML_LEVEL_MASK_ALL) ||
+       cfg->format > EML_SINK_FMT_MSG)
+        return EML_BAD_INPUT;
+    const eml_sync_policy_t* dp       = &cfg->durability;
+    int                      triggers = dp->every_ms || dp->every_bytes || dp->level_mask;
+    if(!dp->fn != !triggers || (dp->level_mask & ~EML_LEVEL_MASK_ALL)) return EML_BAD_INPUT;
+
+    struct sink* s = calloc(1, sizeof *s);
+    if(!s) return EML_TEMP_RESOURCE;
+    s->cfg = *cfg;
+    if(!s->cfg.level_mask) s->cfg.level_mask = EML_LEVEL_MASK_ALL;
+    s->budget = (uint64_t)(cfg->budget_ms ? cfg->budget_ms : EMLOG_SINK_BUDGET_MS) * 1000000ull;
+    pthread_mutex_init(&s->qmu, NULL);
+    pthread_cond_init(&s->qcv, NULL);
+    pthread_mutex_init(&s->cmu, NULL);
+    pthread_cond_init(&s->ccv, NULL);
+    pthread_mutex_init(&s->smu, NULL);
+    pthread_cond_init(&s->scv, NULL);
+    pthread_cond_init(&s->sdcv, NULL);
+    if(dp->fn && pthread_create(&s->sth, NULL, sink_syncer_main, s) != 0)
+    {
+        sink_free(s);
+        return EML_TEMP_RESOURCE;
+    }
+    if(s->cfg.queue_len)
+    {
+        s->q = calloc(s->cfg.queue_len, sizeof *s->q);
+        if(!s->q || pthread_create(&s->th, NULL, sink_worker_main, s) != 0)
+        {
+            sink_stop_syncer(s);
+            sink_free(s);
+            return EML_TEMP_RESOURCE;
+        }
+    }
+
+    pthread_mutex_lock(&G.mu);
+    int slot = -1;
+    for(int i = 0; i < EMLOG_MAX_SINKS && slot < 0; ++i)
+        if(!sinks[i]) slot = i;
+    if(slot >= 0)
+    {
+        sinks[slot] = s;
+        ++sink_count;
+    }
+    pthread_mutex_unlock(&G.mu);
+
+    if(slot < 0)
+    {
+        if(s->cfg.queue_len) /* nothing was queued; just retire the worker */
+        {
+            pthread_mutex_lock(&s->qmu);
+            s->stop = 1;
+            pthread_cond_signal(&s->qcv);
+            pthread_mutex_unlock(&s->qmu);
+            pthread_join(s->th, NULL);
+        }
+        sink_stop_syncer(s);
+        sink_free(s);
+        return EML_TEMP_RESOURCE;
+    }
+    *id = slot;
+    return EML_OK;
+}
+
+eml_err_t emlog_sink_remove(int id)
+{
+    if(id < 0 || id >= EMLOG_MAX_SINKS) return EML_NOT_FOUND;
+
+    pthread_mutex_lock(&G.mu);
+    struct sink* s    = sinks[id];
+    uint64_t     owed = 0;
+    if(s)
+    {
+        sinks[id] = NULL;
+        --sink_count;
+        owed = s->cowed;
+    }
+    pthread_mutex_unlock(&G.mu);
+    if(!s) return EML_NOT_FOUND;
+
+    /* lines handed out before the unlink are still owed a call */
+    pthread_mutex_lock(&s->cmu);
+    s->cwait = 1;
+    while(s->cdone < owed)
+        pthread_cond_wait(&s->ccv, &s->cmu);
+    pthread_mutex_unlock(&s->cmu);
+
+    /* no producer can reach s any more; let the worker drain and exit */
+    if(s->cfg.queue_len)
+    {
+        pthread_mutex_lock(&s->qmu);
+        s->stop = 1;
+        pthread_cond_signal(&s->qcv);
+        pthread_mutex_unlock(&s->qmu);
+        pthread_join(s->th, NULL);
+    }
+    /* last sync, then let every caller still waiting on it go */
+    sink_stop_syncer(s);
+    pthread_mutex_lock(&s->smu);
+    while(s->swait)
+        pthread_cond_wait(&s->sdcv, &s->smu);
+    pthread_mutex_unlock(&s->smu);
+    sink_free(s);
+    return EML_OK;
+}
+
+eml_err_t emlog_sink_stats(int id, eml_sink_stats_t* out)
+{
+    if(!out) return EML_BAD_INPUT;
+    if(id < 0 || id >= EMLOG_MAX_SINKS) return EML_NOT_FOUND;
+
+    eml_err_t rc = EML_NOT_FOUND;
+    pthread_mutex_lock(&G.mu);
+    struct sink* s = sinks[id];
+    if(s)
+    {
+        out->written     = atomic_load(&s->written);
+        out->errors      = atomic_load(&s->errors);
+        out->dropped     = atomic_load(&s->dropped);
+        out->overruns    = atomic_load(&s->overrun);
+        out->syncs       = atomic_load(&s->syncs);
+        out->sync_errors = atomic_load(&s->serrs);
+        rc               = EML_OK;
+    }
+    pthread_mutex_unlock(&G.mu);
+    return rc;
+}
+
+ssize_t emlog_fd_sink_write(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    char         nl     = '\n';
+    struct iovec iov[2] = {{(void*)(uintptr_t)line, n}, {&nl, 1}};
+    return writev((int)(intptr_t)user, iov, 2);
+}
+
+int emlog_fd_sink_sync(void* user)
+{
+#if defined(__linux__)
+    return fdatasync((int)(intptr_t)user);
+#else
+    return fsync((int)(intptr_t)user);
+#endif
+}
+
+static void sink_sync_note(struct sink* s, eml_level_t level, size_t bytes, int may_wait)
+{
+    const eml_sync_policy_t* p      = &s->cfg.durability;
+    int                      urgent = (p->level_mask & EML_LEVEL_MASK(level)) != 0;
+    pthread_mutex_lock(&s->smu);
+    int clean = s->sseq == s->sdone;
+    s->sseq += bytes;
+    if(clean) s->sdirty = mono_ns();
+    if(urgent) s->sreq = s->sseq;
+    if(urgent || (clean && p->every_ms) || (p->every_bytes && s->sseq - s->sdone >= p->every_bytes))
+        pthread_cond_signal(&s->scv);
+    if(urgent && p->wait && may_wait)
+    {
+        int i = 0;
+        while(i < durable_ntls && durable_tls[i].s != s)
+            ++i;
+        if(i == durable_ntls)
+        {
+            durable_tls[durable_ntls++].s = s;
+            ++s->swait;
+        }
+        durable_tls[i].seq = s->sseq;
+    }
+    pthread_mutex_unlock(&s->smu);
+}
+
+static void* sink_syncer_main(void* arg)
+{
+    struct sink*             s = arg;
+    const eml_sync_policy_t* p = &s->cfg.durability;
+    pthread_mutex_lock(&s->smu);
+    for(;;)
+    {
+        int dirty = s->sseq != s->sdone;
+        int due   = s->sreq > s->sdone || (s->sstop && dirty) ||
+                  (p->every_bytes && s->sseq - s->sdone >= p->every_bytes);
+        if(!due && dirty && p->every_ms)
+        {
+            uint64_t at  = s->sdirty + (uint64_t)p->every_ms * 1000000ull;
+            uint64_t now = mono_ns();
+            if(now >= at)
+            {
+                due = 1;
+            }
+            else
+            {
+                /* the condvar clock is CLOCK_REALTIME: convert the gap */
+                struct timespec dl;
+                clock_gettime(CLOCK_REALTIME, &dl);
+                uint64_t ns = (uint64_t)dl.tv_nsec + (at - now);
+                dl.tv_sec += (time_t)(ns / 1000000000ull);
+                dl.tv_nsec = (long)(ns % 1000000000ull);
+                pthread_cond_timedwait(&s->scv, &s->smu, &dl);
+                continue;
+            }
+        }
+        if(!due)
+        {
+            if(s->sstop) break;
+            pthread_cond_wait(&s->scv, &s->smu);
+            continue;
+        }
+
+        /* everything counted in sseq has been written: one call covers it all */
+        uint64_t target = s->sseq;
+        uint64_t start  = mono_ns();
+        pthread_mutex_unlock(&s->smu);
+        int rc = p->fn(s->cfg.user);
+        pthread_mutex_lock(&s->smu);
+        atomic_fetch_add_explicit(&s->syncs, 1u, memory_order_relaxed);
+        if(rc < 0) atomic_fetch_add_explicit(&s->serrs, 1u, memory_order_relaxed);
+        s->sdone = target;
+        if(s->sseq != s->sdone) s->sdirty = start;
+        pthread_cond_broadcast(&s->sdcv);
+    }
+    pthread_mutex_unlock(&s->smu);
+    return NULL;
+}
+
+static void sink_durable_wait(void)
+{
+    for(int i = 0; i < durable_ntls; ++i)
+    {
+        struct sink* s = durable_tls[i].s;
+        pthread_mutex_lock(&s->smu);
+        while(s->sdone < durable_tls[i].seq)
+            pthread_cond_wait(&s->sdcv, &s->smu);
+        /* the last one out lets a pending emlog_sink_remove() finish */
+        if(--s->swait == 0) pthread_cond_broadcast(&s->sdcv);
+        pthread_mutex_unlock(&s->smu);
+    }
+    durable_ntls = 0;
+}
+
+static void sink_stop_syncer(struct sink* s)
+{
+    if(!s->cfg.durability.fn) return;
+    pthread_mutex_lock(&s->smu);
+    s->sstop = 1;
+    pthread_cond_signal(&s->scv);
+    pthread_mutex_unlock(&s->smu);
+    pthread_join(s->sth, NULL);
+}
+
+static void sink_free(struct sink* s)
+{
+    free(s->q);
+    pthread_cond_destroy(&s->qcv);
+    pthread_mutex_destroy(&s->qmu);
+    pthread_cond_destroy(&s->ccv);
+    pthread_mutex_destroy(&s->cmu);
+    pthread_cond_destroy(&s->scv);
+    pthread_cond_destroy(&s->sdcv);
+    pthread_mutex_destroy(&s->smu);
+    free(s);
+}
+
+static uint64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+eml_err_t emlog_journal_sink_open(const eml_journal_sink_cfg_t* cfg, eml_journal_sink_t** out)
+{
+    if(!out) return EML_BAD_INPUT;
+    const char* path  = cfg && cfg->socket_path ? cfg->socket_path : EMLOG_JOURNAL_SOCKET;
+    const char* ident = cfg ? cfg->identifier : NULL;
+#if defined(__GLIBC__)
+    if(!ident) ident = program_invocation_short_name;
+#endif
+    if(!ident || !*ident) ident = LOG_TAG;
+
+    struct eml_journal_sink* s = calloc(1, sizeof *s);
+    if(!s) return EML_TEMP_RESOURCE;
+    if(strlen(path) >= sizeof s->addr.sun_path)
+    {
+        free(s);
+        return EML_BAD_INPUT;
+    }
+    s->addr.sun_family = AF_UNIX;
+    strcpy(s->addr.sun_path, path);
+    s->addrlen   = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + strlen(path) + 1);
+    s->max_dgram = cfg ? cfg->max_datagram : 0;
+    int il       = snprintf(s->ident, sizeof s->ident, "SYSLOG_IDENTIFIER=%s\n", ident);
+    s->ident_len = il < 0 ? 0 : ((size_t)il < sizeof s->ident ? (size_t)il : sizeof s->ident - 1);
+    if(s->ident_len && s->ident[s->ident_len - 1] != '\n') s->ident[s->ident_len - 1] = '\n';
+
+    s->fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if(s->fd < 0)
+    {
+        free(s);
+        return EML_TEMP_RESOURCE;
+    }
+    fcntl(s->fd, F_SETFD, FD_CLOEXEC);
+    /* never block the logging thread on a backlogged journal */
+    fcntl(s->fd, F_SETFL, O_NONBLOCK);
+    *out = s;
+    return EML_OK;
+}
+
+ssize_t emlog_journal_sink_record(const eml_record_t* rec, void* user)
+{
+    struct eml_journal_sink* s = user;
+    if(!s || !rec)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    static const char prio[] = {'7', '6', '4', '3', '2'};
+    unsigned lvl  = (unsigned)rec->level <= EML_LEVEL_CRIT ? (unsigned)rec->level : EML_LEVEL_CRIT;
+    char     meta[96];
+    int      mlen = snprintf(meta, sizeof meta, "PRIORITY=%c\nTID=%llu\n", prio[lvl],
+                             (unsigned long long)rec->tid);
+    if(mlen < 0) mlen = 0;
+    char line[16];
+    int  llen = snprintf(line, sizeof line, "%u", rec->line);
+    if(llen < 0) llen = 0;
+
+    unsigned char lens[5][8];
+    struct iovec  iov[JOURNAL_IOV_MAX];
+    int           n = 0;
+    n = journal_field(iov, n, "MESSAGE", rec->text + rec->hdr_len, rec->len - rec->hdr_len,
+                      lens[0]);
+    iov[n++] = (struct iovec){meta, (size_t)mlen};
+    iov[n++] = (struct iovec){s->ident, s->ident_len};
+    if(rec->comp)
+        n = journal_field(iov, n, "EMLOG_COMPONENT", rec->comp, strlen(rec->comp), lens[1]);
+    if(rec->file)
+    {
+        n = journal_field(iov, n, "CODE_FILE", rec->file, strlen(rec->file), lens[2]);
+        n = journal_field(iov, n, "CODE_LINE", line, (size_t)llen, lens[3]);
+        if(rec->func)
+            n = journal_field(iov, n, "CODE_FUNC", rec->func, strlen(rec->func), lens[4]);
+    }
+
+    size_t total = 0;
+    for(int i = 0; i < n; ++i)
+        total += iov[i].iov_len;
+    return journal_send(s, iov, n, total);
+}
+
+void emlog_journal_sink_close(eml_journal_sink_t* sink)
+{
+    if(!sink) return;
+    close(sink->fd);
+    free(sink);
+}
+
+eml_err_t emlog_syslog_sink_open(const eml_syslog_sink_cfg_t* cfg, eml_syslog_sink_t** out)
+{
+    if(!out) return EML_BAD_INPUT;
+    const char* path     = cfg && cfg->socket_path ? cfg->socket_path : EMLOG_SYSLOG_SOCKET;
+    const char* app      = cfg ? cfg->app_name : NULL;
+    unsigned    facility = cfg && cfg->facility ? cfg->facility : 1u;
+    unsigned    batch    = cfg && cfg->batch ? cfg->batch : 32u;
+    if(facility > 23u || batch > EMLOG_SYSLOG_BATCH_MAX) return EML_BAD_INPUT;
+#if defined(__GLIBC__)
+    if(!app) app = program_invocation_short_name;
+#endif
+    if(!app || !*app) app = LOG_TAG;
+    char host[256];
+    if(cfg && cfg->hostname)
+        snprintf(host, sizeof host, "%s", cfg->hostname);
+    else if(gethostname(host, sizeof host) != 0)
+        snprintf(host, sizeof host, "-");
+    host[sizeof host - 1] = '\0';
+
+    struct eml_syslog_sink* s = calloc(1, sizeof *s);
+    if(!s) return EML_TEMP_RESOURCE;
+    if(strlen(path) >= sizeof s->addr.sun_path)
+    {
+        free(s);
+        return EML_BAD_INPUT;
+    }
+    s->addr.sun_family = AF_UNIX;
+    strcpy(s->addr.sun_path, path);
+    s->addrlen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + strlen(path) + 1);
+    s->fd      = -1;
+    s->batch   = batch;
+
+    static const unsigned sev[] = {7, 6, 4, 3, 2};
+    for(int l = EML_LEVEL_DBG; l <= EML_LEVEL_CRIT; ++l)
+    {
+        int w         = snprintf(s->pri[l], sizeof s->pri[l], "<%u>1 ", facility * 8u + sev[l]);
+        s->pri_len[l] = w > 0 ? (size_t)w : 0;
+    }
+    /* RFC 5424 caps HOSTNAME at 255 and APP-NAME at 48 characters */
+    int w      = snprintf(s->mid, sizeof s->mid, " %.255s %.48s %ld ", host, app, (long)getpid());
+    s->mid_len = w > 0 ? ((size_t)w < sizeof s->mid ? (size_t)w : sizeof s->mid - 1) : 0;
+    pthread_mutex_init(&s->mu, NULL);
+    *out = s;
+    return EML_OK;
+}
+
+ssize_t emlog_syslog_sink_record(const eml_record_t* rec, void* user)
+{
+    struct eml_syslog_sink* s = user;
+    if(!s || !rec)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    unsigned lvl = (unsigned)rec->level <= EML_LEVEL_CRIT ? (unsigned)rec->level : EML_LEVEL_CRIT;
+    char     ts[40];
+    fmt_time_iso8601(ts, sizeof ts, NULL);
+    size_t tlen = strlen(ts);
+    if(!tlen) ts[tlen++] = '-';
+
+    /* MSGID: the component, as up to 32 printable ASCII characters */
+    char        msgid[33];
+    size_t      idlen = 0;
+    const char* comp  = rec->comp && *rec->comp ? rec->comp : "-";
+    for(; comp[idlen] && idlen < sizeof msgid - 1; ++idlen)
+        msgid[idlen] = (comp[idlen] > ' ' && comp[idlen] < 127) ? comp[idlen] : '_';
+
+    const char* msg  = rec->text + rec->hdr_len;
+    size_t      mlen = rec->len - rec->hdr_len;
+    size_t      head = s->pri_len[lvl] + tlen + s->mid_len + idlen + 3;
+    if(head + mlen > SYSLOG_ARENA) mlen = SYSLOG_ARENA - head;
+    size_t need = head + mlen;
+
+    pthread_mutex_lock(&s->mu);
+    if(s->n == s->batch || s->used + need > SYSLOG_ARENA) syslog_flush_locked(s);
+    char* p = s->arena + s->used;
+    memcpy(p, s->pri[lvl], s->pri_len[lvl]);
+    p += s->pri_len[lvl];
+    memcpy(p, ts, tlen);
+    p += tlen;
+    memcpy(p, s->mid, s->mid_len);
+    p += s->mid_len;
+    memcpy(p, msgid, idlen);
+    p += idlen;
+    memcpy(p, " - ", 3);
+    p += 3;
+    memcpy(p, msg, mlen);
+    s->iov[s->n++] = (struct iovec){s->arena + s->used, need};
+    s->used += need;
+    if(s->n == s->batch) syslog_flush_locked(s);
+    pthread_mutex_unlock(&s->mu);
+    return (ssize_t)need;
+}
+
+void emlog_syslog_sink_flush(void* user)
+{
+    struct eml_syslog_sink* s = user;
+    if(!s) return;
+    pthread_mutex_lock(&s->mu);
+    syslog_flush_locked(s);
+    pthread_mutex_unlock(&s->mu);
+}
+
+uint64_t emlog_syslog_sink_sent(const eml_syslog_sink_t* sink)
+{
+    return sink ? atomic_load_explicit(&sink->sent, memory_order_relaxed) : 0u;
+}
+
+uint64_t emlog_syslog_sink_dropped(const eml_syslog_sink_t* sink)
+{
+    return sink ? atomic_load_explicit(&sink->dropped, memory_order_relaxed) : 0u;
+}
+
+void emlog_syslog_sink_close(eml_syslog_sink_t* sink)
+{
+    if(!sink) return;
+    emlog_syslog_sink_flush(sink);
+    if(sink->fd >= 0) close(sink->fd);
+    pthread_mutex_destroy(&sink->mu);
+    free(sink);
+}
+
+static int syslog_connect_locked(struct eml_syslog_sink* s)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    if(s->fd >= 0)
+    {
+        close(s->fd);
+        s->fd = -1;
+    }
+    if(ns < s->retry_ns) return 0;
+    s->retry_ns = ns + SYSLOG_RETRY_NS;
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if(fd < 0) return 0;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    /* connect() on a Unix datagram socket only records the peer */
+    if(connect(fd, (struct sockaddr*)&s->addr, s->addrlen) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+    s->fd = fd;
+    return 1;
+}
+
+static void syslog_flush_locked(struct eml_syslog_sink* s)
+{
+    if(!s->n) return;
+    unsigned off     = 0;
+    int      retried = 0;
+    while(off < s->n)
+    {
+        if(s->fd < 0 && !syslog_connect_locked(s)) break;
+#if defined(__linux__)
+        struct mmsghdr mh[EMLOG_SYSLOG_BATCH_MAX];
+        unsigned       cnt = s->n - off;
+        memset(mh, 0, cnt * sizeof mh[0]);
+        for(unsigned i = 0; i < cnt; ++i)
+        {
+            mh[i].msg_hdr.msg_iov    = &s->iov[off + i];
+            mh[i].msg_hdr.msg_iovlen = 1;
+        }
+        int r = sendmmsg(s->fd, mh, cnt, MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+        int r = send(s->fd, s->iov[off].iov_base, s->iov[off].iov_len, MSG_NOSIGNAL) < 0 ? -1 : 1;
+#endif
+        if(r > 0)
+        {
+            off += (unsigned)r;
+            continue;
+        }
+        if(r < 0 && errno == EINTR) continue;
+        if(r < 0 && !retried &&
+           (errno == ECONNREFUSED || errno == ENOTCONN || errno == ECONNRESET || errno == EPIPE ||
+            errno == ENOENT))
+        {
+            /* daemon restarted: one immediate reconnect, then back off */
+            retried     = 1;
+            s->retry_ns = 0;
+            close(s->fd);
+            s->fd = -1;
+            continue;
+        }
+        break; /* EAGAIN (daemon backlogged) or a hard error: drop the rest */
+    }
+    atomic_fetch_add_explicit(&s->sent, off, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->dropped, s->n - off, memory_order_relaxed);
+    s->n    = 0;
+    s->used = 0;
+}
+
+eml_err_t emlog_batch_sink_open(const eml_batch_sink_cfg_t* cfg, eml_batch_sink_t** out)
+{
+    if(!cfg || !cfg->fn || !out) return EML_BAD_INPUT;
+    unsigned max    = cfg->max_records ? cfg->max_records : 64u;
+    size_t   cap    = cfg->max_bytes ? cfg->max_bytes : 64u * 1024u;
+    unsigned linger = cfg->linger_ms ? cfg->linger_ms : 50u;
+
+    struct eml_batch_sink* s = calloc(1, sizeof *s);
+    if(!s) return EML_TEMP_RESOURCE;
+    s->recs      = calloc(max, sizeof *s->recs);
+    s->arena     = malloc(cap);
+    s->out_recs  = calloc(max, sizeof *s->out_recs);
+    s->out_arena = malloc(cap);
+    if(!s->recs || !s->arena || !s->out_recs || !s->out_arena)
+    {
+        free(s->recs);
+        free(s->arena);
+        free(s->out_recs);
+        free(s->out_arena);
+        free(s);
+        return EML_TEMP_RESOURCE;
+    }
+    s->fn        = cfg->fn;
+    s->user      = cfg->user;
+    s->max       = max;
+    s->cap       = cap;
+    s->linger_ns = (uint64_t)linger * 1000000ull;
+    pthread_mutex_init(&s->mu, NULL);
+    pthread_cond_init(&s->cv, NULL);
+    pthread_cond_init(&s->idle, NULL);
+    if(pthread_create(&s->th, NULL, batch_sink_main, s) != 0)
+    {
+        pthread_cond_destroy(&s->idle);
+        pthread_cond_destroy(&s->cv);
+        pthread_mutex_destroy(&s->mu);
+        free(s->recs);
+        free(s->arena);
+        free(s->out_recs);
+        free(s->out_arena);
+        free(s);
+        return EML_TEMP_RESOURCE;
+    }
+    *out = s;
+    return EML_OK;
+}
+
+ssize_t emlog_batch_sink_record(const eml_record_t* rec, void* user)
+{
+    struct eml_batch_sink* s = user;
+    if(!s || !rec)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t clen = rec->comp ? strlen(rec->comp) + 1 : 0;
+    size_t need = rec->len + clen;
+
+    pthread_mutex_lock(&s->mu);
+    /* others may refill the buffer while a flush has mu dropped */
+    while(s->n && (s->n == s->max || s->used + need > s->cap))
+        batch_flush_locked(s);
+    if(need > s->cap)
+    {
+        /* never fits: pass it on alone, pointing at the caller's copy */
+        atomic_fetch_add_explicit(&s->batches, 1u, memory_order_relaxed);
+        ssize_t r = batch_call_locked(s, rec, 1);
+        if(r < 0) atomic_fetch_add_explicit(&s->failed, 1u, memory_order_relaxed);
+        pthread_mutex_unlock(&s->mu);
+        return r < 0 ? -1 : (ssize_t)rec->len;
+    }
+
+    eml_record_t* r = &s->recs[s->n];
+    *r              = *rec;
+    char* p         = s->arena + s->used;
+    memcpy(p, rec->text, rec->len);
+    r->text = p;
+    if(clen)
+    {
+        memcpy(p + rec->len, rec->comp, clen);
+        r->comp = p + rec->len;
+    }
+    s->used += need;
+    if(s->n++ == 0)
+    {
+        /* first record of a batch: start the linger clock */
+        s->first_ns = mono_ns();
+        pthread_cond_signal(&s->cv);
+    }
+    if(s->n == s->max) batch_flush_locked(s);
+    pthread_mutex_unlock(&s->mu);
+    return (ssize_t)rec->len;
+}
+
+void emlog_batch_sink_flush(void* user)
+{
+    struct eml_batch_sink* s = user;
+    if(!s) return;
+    pthread_mutex_lock(&s->mu);
+    batch_flush_locked(s);
+    pthread_mutex_unlock(&s->mu);
+}
+
+uint64_t emlog_batch_sink_batches(const eml_batch_sink_t* sink)
+{
+    return sink ? atomic_load_explicit(&sink->batches, memory_order_relaxed) : 0u;
+}
+
+uint64_t emlog_batch_sink_failed(const eml_batch_sink_t* sink)
+{
+    return sink ? atomic_load_explicit(&sink->failed, memory_order_relaxed) : 0u;
+}
+
+void emlog_batch_sink_close(eml_batch_sink_t* sink)
+{
+    if(!sink) return;
+    pthread_mutex_lock(&sink->mu);
+    sink->stop = 1;
+    pthread_cond_signal(&sink->cv);
+    pthread_mutex_unlock(&sink->mu);
+    pthread_join(sink->th, NULL);
+    pthread_cond_destroy(&sink->idle);
+    pthread_cond_destroy(&sink->cv);
+    pthread_mutex_destroy(&sink->mu);
+    free(sink->recs);
+    free(sink->arena);
+    free(sink->out_recs);
+    free(sink->out_arena);
+    free(sink);
+}
+
+static void batch_flush_locked(struct eml_batch_sink* s)
+{
+    /* the spare buffers are free once no callback is reading them */
+    while(s->busy)
+        pthread_cond_wait(&s->idle, &s->mu);
+    if(!s->n) return;
+
+    eml_record_t* recs  = s->recs;
+    char*         arena = s->arena;
+    size_t        n     = s->n;
+    s->recs             = s->out_recs;
+    s->arena            = s->out_arena;
+    s->out_recs         = recs;
+    s->out_arena        = arena;
+    s->n                = 0;
+    s->used             = 0;
+    atomic_fetch_add_explicit(&s->batches, 1u, memory_order_relaxed);
+    if(batch_call_locked(s, recs, n) < 0)
+        atomic_fetch_add_explicit(&s->failed, n, memory_order_relaxed);
+}
+
+static ssize_t batch_call_locked(struct eml_batch_sink* s, const eml_record_t* recs, size_t n)
+{
+    while(s->busy)
+        pthread_cond_wait(&s->idle, &s->mu);
+    s->busy = 1;
+    pthread_mutex_unlock(&s->mu);
+    struct eml_batch_sink* prev = batch_self_tls;
+    batch_self_tls              = s;
+    ssize_t r                   = s->fn(recs, n, s->user);
+    batch_self_tls              = prev;
+    pthread_mutex_lock(&s->mu);
+    s->busy = 0;
+    pthread_cond_broadcast(&s->idle);
+    return r;
+}
+
+static void* batch_sink_main(void* arg)
+{
+    struct eml_batch_sink* s = arg;
+    pthread_mutex_lock(&s->mu);
+    for(;;)
+    {
+        if(!s->n)
+        {
+            if(s->stop) break;
+            pthread_cond_wait(&s->cv, &s->mu);
+            continue;
+        }
+        uint64_t at  = s->first_ns + s->linger_ns;
+        uint64_t now = mono_ns();
+        if(s->stop || now >= at)
+        {
+            batch_flush_locked(s);
+            continue;
+        }
+        /* the condvar clock is CLOCK_REALTIME: convert the gap */
+        struct timespec dl;
+        clock_gettime(CLOCK_REALTIME, &dl);
+        uint64_t ns = (uint64_t)dl.tv_nsec + (at - now);
+        dl.tv_sec += (time_t)(ns / 1000000000ull);
+        dl.tv_nsec = (long)(ns % 1000000000ull);
+        pthread_cond_timedwait(&s->cv, &s->mu, &dl);
+    }
+    pthread_mutex_unlock(&s->mu);
+    return NULL;
+}
+
+static int journal_field(struct iovec* iov, int n, const char* key, const char* val, size_t len,
+                         unsigned char* lenbuf)
+{
+    static const char eq = '=', nl = '\n';
+    iov[n++] = (struct iovec){(void*)(uintptr_t)key, strlen(key)};
+    if(!memchr(val, '\n', len))
+    {
+        iov[n++] = (struct iovec){(void*)(uintptr_t)&eq, 1};
+    }
+    else
+    {
+        /* binary form: KEY\n, little-endian 64-bit length, raw bytes */
+        iov[n++] = (struct iovec){(void*)(uintptr_t)&nl, 1};
+        for(int i = 0; i < 8; ++i)
+            lenbuf[i] = (unsigned char)((uint64_t)len >> (8 * i));
+        iov[n++] = (struct iovec){lenbuf, 8};
+    }
+    iov[n++] = (struct iovec){(void*)(uintptr_t)val, len};
+    iov[n++] = (struct iovec){(void*)(uintptr_t)&nl, 1};
+    return n;
+}
+
+static ssize_t journal_send(struct eml_journal_sink* s, struct iovec* iov, int n, size_t total)
+{
+    struct msghdr mh = {.msg_name = &s->addr, .msg_namelen = s->addrlen};
+    if(!s->max_dgram || total <= s->max_dgram)
+    {
+        mh.msg_iov    = iov;
+        mh.msg_iovlen = (size_t)n;
+        ssize_t w     = sendmsg(s->fd, &mh, MSG_NOSIGNAL);
+        if(w >= 0 || (errno != EMSGSIZE && errno != ENOBUFS)) return w;
+    }
+
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING)
+    /* too large for a datagram: hand journald a sealed memfd instead */
+    int mfd = memfd_create("emlog-journal", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if(mfd < 0) return -1;
+    ssize_t w = writev(mfd, iov, n);
+    if(w < 0 || (size_t)w != total ||
+       fcntl(mfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+    {
+        close(mfd);
+        if(w >= 0) errno = EIO;
+        return -1;
+    }
+    union
+    {
+        struct cmsghdr h;
+        char           buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    memset(&ctl, 0, sizeof ctl);
+    mh.msg_iov        = NULL;
+    mh.msg_iovlen     = 0;
+    mh.msg_control    = ctl.buf;
+    mh.msg_controllen = sizeof ctl.buf;
+    struct cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level     = SOL_SOCKET;
+    cm->cmsg_type      = SCM_RIGHTS;
+    cm->cmsg_len       = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &mfd, sizeof(int));
+    ssize_t r = sendmsg(s->fd, &mh, MSG_NOSIGNAL);
+    close(mfd);
+    return r < 0 ? -1 : (ssize_t)total;
+#else
+    errno = EMSGSIZE;
+    return -1;
+#endif
+}
+
+static void sink_call(struct sink* s, const eml_record_t* rec)
+{
+    ssize_t r;
+    if(s->cfg.record)
+        r = s->cfg.record(rec, s->cfg.user);
+    else if(s->cfg.format == EML_SINK_FMT_MSG)
+        r = s->cfg.fn(rec->level, rec->text + rec->hdr_len, rec->len - rec->hdr_len, s->cfg.user);
+    else
+        r = s->cfg.fn(rec->level, rec->text, rec->len, s->cfg.user);
+    if(r < 0)
+        atomic_fetch_add_explicit(&s->errors, 1u, memory_order_relaxed);
+    else
+        atomic_fetch_add_explicit(&s->written, 1u, memory_order_relaxed);
+}
+
+static void sink_rec_put(struct sink_rec* r)
+{
+    if(atomic_fetch_sub_explicit(&r->refs, 1u, memory_order_acq_rel) == 1u) free(r);
+}
+
+static void* sink_worker_main(void* arg)
+{
+    struct sink* s = arg;
+    pthread_mutex_lock(&s->qmu);
+    for(;;)
+    {
+        while(s->qhead == s->qtail && !s->stop)
+            pthread_cond_wait(&s->qcv, &s->qmu);
+        if(s->qhead == s->qtail) break; /* stopped and drained */
+
+        struct sink_rec* r = s->q[s->qhead % s->cfg.queue_len];
+        ++s->qhead;
+        pthread_mutex_unlock(&s->qmu);
+        sink_call(s, &r->rec);
+        if(s->cfg.durability.fn) sink_sync_note(s, r->rec.level, r->rec.len + 1, 0);
+        sink_rec_put(r);
+        pthread_mutex_lock(&s->qmu);
+        if(s->qhead == s->qtail && s->cfg.flush)
+        {
+            /* queue ran dry: end of this batch */
+            pthread_mutex_unlock(&s->qmu);
+            s->cfg.flush(s->cfg.user);
+            pthread_mutex_lock(&s->qmu);
+        }
+    }
+    pthread_mutex_unlock(&s->qmu);
+    return NULL;
+}
+
+static void sink_fanout_locked(eml_level_t level, const struct iovec* iov, int iovcnt)
+{
+    unsigned bit    = EML_LEVEL_MASK(level);
+    int      nsync  = 0;
+    int      nasync = 0;
+    int      nrec   = 0;
+    for(int i = 0; i < EMLOG_MAX_SINKS; ++i)
+    {
+        struct sink* s = sinks[i];
+        if(!s || !(s->cfg.level_mask & bit)) continue;
+        if(s->cfg.record) ++nrec;
+        if(s->cfg.queue_len)
+            ++nasync;
+        else
+            ++nsync;
+    }
+    if(!nsync && !nasync) return;
+
+    eml_record_t r = {.level = level, .comp = line_ctx_tls.comp, .tid = nrec ? eml_tid() : 0};
+    if(nrec)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        r.ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    }
+    if(line_ctx_tls.cs)
+    {
+        r.file = line_ctx_tls.cs->file;
+        r.func = line_ctx_tls.cs->func;
+        r.line = line_ctx_tls.cs->line;
+    }
+    for(int i = 0; i < iovcnt; ++i)
+        r.len += iov[i].iov_len;
+    r.hdr_len = iovcnt > 1 ? iov[0].iov_len : 0;
+    size_t len = r.len;
+
+    /* one contiguous copy, shared by reference */
+    struct sink_rec* rec = malloc(sizeof *rec + len);
+    if(!rec)
+    {
+        for(int i = 0; i < EMLOG_MAX_SINKS; ++i)
+            if(sinks[i] && (sinks[i]->cfg.level_mask & bit))
+                atomic_fetch_add_explicit(&sinks[i]->dropped, 1u, memory_order_relaxed);
+        return;
+    }
+    atomic_init(&rec->refs, 1u);
+    rec->next  = NULL;
+    rec->wait  = durable_arm_tls;
+    rec->nsync = 0;
+    rec->rec   = r;
+    if(r.comp)
+    {
+        snprintf(rec->comp, sizeof rec->comp, "%s", r.comp);
+        rec->rec.comp = rec->comp;
+    }
+    size_t off = 0;
+    for(int i = 0; i < iovcnt; ++i)
+    {
+        memcpy(rec->data + off, iov[i].iov_base, iov[i].iov_len);
+        off += iov[i].iov_len;
+    }
+    rec->rec.text = rec->data;
+
+    for(int i = 0; i < EMLOG_MAX_SINKS; ++i)
+    {
+        struct sink* s = sinks[i];
+        if(!s || !(s->cfg.level_mask & bit)) continue;
+        if(batch_self_tls && s->cfg.record == emlog_batch_sink_record &&
+           s->cfg.user == batch_self_tls)
+        {
+            /* logged from inside this batch sink's callback */
+            atomic_fetch_add_explicit(&s->dropped, 1u, memory_order_relaxed);
+            continue;
+        }
+        if(!s->cfg.queue_len)
+        {
+            if(s == sink_self_tls)
+            {
+                /* logged from inside this sink: calling it again would recurse */
+                atomic_fetch_add_explicit(&s->dropped, 1u, memory_order_relaxed);
+                continue;
+            }
+            rec->sync[rec->nsync++] = s;
+            ++s->cowed;
+            continue;
+        }
+        int queued = 0;
+        pthread_mutex_lock(&s->qmu);
+        if(s->qtail - s->qhead < s->cfg.queue_len)
+        {
+            atomic_fetch_add_explicit(&rec->refs, 1u, memory_order_relaxed);
+            s->q[s->qtail % s->cfg.queue_len] = rec;
+            ++s->qtail;
+            pthread_cond_signal(&s->qcv);
+            queued = 1;
+        }
+        pthread_mutex_unlock(&s->qmu);
+        if(!queued) atomic_fetch_add_explicit(&s->dropped, 1u, memory_order_relaxed);
+    }
+    if(rec->nsync)
+    {
+        /* the deferred list keeps the producer's reference */
+        if(sink_defer_last_tls)
+            sink_defer_last_tls->next = rec;
+        else
+            sink_defer_tls = rec;
+        sink_defer_last_tls = rec;
+        return;
+    }
+    sink_rec_put(rec);
+}
+
+static void sink_call_sync(struct sink* s, struct sink_rec* r)
+{
+    pthread_mutex_lock(&s->cmu);
+    uint64_t t0 = mono_ns();
+    if(t0 < s->bench)
+    {
+        atomic_fetch_add_explicit(&s->dropped, 1u, memory_order_relaxed);
+    }
+    else
+    {
+        sink_self_tls = s;
+        sink_call(s, &r->rec);
+        if(s->cfg.flush) s->cfg.flush(s->cfg.user);
+        sink_self_tls = NULL;
+        uint64_t t1   = mono_ns();
+        if(t1 - t0 > s->budget)
+        {
+            /* too slow for the threads queued behind it: skip it for a while */
+            atomic_fetch_add_explicit(&s->overrun, 1u, memory_order_relaxed);
+            s->bench = t1 + (uint64_t)EMLOG_SINK_BENCH_MS * 1000000ull;
+        }
+        if(s->cfg.durability.fn) sink_sync_note(s, r->rec.level, r->rec.len + 1, r->wait);
+    }
+    ++s->cdone;
+    if(s->cwait) pthread_cond_signal(&s->ccv);
+    pthread_mutex_unlock(&s->cmu);
+}
+
+static void sink_run_deferred(void)
+{
+    if(sink_running_tls) return; /* a sink logged: the outer loop gets to it */
+    sink_running_tls = 1;
+    struct sink_rec* r;
+    while((r = sink_defer_tls) != NULL)
+    {
+        sink_defer_tls = r->next;
+        if(!sink_defer_tls) sink_defer_last_tls = NULL;
+        for(int i = 0; i < r->nsync; ++i)
+            sink_call_sync(r->sync[i], r);
+        sink_rec_put(r);
+    }
+    sink_running_tls = 0;
+}
+
+size_t emlog_lz_bound(size_t n)
+{
+    return n + n / 255u + 16u;
+}
+
+size_t emlog_lz_compress(const void* src, size_t n, void* dst, size_t cap)
+{
+    if(!src || !dst) return 0;
+    uint32_t* tab = calloc(1u << LZ_HASH_BITS, sizeof *tab);
+    if(!tab) return 0;
+    size_t r = lz_compress_tab(src, n, dst, cap, tab);
+    free(tab);
+    return r;
+}
+
+ssize_t emlog_lz_decompress(const void* src, size_t n, void* dst, size_t cap)
+{
+    if(!src || !dst) return -1;
+    const unsigned char* ip   = src;
+    const unsigned char* iend = ip + n;
+    unsigned char*       op   = dst;
+    unsigned char*       oend = op + cap;
+    while(ip < iend)
+    {
+        unsigned token = *ip++;
+        size_t   lit   = token >> 4;
+        if(lit == 15)
+        {
+            unsigned b;
+            do
+            {
+                if(ip >= iend) return -1;
+                b = *ip++;
+                lit += b;
+            } while(b == 255);
+        }
+        if(lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) return -1;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if(ip == iend) break; /* the last sequence has no match */
+
+        if(iend - ip < 2) return -1;
+        size_t off = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if(!off || off > (size_t)(op - (unsigned char*)dst)) return -1;
+        size_t ml = token & 15u;
+        if(ml == 15)
+        {
+            unsigned b;
+            do
+            {
+                if(ip >= iend) return -1;
+                b = *ip++;
+                ml += b;
+            } while(b == 255);
+        }
+        ml += LZ_MIN_MATCH;
+        if(ml > (size_t)(oend - op)) return -1;
+        /* byte copy: source and destination overlap when off < ml */
+        const unsigned char* m = op - off;
+        for(size_t i = 0; i < ml; ++i)
+            op[i] = m[i];
+        op += ml;
+    }
+    return (ssize_t)(op - (unsigned char*)dst);
+}
+
+uint32_t emlog_lz_check(const void* p, size_t n)
+{
+    const unsigned char* b = p;
+    uint32_t             h = 2166136261u;
+    for(size_t i = 0; i < n; ++i)
+        h = (h ^ b[i]) * 16777619u;
+    return h;
+}
+
+eml_err_t emlog_lz_sink_open(const eml_lz_sink_cfg_t* cfg, eml_lz_sink_t** out)
+{
+    if(!cfg || !out || !cfg->path || !*cfg->path) return EML_BAD_INPUT;
+    size_t   block = cfg->block_bytes ? cfg->block_bytes : 64u * 1024u;
+    unsigned nblk  = cfg->blocks ? cfg->blocks : 4u;
+    if(block < 256u || block > EMLOG_LZ_BLOCK_MAX || nblk < 2u || nblk > 1024u)
+        return EML_BAD_INPUT;
+
+    struct eml_lz_sink* s = calloc(1, sizeof *s);
+    if(!s) return EML_TEMP_RESOURCE;
+    s->block    = block;
+    s->nblk     = nblk;
+    s->flush_ms = cfg->flush_ms ? cfg->flush_ms : 1000u;
+    s->cur      = -1;
+    s->buf      = calloc(nblk, sizeof *s->buf);
+    s->len      = calloc(nblk, sizeof *s->len);
+    s->freel    = calloc(nblk, sizeof *s->freel);
+    s->fullq    = calloc(nblk, sizeof *s->fullq);
+    s->out      = malloc(EMLOG_LZ_HEADER + emlog_lz_bound(block));
+    s->tab      = calloc(1u << LZ_HASH_BITS, sizeof *s->tab);
+    int ok      = s->buf && s->len && s->freel && s->fullq && s->out && s->tab;
+    for(unsigned i = 0; ok && i < nblk; ++i)
+    {
+        s->buf[i]            = malloc(block);
+        ok                   = s->buf[i] != NULL;
+        s->freel[s->nfree++] = nblk - 1u - i;
+    }
+    eml_err_t rc = EML_TEMP_RESOURCE;
+    if(ok)
+    {
+        s->fd = open(cfg->path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                     (mode_t)(cfg->mode ? cfg->mode : 0644u));
+        if(s->fd < 0)
+        {
+            ok = 0;
+            rc = (errno == EACCES || errno == EPERM) ? EML_PERM : EML_FATAL_IO;
+        }
+    }
+    if(ok)
+    {
+        pthread_mutex_init(&s->mu, NULL);
+        pthread_cond_init(&s->cv, NULL);
+        if(pthread_create(&s->th, NULL, lz_sink_main, s) != 0)
+        {
+            pthread_cond_destroy(&s->cv);
+            pthread_mutex_destroy(&s->mu);
+            close(s->fd);
+            ok = 0;
+        }
+    }
+    if(!ok)
+    {
+        for(unsigned i = 0; s->buf && i < nblk; ++i)
+            free(s->buf[i]);
+        free(s->buf);
+        free(s->len);
+        free(s->freel);
+        free(s->fullq);
+        free(s->out);
+        free(s->tab);
+        free(s);
+        return rc;
+    }
+    *out = s;
+    return EML_OK;
+}
+
+ssize_t emlog_lz_sink_write(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct eml_lz_sink* s = (struct eml_lz_sink*)user;
+    if(!s) return -1;
+    if(n + 1 > s->block) n = s->block - 1; /* a line never spans blocks */
+
+    pthread_mutex_lock(&s->mu);
+    if(s->cur >= 0 && s->len[s->cur] + n + 1 > s->block)
+    {
+        s->fullq[(s->fhead + s->nfull++) % s->nblk] = (unsigned)s->cur;
+        s->cur                                     = -1;
+        pthread_cond_signal(&s->cv);
+    }
+    if(s->cur < 0 && s->nfree)
+    {
+        s->cur         = (int)s->freel[--s->nfree];
+        s->len[s->cur] = 0;
+    }
+    if(s->cur < 0)
+    {
+        /* compressor is behind by nblk blocks: shed load, never block */
+        pthread_mutex_unlock(&s->mu);
+        atomic_fetch_add_explicit(&s->dropped, 1u, memory_order_relaxed);
+        return -1;
+    }
+    char* p = s->buf[s->cur] + s->len[s->cur];
+    memcpy(p, line, n);
+    p[n] = '\n';
+    s->len[s->cur] += n + 1;
+    pthread_mutex_unlock(&s->mu);
+    return (ssize_t)n;
+}
+
+uint64_t emlog_lz_sink_dropped(const eml_lz_sink_t* sink)
+{
+    return sink ? atomic_load_explicit(&sink->dropped, memory_order_relaxed) : 0u;
+}
+
+void emlog_lz_sink_close(eml_lz_sink_t* sink)
+{
+    if(!sink) return;
+    pthread_mutex_lock(&sink->mu);
+    sink->stop = 1;
+    pthread_cond_signal(&sink->cv);
+    pthread_mutex_unlock(&sink->mu);
+    pthread_join(sink->th, NULL);
+
+    close(sink->fd);
+    for(unsigned i = 0; i < sink->nblk; ++i)
+        free(sink->buf[i]);
+    free(sink->buf);
+    free(sink->len);
+    free(sink->freel);
+    free(sink->fullq);
+    free(sink->out);
+    free(sink->tab);
+    pthread_cond_destroy(&sink->cv);
+    pthread_mutex_destroy(&sink->mu);
+    free(sink);
+}
+
+static void* lz_sink_main(void* arg)
+{
+    struct eml_lz_sink* s = arg;
+    pthread_mutex_lock(&s->mu);
+    for(;;)
+    {
+        if(!s->nfull && !s->stop)
+        {
+            struct timespec dl;
+            clock_gettime(CLOCK_REALTIME, &dl);
+            dl.tv_sec += (time_t)(s->flush_ms / 1000u);
+            dl.tv_nsec += (long)(s->flush_ms % 1000u) * 1000000L;
+            if(dl.tv_nsec >= 1000000000L)
+            {
+                ++dl.tv_sec;
+                dl.tv_nsec -= 1000000000L;
+            }
+            int rc = 0;
+            while(!s->nfull && !s->stop && rc != ETIMEDOUT)
+                rc = pthread_cond_timedwait(&s->cv, &s->mu, &dl);
+        }
+        /* idle interval or shutdown: compress the partial block too */
+        if(!s->nfull && s->cur >= 0 && s->len[s->cur])
+        {
+            s->fullq[(s->fhead + s->nfull++) % s->nblk] = (unsigned)s->cur;
+            s->cur                                     = -1;
+        }
+        if(!s->nfull)
+        {
+            if(s->stop) break;
+            continue;
+        }
+        unsigned i = s->fullq[s->fhead];
+        s->fhead   = (s->fhead + 1u) % s->nblk;
+        --s->nfull;
+        pthread_mutex_unlock(&s->mu);
+
+        lz_write_frame(s, i);
+
+        pthread_mutex_lock(&s->mu);
+        s->freel[s->nfree++] = i;
+    }
+    pthread_mutex_unlock(&s->mu);
+    return NULL;
+}
+
+static void lz_put32(unsigned char* p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static void lz_write_frame(struct eml_lz_sink* s, unsigned i)
+{
+    const unsigned char* raw   = (const unsigned char*)s->buf[i];
+    size_t               n     = s->len[i];
+    unsigned char*       data  = s->out + EMLOG_LZ_HEADER;
+    size_t               clen  = lz_compress_tab(raw, n, data, n, s->tab);
+    uint32_t             flags = 0;
+    if(!clen)
+    {
+        /* did not shrink: store the block as is */
+        memcpy(data, raw, n);
+        clen  = n;
+        flags = EMLOG_LZ_STORED;
+    }
+    lz_put32(s->out, EMLOG_LZ_MAGIC);
+    lz_put32(s->out + 4, flags);
+    lz_put32(s->out + 8, (uint32_t)n);
+    lz_put32(s->out + 12, (uint32_t)clen);
+    lz_put32(s->out + 16, emlog_lz_check(raw, n));
+
+    size_t total = EMLOG_LZ_HEADER + clen;
+    size_t off   = 0;
+    while(off < total)
+    {
+        ssize_t w = write(s->fd, s->out + off, total - off);
+        if(w < 0 && errno == EINTR) continue;
+        if(w <= 0) break; /* best effort, like the default writer */
+        off += (size_t)w;
+    }
+}
+
+static uint32_t lz_read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static int lz_put_len(unsigned char** op, unsigned char* oend, size_t len)
+{
+    /* continuation bytes for a length that did not fit in its 4-bit field */
+    for(; len >= 255; len -= 255)
+    {
+        if(*op >= oend) return -1;
+        *(*op)++ = 255;
+    }
+    if(*op >= oend) return -1;
+    *(*op)++ = (unsigned char)len;
+    return 0;
+}
+
+static size_t lz_compress_tab(const unsigned char* src, size_t n, unsigned char* dst, size_t cap,
+                              uint32_t* tab)
+{
+    unsigned char* op     = dst;
+    unsigned char* oend   = dst + cap;
+    size_t         anchor = 0;
+    size_t         ip     = 0;
+    memset(tab, 0, sizeof(uint32_t) << LZ_HASH_BITS);
+
+    if(n > LZ_MF_LIMIT)
+    {
+        size_t limit  = n - LZ_MF_LIMIT;
+        size_t mlimit = n - LZ_LAST_LITS;
+        while(ip < limit)
+        {
+            uint32_t seq = lz_read32(src + ip);
+            uint32_t h   = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+            size_t   ref = tab[h];
+            tab[h]       = (uint32_t)ip;
+            if(ref >= ip || ip - ref > 65535u || lz_read32(src + ref) != seq)
+            {
+                ++ip;
+                continue;
+            }
+            size_t ml = LZ_MIN_MATCH;
+            while(ip + ml < mlimit && src[ref + ml] == src[ip + ml])
+                ++ml;
+            while(ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1])
+            {
+                --ip;
+                --ref;
+                ++ml;
+            }
+
+            size_t lit = ip - anchor;
+            size_t mc  = ml - LZ_MIN_MATCH;
+            if(op >= oend) return 0;
+            unsigned char* token = op++;
+            *token               = (unsigned char)(((lit < 15 ? lit : 15) << 4) | (mc < 15 ? mc : 15));
+            if(lit >= 15 && lz_put_len(&op, oend, lit - 15) < 0) return 0;
+            if((size_t)(oend - op) < lit + 2) return 0;
+            memcpy(op, src + anchor, lit);
+            op += lit;
+            *op++ = (unsigned char)(ip - ref);
+            *op++ = (unsigned char)((ip - ref) >> 8);
+            if(mc >= 15 && lz_put_len(&op, oend, mc - 15) < 0) return 0;
+
+            ip += ml;
+            anchor = ip;
+        }
+    }
+
+    size_t lit = n - anchor;
+    if(op >= oend) return 0;
+    *op++ = (unsigned char)((lit < 15 ? lit : 15) << 4);
+    if(lit >= 15 && lz_put_len(&op, oend, lit - 15) < 0) return 0;
+    if((size_t)(oend - op) < lit) return 0;
+    memcpy(op, src + anchor, lit);
+    op += lit;
+    return (size_t)(op - dst);
+}
+
+eml_err_t emlog_direct_sink_open(const eml_direct_sink_cfg_t* cfg, eml_direct_sink_t** out)
+{
+    if(!cfg || !out || !cfg->path || !*cfg->path) return EML_BAD_INPUT;
+    size_t   block = cfg->block_bytes ? cfg->block_bytes : 64u * 1024u;
+    unsigned nblk  = cfg->blocks ? cfg->blocks : 4u;
+    if(block % EMLOG_DIRECT_ALIGN || block > (64u << 20) || nblk < 2u || nblk > 1024u)
+        return EML_BAD_INPUT;
+
+    struct eml_direct_sink* s = calloc(1, sizeof *s);
+    if(!s) return EML_TEMP_RESOURCE;
+    s->block    = block;
+    s->nblk     = nblk;
+    s->flush_ms = cfg->flush_ms ? cfg->flush_ms : 1000u;
+    s->cur      = -1;
+    s->fd       = -1;
+    s->buf      = calloc(nblk, sizeof *s->buf);
+    s->len      = calloc(nblk, sizeof *s->len);
+    s->freel    = calloc(nblk, sizeof *s->freel);
+    s->fullq    = calloc(nblk, sizeof *s->fullq);
+    int ok      = s->buf && s->len && s->freel && s->fullq;
+    for(unsigned i = 0; ok && i < nblk; ++i)
+    {
+        void* p              = NULL;
+        ok                   = posix_memalign(&p, EMLOG_DIRECT_ALIGN, block) == 0;
+        s->buf[i]            = p;
+        s->freel[s->nfree++] = nblk - 1u - i;
+    }
+    if(ok)
+    {
+        void* p = NULL;
+        ok      = posix_memalign(&p, EMLOG_DIRECT_ALIGN, block) == 0;
+        s->tail = p;
+    }
+    eml_err_t rc = EML_TEMP_RESOURCE;
+    if(ok)
+    {
+        /* positional writes only: O_APPEND cannot be combined with
+         * rewriting the tail block in place */
+        int    flags = O_RDWR | O_CREAT | O_CLOEXEC;
+        mode_t mode  = (mode_t)(cfg->mode ? cfg->mode : 0644u);
+        int    want  = !cfg->buffered && O_DIRECT != 0;
+        s->fd        = open(cfg->path, flags | (want ? O_DIRECT : 0), mode);
+        if(s->fd < 0 && want && errno == EINVAL)
+        {
+            /* file system without direct I/O (e.g. older tmpfs) */
+            want  = 0;
+            s->fd = open(cfg->path, flags, mode);
+        }
+        s->direct = want;
+        if(s->fd < 0)
+        {
+            ok = 0;
+            rc = (errno == EACCES || errno == EPERM) ? EML_PERM : EML_FATAL_IO;
+        }
+    }
+    if(ok)
+    {
+        /* appending to an unaligned file: reload its last partial block
+         * so it is rewritten in place, whole, by the next write */
+        struct stat st;
+        ok = fstat(s->fd, &st) == 0;
+        if(ok)
+        {
+            size_t part = (size_t)st.st_size % EMLOG_DIRECT_ALIGN;
+            s->off      = st.st_size - (off_t)part;
+            if(part)
+            {
+                s->cur         = (int)s->freel[--s->nfree];
+                ssize_t r      = pread(s->fd, s->buf[s->cur], EMLOG_DIRECT_ALIGN, s->off);
+                ok             = r >= (ssize_t)part;
+                s->len[s->cur] = part;
+                s->tail_done   = part;
+            }
+        }
+        if(!ok)
+        {
+            close(s->fd);
+            rc = EML_FATAL_IO;
+        }
+    }
+    if(ok)
+    {
+        pthread_mutex_init(&s->mu, NULL);
+        pthread_cond_init(&s->cv, NULL);
+        if(pthread_create(&s->th, NULL, direct_sink_main, s) != 0)
+        {
+            pthread_cond_destroy(&s->cv);
+            pthread_mutex_destroy(&s->mu);
+            close(s->fd);
+            ok = 0;
+        }
+    }
+    if(!ok)
+    {
+        for(unsigned i = 0; s->buf && i < nblk; ++i)
+            free(s->buf[i]);
+        free(s->buf);
+        free(s->len);
+        free(s->freel);
+        free(s->fullq);
+        free(s->tail);
+        free(s);
+        return rc;
+    }
+    *out = s;
+    return EML_OK;
+}
+
+ssize_t emlog_direct_sink_write(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct eml_direct_sink* s = (struct eml_direct_sink*)user;
+    if(!s) return -1;
+
+    pthread_mutex_lock(&s->mu);
+    size_t room = s->cur >= 0 ? s->block - s->len[s->cur] : 0;
+    if(n + 1 > room && (n + 1 - room + s->block - 1) / s->block > s->nfree)
+    {
+        /* writer is behind by nblk blocks: shed load, never block */
+        pthread_mutex_unlock(&s->mu);
+        atomic_fetch_add_explicit(&s->dropped, 1u, memory_order_relaxed);
+        return -1;
+    }
+    for(int piece = 0; piece < 2; ++piece)
+    {
+        const char* p = piece ? "\n" : line;
+        size_t      k = piece ? 1u : n;
+        while(k)
+        {
+            if(s->cur < 0)
+            {
+                s->cur         = (int)s->freel[--s->nfree];
+                s->len[s->cur] = 0;
+            }
+            size_t c = s->block - s->len[s->cur];
+            if(c > k) c = k;
+            memcpy(s->buf[s->cur] + s->len[s->cur], p, c);
+            s->len[s->cur] += c;
+            p += c;
+            k -= c;
+            if(s->len[s->cur] == s->block)
+            {
+                s->fullq[(s->fhead + s->nfull++) % s->nblk] = (unsigned)s->cur;
+                s->cur                                     = -1;
+                pthread_cond_signal(&s->cv);
+            }
+        }
+    }
+    pthread_mutex_unlock(&s->mu);
+    return (ssize_t)n;
+}
+
+uint64_t emlog_direct_sink_dropped(const eml_direct_sink_t* sink)
+{
+    return sink ? atomic_load_explicit(&sink->dropped, memory_order_relaxed) : 0u;
+}
+
+bool emlog_direct_sink_is_direct(const eml_direct_sink_t* sink)
+{
+    return sink && sink->direct;
+}
+
+void emlog_direct_sink_close(eml_direct_sink_t* sink)
+{
+    if(!sink) return;
+    pthread_mutex_lock(&sink->mu);
+    sink->stop = 1;
+    pthread_cond_signal(&sink->cv);
+    pthread_mutex_unlock(&sink->mu);
+    pthread_join(sink->th, NULL);
+
+    close(sink->fd);
+    for(unsigned i = 0; i < sink->nblk; ++i)
+        free(sink->buf[i]);
+    free(sink->buf);
+    free(sink->len);
+    free(sink->freel);
+    free(sink->fullq);
+    free(sink->tail);
+    pthread_cond_destroy(&sink->cv);
+    pthread_mutex_destroy(&sink->mu);
+    free(sink);
+}
+
+static void* direct_sink_main(void* arg)
+{
+    struct eml_direct_sink* s = arg;
+    pthread_mutex_lock(&s->mu);
+    for(;;)
+    {
+        if(!s->nfull && !s->stop)
+        {
+            struct timespec dl;
+            clock_gettime(CLOCK_REALTIME, &dl);
+            dl.tv_sec += (time_t)(s->flush_ms / 1000u);
+            dl.tv_nsec += (long)(s->flush_ms % 1000u) * 1000000L;
+            if(dl.tv_nsec >= 1000000000L)
+            {
+                ++dl.tv_sec;
+                dl.tv_nsec -= 1000000000L;
+            }
+            int rc = 0;
+            while(!s->nfull && !s->stop && rc != ETIMEDOUT)
+                rc = pthread_cond_timedwait(&s->cv, &s->mu, &dl);
+        }
+        if(!s->nfull)
+        {
+            /* idle interval or shutdown: put the open tail on disk */
+            size_t len = s->cur >= 0 ? s->len[s->cur] : 0;
+            if(len > s->tail_done)
+            {
+                memcpy(s->tail, s->buf[s->cur], len);
+                pthread_mutex_unlock(&s->mu);
+                direct_write_tail(s, len);
+                pthread_mutex_lock(&s->mu);
+            }
+            if(s->stop) break;
+            continue;
+        }
+        unsigned i = s->fullq[s->fhead];
+        s->fhead   = (s->fhead + 1u) % s->nblk;
+        --s->nfull;
+        pthread_mutex_unlock(&s->mu);
+
+        (void)direct_pwrite(s->fd, s->buf[i], s->block, s->off);
+        s->off += (off_t)s->block;
+        s->tail_done = 0;
+
+        pthread_mutex_lock(&s->mu);
+        s->freel[s->nfree++] = i;
+    }
+    pthread_mutex_unlock(&s->mu);
+    return NULL;
+}
+
+static int direct_pwrite(int fd, const char* p, size_t n, off_t off)
+{
+    while(n)
+    {
+        ssize_t w = pwrite(fd, p, n, off);
+        if(w < 0 && errno == EINTR) continue;
+        if(w <= 0) return -1; /* best effort, like the default writer */
+        p += w;
+        n -= (size_t)w;
+        off += (off_t)w;
+    }
+    return 0;
+}
+
+static void direct_write_tail(struct eml_direct_sink* s, size_t len)
+{
+    size_t padded = (len + EMLOG_DIRECT_ALIGN - 1u) & ~(size_t)(EMLOG_DIRECT_ALIGN - 1u);
+    memset(s->tail + len, 0, padded - len);
+    if(direct_pwrite(s->fd, s->tail, padded, s->off) != 0) return;
+    if(ftruncate(s->fd, s->off + (off_t)len) != 0) return;
+    s->tail_done = len;
+}
+
+void emlog_enable_timestamps(bool on)
+{
+    pthread_mutex_lock(&G.mu);
+    G.use_ts = on ? 1 : 0;
+    pthread_mutex_unlock(&G.mu);
+}
+
+void emlog_set_writer(eml_writer_fn fn, void* user)
+{
+    pthread_mutex_lock(&G.mu);
+    G.writer     = fn;
+    G.writer_iov = NULL;
+    G.writer_ud  = user;
+    pthread_mutex_unlock(&G.mu);
+}
+
+void emlog_set_writer_iov(eml_writer_iov_fn fn, void* user)
+{
+    pthread_mutex_lock(&G.mu);
+    G.writer     = NULL;
+    G.writer_iov = fn;
+    G.writer_ud  = user;
+    pthread_mutex_unlock(&G.mu);
+}
+
+void emlog_set_writev_flush(bool on)
+{
+    pthread_mutex_lock(&G.mu);
+    G.writev_flush = on ? 1 : 0;
+    pthread_mutex_unlock(&G.mu);
+}
+
+eml_err_t emlog_set_fd(unsigned level_mask, int fd)
+{
+    if(level_mask == 0 || (level_mask & ~EML_LEVEL_MASK_ALL)) return EML_BAD_INPUT;
+
+    /* Serialise against in-progress writes so that once this returns no
+     * line is still headed for the previous descriptor. */
+    pthread_mutex_lock(&G.mu);
+    for(int l = EML_LEVEL_DBG; l <= EML_LEVEL_CRIT; ++l)
+    {
+        if(!(level_mask & EML_LEVEL_MASK(l))) continue;
+        int target = fd >= 0 ? fd : (l <= EML_LEVEL_INFO ? STDOUT_FILENO : STDERR_FILENO);
+        atomic_store_explicit(&G.fd[l], target, memory_order_relaxed);
+    }
+    for(int i = 0; i < OVF_SLOTS; ++i)
+    {
+        /* bytes parked for a descriptor no level uses any more */
+        struct ovf_slot* o    = &O.slot[i];
+        int              used = 0;
+        for(int l = EML_LEVEL_DBG; l <= EML_LEVEL_CRIT; ++l)
+            used |= default_fd((eml_level_t)l) == o->fd;
+        if(!o->len || used) continue;
+        ovf_drain_locked(o);
+        if(o->len) ovf_discard_locked(o, &O.dropped);
+    }
+    pthread_mutex_unlock(&G.mu);
+    return EML_OK;
+}
+
+int emlog_get_fd(eml_level_t level)
+{
+    if((unsigned)level > EML_LEVEL_CRIT) return -1;
+    return default_fd(level);
+}
+
+#if defined(__linux__)
+static void pipe_append_locked(eml_level_t level, const struct iovec* iov, int iovcnt)
+{
+    int    fd  = P.fd;
+    size_t was = P.pos;
+    char   nl  = '\n';
+    for(int i = 0; i <= iovcnt; ++i)
+    {
+        const char* p = i < iovcnt ? (const char*)iov[i].iov_base : &nl;
+        size_t      n = i < iovcnt ? iov[i].iov_len : 1;
+        while(n)
+        {
+            if(P.fd < 0 || P.paused)
+            {
+                /* the path turned itself off or paused mid-line: finish
+                 * the line behind what was already written or parked */
+                struct iovec v = {(void*)p, n};
+                write_fd_locked(fd, &v, 1, 1);
+                break;
+            }
+            size_t k = P.cap - P.pos;
+            if(k > n) k = n;
+            memcpy(P.buf[P.cur] + P.pos, p, k);
+            P.pos += k;
+            p += k;
+            n -= k;
+            if(P.pos == P.cap) pipe_splice_full_locked();
+        }
+    }
+    if(P.fd < 0 || P.paused) return;
+    if(level >= EML_LEVEL_ERROR)
+        pipe_drain_locked();
+    else if(!was && P.pos)
+        pthread_cond_signal(&P.cv);
+}
+
+static void pipe_splice_full_locked(void)
+{
+    int sz = fcntl(P.fd, F_GETPIPE_SZ);
+    if(sz < 0 || (size_t)sz > P.cap)
+    {
+        /* more slots than one buffer fills: the swap rule no longer holds */
+        pipe_drain_locked();
+        P.fd = -1;
+        return;
+    }
+    if(ovf_find_locked(P.fd))
+    {
+        /* earlier bytes are parked: queue behind them, never splice */
+        pipe_drain_locked();
+        return;
+    }
+
+    /* vmsplice() ignores O_NONBLOCK: only a blocking pipe may block */
+    int          fl    = fcntl(P.fd, F_GETFL);
+    unsigned     flags = SPLICE_F_GIFT | (fl >= 0 && (fl & O_NONBLOCK) ? SPLICE_F_NONBLOCK : 0u);
+    struct iovec v     = {P.buf[P.cur], P.cap};
+    uint64_t     end   = 0;
+    while(v.iov_len)
+    {
+        ssize_t r = vmsplice(P.fd, &v, 1, flags);
+        if(r > 0)
+        {
+            v.iov_base = (char*)v.iov_base + r;
+            v.iov_len -= (size_t)r;
+            continue;
+        }
+        if(r < 0 && errno == EINTR) continue;
+        if(r < 0 && errno == EAGAIN)
+        {
+            uint64_t now = mono_ns();
+            if(!end) end = now + PIPE_STALL_MS * 1000000ull;
+            if(now < end)
+            {
+                struct pollfd pfd = {.fd = P.fd, .events = POLLOUT};
+                (void)poll(&pfd, 1, (int)((end - now) / 1000000ull) + 1);
+                continue;
+            }
+            /* stalled reader: park the rest and pause, since the pipe may
+             * still hold pages of both buffers */
+            size_t sent = P.cap - v.iov_len;
+            int    cont = sent ? P.buf[P.cur][sent - 1] != '\n' : P.cont;
+            atomic_fetch_add_explicit(&P.spliced, sent, memory_order_relaxed);
+            atomic_fetch_add_explicit(&P.copied, v.iov_len, memory_order_relaxed);
+            pipe_write_locked(v.iov_base, v.iov_len, cont);
+            P.paused = 1;
+            P.pos    = 0;
+            P.cont   = 0;
+            return;
+        }
+        break;
+    }
+    atomic_fetch_add_explicit(&P.spliced, P.cap - v.iov_len, memory_order_relaxed);
+    if(v.iov_len)
+    {
+        /* reader gone or pipe broken: the buffers can no longer be
+         * proven free, so stop splicing (lines are lost as with writev) */
+        P.fd = -1;
+        return;
+    }
+    P.cont = P.buf[P.cur][P.cap - 1] != '\n';
+    P.cur ^= 1;
+    P.pos = 0;
+}
+
+static void pipe_drain_locked(void)
+{
+    if(!P.pos) return;
+    /* write() copies, so the buffer is free again once this returns */
+    atomic_fetch_add_explicit(&P.copied, P.pos, memory_order_relaxed);
+    pipe_write_locked(P.buf[P.cur], P.pos, P.cont);
+    P.pos  = 0;
+    P.cont = 0;
+    if(ovf_find_locked(P.fd)) P.paused = 1;
+}
+
+static void pipe_write_locked(const char* p, size_t n, int cont)
+{
+    const char* first = cont ? memchr(p, '\n', n) : NULL;
+    size_t      head  = first ? (size_t)(first - p) + 1 : cont ? n : 0;
+    const char* last  = memrchr(p + head, '\n', n - head);
+    size_t      tail  = last ? (size_t)(p + n - last) - 1 : n - head;
+    struct iovec v[3] = {{(void*)p, head},
+                         {(void*)(p + head), n - head - tail},
+                         {(void*)(p + n - tail), tail}};
+    for(int i = 0; i < 3; ++i)
+        if(v[i].iov_len) write_fd_locked(P.fd, &v[i], 1, i != 1);
+}
+
+static int pipe_ready_locked(void)
+{
+    if(!P.paused) return 1;
+    int queued = 0;
+    if(ovf_find_locked(P.fd) || ioctl(P.fd, FIONREAD, &queued) < 0 || queued) return 0;
+    P.paused = 0;
+    P.cur    = 0;
+    P.pos    = 0;
+    return 1;
+}
+
+static void* pipe_flush_main(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&G.mu);
+    while(!P.stop)
+    {
+        if(!P.pos)
+        {
+            pthread_cond_wait(&P.cv, &G.mu);
+            continue;
+        }
+        struct timespec dl;
+        clock_gettime(CLOCK_REALTIME, &dl);
+        dl.tv_sec += (time_t)(P.flush_ms / 1000u);
+        dl.tv_nsec += (long)(P.flush_ms % 1000u) * 1000000L;
+        if(dl.tv_nsec >= 1000000000L)
+        {
+            ++dl.tv_sec;
+            dl.tv_nsec -= 1000000000L;
+        }
+        int rc = 0;
+        while(!P.stop && rc != ETIMEDOUT)
+            rc = pthread_cond_timedwait(&P.cv, &G.mu, &dl);
+        if(P.fd >= 0 && P.pos) pipe_drain_locked();
+    }
+    pthread_mutex_unlock(&G.mu);
+    return NULL;
+}
+#endif
+
+eml_err_t emlog_set_pipe_splice(int fd, unsigned flush_ms)
+{
+#if defined(__linux__)
+    pthread_mutex_lock(&P.ctl);
+    if(P.running)
+    {
+        pthread_mutex_lock(&G.mu);
+        if(P.fd >= 0 && P.pos) pipe_drain_locked();
+        P.fd   = -1;
+        P.stop = 1;
+        pthread_cond_signal(&P.cv);
+        pthread_mutex_unlock(&G.mu);
+        pthread_join(P.th, NULL);
+        P.running = 0;
+        /* pages still queued in the pipe hold their own references */
+        munmap(P.buf[0], 2 * P.cap);
+        P.buf[0] = P.buf[1] = NULL;
+    }
+    if(fd < 0)
+    {
+        pthread_mutex_unlock(&P.ctl);
+        return EML_OK;
+    }
+
+    struct stat st;
+    int         sz = fcntl(fd, F_GETPIPE_SZ);
+    if(fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode) || sz <= 0)
+    {
+        pthread_mutex_unlock(&P.ctl);
+        return EML_BAD_INPUT;
+    }
+    char* m = mmap(NULL, 2 * (size_t)sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                   0);
+    if(m == MAP_FAILED)
+    {
+        pthread_mutex_unlock(&P.ctl);
+        return EML_TEMP_RESOURCE;
+    }
+    P.cap      = (size_t)sz;
+    P.buf[0]   = m;
+    P.buf[1]   = m + sz;
+    P.cur      = 0;
+    P.pos      = 0;
+    P.cont     = 0;
+    P.paused   = 0;
+    P.flush_ms = flush_ms ? flush_ms : 100u;
+    P.stop     = 0;
+    if(pthread_create(&P.th, NULL, pipe_flush_main, NULL) != 0)
+    {
+        munmap(m, 2 * (size_t)sz);
+        pthread_mutex_unlock(&P.ctl);
+        return EML_TEMP_RESOURCE;
+    }
+    P.running = 1;
+
+    static int at_exit_hooked;
+    if(!at_exit_hooked)
+    {
+        at_exit_hooked = 1;
+        atexit(emlog_pipe_flush);
+    }
+
+    pthread_mutex_lock(&G.mu);
+    P.fd = fd;
+    pthread_mutex_unlock(&G.mu);
+    pthread_mutex_unlock(&P.ctl);
+    return EML_OK;
+#else
+    (void)fd;
+    (void)flush_ms;
+    return EML_NOT_FOUND;
+#endif
+}
+
+void emlog_pipe_flush(void)
+{
+#if defined(__linux__)
+    pthread_mutex_lock(&G.mu);
+    if(P.fd >= 0 && P.pos) pipe_drain_locked();
+    pthread_mutex_unlock(&G.mu);
+#endif
+}
+
+void emlog_pipe_splice_stats(uint64_t* spliced, uint64_t* copied)
+{
+#if defined(__linux__)
+    if(spliced) *spliced = atomic_load_explicit(&P.spliced, memory_order_relaxed);
+    if(copied) *copied = atomic_load_explicit(&P.copied, memory_order_relaxed);
+#else
+    if(spliced) *spliced = 0;
+    if(copied) *copied = 0;
+#endif
+}
+
+eml_err_t emlog_set_overflow(size_t bytes, eml_overflow_policy_t policy, unsigned block_ms)
+{
+    if((unsigned)policy > EML_OVERFLOW_BLOCK) return EML_BAD_INPUT;
+    pthread_mutex_lock(&G.mu);
+    O.cap      = bytes;
+    O.policy   = policy;
+    O.block_ms = block_ms;
+    pthread_cond_broadcast(&O.room);
+    for(int i = 0; i < OVF_SLOTS; ++i)
+    {
+        /* idle buffers are reallocated at the new size when next needed */
+        struct ovf_slot* o = &O.slot[i];
+        if(o->len) continue;
+        free(o->buf);
+        o->buf  = NULL;
+        o->size = 0;
+    }
+    pthread_mutex_unlock(&G.mu);
+    return EML_OK;
+}
+
+void emlog_overflow_stats(eml_overflow_stats_t* out)
+{
+    if(!out) return;
+    out->partial       = atomic_load_explicit(&O.partial, memory_order_relaxed);
+    out->deferred      = atomic_load_explicit(&O.deferred, memory_order_relaxed);
+    out->dropped       = atomic_load_explicit(&O.dropped, memory_order_relaxed);
+    out->dropped_bytes = atomic_load_explicit(&O.dropped_bytes, memory_order_relaxed);
+    out->blocked       = atomic_load_explicit(&O.blocked, memory_order_relaxed);
+    out->errors        = atomic_load_explicit(&O.errors, memory_order_relaxed);
+    out->pending       = 0;
+    pthread_mutex_lock(&G.mu);
+    for(int i = 0; i < OVF_SLOTS; ++i)
+        out->pending += O.slot[i].len;
+    pthread_mutex_unlock(&G.mu);
+}
+
+void emlog_overflow_flush(void)
+{
+    pthread_mutex_lock(&G.mu);
+    for(int i = 0; i < OVF_SLOTS; ++i)
+    {
+        struct ovf_slot* o = &O.slot[i];
+        if(!o->len) continue;
+        uint64_t end = mono_ns() + 1000000000ull;
+        ovf_drain_locked(o);
+        while(o->len)
+        {
+            uint64_t now = mono_ns();
+            if(now >= end) break;
+            struct pollfd pfd = {.fd = o->fd, .events = POLLOUT};
+            (void)poll(&pfd, 1, (int)((end - now) / 1000000ull) + 1);
+            ovf_drain_locked(o);
+        }
+        if(o->len) ovf_discard_locked(o, &O.dropped);
+    }
+    pthread_mutex_unlock(&G.mu);
+}
+
+static void write_fd_locked(int fd, struct iovec* v, int cnt, int cont)
+{
+    size_t total = 0;
+    for(int i = 0; i < cnt; ++i)
+        total += v[i].iov_len;
+
+    /* this call already waits for fd: keep its lines in order */
+    if(ovf_nwait_tls && ovf_defer_locked(fd, v, cnt, total, 0)) return;
+
+    struct ovf_slot* o = ovf_find_locked(fd);
+    if(o)
+    {
+        /* lines queue behind parked bytes so the stream stays in order */
+        ovf_drain_locked(o);
+        if(o->len)
+        {
+            ovf_park_locked(fd, v, cnt, total, cont);
+            return;
+        }
+    }
+
+    size_t done = 0;
+    for(;;)
+    {
+        ssize_t r = writev(fd, v, cnt);
+        if(r > 0)
+        {
+            done += (size_t)r;
+            if(done == total) return;
+            /* short write (full pipe, signal): continue after what went out */
+            atomic_fetch_add_explicit(&O.partial, 1u, memory_order_relaxed);
+            size_t k = (size_t)r;
+            while(cnt && k >= v->iov_len)
+            {
+                k -= v->iov_len;
+                ++v;
+                --cnt;
+            }
+            v->iov_base = (char*)v->iov_base + k;
+            v->iov_len -= k;
+            continue;
+        }
+        if(r < 0 && errno == EINTR) continue;
+        if(r < 0 && errno == EAGAIN)
+        {
+            ovf_park_locked(fd, v, cnt, total - done, cont || done != 0);
+            return;
+        }
+        /* closed descriptor, reader gone: nothing more can go out */
+        atomic_fetch_add_explicit(&O.errors, 1u, memory_order_relaxed);
+        return;
+    }
+}
+
+static struct ovf_slot* ovf_find_locked(int fd)
+{
+    for(int i = 0; i < OVF_SLOTS; ++i)
+        if(O.slot[i].len && O.slot[i].fd == fd) return &O.slot[i];
+    return NULL;
+}
+
+static void ovf_drain_locked(struct ovf_slot* o)
+{
+    size_t off = o->off;
+    while(o->len)
+    {
+        ssize_t r = write(o->fd, o->buf + o->off, o->len);
+        if(r > 0)
+        {
+            o->off += (size_t)r;
+            o->len -= (size_t)r;
+            continue;
+        }
+        if(r < 0 && errno == EINTR) continue;
+        if(r < 0 && errno == EAGAIN) break;
+        ovf_discard_locked(o, &O.errors);
+        return;
+    }
+    if(o->off != off) pthread_cond_broadcast(&O.room);
+    if(!o->len)
+    {
+        o->off = 0;
+        o->mid = 0;
+    }
+    else if(o->off != off)
+    {
+        o->mid = o->buf[o->off - 1] != '\n';
+    }
+}
+
+static void ovf_park_locked(int fd, const struct iovec* v, int cnt, size_t n, int mid)
+{
+    /* the splice path parks whole buffers: count the lines they end */
+    uint64_t lines = 0;
+    for(int i = 0; i < cnt; ++i)
+        for(size_t k = 0; k < v[i].iov_len; ++k)
+            lines += ((const char*)v[i].iov_base)[k] == '\n';
+    if(!lines) lines = 1;
+
+    struct ovf_slot* o = ovf_find_locked(fd);
+    for(int i = 0; !o && i < OVF_SLOTS; ++i)
+    {
+        if(O.slot[i].len) continue;
+        o      = &O.slot[i];
+        o->fd  = fd;
+        o->off = 0;
+        o->mid = mid;
+    }
+
+    /* the tail of a line that is already partly out is always kept */
+    if(o && !mid && o->len + n > O.cap)
+    {
+        if(O.policy == EML_OVERFLOW_DROP_OLDEST)
+        {
+            ovf_drop_oldest_locked(o, n);
+        }
+        else if(O.policy == EML_OVERFLOW_BLOCK && O.cap >= n && ovf_arm_tls &&
+                ovf_defer_locked(fd, v, cnt, n, 1))
+        {
+            return;
+        }
+    }
+    if(!o || (!mid && o->len + n > O.cap))
+    {
+        atomic_fetch_add_explicit(&O.dropped, lines, memory_order_relaxed);
+        atomic_fetch_add_explicit(&O.dropped_bytes, n, memory_order_relaxed);
+        return;
+    }
+
+    if(o->off + o->len + n > o->size)
+    {
+        memmove(o->buf, o->buf + o->off, o->len);
+        o->off = 0;
+        if(o->len + n > o->size)
+        {
+            size_t size = o->len + n > O.cap ? o->len + n : O.cap;
+            char*  buf  = realloc(o->buf, size);
+            if(!buf)
+            {
+                atomic_fetch_add_explicit(&O.dropped, lines, memory_order_relaxed);
+                atomic_fetch_add_explicit(&O.dropped_bytes, n, memory_order_relaxed);
+                return;
+            }
+            o->buf  = buf;
+            o->size = size;
+        }
+    }
+    char* p = o->buf + o->off + o->len;
+    for(int i = 0; i < cnt; ++i)
+    {
+        memcpy(p, v[i].iov_base, v[i].iov_len);
+        p += v[i].iov_len;
+    }
+    o->len += n;
+    atomic_fetch_add_explicit(&O.deferred, lines, memory_order_relaxed);
+
+    if(!O.running)
+    {
+        pthread_t th;
+        if(pthread_create(&th, NULL, ovf_drain_main, NULL) == 0)
+        {
+            pthread_detach(th);
+            O.running = 1;
+        }
+    }
+    if(!O.hooked)
+    {
+        O.hooked = 1;
+        atexit(emlog_overflow_flush);
+    }
+}
+
+static void ovf_drop_oldest_locked(struct ovf_slot* o, size_t n)
+{
+    char*  p    = o->buf + o->off;
+    size_t keep = 0;
+    if(o->mid)
+    {
+        /* the first line is partly out: finish it, drop what follows */
+        char* nl = memchr(p, '\n', o->len);
+        keep     = nl ? (size_t)(nl - p) + 1 : o->len;
+    }
+    size_t   cut   = keep;
+    uint64_t lines = 0;
+    while(cut < o->len && o->len - (cut - keep) + n > O.cap)
+    {
+        char* nl = memchr(p + cut, '\n', o->len - cut);
+        cut      = nl ? (size_t)(nl - p) + 1 : o->len;
+        ++lines;
+    }
+    if(cut == keep) return;
+    memmove(p + keep, p + cut, o->len - cut);
+    o->len -= cut - keep;
+    atomic_fetch_add_explicit(&O.dropped, lines, memory_order_relaxed);
+    atomic_fetch_add_explicit(&O.dropped_bytes, cut - keep, memory_order_relaxed);
+}
+
+static void ovf_discard_locked(struct ovf_slot* o, _Atomic uint64_t* counter)
+{
+    uint64_t    lines = 0;
+    const char* p     = o->buf + o->off;
+    for(size_t i = 0; i < o->len; ++i)
+        lines += p[i] == '\n';
+    atomic_fetch_add_explicit(counter, lines, memory_order_relaxed);
+    if(counter == &O.dropped)
+        atomic_fetch_add_explicit(&O.dropped_bytes, o->len, memory_order_relaxed);
+    o->len = 0;
+    o->off = 0;
+    o->mid = 0;
+    pthread_cond_broadcast(&O.room);
+}
+
+static int ovf_defer_locked(int fd, const struct iovec* v, int cnt, size_t n, int create)
+{
+    struct ovf_wait* w = NULL;
+    for(int i = 0; i < ovf_nwait_tls && !w; ++i)
+        if(ovf_wait_tls[i].fd == fd) w = &ovf_wait_tls[i];
+    if(!w && !create) return 0;
+    if(!w && ovf_nwait_tls < OVF_SLOTS)
+    {
+        w      = &ovf_wait_tls[ovf_nwait_tls++];
+        w->fd  = fd;
+        w->len = 0;
+        atomic_fetch_add_explicit(&O.blocked, 1u, memory_order_relaxed);
+    }
+    if(w && w->len + n > O.cap) w = NULL;
+    if(w && w->len + n > w->size)
+    {
+        char* buf = realloc(w->buf, O.cap);
+        if(buf)
+        {
+            w->buf  = buf;
+            w->size = O.cap;
+        }
+        else
+        {
+            w = NULL;
+        }
+    }
+    if(!w)
+    {
+        /* more than one buffer's worth behind a stall: drop the newest */
+        uint64_t lines = 0;
+        for(int i = 0; i < cnt; ++i)
+            for(size_t k = 0; k < v[i].iov_len; ++k)
+                lines += ((const char*)v[i].iov_base)[k] == '\n';
+        atomic_fetch_add_explicit(&O.dropped, lines ? lines : 1u, memory_order_relaxed);
+        atomic_fetch_add_explicit(&O.dropped_bytes, n, memory_order_relaxed);
+        return 1;
+    }
+    for(int i = 0; i < cnt; ++i)
+    {
+        memcpy(w->buf + w->len, v[i].iov_base, v[i].iov_len);
+        w->len += v[i].iov_len;
+    }
+    return 1;
+}
+
+static void ovf_block_wait(void)
+{
+    pthread_mutex_lock(&G.mu);
+    uint64_t ms  = O.block_ms ? O.block_ms : EMLOG_OVERFLOW_BLOCK_MS;
+    uint64_t end = mono_ns() + ms * 1000000ull;
+    int      n   = ovf_nwait_tls;
+    ovf_nwait_tls = 0; /* write_fd_locked() below must not queue again */
+    for(int i = 0; i < n; ++i)
+    {
+        struct ovf_wait* w = &ovf_wait_tls[i];
+        for(;;)
+        {
+            struct ovf_slot* o = ovf_find_locked(w->fd);
+            if(!o || o->len + w->len <= O.cap || O.policy != EML_OVERFLOW_BLOCK)
+            {
+                /* room (or the policy changed): park or write as usual */
+                struct iovec v = {w->buf, w->len};
+                write_fd_locked(w->fd, &v, 1, 0);
+                break;
+            }
+            uint64_t now = mono_ns();
+            if(now >= end)
+            {
+                uint64_t lines = 0;
+                for(size_t k = 0; k < w->len; ++k)
+                    lines += w->buf[k] == '\n';
+                atomic_fetch_add_explicit(&O.dropped, lines, memory_order_relaxed);
+                atomic_fetch_add_explicit(&O.dropped_bytes, w->len, memory_order_relaxed);
+                break;
+            }
+            /* the condvar clock is CLOCK_REALTIME: convert the gap */
+            struct timespec dl;
+            clock_gettime(CLOCK_REALTIME, &dl);
+            uint64_t ns = (uint64_t)dl.tv_nsec + (end - now);
+            dl.tv_sec += (time_t)(ns / 1000000000ull);
+            dl.tv_nsec = (long)(ns % 1000000000ull);
+            pthread_cond_timedwait(&O.room, &G.mu, &dl);
+        }
+        free(w->buf);
+        w->buf  = NULL;
+        w->size = 0;
+        w->len  = 0;
+    }
+    pthread_mutex_unlock(&G.mu);
+}
+
+static void* ovf_drain_main(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&G.mu);
+    for(;;)
+    {
+        struct pollfd pfd[OVF_SLOTS];
+        nfds_t        n = 0;
+        for(int i = 0; i < OVF_SLOTS; ++i)
+            if(O.slot[i].len) pfd[n++] = (struct pollfd){.fd = O.slot[i].fd, .events = POLLOUT};
+        if(!n) break;
+        /* bounded wait: picks up slots parked while we were asleep */
+        pthread_mutex_unlock(&G.mu);
+        (void)poll(pfd, n, 100);
+        pthread_mutex_lock(&G.mu);
+        for(int i = 0; i < OVF_SLOTS; ++i)
+            if(O.slot[i].len) ovf_drain_locked(&O.slot[i]);
+    }
+    O.running = 0;
+    pthread_mutex_unlock(&G.mu);
+    return NULL;
+}
+
+void emlog_set_dedup(bool on, unsigned window_ms)
+{
+    pthread_mutex_lock(&G.mu);
+    G.dedup        = on ? 1 : 0;
+    G.dedup_win_ns = (uint64_t)(window_ms ? window_ms : 1000u) * 1000000ull;
+    pthread_mutex_unlock(&G.mu);
+}
+
+void emlog_dedup_flush(void)
+{
+    char ts[40] = {0};
+    pthread_mutex_lock(&G.mu);
+    if(dedup_tls.count)
+    {
+        if(G.use_ts) fmt_time_iso8601(ts, sizeof ts, NULL);
+        dedup_flush_locked(&dedup_tls, ts);
+    }
+    pthread_mutex_unlock(&G.mu);
+    if(sink_defer_tls) sink_run_deferred();
+}
+
+eml_err_t emlog_set_backtrace(eml_level_t capture_level, unsigned lines)
+{
+    if((unsigned)capture_level > EML_LEVEL_CRIT) return EML_BAD_INPUT;
+    pthread_mutex_lock(&ctl_mu);
+    atomic_store_explicit(&bt_lines, lines, memory_order_relaxed);
+    atomic_store_explicit(&bt_level, lines ? (int)capture_level : -1, memory_order_release);
+    refresh_active_level_locked();
+    pthread_mutex_unlock(&ctl_mu);
+    return EML_OK;
+}
+
+eml_err_t emlog_ring_open(const eml_ring_cfg_t* cfg)
+{
+    if(!cfg || (unsigned)cfg->level > EML_LEVEL_CRIT || cfg->crash_fd < 0) return EML_BAD_INPUT;
+    size_t bytes = cfg->bytes ? cfg->bytes : (size_t)4 << 20;
+    if(bytes > (SIZE_MAX >> 2)) return EML_BAD_INPUT;
+    size_t size = (size_t)64 << 10;
+    while(size < bytes)
+        size <<= 1;
+    size_t map_len = sizeof(eml_ring_hdr_t) + size;
+
+    int fd    = -1;
+    int fresh = 1;
+    if(cfg->shm_name)
+    {
+        const char* name = cfg->shm_name;
+        size_t      len  = strlen(name);
+        if(len == 0 || len >= EMLOG_RING_NAME_MAX || name[0] == '.' ||
+           strspn(name, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_.-") != len)
+            return EML_BAD_INPUT;
+        char path[32 + EMLOG_RING_NAME_MAX];
+        snprintf(path, sizeof path, "/dev/shm/emlog-ring.%s", name);
+        fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if(fd < 0) return (errno == EACCES || errno == EPERM) ? EML_PERM : EML_TEMP_RESOURCE;
+        struct stat st;
+        if(fstat(fd, &st) == 0 && (size_t)st.st_size == map_len) fresh = 0;
+    }
+#if defined(__linux__)
+    else
+    {
+        fd = memfd_create("emlog-ring", MFD_CLOEXEC);
+    }
+#endif
+    if(fd >= 0 && fresh && (ftruncate(fd, 0) < 0 || ftruncate(fd, (off_t)map_len) < 0))
+    {
+        close(fd);
+        return EML_TEMP_RESOURCE;
+    }
+    eml_ring_hdr_t* h = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                             fd >= 0 ? MAP_SHARED : MAP_PRIVATE | MAP_ANONYMOUS, fd, 0);
+    if(h == MAP_FAILED)
+    {
+        if(fd >= 0) close(fd);
+        return EML_TEMP_RESOURCE;
+    }
+    /* an existing file of the same geometry keeps its lines */
+    if(fresh || h->magic != EMLOG_RING_MAGIC || h->version != EMLOG_RING_VERSION ||
+       h->hdr_bytes != sizeof *h || h->size != size)
+    {
+        memset(h, 0, sizeof *h);
+        h->version   = EMLOG_RING_VERSION;
+        h->hdr_bytes = sizeof *h;
+        h->size      = size;
+        __atomic_store_n(&h->magic, EMLOG_RING_MAGIC, __ATOMIC_RELEASE);
+    }
+    h->pid = (uint64_t)getpid();
+
+    pthread_mutex_lock(&R.ctl);
+    ring_close_locked();
+    R.map_len  = map_len;
+    R.fd       = fd;
+    R.crash_fd = cfg->crash_fd;
+    atomic_store(&R.hdr, h);
+    if(R.crash_fd)
+    {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sa_handler = ring_crash_handler;
+        sa.sa_flags   = SA_ONSTACK;
+        sigemptyset(&sa.sa_mask);
+        for(int i = 0; i < RING_NSIGS; ++i)
+            sigaction(ring_sigs[i], &sa, &R.old[i]);
+    }
+    pthread_mutex_lock(&ctl_mu);
+    atomic_store_explicit(&ring_level, (int)cfg->level, memory_order_release);
+    refresh_active_level_locked();
+    pthread_mutex_unlock(&ctl_mu);
+    pthread_mutex_unlock(&R.ctl);
+    return EML_OK;
+}
+
+void emlog_ring_close(void)
+{
+    pthread_mutex_lock(&R.ctl);
+    ring_close_locked();
+    pthread_mutex_unlock(&R.ctl);
+}
+
+eml_err_t emlog_ring_dump(int fd)
+{
+    atomic_fetch_add(&R.inflight, 1u);
+    eml_ring_hdr_t* h = atomic_load(&R.hdr);
+    ssize_t         n = h ? ring_walk(h, (const unsigned char*)h + h->hdr_bytes, fd, 1) : 0;
+    atomic_fetch_sub(&R.inflight, 1u);
+    if(!h) return EML_NOT_FOUND;
+    return n < 0 ? EML_TEMP_UNAVAILABLE : EML_OK;
+}
+
+ssize_t emlog_ring_extract(const void* image, size_t len, int fd)
+{
+    const eml_ring_hdr_t* h = image;
+    if(!h || len < sizeof *h || h->magic != EMLOG_RING_MAGIC || h->version != EMLOG_RING_VERSION ||
+       h->hdr_bytes < sizeof *h || h->hdr_bytes > len || h->size < 64u ||
+       (h->size & (h->size - 1u)) || len - h->hdr_bytes < h->size)
+        return -1;
+    return ring_walk(h, (const unsigned char*)image + h->hdr_bytes, fd, 0);
+}
+
+void emlog_log(eml_level_t level, const char* comp, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    emit_va(NULL, level, comp, fmt, ap);
+    va_end(ap);
+}
+
+void emlog__emit(eml_level_t level, const char* comp, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    emit_va(NULL, level, comp, fmt, ap);
+    va_end(ap);
+}
+
+void emlog__emit_site(eml_callsite_t* cs, const char* comp, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    emit_va(cs, (eml_level_t)cs->level, comp, fmt, ap);
+    va_end(ap);
+}
+
+void emlog_log_errno(eml_level_t level, const char* comp, int err, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    log_errno_va(NULL, level, comp, err, fmt, ap);
+    va_end(ap);
+}
+
+void emlog__emit_errno_site(eml_callsite_t* cs, const char* comp, int err, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    log_errno_va(cs, (eml_level_t)cs->level, comp, err, fmt, ap);
+    va_end(ap);
+}
+
+void emlog__callsites_register(eml_callsite_t* start, eml_callsite_t* stop)
+{
+    if(!start || !stop || start >= stop) return;
+    pthread_mutex_lock(&ctl_mu);
+    for(size_t i = 0; i < cs_nmods; ++i)
+    {
+        if(cs_mods[i].start == start)
+        {
+            pthread_mutex_unlock(&ctl_mu);
+            return; /* every TU of a module registers the same section */
+        }
+    }
+    struct cs_module* mods = realloc(cs_mods, (cs_nmods + 1) * sizeof *mods);
+    if(!mods)
+    {
+        /* sites keep their initial enabled=1 and stay precisely filtered */
+        pthread_mutex_unlock(&ctl_mu);
+        return;
+    }
+    cs_mods                 = mods;
+    cs_mods[cs_nmods].start = start;
+    cs_mods[cs_nmods].stop  = stop;
+    ++cs_nmods;
+
+    int active = __atomic_load_n(&emlog__active_level, __ATOMIC_RELAXED);
+    for(eml_callsite_t* cs = start; cs < stop; ++cs)
+    {
+        for(size_t r = 0; r < cs_nrules; ++r)
+            if(cs_match(cs, &cs_rules[r])) cs_set_forced(cs, cs_rules[r].on);
+        cs_sync_site(cs, active);
+    }
+    pthread_mutex_unlock(&ctl_mu);
+}
+
+int emlog__ratelimit(eml_ratelimit_t* rl, unsigned rate, unsigned burst, eml_callsite_t* cs,
+                     eml_level_t level, const char* comp)
+{
+    if(rate == 0) return 1; /* no limit configured */
+    if(burst == 0) burst = 1;
+
+    /* GCRA: each admitted line pushes the theoretical arrival time (tat)
+     * one emission interval into the future; a line is admitted while
+     * tat stays within `burst - 1` intervals of now. */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now      = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    uint64_t interval = 1000000000ull / rate;
+    uint64_t tol      = interval * (burst - 1u);
+    uint64_t tat      = __atomic_load_n(&rl->tat, __ATOMIC_RELAXED);
+    for(;;)
+    {
+        if(tat > now + tol)
+        {
+            /* first drop since the last summary: report it by the time
+             * the bucket has refilled even if no line gets through */
+            if(__atomic_fetch_add(&rl->suppressed, 1u, __ATOMIC_RELAXED) == 0)
+                rl_queue(rl, cs, level, comp, tat);
+            return 0;
+        }
+        uint64_t next = (tat > now ? tat : now) + interval;
+        if(__atomic_compare_exchange_n(&rl->tat, &tat, next, 1, __ATOMIC_RELAXED,
+                                       __ATOMIC_RELAXED))
+            break;
+    }
+
+    uint64_t dropped = __atomic_exchange_n(&rl->suppressed, 0u, __ATOMIC_RELAXED);
+    if(dropped) rl_summary(cs, level, comp, (unsigned long long)dropped);
+    return 1;
+}
+
+static void rl_summary(eml_callsite_t* cs, eml_level_t level, const char* comp,
+                       unsigned long long dropped)
+{
+    if(cs)
+        emit(cs, level, comp, "%llu messages suppressed by rate limit (%s:%u)", dropped, cs->file,
+             cs->line);
+    else
+        emit(NULL, level, comp, "%llu messages suppressed by rate limit", dropped);
+}
+
+static void rl_queue(eml_ratelimit_t* rl, eml_callsite_t* cs, eml_level_t level, const char* comp,
+                     uint64_t due)
+{
+    pthread_mutex_lock(&T.mu);
+    /* the summary outlives the call: keep our own copy of the name */
+    size_t clen = comp ? strlen(comp) : 0;
+    if(clen >= sizeof rl->comp) clen = sizeof rl->comp - 1;
+    memcpy(rl->comp, comp ? comp : "", clen);
+    rl->comp[clen] = '\0';
+    rl->cs         = cs;
+    rl->level      = (int)level;
+    rl->due        = due;
+    if(!rl->queued)
+    {
+        rl->queued = 1;
+        rl->next   = T.rl;
+        T.rl       = rl;
+    }
+    summary_start_locked();
+    pthread_mutex_unlock(&T.mu);
+}
+
+static void summary_arm_dedup(uint64_t due)
+{
+    pthread_mutex_lock(&T.mu);
+    if(!T.dedup_due || due < T.dedup_due) T.dedup_due = due;
+    summary_start_locked();
+    pthread_mutex_unlock(&T.mu);
+}
+
+static void summary_start_locked(void)
+{
+    if(!T.running)
+    {
+        pthread_t th;
+        if(pthread_create(&th, NULL, summary_main, NULL) == 0)
+        {
+            pthread_detach(th);
+            T.running = 1;
+        }
+    }
+    pthread_cond_signal(&T.cv);
+}
+
+static void* summary_main(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&T.mu);
+    while(T.rl || T.dedup_due)
+    {
+        uint64_t          now  = mono_ns();
+        uint64_t          at   = T.dedup_due ? T.dedup_due : UINT64_MAX;
+        eml_ratelimit_t*  fire = NULL;
+        if(T.dedup_due && T.dedup_due <= now)
+        {
+            /* re-armed by dedup_expire() when runs remain open */
+            T.dedup_due = 0;
+            pthread_mutex_unlock(&T.mu);
+            dedup_expire();
+            pthread_mutex_lock(&T.mu);
+            continue;
+        }
+        eml_ratelimit_t** pp   = &T.rl;
+        while(*pp)
+        {
+            eml_ratelimit_t* rl = *pp;
+            if(rl->due <= now)
+            {
+                *pp        = rl->next;
+                rl->queued = 0;
+                fire       = rl;
+                break;
+            }
+            if(rl->due < at) at = rl->due;
+            pp = &rl->next;
+        }
+        if(fire)
+        {
+            /* a drop after the exchange queues the limiter again */
+            eml_callsite_t* cs    = fire->cs;
+            eml_level_t     level = (eml_level_t)fire->level;
+            char            comp[EMLOG_COMPONENT_NAME_MAX];
+            memcpy(comp, fire->comp, sizeof comp);
+            pthread_mutex_unlock(&T.mu);
+            uint64_t dropped = __atomic_exchange_n(&fire->suppressed, 0u, __ATOMIC_RELAXED);
+            if(dropped) rl_summary(cs, level, comp[0] ? comp : NULL, (unsigned long long)dropped);
+            pthread_mutex_lock(&T.mu);
+            continue;
+        }
+        /* the condvar clock is CLOCK_REALTIME: convert the gap */
+        struct timespec dl;
+        clock_gettime(CLOCK_REALTIME, &dl);
+        uint64_t ns = (uint64_t)dl.tv_nsec + (at - now);
+        dl.tv_sec += (time_t)(ns / 1000000000ull);
+        dl.tv_nsec = (long)(ns % 1000000000ull);
+        pthread_cond_timedwait(&T.cv, &T.mu, &dl);
+    }
+    T.running = 0;
+    pthread_mutex_unlock(&T.mu);
+    return NULL;
+}
+
+int emlog_callsite_enable(const char* spec)
+{
+    return cs_apply_spec(spec, 1);
+}
+
+int emlog_callsite_disable(const char* spec)
+{
+    return cs_apply_spec(spec, 0);
+}
+
+eml_err_t eml_from_errno(int e)
+{
+    switch(e)
+    {
+        case 0:
+            return EML_OK;
+        case EINTR:
+        case EAGAIN:
+#if defined(EWOULDBLOCK) && (EWOULDBLOCK != EAGAIN)
+        case EWOULDBLOCK:
+#endif
+            return EML_TRY_AGAIN;
+        case EMFILE:
+        case ENFILE:
+        case ENOMEM:
+            return EML_TEMP_RESOURCE;
+        case EBUSY:
+#if defined(ENETDOWN) && (ENETDOWN != EBUSY)
+        case ENETDOWN:
+#endif
+#if defined(ENETUNREACH) && \
+    (!defined(ENETDOWN) || (ENETUNREACH != ENETDOWN && ENETUNREACH != EBUSY))
+        case ENETUNREACH:
+#endif
+            return EML_TEMP_UNAVAILABLE;
+        case ENOENT:
+        case ESRCH:
+            return EML_NOT_FOUND;
+        case EINVAL:
+#if defined(EPROTO) && (EPROTO != EINVAL)
+        case EPROTO:
+#endif
+#if defined(EBADMSG) && (EBADMSG != EINVAL && (!defined(EPROTO) || EBADMSG != EPROTO))
+        case EBADMSG:
+#endif
+            return EML_BAD_INPUT;
+        case EACCES:
+        case EPERM:
+            return EML_PERM;
+        case EEXIST:
+#if defined(EADDRINUSE) && (EADDRINUSE != EEXIST)
+        case EADDRINUSE:
+#endif
+            return EML_CONFLICT;
+        case EIO:
+        case ENOSPC:
+            return EML_FATAL_IO;
+        default:
+            return EML_FATAL_BUG;
+    }
+}
+
+const char* eml_err_name(eml_err_t e)
+{
+    switch(e)
+    {
+        case EML_OK:
+            return "EML_OK";
+        case EML_TRY_AGAIN:
+            return "EML_TRY_AGAIN";
+        case EML_TEMP_RESOURCE:
+            return "EML_TEMP_RESOURCE";
+        case EML_TEMP_UNAVAILABLE:
+            return "EML_TEMP_UNAVAILABLE";
+        case EML_BAD_INPUT:
+            return "EML_BAD_INPUT";
+        case EML_NOT_FOUND:
+            return "EML_NOT_FOUND";
+        case EML_PERM:
+            return "EML_PERM";
+        case EML_CONFLICT:
+            return "EML_CONFLICT";
+        case EML_FATAL_CONF:
+            return "EML_FATAL_CONF";
+        case EML_FATAL_IO:
+            return "EML_FATAL_IO";
+        case EML_FATAL_CRYPTO:
+            return "EML_FATAL_CRYPTO";
+        case EML_FATAL_BUG:
+            return "EML_FATAL_BUG";
+        case EML__COUNT:
+            return "EML__COUNT";
+        default:
+            return "EML_UNKNOWN";
+    }
+}
+
+int eml_err_to_exit(eml_err_t e)
+{
+    switch(e)
+    {
+        case EML_OK:
+        case EML_TRY_AGAIN:
+        case EML_TEMP_UNAVAILABLE:
+        case EML_BAD_INPUT:
+        case EML_NOT_FOUND:
+        case EML_PERM:
+        case EML_CONFLICT:
+            return EML_EXIT_OK;
+        case EML_FATAL_CRYPTO:
+        case EML_FATAL_CONF:
+            return EML_EXIT_CONF;
+        case EML_FATAL_IO:
+            return EML_EXIT_IO;
+        case EML_TEMP_RESOURCE:
+            return EML_EXIT_MEM;
+        case EML_FATAL_BUG:
+        case EML__COUNT:
+            return EML_EXIT_BUG;
+        default:
+            return EML_EXIT_OK;
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Private static implementations
+ *
+ * The functions below implement the helpers declared above. They are kept
+ * static to avoid leaking symbols into the public library ABI.
+ * -------------------------------------------------------------------------- */
+
+static const char* lvl_str(eml_level_t l)
+{
+    switch(l)
+    {
+        case EML_LEVEL_DBG:
+            return "DBG";
+        case EML_LEVEL_INFO:
+            return "INF";
+        case EML_LEVEL_WARN:
+            return "WRN";
+        case EML_LEVEL_ERROR:
+            return "ERR";
+        case EML_LEVEL_CRIT:
+            return "CRT";
+        default:
+            return "UNK";
+    }
+}
+
+static int default_fd(eml_level_t l)
+{
+    if((unsigned)l > EML_LEVEL_CRIT) l = EML_LEVEL_CRIT;
+    return atomic_load_explicit(&G.fd[l], memory_order_relaxed);
+}
+
+uint64_t eml_tid(void)
+{
+#if defined(__linux__)
+#    if defined(SYS_gettid)
+    return (uint64_t)syscall(SYS_gettid);
+#    else
+    return (uint64_t)getpid(); /* fallback */
+#    endif
+#else
+    return (uint64_t)(uintptr_t)pthread_self();
+#endif
+}
+
+static void copy_cached_ts(char* out, size_t n, unsigned ms)
+{
+    char buf[64];
+    int  w = snprintf(buf, sizeof buf, "%s.%03u%s", ts_cache_prefix_tls, ms, ts_cache_tz_tls);
+    if(!n) return;
+    if(w < 0)
+    {
+        out[0] = '\0';
+        return;
+    }
+    size_t copy = (size_t)w;
+    if(copy >= n) copy = n - 1;
+    memcpy(out, buf, copy);
+    out[copy] = '\0';
+}
+
+static void fmt_time_iso8601(char* out, size_t n, unsigned* msec_out)
+{
+    /*
+     * New cached strategy:
+     * - Fetch CLOCK_REALTIME once.
+     * - If seconds differ from cache, compute a new prefix and cached tz.
+     * - Always compute milliseconds from ts.tv_nsec.
+     * - Compose final string as: <prefix>.<mmm><tz>
+     *
+     * We keep the prefix and tz in small static buffers and protect
+     * updates with a mutex. Readers only take the mutex when the
+     * second rolls over which is rare for high-frequency logging within
+     * the same second.
+     */
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    /* compute ms from ns (0..999) */
+    unsigned ms = (unsigned)((ts.tv_nsec / 1000000u) % 1000u);
+
+    time_t sec = ts.tv_sec;
+
+    /* Fast path: if seconds match the thread-local cache, avoid any
+     * locking or further calls. We append ms and tz to the cached
+     * prefix residing in thread-local storage.
+     */
+    if(sec == (__time_t)ts_cache_sec_tls)
+    {
+        copy_cached_ts(out, n, ms);
+        if(msec_out) *msec_out = ms;
+        return;
+    }
+
+    /* Slow path: second changed for this thread -> rebuild this thread's
+     * cache using thread-local storage. No global mutex needed since
+     * each thread updates its own cache.
+     */
+    if(sec != (__time_t)ts_cache_sec_tls)
+    {
+        struct tm tm;
+        /* localtime_r is thread-safe and will populate tm for the
+         * current timezone. This is where libc may need tz data but it
+         * should already be initialized by emlog_init() calling tzset().
+         */
+        localtime_r(&sec, &tm);
+
+        /* Fill prefix: YYYY-MM-DDTHH:MM:SS
+         * Use strftime which is safer for locale-aware date/time
+         * formatting and avoids compiler warnings about format
+         * truncation on snprintf. strftime writes a NUL-terminated
+         * string on success; fall back to empty prefix on failure.
+         */
+        if(!strftime(ts_cache_prefix_tls, sizeof ts_cache_prefix_tls, "%Y-%m-%dT%H:%M:%S", &tm))
+        {
+            ts_cache_prefix_tls[0] = '\0';
+        }
+
+        /* Build timezone offset as +HH:MM or -HH:MM. Using strftime(%z)
+         * yields "+HHMM" (no colon) on many platforms, so we read that
+         * and insert a colon. If strftime fails, fall back to "+00:00".
+         */
+        char z[8] = "";
+        if(strftime(z, sizeof z, "%z", &tm) && strlen(z) >= 5)
+        {
+            /* z is e.g. +0200 or -0530; convert to +02:00 */
+            ts_cache_tz_tls[0] = z[0];
+            ts_cache_tz_tls[1] = z[1];
+            ts_cache_tz_tls[2] = z[2];
+            ts_cache_tz_tls[3] = ':';
+            ts_cache_tz_tls[4] = z[3];
+            ts_cache_tz_tls[5] = z[4];
+            ts_cache_tz_tls[6] = '\0';
+        }
+        else
+        {
+            memcpy(ts_cache_tz_tls, "+00:00", sizeof "+00:00");
+        }
+
+        ts_cache_sec_tls = sec; /* publish updated cache for this thread */
+    }
+    /* Compose final string using thread-local cache. */
+    copy_cached_ts(out, n, ms);
+    if(msec_out) *msec_out = ms;
+}
+
+static eml_level_t parse_level(const char* s)
+{
+    if(!s) return EML_LEVEL_INFO;
+    if(!strcasecmp(s, "debug")) return EML_LEVEL_DBG;
+    if(!strcasecmp(s, "info")) return EML_LEVEL_INFO;
+    if(!strcasecmp(s, "warn") || !strcasecmp(s, "warning")) return EML_LEVEL_WARN;
+    if(!strcasecmp(s, "error")) return EML_LEVEL_ERROR;
+    if(!strcasecmp(s, "crit") || !strcasecmp(s, "fatal")) return EML_LEVEL_CRIT;
+    return EML_LEVEL_INFO;
+}
+
+static int parse_level_strict(const char* s, int* out)
+{
+    static const struct
+    {
+        const char* name;
+        int         level;
+    } names[] = {
+        {"dbg", EML_LEVEL_DBG},      {"debug", EML_LEVEL_DBG},    {"inf", EML_LEVEL_INFO},
+        {"info", EML_LEVEL_INFO},    {"wrn", EML_LEVEL_WARN},     {"warn", EML_LEVEL_WARN},
+        {"warning", EML_LEVEL_WARN}, {"err", EML_LEVEL_ERROR},    {"error", EML_LEVEL_ERROR},
+        {"crt", EML_LEVEL_CRIT},     {"crit", EML_LEVEL_CRIT},    {"fatal", EML_LEVEL_CRIT},
+    };
+    if(s[0] >= '0' && s[0] <= '4' && s[1] == '\0')
+    {
+        *out = s[0] - '0';
+        return 0;
+    }
+    for(size_t i = 0; i < sizeof names / sizeof names[0]; ++i)
+    {
+        if(!strcasecmp(s, names[i].name))
+        {
+            *out = names[i].level;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int parse_bool(const char* s, int* out)
+{
+    if(!strcasecmp(s, "on") || !strcasecmp(s, "true") || !strcasecmp(s, "yes") || !strcmp(s, "1"))
+        *out = 1;
+    else if(!strcasecmp(s, "off") || !strcasecmp(s, "false") || !strcasecmp(s, "no") ||
+            !strcmp(s, "0"))
+        *out = 0;
+    else
+        return -1;
+    return 0;
+}
+
+static char* trim(char* s)
+{
+    while(*s == ' ' || *s == '\t')
+        ++s;
+    char* e = s + strlen(s);
+    while(e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\n' || e[-1] == '\r'))
+        --e;
+    *e = '\0';
+    return s;
+}
+
+static eml_err_t cfg_parse(const char* path, struct cfg_file* cfg)
+{
+    FILE* f = fopen(path, "re");
+    if(!f) return EML_NOT_FOUND;
+
+    cfg->level = cfg->use_ts = cfg->writev_flush = -1;
+    cfg->ncomp                                   = 0;
+
+    char      line[256];
+    unsigned  lineno = 0;
+    eml_err_t rc     = EML_OK;
+    while(rc == EML_OK && fgets(line, sizeof line, f))
+    {
+        ++lineno;
+        char* hash = strchr(line, '#');
+        if(hash) *hash = '\0';
+        char* key = trim(line);
+        if(!*key) continue;
+        char* eq = strchr(key, '=');
+        if(!eq)
+        {
+            rc = EML_BAD_INPUT;
+            break;
+        }
+        *eq       = '\0';
+        key       = trim(key);
+        char* val = trim(eq + 1);
+
+        if(!strcmp(key, "level"))
+            rc = parse_level_strict(val, &cfg->level) ? EML_BAD_INPUT : EML_OK;
+        else if(!strcmp(key, "timestamps"))
+            rc = parse_bool(val, &cfg->use_ts) ? EML_BAD_INPUT : EML_OK;
+        else if(!strcmp(key, "writev_flush"))
+            rc = parse_bool(val, &cfg->writev_flush) ? EML_BAD_INPUT : EML_OK;
+        else if(!strncmp(key, "component.", 10))
+        {
+            const char* name = key + 10;
+            size_t      len  = strlen(name);
+            int         lvl  = -1;
+            if(len == 0 || len >= EMLOG_COMPONENT_NAME_MAX || cfg->ncomp >= EMLOG_MAX_COMPONENTS ||
+               (strcasecmp(val, "inherit") && parse_level_strict(val, &lvl)))
+            {
+                rc = EML_BAD_INPUT;
+                break;
+            }
+            memcpy(cfg->comp[cfg->ncomp].name, name, len + 1);
+            cfg->comp[cfg->ncomp].level = lvl;
+            ++cfg->ncomp;
+        }
+        else
+            rc = EML_BAD_INPUT;
+    }
+    fclose(f);
+    if(rc != EML_OK) EML_WARN(LOG_TAG, "%s:%u: invalid configuration line", path, lineno);
+    return rc;
+}
+
+static void cfg_apply_locked(const struct cfg_file* cfg, struct cfg_owner* owner)
+{
+    /* drop overrides a previous load installed that this one no longer has */
+    for(unsigned i = 0; i < owner->n; ++i)
+    {
+        int keep = 0;
+        for(unsigned j = 0; j < cfg->ncomp && !keep; ++j)
+            keep = cfg->comp[j].level >= 0 && !strcmp(owner->names[i], cfg->comp[j].name);
+        if(!keep) emlog_set_component_level(owner->names[i], -1);
+    }
+
+    owner->n = 0;
+    for(unsigned j = 0; j < cfg->ncomp; ++j)
+    {
+        eml_err_t rc = emlog_set_component_level(cfg->comp[j].name, cfg->comp[j].level);
+        if(rc != EML_OK)
+            EML_WARN(LOG_TAG, "component %s: override not installed", cfg->comp[j].name);
+        else if(cfg->comp[j].level >= 0)
+            memcpy(owner->names[owner->n++], cfg->comp[j].name, sizeof owner->names[0]);
+    }
+
+    if(cfg->level >= 0) emlog_set_level((eml_level_t)cfg->level);
+    if(cfg->use_ts >= 0) emlog_enable_timestamps(cfg->use_ts != 0);
+    if(cfg->writev_flush >= 0) emlog_set_writev_flush(cfg->writev_flush != 0);
+}
+
+#if defined(__linux__)
+static void* cfg_watch_main(void* arg)
+{
+    (void)arg;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfd[2] = {{W.ino_fd, POLLIN, 0}, {W.stop_fd[0], POLLIN, 0}};
+    for(;;)
+    {
+        if(poll(pfd, 2, -1) < 0)
+        {
+            if(errno == EINTR) continue;
+            break;
+        }
+        if(pfd[1].revents) break;
+
+        /* drain the queue; one reload covers every event read */
+        int     hit = 0;
+        ssize_t n;
+        while((n = read(W.ino_fd, buf, sizeof buf)) > 0)
+        {
+            for(char* p = buf; p < buf + n;)
+            {
+                const struct inotify_event* ev = (const struct inotify_event*)(void*)p;
+                if(ev->len && !strcmp(ev->name, W.base)) hit = 1;
+                p += sizeof *ev + ev->len;
+            }
+        }
+        if(hit) (void)emlog_config_load(W.path);
+    }
+    return NULL;
+}
+#endif
+
+#if defined(__linux__)
+static eml_shm_page_t* shm_map(const char* name, int create, unsigned mode, int* fd_out,
+                               eml_err_t* err_out)
+{
+    size_t len = name ? strlen(name) : 0;
+    if(len == 0 || len >= EMLOG_SHM_NAME_MAX || name[0] == '.' ||
+       strspn(name, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_.-") != len)
+    {
+        *err_out = EML_BAD_INPUT;
+        return NULL;
+    }
+    char path[32 + EMLOG_SHM_NAME_MAX];
+    snprintf(path, sizeof path, "/dev/shm/emlog.%s", name);
+
+    int fd = open(path, O_RDWR | O_CLOEXEC | O_NOFOLLOW | (create ? O_CREAT : 0), (mode_t)mode);
+    if(fd < 0)
+    {
+        *err_out = (errno == EACCES || errno == EPERM) ? EML_PERM
+                   : errno == ENOENT                   ? EML_NOT_FOUND
+                                                       : EML_TEMP_UNAVAILABLE;
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0 ||
+       ((size_t)st.st_size < sizeof(eml_shm_page_t) && ftruncate(fd, sizeof(eml_shm_page_t)) < 0))
+    {
+        close(fd);
+        *err_out = EML_TEMP_UNAVAILABLE;
+        return NULL;
+    }
+    eml_shm_page_t* pg = mmap(NULL, sizeof *pg, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(pg == MAP_FAILED)
+    {
+        close(fd);
+        *err_out = EML_TEMP_UNAVAILABLE;
+        return NULL;
+    }
+    /* a fresh page is all zeroes, which already means "nothing set" */
+    if(__atomic_load_n(&pg->magic, __ATOMIC_ACQUIRE) != EMLOG_SHM_MAGIC)
+    {
+        flock(fd, LOCK_EX);
+        if(pg->magic != EMLOG_SHM_MAGIC)
+        {
+            pg->version = EMLOG_SHM_VERSION;
+            __atomic_store_n(&pg->magic, EMLOG_SHM_MAGIC, __ATOMIC_RELEASE);
+        }
+        flock(fd, LOCK_UN);
+    }
+    *fd_out = fd;
+    return pg;
 }
 
-void emlog_log_errno(eml_level_t level, const char* comp, int err, const char* fmt, ...)
+static int shm_snapshot(eml_shm_page_t* pg, eml_shm_page_t* out, uint32_t* seq_out)
 {
-    char    base[768];
-    va_list ap;
-    va_start(ap, fmt);
-    vsnprintf(base, sizeof base, fmt, ap);
-    va_end(ap);
+    for(unsigned waits = 0; waits < 20u;)
+    {
+        uint32_t s1 = __atomic_load_n(&pg->seq, __ATOMIC_ACQUIRE);
+        if(s1 & 1u)
+        {
+            /* writer in progress: sleep until it publishes */
+            if(atomic_load_explicit(&S.stop, memory_order_acquire) && S.page == pg) return -1;
+            struct timespec to = {0, 50 * 1000000L};
+            syscall(SYS_futex, &pg->seq, FUTEX_WAIT, s1, &to, NULL, 0);
+            ++waits;
+            continue;
+        }
+        memcpy(out, pg, sizeof *out);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&pg->seq, __ATOMIC_RELAXED) == s1)
+        {
+            if(out->ncomp > EMLOG_MAX_COMPONENTS) out->ncomp = EMLOG_MAX_COMPONENTS;
+            *seq_out = s1;
+            return 0;
+        }
+    }
+    return -1;
+}
 
-    char eb[128];
-#if defined(__GLIBC__) && !defined(__APPLE__)
-    char* s = strerror_r(err, eb, sizeof eb); /* GNU variant */
-    emlog_log(level, comp, "%s: %s (%d)", base, s, err);
-#else
-    strerror_r(err, eb, sizeof eb); /* POSIX variant */
-    emlog_log(level, comp, "%s: %s (%d)", base, eb, err);
-#endif
+static eml_shm_page_t* shm_write_begin(const char* name, int* fd_out, eml_err_t* err_out)
+{
+    eml_shm_page_t* pg = shm_map(name, 1, EMLOG_SHM_MODE, fd_out, err_out);
+    if(!pg) return NULL;
+    flock(*fd_out, LOCK_EX); /* one writer at a time, across processes */
+    /* "| 1" also repairs a sequence left odd by a writer that died */
+    __atomic_store_n(&pg->seq, (pg->seq + 1u) | 1u, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return pg;
 }
 
-eml_err_t eml_from_errno(int e)
+static void shm_write_end(eml_shm_page_t* pg, int fd)
 {
-    switch(e)
+    __atomic_store_n(&pg->seq, pg->seq + 1u, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &pg->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    flock(fd, LOCK_UN);
+    munmap(pg, sizeof *pg);
+    close(fd);
+}
+
+static void* shm_watch_main(void* arg)
+{
+    eml_shm_page_t*  pg   = (eml_shm_page_t*)arg;
+    eml_shm_page_t*  snap = malloc(sizeof *snap);
+    struct cfg_file* cfg  = malloc(sizeof *cfg);
+    uint32_t         seen = 1u; /* odd: never a published value, forces the first apply */
+    while(snap && cfg && !atomic_load_explicit(&S.stop, memory_order_acquire))
     {
-        case 0:
-            return EML_OK;
-        case EINTR:
-        case EAGAIN:
-#if defined(EWOULDBLOCK) && (EWOULDBLOCK != EAGAIN)
-        case EWOULDBLOCK:
-#endif
-            return EML_TRY_AGAIN;
-        case EMFILE:
-        case ENFILE:
-        case ENOMEM:
-            return EML_TEMP_RESOURCE;
-        case EBUSY:
-#if defined(ENETDOWN) && (ENETDOWN != EBUSY)
-        case ENETDOWN:
-#endif
-#if defined(ENETUNREACH) && \
-    (!defined(ENETDOWN) || (ENETUNREACH != ENETDOWN && ENETUNREACH != EBUSY))
-        case ENETUNREACH:
+        uint32_t cur = __atomic_load_n(&pg->seq, __ATOMIC_ACQUIRE);
+        if(cur == seen)
+        {
+            syscall(SYS_futex, &pg->seq, FUTEX_WAIT, cur, NULL, NULL, 0);
+            continue;
+        }
+        if(shm_snapshot(pg, snap, &seen) != 0) continue;
+
+        cfg->level        = (snap->flags & EMLOG_SHM_LEVEL) ? snap->level : -1;
+        cfg->use_ts       = (snap->flags & EMLOG_SHM_TS) ? snap->timestamps : -1;
+        cfg->writev_flush = -1;
+        cfg->ncomp        = 0;
+        for(uint32_t i = 0; i < snap->ncomp; ++i)
+        {
+            snap->comp[i].name[EMLOG_COMPONENT_NAME_MAX - 1] = '\0';
+            if(!snap->comp[i].name[0] || snap->comp[i].level < 0 ||
+               snap->comp[i].level > EML_LEVEL_CRIT)
+                continue;
+            memcpy(cfg->comp[cfg->ncomp].name, snap->comp[i].name, EMLOG_COMPONENT_NAME_MAX);
+            cfg->comp[cfg->ncomp].level = snap->comp[i].level;
+            ++cfg->ncomp;
+        }
+        if(cfg->level > EML_LEVEL_CRIT) cfg->level = -1;
+
+        pthread_mutex_lock(&cfg_mu);
+        cfg_apply_locked(cfg, &cfg_shm_owned);
+        pthread_mutex_unlock(&cfg_mu);
+    }
+    free(snap);
+    free(cfg);
+    return NULL;
+}
 #endif
-            return EML_TEMP_UNAVAILABLE;
-        case ENOENT:
-        case ESRCH:
-            return EML_NOT_FOUND;
-        case EINVAL:
-#if defined(EPROTO) && (EPROTO != EINVAL)
-        case EPROTO:
+
+static void sink_rotate(struct eml_file_sink* s)
+{
+    char from[PATH_MAX + 16];
+    char to[PATH_MAX + 16];
+
+    /* shift path.(keep-1) -> path.keep ... path.1 -> path.2 */
+    if(s->keep)
+    {
+        snprintf(to, sizeof to, "%s.%u", s->path, s->keep);
+        unlink(to);
+        for(unsigned i = s->keep; i > 1; --i)
+        {
+            snprintf(from, sizeof from, "%s.%u", s->path, i - 1);
+            snprintf(to, sizeof to, "%s.%u", s->path, i);
+            rename(from, to);
+        }
+    }
+    snprintf(to, sizeof to, "%s.1", s->path);
+    if(rename(s->path, to) < 0 && errno != ENOENT) return; /* keep writing to the old file */
+
+    int nfd = open(s->path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, (mode_t)s->mode);
+    if(nfd < 0) return; /* the old descriptor stays valid; retry on the next trigger */
+
+    /* the only step logging threads can observe */
+    int ofd = atomic_exchange(&s->fd, nfd);
+    atomic_store(&s->bytes, 0u);
+    atomic_store(&s->pending, 0); /* size triggers raised by the old file are served */
+    while(atomic_load(&s->inflight))
+        sched_yield();
+    /* a durability policy only syncs the current file: finish the old one */
+    if(atomic_load(&s->durable)) (void)fsync(ofd);
+    close(ofd);
+    if(!s->keep) unlink(to);
+}
+
+static void* sink_rotate_main(void* arg)
+{
+    struct eml_file_sink* s    = (struct eml_file_sink*)arg;
+    struct timespec       now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    time_t next = s->interval ? now.tv_sec + (time_t)s->interval : 0;
+
+    while(!atomic_load(&s->stop))
+    {
+        int timeout = -1;
+        if(next)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            timeout = now.tv_sec >= next ? 0 : (int)(next - now.tv_sec) * 1000;
+        }
+        struct pollfd pfd = {s->wake[0], POLLIN, 0};
+        if(poll(&pfd, 1, timeout) > 0)
+        {
+            char buf[64];
+            while(read(s->wake[0], buf, sizeof buf) > 0)
+            {
+            }
+        }
+        if(atomic_load(&s->stop)) break;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int due = next && now.tv_sec >= next;
+        if(due) next = now.tv_sec + (time_t)s->interval;
+        /* skip empty files on the timer; explicit/size requests always rotate */
+        if(atomic_exchange(&s->pending, 0) || (due && atomic_load(&s->bytes))) sink_rotate(s);
+    }
+    return NULL;
+}
+
+static char* mm_map_locked(struct eml_mmap_sink* s, size_t idx)
+{
+    char* base = atomic_load(&s->seg[idx].base);
+    if(base) return base;
+    off_t off = (off_t)((uint64_t)idx * s->seg_bytes);
+#if defined(__linux__)
+    if(fallocate(s->fd, 0, off, (off_t)s->seg_bytes) < 0 &&
+       posix_fallocate(s->fd, off, (off_t)s->seg_bytes) != 0)
+        return NULL;
+#else
+    if(posix_fallocate(s->fd, off, (off_t)s->seg_bytes) != 0) return NULL;
 #endif
-#if defined(EBADMSG) && (EBADMSG != EINVAL && (!defined(EPROTO) || EBADMSG != EPROTO))
-        case EBADMSG:
+    void* m = mmap(NULL, s->seg_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, off);
+    if(m == MAP_FAILED) return NULL;
+    atomic_store(&s->seg[idx].base, (char*)m);
+    return (char*)m;
+}
+
+static void mm_pad(char* p, size_t len)
+{
+    /* len is a non-zero multiple of 8, so the header always fits */
+    __atomic_store_n((uint32_t*)(void*)p,
+                     (uint32_t)(len - 4u) | EMLOG_MMAP_PAD | EMLOG_MMAP_COMMITTED,
+                     __ATOMIC_RELEASE);
+}
+
+static uint64_t mm_scan_end(int fd, uint64_t size)
+{
+    if(size == 0) return 0;
+    const char* m = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+    if(m == MAP_FAILED) return (size + 7u) & ~(uint64_t)7u; /* best effort: append after it */
+    uint64_t off = 0;
+    while(off + 4u <= size)
+    {
+        uint32_t h;
+        memcpy(&h, m + off, sizeof h);
+        if(h == 0) break;
+        off += (4u + (h & EMLOG_MMAP_LEN_MASK) + 7u) & ~(uint64_t)7u;
+    }
+    munmap((void*)(uintptr_t)m, (size_t)size);
+    return off < size ? off : (size + 7u) & ~(uint64_t)7u;
+}
+
+static void* mm_helper_main(void* arg)
+{
+    struct eml_mmap_sink* s    = (struct eml_mmap_sink*)arg;
+    size_t                segb = s->seg_bytes;
+    while(!atomic_load(&s->stop))
+    {
+        struct pollfd pfd = {s->wake[0], POLLIN, 0};
+        if(poll(&pfd, 1, (int)s->sync_ms) > 0)
+        {
+            char buf[64];
+            while(read(s->wake[0], buf, sizeof buf) > 0)
+            {
+            }
+        }
+        uint64_t tail = atomic_load(&s->tail);
+        size_t   cur  = (size_t)(tail / segb);
+        if(cur + 2 >= MM_MAX_SEGS) cur = MM_MAX_SEGS - 3;
+
+        pthread_mutex_lock(&s->map_mu);
+        /* extend: keep the current and the next segment mapped */
+        mm_map_locked(s, cur);
+        mm_map_locked(s, cur + 1);
+
+        /* retire segments writers have moved past */
+        while(s->retired + 1 < cur)
+        {
+            struct mm_seg* g    = &s->seg[s->retired];
+            char*          base = atomic_exchange(&g->base, NULL);
+            if(base && atomic_load(&g->writers))
+            {
+                atomic_store(&g->base, base); /* a straggler is still copying */
+                break;
+            }
+            if(base)
+            {
+#if !defined(__linux__)
+                msync(base, segb, MS_ASYNC);
 #endif
-            return EML_BAD_INPUT;
-        case EACCES:
-        case EPERM:
-            return EML_PERM;
-        case EEXIST:
-#if defined(EADDRINUSE) && (EADDRINUSE != EEXIST)
-        case EADDRINUSE:
+                munmap(base, segb);
+            }
+            ++s->retired;
+        }
+        pthread_mutex_unlock(&s->map_mu);
+
+        /* start writeback of what was appended since the last round */
+        if(tail > s->synced)
+        {
+#if defined(__linux__)
+            sync_file_range(s->fd, (off_t)s->synced, (off_t)(tail - s->synced),
+                            SYNC_FILE_RANGE_WRITE);
+#else
+            /* msync needs a mapping; retired segments were synced on unmap */
 #endif
-            return EML_CONFLICT;
-        case EIO:
-        case ENOSPC:
-            return EML_FATAL_IO;
-        default:
-            return EML_FATAL_BUG;
+            s->synced = tail;
+        }
     }
+    return NULL;
 }
 
-const char* eml_err_name(eml_err_t e)
+static inline uint64_t comp_hash(const char* comp, size_t* len_out)
 {
-    switch(e)
+    const unsigned char* p = (const unsigned char*)comp;
+    uint64_t             h = 0xcbf29ce484222325ull;
+    for(; *p; ++p)
     {
-        case EML_OK:
-            return "EML_OK";
-        case EML_TRY_AGAIN:
-            return "EML_TRY_AGAIN";
-        case EML_TEMP_RESOURCE:
-            return "EML_TEMP_RESOURCE";
-        case EML_TEMP_UNAVAILABLE:
-            return "EML_TEMP_UNAVAILABLE";
-        case EML_BAD_INPUT:
-            return "EML_BAD_INPUT";
-        case EML_NOT_FOUND:
-            return "EML_NOT_FOUND";
-        case EML_PERM:
-            return "EML_PERM";
-        case EML_CONFLICT:
-            return "EML_CONFLICT";
-        case EML_FATAL_CONF:
-            return "EML_FATAL_CONF";
-        case EML_FATAL_IO:
-            return "EML_FATAL_IO";
-        case EML_FATAL_CRYPTO:
-            return "EML_FATAL_CRYPTO";
-        case EML_FATAL_BUG:
-            return "EML_FATAL_BUG";
-        case EML__COUNT:
-            return "EML__COUNT";
-        default:
-            return "EML_UNKNOWN";
+        h ^= *p;
+        h *= 0x100000001b3ull;
     }
+    *len_out = (size_t)(p - (const unsigned char*)comp);
+    return h ? h : 1u;
 }
 
-int eml_err_to_exit(eml_err_t e)
+static inline struct comp_slot* comp_find(const char* comp, uint64_t h, size_t len)
 {
-    switch(e)
+    for(uint64_t i = 0; i <= COMP_MASK; ++i)
     {
-        case EML_OK:
-        case EML_TRY_AGAIN:
-        case EML_TEMP_UNAVAILABLE:
-        case EML_BAD_INPUT:
-        case EML_NOT_FOUND:
-        case EML_PERM:
-        case EML_CONFLICT:
-            return EML_EXIT_OK;
-        case EML_FATAL_CRYPTO:
-        case EML_FATAL_CONF:
-            return EML_EXIT_CONF;
-        case EML_FATAL_IO:
-            return EML_EXIT_IO;
-        case EML_TEMP_RESOURCE:
-            return EML_EXIT_MEM;
-        case EML_FATAL_BUG:
-        case EML__COUNT:
-            return EML_EXIT_BUG;
-        default:
-            return EML_EXIT_OK;
+        struct comp_slot* s  = &comp_tab[(h + i) & COMP_MASK];
+        uint64_t          sh = atomic_load_explicit(&s->hash, memory_order_acquire);
+        if(sh == 0) return NULL; /* probe chain ends at the first empty slot */
+        /* names are short; an inline compare beats a libc strcmp() call */
+        if(sh == h && s->len == len)
+        {
+            size_t k = 0;
+            while(k < len && s->name[k] == comp[k])
+                ++k;
+            if(k == len) return s;
+        }
+    }
+    return NULL;
+}
+
+static struct comp_slot* comp_claim_locked(const char* comp, uint64_t h, size_t len)
+{
+    struct comp_slot* slot = comp_find(comp, h, len);
+    if(slot) return slot;
+    for(uint64_t i = 0; i <= COMP_MASK; ++i)
+    {
+        struct comp_slot* s = &comp_tab[(h + i) & COMP_MASK];
+        if(atomic_load_explicit(&s->hash, memory_order_relaxed) == 0)
+        {
+            slot = s;
+            break;
+        }
+    }
+    if(!slot) return NULL;
+    memcpy(slot->name, comp, len + 1);
+    slot->len = (unsigned)len;
+    atomic_store_explicit(&slot->level, COMP_INHERIT, memory_order_relaxed);
+    atomic_store_explicit(&slot->sample, 0u, memory_order_relaxed);
+    atomic_store_explicit(&slot->hash, h, memory_order_release);
+    atomic_fetch_add_explicit(&comp_gen, 1u, memory_order_release);
+    return slot;
+}
+
+static inline struct comp_slot* comp_lookup(eml_callsite_t* cs, const char* comp)
+{
+    int      cached = cs && cs->comp == comp;
+    unsigned gen    = 0;
+    if(cached)
+    {
+        struct comp_slot* s = __atomic_load_n((struct comp_slot**)&cs->slot, __ATOMIC_ACQUIRE);
+        if(s) return s;
+        /* +1 keeps the zero-initialized gen from matching a fresh table */
+        gen = atomic_load_explicit(&comp_gen, memory_order_acquire) + 1u;
+        if(__atomic_load_n(&cs->gen, __ATOMIC_RELAXED) == gen) return NULL;
+    }
+    size_t            len;
+    uint64_t          h = comp_hash(comp, &len);
+    struct comp_slot* s = comp_find(comp, h, len);
+    if(cached)
+    {
+        if(s)
+            __atomic_store_n((struct comp_slot**)&cs->slot, s, __ATOMIC_RELEASE);
+        else
+            __atomic_store_n(&cs->gen, gen, __ATOMIC_RELAXED);
+    }
+    return s;
+}
+
+static int sample_draw(unsigned n)
+{
+    uint64_t x;
+    if(sample_key_set_tls)
+    {
+        /* splitmix64 finalizer: a pure function of the key */
+        x = sample_key_tls + 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        x ^= x >> 31;
+    }
+    else
+    {
+        x = sample_rng_tls;
+        if(!x) x = (eml_tid() << 32) ^ (uint64_t)(uintptr_t)&sample_rng_tls ^ 0x2545f4914f6cdd1dull;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        sample_rng_tls = x;
+        x *= 0x2545f4914f6cdd1dull; /* xorshift64* output */
+    }
+    /* threshold compare: keeping at 1-in-100 implies keeping at 1-in-10 */
+    return x < UINT64_MAX / n;
+}
+
+static int admit(eml_callsite_t* cs, eml_level_t level, const char* comp, int sample)
+{
+    if(cs && (__atomic_load_n(&cs->flags, __ATOMIC_RELAXED) & CS_FORCED)) return ADMIT_WRITE;
+
+    /* Fast exit: with no overrides or rates installed we never hash the name. */
+    struct comp_slot* s = NULL;
+    if(comp && (atomic_load_explicit(&comp_active, memory_order_acquire) ||
+                (sample && atomic_load_explicit(&comp_sampled, memory_order_acquire))))
+        s = comp_lookup(cs, comp);
+
+    int min = thread_level_tls >= 0 ? thread_level_tls
+                                    : atomic_load_explicit(&G.min_level, memory_order_acquire);
+    if(s)
+    {
+        int cl = atomic_load_explicit(&s->level, memory_order_acquire);
+        if(cl != COMP_INHERIT) min = cl;
+    }
+    if((int)level < min)
+    {
+        int bt = atomic_load_explicit(&bt_level, memory_order_acquire);
+        if(bt >= 0 && (int)level >= bt) return ADMIT_CAPTURE;
+        return ring_keeps(level) ? ADMIT_RING : ADMIT_DROP;
+    }
+    if(!sample) return ADMIT_WRITE;
+
+    unsigned n = s ? atomic_load_explicit(&s->sample, memory_order_relaxed) : 0u;
+    if(!n && (unsigned)level <= EML_LEVEL_CRIT)
+        n = atomic_load_explicit(&level_sample[level], memory_order_relaxed);
+    return (n <= 1 || sample_draw(n)) ? ADMIT_WRITE : ADMIT_DROP;
+}
+
+static void thread_level_make_key(void)
+{
+    pthread_key_create(&thread_level_key, thread_level_exit);
+}
+
+static void thread_level_exit(void* arg)
+{
+    int lvl = (int)(intptr_t)arg - 1;
+    if(lvl < 0 || lvl > EML_LEVEL_CRIT) return;
+    pthread_mutex_lock(&ctl_mu);
+    atomic_fetch_sub_explicit(&thread_levels[lvl], 1u, memory_order_release);
+    refresh_active_level_locked();
+    pthread_mutex_unlock(&ctl_mu);
+}
+
+static void bt_make_key(void)
+{
+    pthread_key_create(&bt_key, free);
+}
+
+static void bt_capture(eml_level_t level, const char* comp, const char* fmt, va_list ap)
+{
+    unsigned        cap = atomic_load_explicit(&bt_lines, memory_order_relaxed);
+    struct bt_ring* r   = bt_tls;
+    if(!cap) return;
+    if(!r || r->cap != cap)
+    {
+        /* first capture on this thread, or the capacity changed */
+        free(r);
+        bt_tls = r = calloc(1, sizeof *r + (size_t)cap * sizeof r->e[0]);
+        pthread_once(&bt_key_once, bt_make_key);
+        pthread_setspecific(bt_key, r);
+        if(!r) return;
+        r->cap = cap;
+    }
+
+    struct bt_entry* e = &r->e[r->head];
+    r->head            = (r->head + 1u) % r->cap;
+    if(r->count < r->cap) ++r->count;
+
+    char ts[40] = {0};
+    if(__atomic_load_n(&G.use_ts, __ATOMIC_RELAXED)) fmt_time_iso8601(ts, sizeof ts, NULL);
+    int hlen = format_header(e->line, sizeof e->line, ts, level, eml_tid(), comp);
+    size_t room = sizeof e->line - (size_t)hlen;
+    int    mlen = vsnprintf(e->line + hlen, room, fmt, ap);
+    if(mlen < 0) mlen = 0;
+    if((size_t)mlen >= room) mlen = (int)room - 1;
+    e->level = level;
+    e->len   = (unsigned)(hlen + mlen);
+    if(ring_keeps(level))
+    {
+        struct iovec v = {e->line, e->len};
+        ring_append(level, &v, 1);
+    }
+}
+
+static void bt_flush_locked(eml_level_t level, const char* comp)
+{
+    struct bt_ring* r = bt_tls;
+    if(!r || !r->count) return;
+
+    char ts[40] = {0};
+    if(G.use_ts) fmt_time_iso8601(ts, sizeof ts, NULL);
+    char head[128];
+    char body[64];
+    int  hlen = format_header(head, sizeof head, ts, level, eml_tid(), comp);
+    int  blen = snprintf(body, sizeof body, "--- backtrace: %u earlier lines ---", r->count);
+    struct iovec iov[2] = {{head, (size_t)hlen}, {body, (size_t)(blen < 0 ? 0 : blen)}};
+    write_line_iov(level, iov, 2);
+
+    /* the entries reached the flight recorder when they were captured */
+    unsigned first = (r->head + r->cap - r->count) % r->cap;
+    ring_mute_tls  = 1;
+    for(unsigned i = 0; i < r->count; ++i)
+    {
+        struct bt_entry* e    = &r->e[(first + i) % r->cap];
+        struct iovec     line = {e->line, e->len};
+        write_line_iov(e->level, &line, 1);
     }
+    ring_mute_tls = 0;
+    r->count = 0;
+    r->head  = 0;
+
+    blen           = snprintf(body, sizeof body, "--- end of backtrace ---");
+    iov[1].iov_len = (size_t)(blen < 0 ? 0 : blen);
+    write_line_iov(level, iov, 2);
 }
 
-/* --------------------------------------------------------------------------
- * Private static implementations
- *
- * The functions below implement the helpers declared above. They are kept
- * static to avoid leaking symbols into the public library ABI.
- * -------------------------------------------------------------------------- */
+static int ring_keeps(eml_level_t level)
+{
+    int rl = atomic_load_explicit(&ring_level, memory_order_acquire);
+    return rl >= 0 && (int)level >= rl;
+}
 
-static const char* lvl_str(eml_level_t l)
+static void ring_capture(eml_level_t level, const char* comp, const char* fmt, va_list ap)
 {
-    switch(l)
+    char line[EMLOG_RING_LINE_MAX];
+    char ts[40] = {0};
+    if(__atomic_load_n(&G.use_ts, __ATOMIC_RELAXED)) fmt_time_iso8601(ts, sizeof ts, NULL);
+    int    hlen = format_header(line, sizeof line, ts, level, eml_tid(), comp);
+    size_t room = sizeof line - (size_t)hlen;
+    int    mlen = vsnprintf(line + hlen, room, fmt, ap);
+    if(mlen < 0) mlen = 0;
+    if((size_t)mlen >= room) mlen = (int)room - 1;
+    struct iovec v = {line, (size_t)(hlen + mlen)};
+    ring_append(level, &v, 1);
+}
+
+static void ring_append(eml_level_t level, const struct iovec* iov, int iovcnt)
+{
+    atomic_fetch_add(&R.inflight, 1u);
+    eml_ring_hdr_t* h = atomic_load(&R.hdr);
+    if(!h)
     {
-        case EML_LEVEL_DBG:
-            return "DBG";
-        case EML_LEVEL_INFO:
-            return "INF";
-        case EML_LEVEL_WARN:
-            return "WRN";
-        case EML_LEVEL_ERROR:
-            return "ERR";
-        case EML_LEVEL_CRIT:
-            return "CRT";
-        default:
-            return "UNK";
+        atomic_fetch_sub(&R.inflight, 1u);
+        return;
+    }
+    size_t len = 0;
+    for(int i = 0; i < iovcnt; ++i)
+        len += iov[i].iov_len;
+    if(len > EMLOG_RING_LINE_MAX) len = EMLOG_RING_LINE_MAX;
+
+    unsigned char*  data = (unsigned char*)h + h->hdr_bytes;
+    uint64_t        mask = h->size - 1u;
+    uint64_t        need = (sizeof(eml_ring_rec_t) + len + 15u) & ~(uint64_t)15u;
+    uint64_t        pos  = __atomic_fetch_add(&h->head, need, __ATOMIC_SEQ_CST);
+    eml_ring_rec_t* r    = (eml_ring_rec_t*)(void*)(data + (pos & mask));
+    /* readers that see these bytes must also see the new head */
+    atomic_thread_fence(memory_order_release);
+
+    uint64_t at   = pos + sizeof *r;
+    size_t   left = len;
+    for(int i = 0; i < iovcnt && left; ++i)
+    {
+        size_t n = iov[i].iov_len < left ? iov[i].iov_len : left;
+        ring_copy_in(data, mask, at, iov[i].iov_base, n);
+        at += n;
+        left -= n;
     }
+    r->len   = (uint32_t)len;
+    r->level = (uint16_t)level;
+    r->magic = EMLOG_RING_REC_MAGIC;
+    __atomic_store_n(&r->pos, pos, __ATOMIC_RELEASE);
+    atomic_fetch_sub(&R.inflight, 1u);
 }
 
-static FILE* default_stream(eml_level_t l)
+static void ring_copy_in(unsigned char* data, uint64_t mask, uint64_t at, const void* src,
+                         size_t n)
 {
-    return (l <= EML_LEVEL_INFO) ? stdout : stderr;
+    size_t off   = (size_t)(at & mask);
+    size_t first = (size_t)(mask + 1u) - off;
+    if(first > n) first = n;
+    memcpy(data + off, src, first);
+    memcpy(data, (const unsigned char*)src + first, n - first);
 }
 
-uint64_t eml_tid(void)
+static void ring_copy_out(void* dst, const unsigned char* data, uint64_t mask, uint64_t at,
+                          size_t n)
 {
-#if defined(__linux__)
-#    if defined(SYS_gettid)
-    return (uint64_t)syscall(SYS_gettid);
-#    else
-    return (uint64_t)getpid(); /* fallback */
-#    endif
-#else
-    return (uint64_t)(uintptr_t)pthread_self();
-#endif
+    size_t off   = (size_t)(at & mask);
+    size_t first = (size_t)(mask + 1u) - off;
+    if(first > n) first = n;
+    memcpy(dst, data + off, first);
+    memcpy((unsigned char*)dst + first, data, n - first);
 }
 
-static void copy_cached_ts(char* out, size_t n, unsigned ms)
+static ssize_t ring_walk(const eml_ring_hdr_t* h, const unsigned char* data, int fd, int live)
 {
-    char buf[64];
-    int  w = snprintf(buf, sizeof buf, "%s.%03u%s", ts_cache_prefix_tls, ms, ts_cache_tz_tls);
-    if(!n) return;
-    if(w < 0)
+    uint64_t size  = h->size;
+    uint64_t mask  = size - 1u;
+    uint64_t head  = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+    uint64_t p     = head > size ? head - size : 0;
+    ssize_t  lines = 0;
+    char     line[EMLOG_RING_LINE_MAX + 1];
+
+    while(p + sizeof(eml_ring_rec_t) <= head)
     {
-        out[0] = '\0';
-        return;
+        const eml_ring_rec_t* r    = (const eml_ring_rec_t*)(const void*)(data + (p & mask));
+        uint64_t              pos  = __atomic_load_n(&r->pos, __ATOMIC_ACQUIRE);
+        uint32_t              len  = __atomic_load_n(&r->len, __ATOMIC_RELAXED);
+        uint16_t              mg   = __atomic_load_n(&r->magic, __ATOMIC_RELAXED);
+        uint64_t              need = (sizeof *r + (uint64_t)len + 15u) & ~(uint64_t)15u;
+        if(pos != p || mg != EMLOG_RING_REC_MAGIC || len > EMLOG_RING_LINE_MAX ||
+           p + need > head)
+        {
+            /* unfinished, torn or the tail of an overwritten record */
+            p += 16u;
+            continue;
+        }
+        ring_copy_out(line, data, mask, p + sizeof *r, len);
+        if(live)
+        {
+            /* the copy is only good if nobody has reserved over it since */
+            atomic_thread_fence(memory_order_acquire);
+            if(__atomic_load_n(&h->head, __ATOMIC_RELAXED) - p > size)
+            {
+                p += need;
+                continue;
+            }
+        }
+        line[len] = '\n';
+        for(size_t off = 0; off <= len;)
+        {
+            ssize_t n = write(fd, line + off, (size_t)len + 1u - off);
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) return -1;
+            off += (size_t)n;
+        }
+        ++lines;
+        p += need;
     }
-    size_t copy = (size_t)w;
-    if(copy >= n) copy = n - 1;
-    memcpy(out, buf, copy);
-    out[copy] = '\0';
+    return lines;
 }
 
-static void fmt_time_iso8601(char* out, size_t n, unsigned* msec_out)
+static void ring_close_locked(void)
 {
-    /*
-     * New cached strategy:
-     * - Fetch CLOCK_REALTIME once.
-     * - If seconds differ from cache, compute a new prefix and cached tz.
-     * - Always compute milliseconds from ts.tv_nsec.
-     * - Compose final string as: <prefix>.<mmm><tz>
-     *
-     * We keep the prefix and tz in small static buffers and protect
-     * updates with a mutex. Readers only take the mutex when the
-     * second rolls over which is rare for high-frequency logging within
-     * the same second.
-     */
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
+    pthread_mutex_lock(&ctl_mu);
+    atomic_store_explicit(&ring_level, -1, memory_order_release);
+    refresh_active_level_locked();
+    pthread_mutex_unlock(&ctl_mu);
 
-    /* compute ms from ns (0..999) */
-    unsigned ms = (unsigned)((ts.tv_nsec / 1000000u) % 1000u);
+    if(R.crash_fd)
+    {
+        for(int i = 0; i < RING_NSIGS; ++i)
+            sigaction(ring_sigs[i], &R.old[i], NULL);
+        R.crash_fd = 0;
+    }
+    eml_ring_hdr_t* h = atomic_exchange(&R.hdr, NULL);
+    if(!h) return;
+    /* writers that loaded the old pointer finish before it goes away */
+    while(atomic_load(&R.inflight))
+        sched_yield();
+    munmap(h, R.map_len);
+    if(R.fd >= 0) close(R.fd);
+    R.fd      = -1;
+    R.map_len = 0;
+}
 
-    time_t sec = ts.tv_sec;
+static void ring_crash_handler(int sig)
+{
+    int saved = errno;
+    if(R.crash_fd > 0) (void)emlog_ring_dump(R.crash_fd);
+    /* hand the signal to whoever had it before us */
+    for(int i = 0; i < RING_NSIGS; ++i)
+        if(ring_sigs[i] == sig) sigaction(sig, &R.old[i], NULL);
+    errno = saved;
+    raise(sig);
+}
 
-    /* Fast path: if seconds match the thread-local cache, avoid any
-     * locking or further calls. We append ms and tz to the cached
-     * prefix residing in thread-local storage.
-     */
-    if(sec == (__time_t)ts_cache_sec_tls)
+static void deliver(int verdict, eml_callsite_t* cs, eml_level_t level, const char* comp,
+                    const char* fmt, va_list ap)
+{
+    if(verdict == ADMIT_CAPTURE)
     {
-        copy_cached_ts(out, n, ms);
-        if(msec_out) *msec_out = ms;
+        bt_capture(level, comp, fmt, ap);
         return;
     }
-
-    /* Slow path: second changed for this thread -> rebuild this thread's
-     * cache using thread-local storage. No global mutex needed since
-     * each thread updates its own cache.
-     */
-    if(sec != (__time_t)ts_cache_sec_tls)
+    if(verdict == ADMIT_RING)
     {
-        struct tm tm;
-        /* localtime_r is thread-safe and will populate tm for the
-         * current timezone. This is where libc may need tz data but it
-         * should already be initialized by emlog_init() calling tzset().
-         */
-        localtime_r(&sec, &tm);
+        ring_capture(level, comp, fmt, ap);
+        return;
+    }
+    pthread_mutex_lock(&G.mu);
+    line_ctx_tls    = (struct line_ctx){cs, comp};
+    durable_arm_tls = 1;
+    ovf_arm_tls     = 1;
+    vlog(level, comp, fmt, ap);
+    ovf_arm_tls     = 0;
+    durable_arm_tls = 0;
+    line_ctx_tls    = (struct line_ctx){NULL, NULL};
+    pthread_mutex_unlock(&G.mu);
+    if(ovf_nwait_tls) ovf_block_wait();
+    if(sink_defer_tls) sink_run_deferred();
+    if(durable_ntls) sink_durable_wait();
+}
 
-        /* Fill prefix: YYYY-MM-DDTHH:MM:SS
-         * Use strftime which is safer for locale-aware date/time
-         * formatting and avoids compiler warnings about format
-         * truncation on snprintf. strftime writes a NUL-terminated
-         * string on success; fall back to empty prefix on failure.
-         */
-        if(!strftime(ts_cache_prefix_tls, sizeof ts_cache_prefix_tls, "%Y-%m-%dT%H:%M:%S", &tm))
+static void refresh_active_level_locked(void)
+{
+    int lvl = atomic_load_explicit(&G.min_level, memory_order_acquire);
+    if(atomic_load_explicit(&comp_active, memory_order_acquire))
+    {
+        for(size_t i = 0; i < EMLOG_MAX_COMPONENTS; ++i)
         {
-            ts_cache_prefix_tls[0] = '\0';
+            if(!atomic_load_explicit(&comp_tab[i].hash, memory_order_acquire)) continue;
+            int cl = atomic_load_explicit(&comp_tab[i].level, memory_order_acquire);
+            if(cl != COMP_INHERIT && cl < lvl) lvl = cl;
+        }
+    }
+    for(int t = 0; t < lvl; ++t)
+    {
+        /* a thread override below the global level */
+        if(atomic_load_explicit(&thread_levels[t], memory_order_acquire))
+        {
+            lvl = t;
+            break;
         }
+    }
+    int bt = atomic_load_explicit(&bt_level, memory_order_acquire);
+    if(bt >= 0 && bt < lvl) lvl = bt; /* captured lines must reach admit() */
+    int rl = atomic_load_explicit(&ring_level, memory_order_acquire);
+    if(rl >= 0 && rl < lvl) lvl = rl; /* and so must recorded ones */
+    __atomic_store_n(&emlog__active_level, lvl, __ATOMIC_RELEASE);
 
-        /* Build timezone offset as +HH:MM or -HH:MM. Using strftime(%z)
-         * yields "+HHMM" (no colon) on many platforms, so we read that
-         * and insert a colon. If strftime fails, fall back to "+00:00".
-         */
-        char z[8] = "";
-        if(strftime(z, sizeof z, "%z", &tm) && strlen(z) >= 5)
+    if(lvl == cs_synced_level) return;
+    cs_synced_level = lvl;
+    for(size_t m = 0; m < cs_nmods; ++m)
+        for(eml_callsite_t* cs = cs_mods[m].start; cs < cs_mods[m].stop; ++cs)
+            cs_sync_site(cs, lvl);
+}
+
+static void cs_set_forced(eml_callsite_t* cs, int on)
+{
+    unsigned char f = cs->flags;
+    f               = (unsigned char)(on ? (f | CS_FORCED) : (f & ~CS_FORCED));
+    __atomic_store_n(&cs->flags, f, __ATOMIC_RELAXED);
+}
+
+static void cs_sync_site(eml_callsite_t* cs, int active)
+{
+    unsigned char on = (unsigned char)((cs->flags & CS_FORCED) || (int)cs->level >= active);
+    __atomic_store_n(&cs->enabled, on, __ATOMIC_RELAXED);
+}
+
+static int cs_parse_spec(const char* spec, int on, struct cs_rule* r)
+{
+    if(!spec)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t      glen  = strlen(spec);
+    const char* colon = strrchr(spec, ':');
+    r->lo             = 0;
+    r->hi             = UINT_MAX;
+    r->on             = on;
+    if(colon)
+    {
+        const char* p = colon + 1;
+        char*       end;
+        if(*p < '0' || *p > '9') goto bad;
+        unsigned long lo = strtoul(p, &end, 10);
+        unsigned long hi = lo;
+        if(*end == '-')
         {
-            /* z is e.g. +0200 or -0530; convert to +02:00 */
-            ts_cache_tz_tls[0] = z[0];
-            ts_cache_tz_tls[1] = z[1];
-            ts_cache_tz_tls[2] = z[2];
-            ts_cache_tz_tls[3] = ':';
-            ts_cache_tz_tls[4] = z[3];
-            ts_cache_tz_tls[5] = z[4];
-            ts_cache_tz_tls[6] = '\0';
+            p = end + 1;
+            if(*p < '0' || *p > '9') goto bad;
+            hi = strtoul(p, &end, 10);
         }
-        else
+        if(*end || hi < lo || hi > UINT_MAX) goto bad;
+        r->lo = (unsigned)lo;
+        r->hi = (unsigned)hi;
+        glen  = (size_t)(colon - spec);
+    }
+    r->glob = glen ? strndup(spec, glen) : strdup("*");
+    if(!r->glob)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+bad:
+    errno = EINVAL;
+    return -1;
+}
+
+static int cs_match(const eml_callsite_t* cs, const struct cs_rule* r)
+{
+    if(cs->line < r->lo || cs->line > r->hi) return 0;
+    const char* file = cs->file ? cs->file : "";
+    if(!fnmatch(r->glob, file, 0)) return 1;
+    /* let relative patterns match absolute __FILE__ values */
+    for(const char* p = strchr(file, '/'); p; p = strchr(p + 1, '/'))
+        if(!fnmatch(r->glob, p + 1, 0)) return 1;
+    return 0;
+}
+
+static int cs_apply_spec(const char* spec, int on)
+{
+    struct cs_rule rule;
+    if(cs_parse_spec(spec, on, &rule) < 0) return -1;
+
+    pthread_mutex_lock(&ctl_mu);
+    /* a repeated selector replaces its older rule instead of piling up */
+    for(size_t i = 0; i < cs_nrules; ++i)
+    {
+        struct cs_rule* old = &cs_rules[i];
+        if(old->lo == rule.lo && old->hi == rule.hi && !strcmp(old->glob, rule.glob))
         {
-            memcpy(ts_cache_tz_tls, "+00:00", sizeof "+00:00");
+            free(old->glob);
+            memmove(old, old + 1, (cs_nrules - i - 1) * sizeof *old);
+            --cs_nrules;
+            break;
         }
+    }
+    struct cs_rule* rules = realloc(cs_rules, (cs_nrules + 1) * sizeof *rules);
+    if(!rules)
+    {
+        pthread_mutex_unlock(&ctl_mu);
+        free(rule.glob);
+        errno = ENOMEM;
+        return -1;
+    }
+    cs_rules              = rules;
+    cs_rules[cs_nrules++] = rule;
 
-        ts_cache_sec_tls = sec; /* publish updated cache for this thread */
+    int active  = __atomic_load_n(&emlog__active_level, __ATOMIC_RELAXED);
+    int matched = 0;
+    for(size_t m = 0; m < cs_nmods; ++m)
+    {
+        for(eml_callsite_t* cs = cs_mods[m].start; cs < cs_mods[m].stop; ++cs)
+        {
+            if(!cs_match(cs, &rule)) continue;
+            cs_set_forced(cs, on);
+            cs_sync_site(cs, active);
+            ++matched;
+        }
     }
-    /* Compose final string using thread-local cache. */
-    copy_cached_ts(out, n, ms);
-    if(msec_out) *msec_out = ms;
+    pthread_mutex_unlock(&ctl_mu);
+    return matched;
 }
 
-static eml_level_t parse_level(const char* s)
+static void emit_va(eml_callsite_t* cs, eml_level_t level, const char* comp, const char* fmt,
+                    va_list ap)
 {
-    if(!s) return EML_LEVEL_INFO;
-    if(!strcasecmp(s, "debug")) return EML_LEVEL_DBG;
-    if(!strcasecmp(s, "info")) return EML_LEVEL_INFO;
-    if(!strcasecmp(s, "warn") || !strcasecmp(s, "warning")) return EML_LEVEL_WARN;
-    if(!strcasecmp(s, "error")) return EML_LEVEL_ERROR;
-    if(!strcasecmp(s, "crit") || !strcasecmp(s, "fatal")) return EML_LEVEL_CRIT;
-    return EML_LEVEL_INFO;
+    /* The precise filter runs lock-free; only lines that will actually be
+     * written pay for G.mu, timestamps and formatting. */
+    int verdict = admit(cs, level, comp, 1);
+    if(verdict == ADMIT_DROP) return;
+    deliver(verdict, cs, level, comp, fmt, ap);
+}
+
+static void log_errno_va(eml_callsite_t* cs, eml_level_t level, const char* comp, int err,
+                         const char* fmt, va_list ap)
+{
+    /* filter first: do not pay for two vsnprintf passes on a dropped line */
+    if(admit(cs, level, comp, 1) == ADMIT_DROP) return;
+
+    char base[768];
+    vsnprintf(base, sizeof base, fmt, ap);
+
+    char eb[128];
+#if defined(__GLIBC__) && !defined(__APPLE__)
+    const char* s = strerror_r(err, eb, sizeof eb); /* GNU variant */
+#else
+    strerror_r(err, eb, sizeof eb); /* POSIX variant */
+    const char* s = eb;
+#endif
+    emit(cs, level, comp, "%s: %s (%d)", base, s, err);
+}
+
+static void emit(eml_callsite_t* cs, eml_level_t level, const char* comp, const char* fmt, ...)
+{
+    /* already-admitted or summary lines: re-check the level, never sample */
+    int verdict = admit(cs, level, comp, 0);
+    if(verdict == ADMIT_DROP) return;
+    va_list ap;
+    va_start(ap, fmt);
+    deliver(verdict, cs, level, comp, fmt, ap);
+    va_end(ap);
+}
+
+static int format_header(char* head, size_t n, const char* ts, eml_level_t level, uint64_t tid,
+                         const char* comp)
+{
+    int hlen = ts[0] ? snprintf(head, n, "%s %s [%llu] [%s] ", ts, lvl_str(level),
+                                (unsigned long long)tid, comp ? comp : "-")
+                     : snprintf(head, n, "%s [%llu] [%s] ", lvl_str(level),
+                                (unsigned long long)tid, comp ? comp : "-");
+    if(hlen < 0) return 0;
+    return (size_t)hlen >= n ? (int)n - 1 : hlen;
 }
 
 /*
@@ -526,13 +6297,26 @@ static eml_level_t parse_level(const char* s)
  *
  * A variant of write_line that accepts an iovec array. On POSIX
  * platforms (Linux) we use writev() to write header+message+"\n" in a
- * single syscall, avoiding a temporary allocation. If a custom writer
- * is installed we fall back to calling the writer with a contiguous
- * buffer (constructed on the stack when small, or via malloc when
- * necessary).
+ * single syscall, avoiding a temporary allocation; short writes are
+ * continued and EAGAIN parks the rest (see write_fd_locked()). If a
+ * custom writer is installed we fall back to calling the writer with a
+ * contiguous buffer (constructed on the stack when small, or via malloc
+ * when necessary).
  */
 static void write_line_iov(eml_level_t level, struct iovec* iov, int iovcnt)
 {
+    if(!ring_mute_tls && ring_keeps(level)) ring_append(level, iov, iovcnt);
+    if(sink_count)
+    {
+        sink_fanout_locked(level, iov, iovcnt);
+        return;
+    }
+    if(G.writer_iov)
+    {
+        /* scatter-gather writer: hand over the pieces as they are */
+        (void)G.writer_iov(level, iov, iovcnt, G.writer_ud);
+        return;
+    }
     if(G.writer)
     {
         /* custom writer: needs a contiguous buffer; assemble quickly */
@@ -569,17 +6353,30 @@ static void write_line_iov(eml_level_t level, struct iovec* iov, int iovcnt)
     }
 
 #if defined(__linux__) || defined(__unix__) || defined(__APPLE__)
-    /* Default writer: use writev on the underlying FILE* descriptor. We
-     * use fileno() to obtain the FD and writev to emit all iovecs and a
-     * trailing newline atomically at the syscall level. This reduces
-     * allocations and syscalls for the common case.
+    /* Default writer: writev header, message and a trailing newline to
+     * the level's descriptor in one syscall. No FILE* is involved, so
+     * nothing sits in a stdio buffer and no allocation is needed.
      */
-    FILE* out = default_stream(level);
-    int   fd  = fileno(out);
-    /* If configured, flush stdio buffers to avoid interleaving with other
-     * code that may be using stdio on the same stream (safer but slower).
+    int fd = default_fd(level);
+#    if defined(__linux__)
+    if(fd == P.fd && pipe_ready_locked())
+    {
+        pipe_append_locked(level, iov, iovcnt);
+        return;
+    }
+#    endif
+    /* If configured and the target is stdout/stderr, flush stdio buffers
+     * to avoid interleaving with other code that may be using stdio on
+     * the same stream (safer but slower). Other descriptors have no
+     * stdio stream to flush.
      */
-    if(G.writev_flush) fflush(out);
+    if(G.writev_flush)
+    {
+        if(fd == STDOUT_FILENO)
+            fflush(stdout);
+        else if(fd == STDERR_FILENO)
+            fflush(stderr);
+    }
     /* prepare newline iovec */
     char         nl = '\n';
     struct iovec local_iov[16];
@@ -592,11 +6389,11 @@ static void write_line_iov(eml_level_t level, struct iovec* iov, int iovcnt)
     local_iov[cnt].iov_len  = 1;
     ++cnt;
 
-    ssize_t r = writev(fd, local_iov, cnt);
-    (void)r; /* best-effort, ignore errors */
+    write_fd_locked(fd, local_iov, cnt, 0);
 #else
-    /* Fallback: write each iovec with fwrite and append newline */
-    FILE* out = default_stream(level);
+    /* Fallback: write each iovec with fwrite and append newline; only
+     * the stdout/stderr routing is honoured here */
+    FILE* out = default_fd(level) == 1 ? stdout : stderr;
     for(int i = 0; i < iovcnt; ++i)
         fwrite(iov[i].iov_base, 1, iov[i].iov_len, out);
     fputc('\n', out);
@@ -604,6 +6401,105 @@ static void write_line_iov(eml_level_t level, struct iovec* iov, int iovcnt)
 #endif
 }
 
+static void dedup_make_key(void)
+{
+    pthread_key_create(&dedup_key, dedup_thread_exit);
+}
+
+static void dedup_thread_exit(void* arg)
+{
+    (void)arg;
+    emlog_dedup_flush();
+}
+
+static void dedup_flush_locked(struct dedup_state* d, const char* ts)
+{
+    if(!d->count) return;
+    for(struct dedup_state** pp = &dedup_open; *pp; pp = &(*pp)->next)
+    {
+        if(*pp != d) continue;
+        *pp = d->next;
+        break;
+    }
+    const char* comp = d->comp[0] ? d->comp : NULL;
+    char        head[128];
+    char        body[64];
+    int         hlen = format_header(head, sizeof head, ts, d->level, d->tid, comp);
+    int         blen = snprintf(body, sizeof body, "last message repeated %llu time%s", d->count,
+                                d->count == 1 ? "" : "s");
+    d->count = 0;
+    if(blen < 0) return;
+    struct iovec    iov[2] = {{head, (size_t)hlen}, {body, (size_t)blen}};
+    struct line_ctx saved  = line_ctx_tls;
+    line_ctx_tls = (struct line_ctx){NULL, comp};
+    write_line_iov(d->level, iov, 2);
+    line_ctx_tls = saved;
+}
+
+static void dedup_expire(void)
+{
+    char ts[40] = {0};
+    pthread_mutex_lock(&G.mu);
+    if(G.use_ts && dedup_open) fmt_time_iso8601(ts, sizeof ts, NULL);
+    uint64_t now  = mono_ns();
+    uint64_t next = 0;
+    for(struct dedup_state* d = dedup_open; d;)
+    {
+        struct dedup_state* after = d->next;
+        uint64_t            end   = d->first_ns + G.dedup_win_ns;
+        if(now >= end)
+            dedup_flush_locked(d, ts);
+        else if(!next || end < next)
+            next = end;
+        d = after;
+    }
+    if(next) summary_arm_dedup(next);
+    pthread_mutex_unlock(&G.mu);
+    if(sink_defer_tls) sink_run_deferred();
+}
+
+static int dedup_check(eml_level_t level, const char* comp, const char* msg, size_t msglen,
+                       const char* ts, uint64_t tid)
+{
+    uint64_t h = 0xcbf29ce484222325ull ^ (uint64_t)level;
+    for(const unsigned char* p = (const unsigned char*)(comp ? comp : ""); *p; ++p)
+        h = (h ^ *p) * 0x100000001b3ull;
+    h = (h ^ 0xffu) * 0x100000001b3ull; /* separator: "ab"+"c" != "a"+"bc" */
+    for(size_t i = 0; i < msglen; ++i)
+        h = (h ^ (unsigned char)msg[i]) * 0x100000001b3ull;
+    h = h ? h : 1u;
+
+    struct timespec now_ts;
+    clock_gettime(CLOCK_MONOTONIC, &now_ts);
+    uint64_t now = (uint64_t)now_ts.tv_sec * 1000000000ull + (uint64_t)now_ts.tv_nsec;
+
+    if(h == dedup_tls.hash && now - dedup_tls.first_ns < G.dedup_win_ns)
+    {
+        if(dedup_tls.count++ == 0)
+        {
+            /* first suppressed line: make sure the window end and
+             * thread exit report it */
+            pthread_once(&dedup_key_once, dedup_make_key);
+            pthread_setspecific(dedup_key, &dedup_tls);
+            dedup_tls.next = dedup_open;
+            dedup_open     = &dedup_tls;
+            summary_arm_dedup(dedup_tls.first_ns + G.dedup_win_ns);
+        }
+        return 1;
+    }
+
+    dedup_flush_locked(&dedup_tls, ts);
+    dedup_tls.hash     = h;
+    dedup_tls.first_ns = now;
+    dedup_tls.tid      = tid;
+    dedup_tls.level    = level;
+    size_t clen        = comp ? strlen(comp) : 0;
+    if(clen >= sizeof dedup_tls.comp) clen = sizeof dedup_tls.comp - 1;
+    memcpy(dedup_tls.comp, comp ? comp : "", clen);
+    dedup_tls.comp[clen] = '\0';
+    return 0;
+}
+
 static void vlog(eml_level_t level, const char* comp, const char* fmt, va_list ap)
 {
     /*
@@ -612,7 +6508,7 @@ static void vlog(eml_level_t level, const char* comp, const char* fmt, va_list a
      * -----------------------------------------------------------------
      *
      * This function is the heart of the logging pipeline. It is invoked
-     * with the global mutex held (emlog_log acquires G.mu before calling
+     * with the global mutex held (deliver() acquires G.mu before calling
      * into here), so the implementation can safely read and write global
      * state without additional synchronization. The function is
      * carefully designed to avoid heap allocations for common short
@@ -620,10 +6516,12 @@ static void vlog(eml_level_t level, const char* comp, const char* fmt, va_list a
      * fallback path.
      *
      * Step-by-step behavior (annotated):
-     * 1) Level filtering: if the provided level is below G.min_level,
-     *    drop the message immediately and return. This is an important
-     *    early-out to avoid any formatting work for messages that would
-     *    be discarded.
+     * 1) Level filtering happens before we get here: the EML_* macros
+     *    compare against emlog__active_level inline, and emit_va() then
+     *    runs admit(): the effective minimum for @p comp (a per-component
+     *    override when one is installed, G.min_level otherwise) and the
+     *    sampling rate, all without holding G.mu. Dropped messages therefore never pay for the
+     *    mutex, timestamps or formatting.
      *
      * 2) Timestamp formatting: if timestamps are enabled (G.use_ts), we
      *    call fmt_time_iso8601 to produce an ISO8601 timestamp string.
@@ -642,20 +6540,28 @@ static void vlog(eml_level_t level, const char* comp, const char* fmt, va_list a
      *        message. If malloc fails we fall back to the truncated
      *        stack buffer contents.
      *
-     * 4) Header composition: we build a small header containing either
+     * 4) Repeat suppression: when emlog_set_dedup() is on, dedup_check()
+     *    compares the formatted line with the thread's previous one and
+     *    swallows it (counting) if identical and inside the window.
+     *
+     * 5) Header composition: we build a small header containing either
      *    "<ts> <lvl> [tid] [comp] " when timestamps are enabled, or
      *    "<lvl> [tid] [comp] " without timestamps. The thread id is
      *    acquired via eml_tid() which returns a numeric identifier
      *    suitable for human-readable logs.
      *
-     * 5) Single-allocation line assembly: to ensure the writer sees a
-     *    contiguous line we allocate a buffer of size header+msg and
-     *    memcpy both pieces into it, NUL-terminate, and pass it to
-     *    write_line. If allocation fails we degrade gracefully by
-     *    writing the header and message separately (two writes).
+     * 6) Backtrace flush: an ERROR or worse line that survived step 4
+     *    first writes the thread's buffered backtrace lines (see
+     *    emlog_set_backtrace()). Doing it after the repeat check keeps a
+     *    swallowed duplicate from emptying the buffer.
      *
-     * 6) Cleanup: free any heap memory allocated for the message or
-     *    composed line.
+     * 7) Line assembly: the header and message go out as a two-entry
+     *    iovec, truncated so header+message+newline fits LOG_MAX_WRITE.
+     *    write_line_iov() appends the newline and routes the line: the
+     *    flight recorder, the sinks, an iovec or flat writer callback,
+     *    and finally the level's fd (the splice buffer, or writev(2)
+     *    with the overflow buffer behind it). No allocation is needed
+     *    beyond the heap message of step 3.
      *
      * Important design and safety notes:
      * - The global mutex prevents concurrent modification of writer and
@@ -667,15 +6573,9 @@ static void vlog(eml_level_t level, const char* comp, const char* fmt, va_list a
      *   growing stack frames too much.
      *
      * Potential micro-optimizations (documented for future work):
-     * - Avoid single allocation for the full line by using writev(2) on
-     *   platforms where it's available and safe: header+msg could be
-     *   written atomically to a FD. That would avoid the malloc/free
-     *   for the assembled line.
      * - Support a per-thread scratch buffer to avoid frequent small
      *   heap mallocs when messages are slightly larger than stackbuf.
      */
-    if(level < G.min_level) return;
-
     char ts[40] = {0};
     if(G.use_ts)
     {
@@ -711,13 +6611,26 @@ static void vlog(eml_level_t level, const char* comp, const char* fmt, va_list a
         }
     }
 
-    char     head[128];
-    uint64_t tid  = eml_tid();
-    int      hlen = G.use_ts ? snprintf(head, sizeof head, "%s %s [%llu] [%s] ", ts, lvl_str(level),
-                                        (unsigned long long)tid, comp ? comp : "-")
-                             : snprintf(head, sizeof head, "%s [%llu] [%s] ", lvl_str(level),
-                                        (unsigned long long)tid, comp ? comp : "-");
-    if(hlen < 0) hlen = 0;
+    uint64_t tid = eml_tid();
+    if(G.dedup && dedup_check(level, comp, msg, msglen, ts, tid))
+    {
+        free(heap);
+        return;
+    }
+    if(level >= EML_LEVEL_ERROR && bt_tls && bt_tls->count)
+    {
+        /* the backtrace lines are not the call site's, nor durable */
+        struct line_ctx ctx = line_ctx_tls;
+        int             arm = durable_arm_tls;
+        line_ctx_tls.cs     = NULL;
+        durable_arm_tls     = 0;
+        bt_flush_locked(level, comp);
+        line_ctx_tls    = ctx;
+        durable_arm_tls = arm;
+    }
+
+    char head[128];
+    int  hlen = format_header(head, sizeof head, ts, level, tid, comp);
 
     /* Build iovec for header and message, then call write_line_iov which
      * will choose an efficient path (writev or writer callback).
@@ -0,0 +1,111 @@
+/* tests/bench/bench_component_level.c
+ * Micro-benchmark for the per-component level lookup.
+ *
+ * Usage: emlog_bench_component_level [iterations] [budget_ns]
+ *
+ * Times a macro call rejected by a component override (hit), one whose
+ * component has no override (miss) and the same call without a component.
+ * The difference to the latter is the lookup cost; the bench exits with 1
+ * when a hit or a miss costs more than budget_ns (default 5). The string
+ * API lookups are reported for reference only.
+ */
+
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "emlog.h"
+
+#define ROUNDS 5 /**< Best-of rounds per measurement */
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double call_none(long iters)
+{
+    double t0 = now_ns();
+    for(long i = 0; i < iters; ++i)
+        EML_INFO(NULL, "filtered %ld", i);
+    return (now_ns() - t0) / (double)iters;
+}
+
+static double call_hit(long iters)
+{
+    double t0 = now_ns();
+    for(long i = 0; i < iters; ++i)
+        EML_INFO("disk", "filtered %ld", i);
+    return (now_ns() - t0) / (double)iters;
+}
+
+static double call_miss(long iters)
+{
+    double t0 = now_ns();
+    for(long i = 0; i < iters; ++i)
+        EML_INFO("storage", "filtered %ld", i);
+    return (now_ns() - t0) / (double)iters;
+}
+
+static double best_of(double (*fn)(long), long iters)
+{
+    double best = fn(iters);
+    for(int r = 1; r < ROUNDS; ++r)
+    {
+        double t = fn(iters);
+        if(t < best) best = t;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    long   iters  = 10000000;
+    double budget = 5.0;
+    if(argc >= 2) iters = atol(argv[1]);
+    if(argc >= 3) budget = atof(argv[2]);
+    if(iters <= 0) iters = 1;
+
+    /* a realistic table: a handful of overrides besides the one we probe */
+    const char* names[] = {"net", "disk", "db", "http", "auth", "cache", "sched", "rpc"};
+    for(size_t i = 0; i < sizeof names / sizeof names[0]; ++i)
+        emlog_set_component_level(names[i], EML_LEVEL_WARN);
+    emlog_set_component_level("net", EML_LEVEL_DBG);
+    emlog_set_level(EML_LEVEL_WARN);
+
+    /* volatile sink keeps the compiler from hoisting the lookups */
+    volatile int sink = 0;
+    const char*  hit  = "net";
+    const char*  miss = "storage";
+
+    double t0 = now_ns();
+    for(long i = 0; i < iters; ++i)
+        sink += emlog_get_component_level(hit);
+    double t1 = now_ns();
+    for(long i = 0; i < iters; ++i)
+        sink += emlog_get_component_level(miss);
+    double t2 = now_ns();
+
+    double none = best_of(call_none, iters);
+    double on   = best_of(call_hit, iters) - none;
+    double off  = best_of(call_miss, iters) - none;
+
+    printf("string lookup (hit):     %.2f ns/op\n", (t1 - t0) / (double)iters);
+    printf("string lookup (miss):    %.2f ns/op\n", (t2 - t1) / (double)iters);
+    printf("filtered call, no comp:  %.2f ns/op\n", none);
+    printf("call-site lookup (hit):  %.2f ns/op\n", on);
+    printf("call-site lookup (miss): %.2f ns/op\n", off);
+    (void)sink;
+
+    if(on > budget || off > budget)
+    {
+        fprintf(stderr, "component lookup exceeds the %.2f ns budget\n", budget);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+/* tests/unit/test_emlog_backtrace.c
+ * Covers the per-thread backtrace ring flushed on ERROR.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct capture
+{
+    char*  buf;
+    size_t cap;
+    size_t len;
+    int    lines;
+};
+
+static ssize_t capture_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct capture* c       = (struct capture*)user;
+    size_t          avail   = (c->cap > 0) ? c->cap - 1 - c->len : 0;
+    size_t          to_copy = (n < avail) ? n : avail;
+    if(to_copy > 0)
+    {
+        memcpy(c->buf + c->len, line, to_copy);
+        c->len         += to_copy;
+        c->buf[c->len]  = '\0';
+    }
+    ++c->lines;
+    return (ssize_t)n;
+}
+
+static void test_backtrace_flush_on_error(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 8192};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_WARN);
+
+    assert_int_equal(emlog_set_backtrace((eml_level_t)9, 4), EML_BAD_INPUT);
+    assert_int_equal(emlog_set_backtrace(EML_LEVEL_DBG, 4), EML_OK);
+
+    /* below-level lines are held back; only the last 4 survive */
+    for(int i = 0; i < 6; ++i)
+        EML_DBG("bt", "CTX %d", i);
+    EML_INFO("bt", "CTX_INFO");
+    assert_int_equal(c.lines, 0);
+
+    /* WARN is written normally and does not flush */
+    EML_WARN("bt", "PLAIN_WARN");
+    assert_int_equal(c.lines, 1);
+
+    EML_ERROR("bt", "BOOM");
+    /* marker + 4 captured + end marker + the error itself */
+    assert_int_equal(c.lines, 1 + 6 + 1);
+    assert_null(strstr(c.buf, "CTX 2"));
+    char* start = strstr(c.buf, "--- backtrace: 4 earlier lines ---");
+    char* ctx3  = strstr(c.buf, "DBG [");
+    char* info  = strstr(c.buf, "CTX_INFO");
+    char* end   = strstr(c.buf, "--- end of backtrace ---");
+    char* boom  = strstr(c.buf, "BOOM");
+    assert_non_null(start);
+    assert_non_null(ctx3);
+    assert_non_null(strstr(c.buf, "CTX 3"));
+    assert_true(start < ctx3 && ctx3 < info && info < end && end < boom);
+
+    /* the ring is cleared after a flush */
+    c.len    = 0;
+    c.buf[0] = '\0';
+    c.lines  = 0;
+    EML_CRIT("bt", "AGAIN");
+    assert_int_equal(c.lines, 1);
+
+    /* a swallowed repeat does not flush; the next line that prints does */
+    emlog_set_dedup(true, 10000);
+    EML_ERROR("bt", "SAME");
+    EML_DBG("bt", "HELD");
+    EML_ERROR("bt", "SAME");
+    assert_int_equal(c.lines, 2);
+    assert_null(strstr(c.buf, "HELD"));
+    EML_ERROR("bt", "OTHER");
+    assert_non_null(strstr(c.buf, "HELD"));
+    assert_true(strstr(c.buf, "repeated 1 time") < strstr(c.buf, "--- backtrace: 1"));
+    emlog_set_dedup(false, 0);
+    c.len    = 0;
+    c.buf[0] = '\0';
+    c.lines  = 0;
+
+    /* disabled: below-level lines are dropped again */
+    assert_int_equal(emlog_set_backtrace(EML_LEVEL_DBG, 0), EML_OK);
+    EML_DBG("bt", "GONE");
+    EML_ERROR("bt", "AFTER");
+    assert_int_equal(c.lines, 1);
+    assert_null(strstr(c.buf, "GONE"));
+
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+static void test_backtrace_truncates_lines(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 8192};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_ERROR);
+    emlog_set_backtrace(EML_LEVEL_INFO, 2);
+
+    char big[1024];
+    memset(big, 'x', sizeof big - 1);
+    big[sizeof big - 1] = '\0';
+    EML_WARN("bt", "%s", big);
+    EML_DBG("bt", "NOT_CAPTURED");
+    EML_ERROR("bt", "FAIL");
+    assert_int_equal(c.lines, 4);
+    assert_null(strstr(c.buf, "NOT_CAPTURED"));
+    /* the captured line is cut to EMLOG_BACKTRACE_LINE_MAX - 1 bytes */
+    char* w = strstr(c.buf, "WRN [");
+    assert_non_null(w);
+    assert_non_null(strstr(c.buf, "[bt] xxx"));
+    size_t xs = 0;
+    for(const char* p = w; *p; ++p)
+        xs += (*p == 'x');
+    assert_true(xs > 0 && xs < EMLOG_BACKTRACE_LINE_MAX);
+
+    emlog_set_backtrace(EML_LEVEL_DBG, 0);
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+void emlog_backtrace_flush_on_error(void** state)
+{
+    test_backtrace_flush_on_error(state);
+}
+
+void emlog_backtrace_truncates_lines(void** state)
+{
+    test_backtrace_truncates_lines(state);
+}
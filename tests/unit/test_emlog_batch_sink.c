@@ -0,0 +1,235 @@
+/* tests/unit/test_emlog_batch_sink.c
+ * Covers the batch sink: count, byte and linger boundaries, the record
+ * fields each batch carries and a callback that blocks or logs.
+ */
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct capture
+{
+    pthread_mutex_t mu;
+    int             batches;
+    int             records;
+    int             sizes[64];
+    int             next; /* expected "r%d" payload */
+    int             ordered;
+    uint64_t        last_ts;
+};
+
+static ssize_t capture_batch(const eml_record_t* recs, size_t n, void* user)
+{
+    struct capture* c = user;
+    pthread_mutex_lock(&c->mu);
+    if(c->batches < 64) c->sizes[c->batches] = (int)n;
+    ++c->batches;
+    for(size_t i = 0; i < n; ++i)
+    {
+        const eml_record_t* r = &recs[i];
+        int                 v = -1;
+        if(sscanf(r->text + r->hdr_len, "r%d", &v) != 1 || v != c->next ||
+           !r->comp || strcmp(r->comp, "bat") != 0 || r->ts_ns < c->last_ts || !r->tid)
+            c->ordered = 0;
+        ++c->next;
+        c->last_ts = r->ts_ns;
+        ++c->records;
+    }
+    pthread_mutex_unlock(&c->mu);
+    return 0;
+}
+
+static int batches(struct capture* c)
+{
+    pthread_mutex_lock(&c->mu);
+    int b = c->batches;
+    pthread_mutex_unlock(&c->mu);
+    return b;
+}
+
+static void test_batch_sink_boundaries(void** state)
+{
+    (void)state;
+    struct capture c = {.mu = PTHREAD_MUTEX_INITIALIZER, .ordered = 1};
+
+    eml_batch_sink_cfg_t bad = {.max_records = 4};
+    eml_batch_sink_t*    bs;
+    assert_int_equal(emlog_batch_sink_open(&bad, &bs), EML_BAD_INPUT);
+
+    /* long linger: only count and bytes close batches */
+    eml_batch_sink_cfg_t cfg = {.fn          = capture_batch,
+                                .user        = &c,
+                                .max_records = 4,
+                                .max_bytes   = 256,
+                                .linger_ms   = 60000};
+    assert_int_equal(emlog_batch_sink_open(&cfg, &bs), EML_OK);
+    eml_sink_cfg_t sc = {.record = emlog_batch_sink_record, .user = bs};
+    int            id;
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    for(int i = 0; i < 8; ++i)
+        EML_INFO("bat", "r%d", i);
+    assert_int_equal(batches(&c), 2);
+    assert_int_equal(c.sizes[0], 4);
+    assert_int_equal(c.sizes[1], 4);
+
+    /* ~100-byte lines: the third would overflow 256 bytes */
+    char pad[80];
+    memset(pad, 'p', sizeof pad - 1);
+    pad[sizeof pad - 1] = '\0';
+    for(int i = 8; i < 11; ++i)
+        EML_INFO("bat", "r%d %s", i, pad);
+    assert_int_equal(batches(&c), 3);
+    assert_int_equal(c.sizes[2], 2);
+
+    /* a record larger than max_bytes travels alone */
+    char big[400];
+    memset(big, 'b', sizeof big - 1);
+    big[sizeof big - 1] = '\0';
+    EML_INFO("bat", "r11 %s", big);
+    assert_int_equal(batches(&c), 5);
+    assert_int_equal(c.sizes[3], 1);
+    assert_int_equal(c.sizes[4], 1);
+
+    EML_INFO("bat", "r12");
+    emlog_batch_sink_flush(bs);
+    assert_int_equal(batches(&c), 6);
+
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+    emlog_batch_sink_close(bs);
+    assert_int_equal(c.records, 13);
+    assert_true(c.ordered);
+    assert_int_equal(emlog_batch_sink_batches(NULL), 0);
+}
+
+static void test_batch_sink_linger(void** state)
+{
+    (void)state;
+    struct capture c = {.mu = PTHREAD_MUTEX_INITIALIZER, .ordered = 1};
+
+    eml_batch_sink_cfg_t cfg = {.fn = capture_batch, .user = &c, .linger_ms = 20};
+    eml_batch_sink_t*    bs;
+    assert_int_equal(emlog_batch_sink_open(&cfg, &bs), EML_OK);
+    eml_sink_cfg_t sc = {.record = emlog_batch_sink_record, .user = bs};
+    int            id;
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    EML_INFO("bat", "r0");
+    EML_WARN("bat", "r1");
+    EML_DBG("bat", "filtered");
+    assert_int_equal(batches(&c), 0);
+
+    /* the linger thread hands the partial batch over on its own */
+    for(int i = 0; i < 200 && batches(&c) == 0; ++i)
+        usleep(10 * 1000);
+    assert_int_equal(batches(&c), 1);
+    assert_int_equal(c.sizes[0], 2);
+    assert_int_equal(emlog_batch_sink_batches(bs), 1);
+    assert_int_equal(emlog_batch_sink_failed(bs), 0);
+
+    /* close delivers whatever is still buffered */
+    EML_INFO("bat", "r2");
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+    emlog_batch_sink_close(bs);
+    assert_int_equal(c.batches, 2);
+    assert_int_equal(c.records, 3);
+    assert_true(c.ordered);
+}
+
+static atomic_int gate_open;
+static atomic_int gate_calls;
+static atomic_int gate_records;
+
+static ssize_t gated_batch(const eml_record_t* recs, size_t n, void* user)
+{
+    (void)recs;
+    (void)user;
+    atomic_fetch_add(&gate_calls, 1);
+    while(!atomic_load(&gate_open))
+        usleep(1000);
+    atomic_fetch_add(&gate_records, (int)n);
+    /* a consumer that reports through the logger it drains */
+    EML_WARN("bat", "forwarded %zu", n);
+    return 0;
+}
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static void test_batch_sink_callback_unlocked(void** state)
+{
+    (void)state;
+    atomic_store(&gate_open, 0);
+    atomic_store(&gate_calls, 0);
+    atomic_store(&gate_records, 0);
+
+    eml_batch_sink_cfg_t cfg = {.fn = gated_batch, .linger_ms = 10};
+    eml_batch_sink_t*    bs;
+    assert_int_equal(emlog_batch_sink_open(&cfg, &bs), EML_OK);
+    eml_sink_cfg_t sc = {.record = emlog_batch_sink_record, .user = bs};
+    int            id;
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    /* the linger thread hands "r0" over and the callback blocks */
+    EML_INFO("bat", "r0");
+    for(int i = 0; i < 2000 && !atomic_load(&gate_calls); ++i)
+        usleep(1000);
+    if(!atomic_load(&gate_calls)) atomic_store(&gate_open, 1); /* do not strand the thread */
+    assert_int_equal(atomic_load(&gate_calls), 1);
+
+    /* new records collect in the other buffer meanwhile */
+    uint64_t t0 = now_ms();
+    for(int i = 1; i <= 10; ++i)
+        EML_INFO("bat", "r%d", i);
+    uint64_t took = now_ms() - t0;
+
+    atomic_store(&gate_open, 1);
+    emlog_batch_sink_flush(bs);
+    assert_true(took < 1000u);
+    assert_int_equal(atomic_load(&gate_records), 11);
+
+    /* the callback's own lines were kept away from its sink */
+    eml_sink_stats_t st;
+    assert_int_equal(emlog_sink_stats(id, &st), EML_OK);
+    assert_int_equal(st.written, 11);
+    assert_int_equal(st.dropped, 2);
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+    assert_int_equal(emlog_batch_sink_batches(bs), 2);
+    emlog_batch_sink_close(bs);
+}
+
+void emlog_batch_sink_boundaries(void** state)
+{
+    test_batch_sink_boundaries(state);
+}
+
+void emlog_batch_sink_linger(void** state)
+{
+    test_batch_sink_linger(state);
+}
+
+void emlog_batch_sink_callback_unlocked(void** state)
+{
+    test_batch_sink_callback_unlocked(state);
+}
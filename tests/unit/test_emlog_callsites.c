@@ -0,0 +1,125 @@
+/* tests/unit/test_emlog_callsites.c
+ * Covers per-call-site switches (emlog_callsite_enable/disable).
+ */
+
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct capture
+{
+    char*  buf;
+    size_t cap;
+    size_t len;
+};
+
+static ssize_t capture_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct capture* c       = (struct capture*)user;
+    size_t          avail   = (c->cap > 0) ? c->cap - 1 - c->len : 0;
+    size_t          to_copy = (n < avail) ? n : avail;
+    if(to_copy > 0)
+    {
+        memcpy(c->buf + c->len, line, to_copy);
+        c->len         += to_copy;
+        c->buf[c->len]  = '\0';
+    }
+    return (ssize_t)n;
+}
+
+/* Each helper records the line of its single call site. */
+static unsigned line_a, line_b;
+
+static void site_a(void)
+{
+    line_a = __LINE__; EML_DBG("cs", "SITE_A");
+}
+
+static void site_b(void)
+{
+    line_b = __LINE__; EML_DBG("cs", "SITE_B");
+}
+
+static void run_sites(struct capture* c)
+{
+    c->len    = 0;
+    c->buf[0] = '\0';
+    site_a();
+    site_b();
+}
+
+static void test_callsite_enable_by_line(void** state)
+{
+    (void)state;
+#if defined(EMLOG_HAVE_CALLSITES)
+    struct capture c = {.cap = 1024};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_WARN);
+
+    run_sites(&c);
+    assert_null(strstr(c.buf, "SITE_A"));
+    assert_null(strstr(c.buf, "SITE_B"));
+
+    char spec[128];
+    snprintf(spec, sizeof spec, "unit/test_emlog_callsites.c:%u", line_a);
+    assert_int_equal(emlog_callsite_enable(spec), 1);
+    run_sites(&c);
+    assert_non_null(strstr(c.buf, "SITE_A"));
+    assert_null(strstr(c.buf, "SITE_B"));
+
+    /* a range selects both; disabling the range releases both */
+    snprintf(spec, sizeof spec, "*callsites.c:%u-%u", line_a, line_b);
+    assert_int_equal(emlog_callsite_enable(spec), 2);
+    run_sites(&c);
+    assert_non_null(strstr(c.buf, "SITE_B"));
+    assert_int_equal(emlog_callsite_disable(spec), 2);
+    run_sites(&c);
+    assert_null(strstr(c.buf, "SITE_A"));
+    assert_null(strstr(c.buf, "SITE_B"));
+
+    /* sites still follow the global level while not forced */
+    emlog_set_level(EML_LEVEL_DBG);
+    run_sites(&c);
+    assert_non_null(strstr(c.buf, "SITE_A"));
+    assert_non_null(strstr(c.buf, "SITE_B"));
+
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+#endif
+}
+
+static void test_callsite_bad_specs(void** state)
+{
+    (void)state;
+    errno = 0;
+    assert_int_equal(emlog_callsite_enable(NULL), -1);
+    assert_int_equal(errno, EINVAL);
+    assert_int_equal(emlog_callsite_enable("foo.c:abc"), -1);
+    assert_int_equal(emlog_callsite_enable("foo.c:20-10"), -1);
+    assert_int_equal(emlog_callsite_enable("foo.c:10-"), -1);
+    assert_int_equal(emlog_callsite_enable("no_such_file.c"), 0);
+    assert_int_equal(emlog_callsite_disable("no_such_file.c"), 0);
+}
+
+void emlog_callsite_enable_by_line(void** state)
+{
+    test_callsite_enable_by_line(state);
+}
+
+void emlog_callsite_bad_specs(void** state)
+{
+    test_callsite_bad_specs(state);
+}
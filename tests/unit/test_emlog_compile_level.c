@@ -0,0 +1,83 @@
+/* tests/unit/test_emlog_compile_level.c
+ * Verifies EMLOG_COMPILE_MIN_LEVEL strips macro call sites and their
+ * arguments. This file pins its own value regardless of the build option.
+ */
+
+#undef EMLOG_COMPILE_MIN_LEVEL
+#define EMLOG_COMPILE_MIN_LEVEL 2 /* strip DBG and INFO */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct capture
+{
+    char*  buf;
+    size_t cap;
+    size_t len;
+};
+
+static ssize_t capture_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct capture* c       = (struct capture*)user;
+    size_t          avail   = (c->cap > 0) ? c->cap - 1 - c->len : 0;
+    size_t          to_copy = (n < avail) ? n : avail;
+    if(to_copy > 0)
+    {
+        memcpy(c->buf + c->len, line, to_copy);
+        c->len         += to_copy;
+        c->buf[c->len]  = '\0';
+    }
+    return (ssize_t)n;
+}
+
+static int side_effects;
+
+static int bump(void)
+{
+    return ++side_effects;
+}
+
+static void test_compile_level_strips_below(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 1024};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_DBG);
+    side_effects = 0;
+
+    EML_DBG("UT", "STRIPPED_DBG %d", bump());
+    EML_INFO("UT", "STRIPPED_INF %d", bump());
+    assert_int_equal(side_effects, 0); /* arguments never evaluated */
+    assert_null(strstr(c.buf, "STRIPPED_"));
+
+    EML_WARN("UT", "KEPT_WRN %d", bump());
+    EML_ERROR("UT", "KEPT_ERR %d", bump());
+    assert_int_equal(side_effects, 2);
+    assert_non_null(strstr(c.buf, "KEPT_WRN 1"));
+    assert_non_null(strstr(c.buf, "KEPT_ERR 2"));
+
+    /* direct calls bypass the compile-time filter */
+    emlog_log(EML_LEVEL_DBG, "UT", "DIRECT_DBG");
+    assert_non_null(strstr(c.buf, "DIRECT_DBG"));
+
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+void emlog_compile_level_strips(void** state)
+{
+    test_compile_level_strips_below(state);
+}
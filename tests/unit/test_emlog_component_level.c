@@ -0,0 +1,163 @@
+/* tests/unit/test_emlog_component_level.c
+ * Covers per-component level overrides (emlog_set_component_level).
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct capture
+{
+    char*  buf;
+    size_t cap;
+    size_t len;
+};
+
+static ssize_t capture_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct capture* c       = (struct capture*)user;
+    size_t          avail   = (c->cap > 0) ? c->cap - 1 - c->len : 0;
+    size_t          to_copy = (n < avail) ? n : avail;
+    if(to_copy > 0)
+    {
+        memcpy(c->buf + c->len, line, to_copy);
+        c->len         += to_copy;
+        c->buf[c->len]  = '\0';
+    }
+    return (ssize_t)n;
+}
+
+static void test_component_override_filters(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 2048};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_WARN);
+    assert_int_equal(emlog_set_component_level("net", EML_LEVEL_DBG), EML_OK);
+    assert_int_equal(emlog_get_component_level("net"), EML_LEVEL_DBG);
+    assert_int_equal(emlog_get_component_level("disk"), -1);
+
+    emlog_log(EML_LEVEL_DBG, "net", "NET_DBG");
+    emlog_log(EML_LEVEL_DBG, "disk", "DISK_DBG");
+    emlog_log(EML_LEVEL_INFO, "disk", "DISK_INF");
+    emlog_log(EML_LEVEL_WARN, "disk", "DISK_WRN");
+    emlog_log(EML_LEVEL_DBG, NULL, "NULL_DBG");
+
+    assert_non_null(strstr(c.buf, "NET_DBG"));
+    assert_null(strstr(c.buf, "DISK_DBG"));
+    assert_null(strstr(c.buf, "DISK_INF"));
+    assert_non_null(strstr(c.buf, "DISK_WRN"));
+    assert_null(strstr(c.buf, "NULL_DBG"));
+
+    /* overrides can also be stricter than the global level */
+    emlog_set_level(EML_LEVEL_DBG);
+    assert_int_equal(emlog_set_component_level("disk", EML_LEVEL_ERROR), EML_OK);
+    c.len    = 0;
+    c.buf[0] = '\0';
+    emlog_log(EML_LEVEL_WARN, "disk", "DISK_WRN2");
+    emlog_log(EML_LEVEL_INFO, "other", "OTHER_INF");
+    assert_null(strstr(c.buf, "DISK_WRN2"));
+    assert_non_null(strstr(c.buf, "OTHER_INF"));
+
+    /* clearing falls back to the global level */
+    assert_int_equal(emlog_set_component_level("net", -1), EML_OK);
+    assert_int_equal(emlog_set_component_level("disk", -1), EML_OK);
+    assert_int_equal(emlog_get_component_level("net"), -1);
+    emlog_set_level(EML_LEVEL_WARN);
+    c.len    = 0;
+    c.buf[0] = '\0';
+    emlog_log(EML_LEVEL_DBG, "net", "NET_DBG2");
+    emlog_log(EML_LEVEL_WARN, "disk", "DISK_WRN3");
+    assert_null(strstr(c.buf, "NET_DBG2"));
+    assert_non_null(strstr(c.buf, "DISK_WRN3"));
+
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+static void cached_site(int n)
+{
+    EML_INFO("late_cs", "LATE_%d", n);
+}
+
+static void test_component_override_callsite_cache(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 2048};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    /* an unrelated override makes the site look its component up */
+    assert_int_equal(emlog_set_component_level("anchor_cs", EML_LEVEL_WARN), EML_OK);
+
+    cached_site(1); /* miss, remembered by the site */
+    assert_int_equal(emlog_set_component_level("late_cs", EML_LEVEL_WARN), EML_OK);
+    cached_site(2); /* the new entry invalidates the remembered miss */
+    assert_int_equal(emlog_set_component_level("late_cs", EML_LEVEL_DBG), EML_OK);
+    cached_site(3); /* hit through the cached entry */
+    assert_int_equal(emlog_set_component_level("late_cs", EML_LEVEL_ERROR), EML_OK);
+    cached_site(4);
+
+    assert_non_null(strstr(c.buf, "LATE_1"));
+    assert_null(strstr(c.buf, "LATE_2"));
+    assert_non_null(strstr(c.buf, "LATE_3"));
+    assert_null(strstr(c.buf, "LATE_4"));
+
+    assert_int_equal(emlog_set_component_level("late_cs", -1), EML_OK);
+    assert_int_equal(emlog_set_component_level("anchor_cs", -1), EML_OK);
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+static void test_component_override_limits(void** state)
+{
+    (void)state;
+    char longname[EMLOG_COMPONENT_NAME_MAX + 1];
+    memset(longname, 'x', sizeof longname - 1);
+    longname[sizeof longname - 1] = '\0';
+
+    assert_int_equal(emlog_set_component_level(NULL, EML_LEVEL_DBG), EML_BAD_INPUT);
+    assert_int_equal(emlog_set_component_level("", EML_LEVEL_DBG), EML_BAD_INPUT);
+    assert_int_equal(emlog_set_component_level(longname, EML_LEVEL_DBG), EML_BAD_INPUT);
+    assert_int_equal(emlog_get_component_level(NULL), -1);
+
+    assert_int_equal(emlog_set_component_level("rearm", EML_LEVEL_ERROR), EML_OK);
+    assert_int_equal(emlog_get_component_level("rearm"), EML_LEVEL_ERROR);
+
+    /* clearing keeps the slot so the name can be re-armed */
+    assert_int_equal(emlog_set_component_level("rearm", -1), EML_OK);
+    assert_int_equal(emlog_get_component_level("rearm"), -1);
+    assert_int_equal(emlog_set_component_level("rearm", EML_LEVEL_WARN), EML_OK);
+    assert_int_equal(emlog_get_component_level("rearm"), EML_LEVEL_WARN);
+    assert_int_equal(emlog_set_component_level("rearm", -1), EML_OK);
+}
+
+void emlog_component_level_filters(void** state)
+{
+    test_component_override_filters(state);
+}
+
+void emlog_component_level_callsite_cache(void** state)
+{
+    test_component_override_callsite_cache(state);
+}
+
+void emlog_component_level_limits(void** state)
+{
+    test_component_override_limits(state);
+}
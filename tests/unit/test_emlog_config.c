@@ -0,0 +1,151 @@
+/* tests/unit/test_emlog_config.c
+ * Covers configuration file loading and the inotify reload watcher.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static ssize_t count_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    (void)line;
+    ++*(int*)user;
+    return (ssize_t)n;
+}
+
+static void write_file(const char* path, const char* text)
+{
+    /* write-then-rename, like most editors and config managers */
+    char tmp[256];
+    snprintf(tmp, sizeof tmp, "%s.tmp", path);
+    FILE* f = fopen(tmp, "w");
+    assert_non_null(f);
+    fputs(text, f);
+    fclose(f);
+    assert_int_equal(rename(tmp, path), 0);
+}
+
+static void test_config_load(void** state)
+{
+    (void)state;
+    char dir[] = "/tmp/emlog_cfg_XXXXXX";
+    assert_non_null(mkdtemp(dir));
+    char path[256];
+    snprintf(path, sizeof path, "%s/emlog.conf", dir);
+
+    int lines = 0;
+    emlog_set_writer(count_writer, &lines);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    assert_int_equal(emlog_config_load(NULL), EML_BAD_INPUT);
+    assert_int_equal(emlog_config_load(path), EML_NOT_FOUND);
+
+    write_file(path, "# sample\n"
+                     "level = warn\n"
+                     "timestamps = off\n"
+                     "component.cfg_net = DBG   # chatty\n"
+                     "component.cfg_db = error\n");
+    assert_int_equal(emlog_config_load(path), EML_OK);
+    assert_int_equal(emlog_get_component_level("cfg_net"), EML_LEVEL_DBG);
+    assert_int_equal(emlog_get_component_level("cfg_db"), EML_LEVEL_ERROR);
+    EML_INFO("cfg", "dropped at WARN");
+    assert_int_equal(lines, 0);
+    EML_DBG("cfg_net", "kept by override");
+    assert_int_equal(lines, 1);
+
+    /* a reload clears overrides that disappeared from the file */
+    write_file(path, "level = 1\ncomponent.cfg_net = inherit\n");
+    assert_int_equal(emlog_config_load(path), EML_OK);
+    assert_int_equal(emlog_get_component_level("cfg_net"), -1);
+    assert_int_equal(emlog_get_component_level("cfg_db"), -1);
+    EML_INFO("cfg", "kept at INFO");
+    assert_int_equal(lines, 2);
+
+    /* malformed files change nothing */
+    write_file(path, "level = DBG\nbogus line\n");
+    assert_int_equal(emlog_config_load(path), EML_BAD_INPUT);
+    write_file(path, "level = loud\n");
+    assert_int_equal(emlog_config_load(path), EML_BAD_INPUT);
+    write_file(path, "colour = on\n");
+    assert_int_equal(emlog_config_load(path), EML_BAD_INPUT);
+    lines = 0;
+    EML_DBG("cfg", "still INFO");
+    assert_int_equal(lines, 0);
+
+    unlink(path);
+    rmdir(dir);
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+}
+
+static int wait_component_level(const char* comp, int want)
+{
+    for(int i = 0; i < 200; ++i)
+    {
+        if(emlog_get_component_level(comp) == want) return 1;
+        struct timespec pause = {0, 10 * 1000000L};
+        nanosleep(&pause, NULL);
+    }
+    return 0;
+}
+
+static void test_config_watch(void** state)
+{
+    (void)state;
+    char dir[] = "/tmp/emlog_cfg_XXXXXX";
+    assert_non_null(mkdtemp(dir));
+    char path[256];
+    snprintf(path, sizeof path, "%s/emlog.conf", dir);
+
+    int lines = 0;
+    emlog_set_writer(count_writer, &lines);
+
+    /* the file may appear after the watch starts */
+    assert_int_equal(emlog_config_watch(path), EML_OK);
+    assert_int_equal(emlog_config_watch(path), EML_CONFLICT);
+
+    write_file(path, "component.cfg_watch = crit\n");
+    assert_true(wait_component_level("cfg_watch", EML_LEVEL_CRIT));
+
+    write_file(path, "component.cfg_watch = dbg\n");
+    assert_true(wait_component_level("cfg_watch", EML_LEVEL_DBG));
+
+    /* in-place edits are seen as well */
+    FILE* f = fopen(path, "w");
+    assert_non_null(f);
+    fputs("component.cfg_watch = warn\n", f);
+    fclose(f);
+    assert_true(wait_component_level("cfg_watch", EML_LEVEL_WARN));
+
+    emlog_config_unwatch();
+    emlog_config_unwatch();
+    write_file(path, "component.cfg_watch = error\n");
+    struct timespec pause = {0, 50 * 1000000L};
+    nanosleep(&pause, NULL);
+    assert_int_equal(emlog_get_component_level("cfg_watch"), EML_LEVEL_WARN);
+
+    emlog_set_component_level("cfg_watch", -1);
+    unlink(path);
+    rmdir(dir);
+    emlog_set_writer(NULL, NULL);
+}
+
+void emlog_config_load_applies(void** state)
+{
+    test_config_load(state);
+}
+
+void emlog_config_watch_reloads(void** state)
+{
+    test_config_watch(state);
+}
@@ -0,0 +1,149 @@
+/* tests/unit/test_emlog_dedup.c
+ * Covers per-thread repeated-message suppression (emlog_set_dedup).
+ */
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct capture
+{
+    char*  buf;
+    size_t cap;
+    size_t len;
+    int    lines;
+};
+
+static ssize_t capture_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct capture* c       = (struct capture*)user;
+    size_t          avail   = (c->cap > 0) ? c->cap - 1 - c->len : 0;
+    size_t          to_copy = (n < avail) ? n : avail;
+    if(to_copy > 0)
+    {
+        memcpy(c->buf + c->len, line, to_copy);
+        c->len         += to_copy;
+        c->buf[c->len]  = '\0';
+    }
+    ++c->lines;
+    return (ssize_t)n;
+}
+
+static void* repeat_thread(void* arg)
+{
+    (void)arg;
+    for(int i = 0; i < 4; ++i)
+        EML_WARN("dd", "THREAD_SPAM");
+    return NULL; /* run left open: summarized by the thread-exit hook */
+}
+
+static void test_dedup_collapses_runs(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 4096};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_dedup(true, 10000);
+
+    for(int i = 0; i < 5; ++i)
+        EML_INFO("dd", "SAME %d", 1);
+    assert_int_equal(c.lines, 1);
+
+    /* a different line closes the run first */
+    EML_INFO("dd", "OTHER");
+    assert_int_equal(c.lines, 3);
+    assert_non_null(strstr(c.buf, "last message repeated 4 times"));
+    assert_true(strstr(c.buf, "repeated") < strstr(c.buf, "OTHER"));
+
+    /* same text from another component is not a repeat */
+    EML_INFO("dd2", "OTHER");
+    assert_int_equal(c.lines, 4);
+
+    /* explicit flush */
+    EML_INFO("dd2", "OTHER");
+    EML_INFO("dd2", "OTHER");
+    assert_int_equal(c.lines, 4);
+    emlog_dedup_flush();
+    assert_int_equal(c.lines, 5);
+    assert_non_null(strstr(c.buf, "[dd2] last message repeated 2 times"));
+    emlog_dedup_flush();
+    assert_int_equal(c.lines, 5);
+
+    /* thread exit reports its pending run */
+    pthread_t th;
+    assert_int_equal(pthread_create(&th, NULL, repeat_thread, NULL), 0);
+    pthread_join(th, NULL);
+    assert_int_equal(c.lines, 7);
+    assert_non_null(strstr(c.buf, "[dd] last message repeated 3 times"));
+
+    emlog_set_dedup(false, 0);
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+static void test_dedup_window_expires(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 2048};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_dedup(true, 50);
+
+    /* no reads here: the timer may already be writing the summary */
+    EML_ERROR("dd", "TICK");
+    EML_ERROR("dd", "TICK");
+
+    /* the run ends with its window, not with the next line */
+    struct timespec pause = {0, 80 * 1000000L};
+    nanosleep(&pause, NULL);
+    EML_ERROR("dd", "TOCK");
+    assert_int_equal(c.lines, 3);
+    char* sum = strstr(c.buf, "last message repeated 1 time");
+    assert_non_null(sum);
+    assert_null(strstr(c.buf, "repeated 1 times"));
+    assert_true(sum < strstr(c.buf, "TOCK"));
+
+    /* a retry loop that goes quiet still gets its count reported */
+    for(int i = 0; i < 6; ++i)
+        EML_ERROR("dd", "RETRY");
+    pause.tv_nsec = 300 * 1000000L;
+    nanosleep(&pause, NULL);
+    emlog_set_writer(NULL, NULL); /* orders the timer's write before the reads */
+    assert_int_equal(c.lines, 5);
+    assert_non_null(strstr(c.buf, "last message repeated 5 times"));
+    emlog_set_writer(capture_writer, &c);
+
+    /* disabled: every line is written */
+    emlog_set_dedup(false, 0);
+    EML_ERROR("dd", "TICK");
+    EML_ERROR("dd", "TICK");
+    assert_int_equal(c.lines, 7);
+
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+void emlog_dedup_collapses_runs(void** state)
+{
+    test_dedup_collapses_runs(state);
+}
+
+void emlog_dedup_window_expires(void** state)
+{
+    test_dedup_window_expires(state);
+}
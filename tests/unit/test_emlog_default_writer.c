@@ -1,5 +1,6 @@
 /* tests/unit/test_emlog_default_writer.c
- * Covers default writev path (stdout/stderr) and flush toggle.
+ * Covers default writev path (stdout/stderr), flush toggle and explicit
+ * descriptor routing.
  */
 
 #include <fcntl.h>
@@ -81,6 +82,55 @@ static void test_default_writer_routes_stderr(void** state)
     assert_default_route(EML_LEVEL_WARN, "ERR", "warn-route", STDERR_FILENO, stderr);
 }
 
+static void test_set_fd_routes_levels(void** state)
+{
+    (void)state;
+    int lo[2], hi[2];
+    assert_int_equal(pipe(lo), 0);
+    assert_int_equal(pipe(hi), 0);
+    fcntl(lo[0], F_SETFL, O_NONBLOCK);
+    fcntl(hi[0], F_SETFL, O_NONBLOCK);
+
+    emlog_set_writer(NULL, NULL);
+    emlog_init(EML_LEVEL_DBG, false);
+    assert_int_equal(emlog_set_fd(EML_LEVEL_MASK_ALL, lo[1]), EML_OK);
+    assert_int_equal(
+        emlog_set_fd(EML_LEVEL_MASK(EML_LEVEL_ERROR) | EML_LEVEL_MASK(EML_LEVEL_CRIT), hi[1]),
+        EML_OK);
+    assert_int_equal(emlog_get_fd(EML_LEVEL_DBG), lo[1]);
+    assert_int_equal(emlog_get_fd(EML_LEVEL_CRIT), hi[1]);
+
+    emlog_log(EML_LEVEL_DBG, "FD", "dbg-to-lo");
+    emlog_log(EML_LEVEL_WARN, "FD", "warn-to-lo");
+    emlog_log(EML_LEVEL_ERROR, "FD", "err-to-hi");
+
+    /* restore stdout/stderr before asserting so failures stay visible */
+    assert_int_equal(emlog_set_fd(EML_LEVEL_MASK_ALL, -1), EML_OK);
+    assert_int_equal(emlog_get_fd(EML_LEVEL_INFO), STDOUT_FILENO);
+    assert_int_equal(emlog_get_fd(EML_LEVEL_WARN), STDERR_FILENO);
+    close(lo[1]);
+    close(hi[1]);
+
+    char a[512], b[512];
+    read_all(lo[0], a, sizeof a);
+    read_all(hi[0], b, sizeof b);
+    close(lo[0]);
+    close(hi[0]);
+    assert_non_null(strstr(a, "dbg-to-lo\n"));
+    assert_non_null(strstr(a, "warn-to-lo\n"));
+    assert_null(strstr(a, "err-to-hi"));
+    assert_non_null(strstr(b, "err-to-hi\n"));
+    assert_null(strstr(b, "to-lo"));
+}
+
+static void test_set_fd_rejects_bad_mask(void** state)
+{
+    (void)state;
+    assert_int_equal(emlog_set_fd(0, STDOUT_FILENO), EML_BAD_INPUT);
+    assert_int_equal(emlog_set_fd(EML_LEVEL_MASK(5), STDOUT_FILENO), EML_BAD_INPUT);
+    assert_int_equal(emlog_get_fd((eml_level_t)7), -1);
+}
+
 void emlog_default_writer_stdout(void** state)
 {
     test_default_writer_routes_stdout(state);
@@ -90,3 +140,13 @@ void emlog_default_writer_stderr(void** state)
 {
     test_default_writer_routes_stderr(state);
 }
+
+void emlog_default_writer_set_fd(void** state)
+{
+    test_set_fd_routes_levels(state);
+}
+
+void emlog_default_writer_set_fd_bad_mask(void** state)
+{
+    test_set_fd_rejects_bad_mask(state);
+}
@@ -0,0 +1,138 @@
+/* tests/unit/test_emlog_direct_sink.c
+ * Covers the O_DIRECT file sink: block packing, tail tracking and reopen.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static char* slurp(const char* path, size_t* n)
+{
+    FILE* f = fopen(path, "rb");
+    assert_non_null(f);
+    fseek(f, 0, SEEK_END);
+    long sz = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* p = malloc((size_t)sz + 1);
+    assert_non_null(p);
+    assert_int_equal(fread(p, 1, (size_t)sz, f), (size_t)sz);
+    fclose(f);
+    p[sz] = '\0';
+    *n    = (size_t)sz;
+    return p;
+}
+
+static void test_direct_sink_blocks(void** state)
+{
+    (void)state;
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_direct_%d.log", (int)getpid());
+    unlink(path);
+
+    eml_direct_sink_cfg_t bad = {.path = path, .block_bytes = 1000};
+    eml_direct_sink_t*    ds;
+    assert_int_equal(emlog_direct_sink_open(&bad, &ds), EML_BAD_INPUT);
+
+    /* small blocks so lines straddle block boundaries */
+    eml_direct_sink_cfg_t cfg = {.path = path, .block_bytes = 8192, .blocks = 256};
+    assert_int_equal(emlog_direct_sink_open(&cfg, &ds), EML_OK);
+    emlog_set_writer(emlog_direct_sink_write, ds);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    for(int i = 0; i < 3000; ++i)
+        EML_INFO("dio", "record %d payload %d", i, i * 7);
+    emlog_set_writer(NULL, NULL);
+    assert_int_equal(emlog_direct_sink_dropped(ds), 0);
+    emlog_direct_sink_close(ds);
+
+    /* close trimmed the padded tail: the file is exactly the text */
+    size_t n;
+    char*  text = slurp(path, &n);
+    assert_true(n % EMLOG_DIRECT_ALIGN != 0);
+    assert_int_equal(text[n - 1], '\n');
+    int   next = 0;
+    char* line = text;
+    while(line < text + n)
+    {
+        char* nl = strchr(line, '\n');
+        assert_non_null(nl);
+        int i = -1;
+        assert_int_equal(sscanf(line, "INF [%*u] [dio] record %d", &i), 1);
+        assert_int_equal(i, next++);
+        line = nl + 1;
+    }
+    assert_int_equal(next, 3000);
+    free(text);
+
+    /* reopening an unaligned file appends after its last byte */
+    eml_direct_sink_cfg_t buf = {.path = path, .buffered = true};
+    assert_int_equal(emlog_direct_sink_open(&buf, &ds), EML_OK);
+    assert_false(emlog_direct_sink_is_direct(ds));
+    assert_int_equal(emlog_direct_sink_write(EML_LEVEL_INFO, "appended", 8, ds), 8);
+    emlog_direct_sink_close(ds);
+    size_t n2;
+    text = slurp(path, &n2);
+    assert_int_equal(n2, n + 9);
+    assert_string_equal(text + n, "appended\n");
+    assert_int_equal(text[n - 1], '\n');
+    free(text);
+    unlink(path);
+}
+
+static void test_direct_sink_tail_flush(void** state)
+{
+    (void)state;
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_direct_t%d.log", (int)getpid());
+    unlink(path);
+
+    eml_direct_sink_cfg_t cfg = {.path = path, .flush_ms = 20};
+    eml_direct_sink_t*    ds;
+    assert_int_equal(emlog_direct_sink_open(&cfg, &ds), EML_OK);
+    assert_int_equal(emlog_direct_sink_write(EML_LEVEL_INFO, "first", 5, ds), 5);
+
+    /* an idle partial block reaches the file at its real length */
+    struct stat st = {0};
+    for(int i = 0; i < 200 && st.st_size != 6; ++i)
+    {
+        usleep(10 * 1000);
+        assert_int_equal(stat(path, &st), 0);
+    }
+    assert_int_equal(st.st_size, 6);
+
+    /* the tail grows in place rather than being appended again */
+    assert_int_equal(emlog_direct_sink_write(EML_LEVEL_INFO, "second", 6, ds), 6);
+    for(int i = 0; i < 200 && st.st_size != 13; ++i)
+    {
+        usleep(10 * 1000);
+        assert_int_equal(stat(path, &st), 0);
+    }
+    assert_int_equal(st.st_size, 13);
+    emlog_direct_sink_close(ds);
+
+    size_t n;
+    char*  text = slurp(path, &n);
+    assert_string_equal(text, "first\nsecond\n");
+    free(text);
+    unlink(path);
+}
+
+void emlog_direct_sink_blocks(void** state)
+{
+    test_direct_sink_blocks(state);
+}
+
+void emlog_direct_sink_tail_flush(void** state)
+{
+    test_direct_sink_tail_flush(state);
+}
@@ -0,0 +1,110 @@
+/* tests/unit/test_emlog_fast_path.c
+ * Covers the inline level check in the EML_* macros (emlog__active_level).
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct capture
+{
+    char*  buf;
+    size_t cap;
+    size_t len;
+};
+
+static ssize_t capture_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct capture* c       = (struct capture*)user;
+    size_t          avail   = (c->cap > 0) ? c->cap - 1 - c->len : 0;
+    size_t          to_copy = (n < avail) ? n : avail;
+    if(to_copy > 0)
+    {
+        memcpy(c->buf + c->len, line, to_copy);
+        c->len         += to_copy;
+        c->buf[c->len]  = '\0';
+    }
+    return (ssize_t)n;
+}
+
+static int evaluated;
+
+static int bump(void)
+{
+    return ++evaluated;
+}
+
+static void test_fast_path_skips_arguments(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 1024};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_WARN);
+    assert_int_equal(emlog__active_level, EML_LEVEL_WARN);
+
+    evaluated = 0;
+    EML_DBG("UT", "FAST_DBG %d", bump());
+    EML_INFO("UT", "FAST_INF %d", bump());
+    assert_int_equal(evaluated, 0);
+    EML_WARN("UT", "FAST_WRN %d", bump());
+    assert_int_equal(evaluated, 1);
+    assert_null(strstr(c.buf, "FAST_DBG"));
+    assert_non_null(strstr(c.buf, "FAST_WRN 1"));
+
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+static void test_fast_path_tracks_component_overrides(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 1024};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_WARN);
+
+    /* a more verbose override lowers the inline gate ... */
+    assert_int_equal(emlog_set_component_level("fastnet", EML_LEVEL_DBG), EML_OK);
+    assert_int_equal(emlog__active_level, EML_LEVEL_DBG);
+
+    evaluated = 0;
+    EML_DBG("fastnet", "NET_DBG %d", bump());
+    EML_DBG("fastdisk", "DISK_DBG %d", bump());
+    /* ... both calls pass the gate, the precise filter drops the second */
+    assert_int_equal(evaluated, 2);
+    assert_non_null(strstr(c.buf, "NET_DBG 1"));
+    assert_null(strstr(c.buf, "DISK_DBG"));
+
+    /* clearing the override restores the global gate */
+    assert_int_equal(emlog_set_component_level("fastnet", -1), EML_OK);
+    assert_int_equal(emlog__active_level, EML_LEVEL_WARN);
+
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+void emlog_fast_path_skips_arguments(void** state)
+{
+    test_fast_path_skips_arguments(state);
+}
+
+void emlog_fast_path_component_overrides(void** state)
+{
+    test_fast_path_tracks_component_overrides(state);
+}
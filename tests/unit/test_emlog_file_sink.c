@@ -0,0 +1,143 @@
+/* tests/unit/test_emlog_file_sink.c
+ * Covers the rotating file sink (size, explicit and interval rotation).
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static int count_lines(const char* path)
+{
+    FILE* f = fopen(path, "r");
+    if(!f) return -1;
+    int n = 0;
+    int c;
+    while((c = fgetc(f)) != EOF)
+        n += (c == '\n');
+    fclose(f);
+    return n;
+}
+
+static int wait_exists(const char* path, int want)
+{
+    for(int i = 0; i < 300; ++i)
+    {
+        if((access(path, F_OK) == 0) == want) return 1;
+        struct timespec pause = {0, 10 * 1000000L};
+        nanosleep(&pause, NULL);
+    }
+    return 0;
+}
+
+static void rotated_name(char* out, size_t n, const char* path, int i)
+{
+    snprintf(out, n, "%s.%d", path, i);
+}
+
+static void test_file_sink_size_rotation(void** state)
+{
+    (void)state;
+    char dir[] = "/tmp/emlog_sink_XXXXXX";
+    assert_non_null(mkdtemp(dir));
+    char path[256], r1[272], r2[272], r3[272];
+    snprintf(path, sizeof path, "%s/app.log", dir);
+    rotated_name(r1, sizeof r1, path, 1);
+    rotated_name(r2, sizeof r2, path, 2);
+    rotated_name(r3, sizeof r3, path, 3);
+
+    eml_file_sink_t*    sink = NULL;
+    eml_file_sink_cfg_t bad  = {0};
+    assert_int_equal(emlog_file_sink_open(&bad, &sink), EML_BAD_INPUT);
+
+    eml_file_sink_cfg_t cfg = {.path = path, .max_bytes = 200, .keep = 2};
+    assert_int_equal(emlog_file_sink_open(&cfg, &sink), EML_OK);
+    emlog_set_writer(emlog_file_sink_write, sink);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    /* ~40 bytes per line: the 5th line crosses 200 bytes */
+    for(int i = 0; i < 8; ++i)
+        EML_INFO("sink", "line %02d of the first file......", i);
+    assert_true(wait_exists(r1, 1));
+    EML_INFO("sink", "after rotation");
+    /* nothing is lost across the descriptor swap */
+    int total = count_lines(path) + count_lines(r1);
+    if(access(r2, F_OK) == 0) total += count_lines(r2);
+    assert_int_equal(total, 9);
+
+    /* retention: never more than keep rotated files */
+    for(int round = 0; round < 3; ++round)
+    {
+        emlog_file_sink_rotate(sink);
+        struct timespec pause = {0, 30 * 1000000L};
+        nanosleep(&pause, NULL);
+        EML_INFO("sink", "round %d", round);
+    }
+    assert_true(wait_exists(r2, 1));
+    assert_int_equal(access(r3, F_OK), -1);
+
+    emlog_set_writer(NULL, NULL);
+    emlog_file_sink_close(sink);
+    unlink(path);
+    unlink(r1);
+    unlink(r2);
+    rmdir(dir);
+}
+
+static void test_file_sink_interval_no_keep(void** state)
+{
+    (void)state;
+    char dir[] = "/tmp/emlog_sink_XXXXXX";
+    assert_non_null(mkdtemp(dir));
+    char path[256], r1[272];
+    snprintf(path, sizeof path, "%s/app.log", dir);
+    rotated_name(r1, sizeof r1, path, 1);
+
+    eml_file_sink_t*    sink = NULL;
+    eml_file_sink_cfg_t cfg  = {.path = path, .interval_s = 1, .keep = 0};
+    assert_int_equal(emlog_file_sink_open(&cfg, &sink), EML_OK);
+    emlog_set_writer(emlog_file_sink_write, sink);
+    emlog_enable_timestamps(false);
+
+    EML_WARN("sink", "old content");
+    assert_int_equal(count_lines(path), 1);
+
+    /* after one interval the file restarts empty and nothing is kept */
+    int emptied = 0;
+    for(int i = 0; i < 300 && !emptied; ++i)
+    {
+        struct stat st;
+        emptied = stat(path, &st) == 0 && st.st_size == 0;
+        struct timespec pause = {0, 10 * 1000000L};
+        nanosleep(&pause, NULL);
+    }
+    assert_true(emptied);
+    assert_int_equal(access(r1, F_OK), -1);
+    EML_WARN("sink", "new content");
+    assert_int_equal(count_lines(path), 1);
+
+    emlog_set_writer(NULL, NULL);
+    emlog_file_sink_close(sink);
+    unlink(path);
+    rmdir(dir);
+}
+
+void emlog_file_sink_size_rotation(void** state)
+{
+    test_file_sink_size_rotation(state);
+}
+
+void emlog_file_sink_interval_no_keep(void** state)
+{
+    test_file_sink_interval_no_keep(state);
+}
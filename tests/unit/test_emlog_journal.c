@@ -0,0 +1,160 @@
+/* tests/unit/test_emlog_journal.c
+ * Covers the journald sink against a bound datagram socket standing in
+ * for /run/systemd/journal/socket.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static int bind_journal(const char* path)
+{
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    assert_true(fd >= 0);
+    struct sockaddr_un a = {.sun_family = AF_UNIX};
+    snprintf(a.sun_path, sizeof a.sun_path, "%s", path);
+    unlink(path);
+    assert_int_equal(bind(fd, (struct sockaddr*)&a, sizeof a), 0);
+    struct timeval tv = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    return fd;
+}
+
+/* Receive one datagram; a passed memfd is read back in its place. */
+static ssize_t recv_entry(int fd, char* buf, size_t cap, int* via_memfd)
+{
+    union
+    {
+        struct cmsghdr h;
+        char           buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    struct iovec  iov = {buf, cap - 1};
+    struct msghdr mh  = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = ctl.buf,
+                         .msg_controllen = sizeof ctl.buf};
+    ssize_t       n   = recvmsg(fd, &mh, 0);
+    *via_memfd        = 0;
+    struct cmsghdr* cm = n >= 0 ? CMSG_FIRSTHDR(&mh) : NULL;
+    if(cm && cm->cmsg_type == SCM_RIGHTS)
+    {
+        int mfd;
+        memcpy(&mfd, CMSG_DATA(cm), sizeof mfd);
+        n = pread(mfd, buf, cap - 1, 0);
+        close(mfd);
+        *via_memfd = 1;
+    }
+    if(n >= 0) buf[n] = '\0';
+    return n;
+}
+
+static void test_journal_fields(void** state)
+{
+    (void)state;
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_journal_%d.sock", (int)getpid());
+    int srv = bind_journal(path);
+
+    eml_journal_sink_cfg_t jc = {.socket_path = path, .identifier = "emlogtest"};
+    eml_journal_sink_t*    js;
+    assert_int_equal(emlog_journal_sink_open(&jc, &js), EML_OK);
+    eml_sink_cfg_t sc = {.record = emlog_journal_sink_record, .user = js};
+    int            id;
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    emlog_enable_timestamps(true);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    char buf[8192];
+    int  memfd;
+    EML_WARN("jrn", "hello %d", 7);
+    assert_true(recv_entry(srv, buf, sizeof buf, &memfd) > 0);
+    assert_int_equal(memfd, 0);
+    /* the message carries no emlog header: journald stamps its own */
+    assert_non_null(strstr(buf, "MESSAGE=hello 7\n"));
+    assert_non_null(strstr(buf, "PRIORITY=4\n"));
+    assert_non_null(strstr(buf, "SYSLOG_IDENTIFIER=emlogtest\n"));
+    assert_non_null(strstr(buf, "EMLOG_COMPONENT=jrn\n"));
+    assert_non_null(strstr(buf, "TID="));
+#ifdef EMLOG_HAVE_CALLSITES
+    assert_non_null(strstr(buf, "test_emlog_journal.c\n"));
+    assert_non_null(strstr(buf, "CODE_FUNC=test_journal_fields\n"));
+#endif
+
+    /* a newline in the value switches to the length-prefixed form */
+    emlog_log(EML_LEVEL_ERROR, "jrn", "a\nb");
+    ssize_t n = recv_entry(srv, buf, sizeof buf, &memfd);
+    static const char bin[] = "MESSAGE\n\3\0\0\0\0\0\0\0a\nb\n";
+    assert_true(n >= (ssize_t)sizeof bin - 1);
+    assert_memory_equal(buf, bin, sizeof bin - 1);
+    assert_non_null(strstr(buf + sizeof bin - 1, "PRIORITY=3\n"));
+    assert_null(strstr(buf + sizeof bin - 1, "CODE_FILE"));
+
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+    emlog_journal_sink_close(js);
+    emlog_enable_timestamps(false);
+    close(srv);
+    unlink(path);
+}
+
+static void test_journal_memfd_fallback(void** state)
+{
+    (void)state;
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_journal_m%d.sock", (int)getpid());
+    int srv = bind_journal(path);
+
+    eml_journal_sink_cfg_t jc = {.socket_path = path, .identifier = "big", .max_datagram = 64};
+    eml_journal_sink_t*    js;
+    assert_int_equal(emlog_journal_sink_open(&jc, &js), EML_OK);
+    eml_sink_cfg_t sc = {.record = emlog_journal_sink_record, .user = js};
+    int            id;
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    char big[1024];
+    memset(big, 'x', sizeof big - 1);
+    big[sizeof big - 1] = '\0';
+    EML_INFO("jrn", "%s", big);
+
+    char buf[8192];
+    int  memfd;
+    assert_true(recv_entry(srv, buf, sizeof buf, &memfd) > (ssize_t)sizeof big);
+#if defined(__linux__)
+    assert_int_equal(memfd, 1);
+#endif
+    assert_non_null(strstr(buf, "MESSAGE=xxxx"));
+    assert_non_null(strstr(buf, "SYSLOG_IDENTIFIER=big\n"));
+
+    eml_sink_stats_t st;
+    assert_int_equal(emlog_sink_stats(id, &st), EML_OK);
+    assert_int_equal(st.written, 1);
+    assert_int_equal(st.errors, 0);
+
+    /* an unreachable journal is a sink error, not a logging failure */
+    close(srv);
+    unlink(path);
+    EML_INFO("jrn", "nobody listening");
+    assert_int_equal(emlog_sink_stats(id, &st), EML_OK);
+    assert_int_equal(st.errors, 1);
+
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+    emlog_journal_sink_close(js);
+}
+
+void emlog_journal_fields(void** state)
+{
+    test_journal_fields(state);
+}
+
+void emlog_journal_memfd_fallback(void** state)
+{
+    test_journal_memfd_fallback(state);
+}
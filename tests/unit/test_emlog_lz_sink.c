@@ -0,0 +1,169 @@
+/* tests/unit/test_emlog_lz_sink.c
+ * Covers the built-in block compressor and the compressing file sink.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static void roundtrip(const unsigned char* src, size_t n)
+{
+    size_t         cap = emlog_lz_bound(n);
+    unsigned char* c   = malloc(cap);
+    unsigned char* d   = malloc(n + 1);
+    assert_non_null(c);
+    assert_non_null(d);
+    size_t clen = emlog_lz_compress(src, n, c, cap);
+    assert_true(clen > 0);
+    assert_int_equal(emlog_lz_decompress(c, clen, d, n), (ssize_t)n);
+    assert_memory_equal(d, src, n);
+    free(c);
+    free(d);
+}
+
+static void test_lz_roundtrip(void** state)
+{
+    (void)state;
+    static unsigned char buf[70000];
+
+    /* random bytes do not compress but must survive */
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    for(size_t i = 0; i < sizeof buf; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        buf[i] = (unsigned char)x;
+    }
+    roundtrip(buf, sizeof buf);
+    for(size_t n = 0; n < 40; ++n)
+        roundtrip(buf, n);
+
+    /* log-like text, long runs and overlapping matches */
+    size_t off = 0;
+    for(int i = 0; off + 80 < sizeof buf; ++i)
+        off += (size_t)snprintf((char*)buf + off, 80, "INF [1234] [net] request %d done\n", i);
+    roundtrip(buf, off);
+    size_t         cap = emlog_lz_bound(off);
+    unsigned char* c   = malloc(cap);
+    assert_true(emlog_lz_compress(buf, off, c, cap) < off / 4);
+    free(c);
+    memset(buf, 'a', sizeof buf);
+    roundtrip(buf, sizeof buf);
+
+    /* corrupt input is rejected, never overruns */
+    unsigned char bad[] = {0x1f, 'x', 0x40, 0x00};
+    unsigned char out[64];
+    assert_int_equal(emlog_lz_decompress(bad, sizeof bad, out, sizeof out), -1);
+    unsigned char big[] = {0xf0, 0xff, 0xff};
+    assert_int_equal(emlog_lz_decompress(big, sizeof big, out, sizeof out), -1);
+    for(size_t i = 0; i < 1000; ++i)
+        buf[i] = (unsigned char)(i * 2654435761u >> 13);
+    assert_int_equal(emlog_lz_compress(buf, 1000, out, sizeof out), 0); /* too small a dst */
+}
+
+static uint32_t get32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static void test_lz_sink_frames(void** state)
+{
+    (void)state;
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_lz_%d.emlz", (int)getpid());
+    unlink(path);
+
+    eml_lz_sink_cfg_t bad = {.path = path, .block_bytes = 16};
+    eml_lz_sink_t*    sink;
+    assert_int_equal(emlog_lz_sink_open(&bad, &sink), EML_BAD_INPUT);
+
+    eml_lz_sink_cfg_t cfg = {.path = path, .block_bytes = 4096, .blocks = 64};
+    assert_int_equal(emlog_lz_sink_open(&cfg, &sink), EML_OK);
+    emlog_set_writer(emlog_lz_sink_write, sink);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    for(int i = 0; i < 2000; ++i)
+        EML_INFO("lz", "request %d finished with status %d", i, i % 7);
+    emlog_set_writer(NULL, NULL);
+    uint64_t dropped = emlog_lz_sink_dropped(sink);
+    emlog_lz_sink_close(sink);
+
+    FILE* f = fopen(path, "rb");
+    assert_non_null(f);
+    fseek(f, 0, SEEK_END);
+    long fsz = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char* file = malloc((size_t)fsz);
+    assert_int_equal(fread(file, 1, (size_t)fsz, f), (size_t)fsz);
+    fclose(f);
+
+    /* walk the frames and rebuild the text */
+    char*  text   = calloc(1, 1u << 20);
+    size_t tlen   = 0;
+    long   off    = 0;
+    int    frames = 0;
+    while(off < fsz)
+    {
+        assert_true(fsz - off >= (long)EMLOG_LZ_HEADER);
+        const unsigned char* h = file + off;
+        assert_int_equal(get32(h), EMLOG_LZ_MAGIC);
+        uint32_t rlen = get32(h + 8);
+        uint32_t dlen = get32(h + 12);
+        assert_true(rlen <= 4096);
+        assert_true(off + (long)EMLOG_LZ_HEADER + (long)dlen <= fsz);
+        if(get32(h + 4) & EMLOG_LZ_STORED)
+            memcpy(text + tlen, h + EMLOG_LZ_HEADER, dlen);
+        else
+            assert_int_equal(emlog_lz_decompress(h + EMLOG_LZ_HEADER, dlen, text + tlen, rlen),
+                             (ssize_t)rlen);
+        assert_int_equal(emlog_lz_check(text + tlen, rlen), get32(h + 16));
+        tlen += rlen;
+        off += (long)EMLOG_LZ_HEADER + (long)dlen;
+        ++frames;
+    }
+    assert_true(frames > 1);
+    assert_true((size_t)fsz * 3 < tlen);
+
+    /* every line that was not dropped is there, whole and in order */
+    int   next  = 0;
+    char* line  = text;
+    int   lines = 0;
+    while(line < text + tlen)
+    {
+        char* nl = memchr(line, '\n', (size_t)(text + tlen - line));
+        assert_non_null(nl);
+        int i = -1;
+        assert_int_equal(sscanf(line, "INF [%*u] [lz] request %d", &i), 1);
+        assert_true(i >= next);
+        next = i + 1;
+        ++lines;
+        line = nl + 1;
+    }
+    assert_int_equal((uint64_t)lines + dropped, 2000);
+    assert_true(lines > 0);
+
+    free(text);
+    free(file);
+    unlink(path);
+}
+
+void emlog_lz_roundtrip(void** state)
+{
+    test_lz_roundtrip(state);
+}
+
+void emlog_lz_sink_frames(void** state)
+{
+    test_lz_sink_frames(state);
+}
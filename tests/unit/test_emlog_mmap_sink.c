@@ -0,0 +1,134 @@
+/* tests/unit/test_emlog_mmap_sink.c
+ * Covers the memory-mapped append-only sink and its record format.
+ */
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+#define MM_THREADS 4
+#define MM_LINES   400
+
+struct scan
+{
+    int records;  /**< Committed data records */
+    int pads;     /**< Committed PAD records */
+    int reserved; /**< Records without the COMMITTED bit */
+    int bad;      /**< Payloads not ending in '\n' */
+};
+
+static struct scan scan_file(const char* path)
+{
+    struct scan r = {0};
+    FILE*       f = fopen(path, "rb");
+    assert_non_null(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    char* buf = malloc((size_t)size + 1);
+    assert_non_null(buf);
+    assert_int_equal(fread(buf, 1, (size_t)size, f), (size_t)size);
+    fclose(f);
+
+    long off = 0;
+    while(off + 4 <= size)
+    {
+        uint32_t h;
+        memcpy(&h, buf + off, sizeof h);
+        if(h == 0) break;
+        uint32_t len = h & EMLOG_MMAP_LEN_MASK;
+        if(!(h & EMLOG_MMAP_COMMITTED))
+            ++r.reserved;
+        else if(h & EMLOG_MMAP_PAD)
+            ++r.pads;
+        else
+        {
+            ++r.records;
+            r.bad += (len == 0 || buf[off + 4 + len - 1] != '\n');
+        }
+        off += (long)((4u + len + 7u) & ~7u);
+    }
+    free(buf);
+    return r;
+}
+
+static void* mm_writer(void* arg)
+{
+    eml_mmap_sink_t* sink = (eml_mmap_sink_t*)arg;
+    char             line[200];
+    for(int i = 0; i < MM_LINES; ++i)
+    {
+        int n = snprintf(line, sizeof line, "INF [%d] [mm] line %d %.*s", i % 7, i, i % 120,
+                         "................................................................"
+                         "................................................................");
+        emlog_mmap_sink_write(EML_LEVEL_INFO, line, (size_t)n, sink);
+    }
+    return NULL;
+}
+
+static void test_mmap_sink_records(void** state)
+{
+    (void)state;
+    char dir[] = "/tmp/emlog_mm_XXXXXX";
+    assert_non_null(mkdtemp(dir));
+    char path[256];
+    snprintf(path, sizeof path, "%s/app.mlog", dir);
+
+    eml_mmap_sink_t*    sink = NULL;
+    eml_mmap_sink_cfg_t bad  = {0};
+    assert_int_equal(emlog_mmap_sink_open(&bad, &sink), EML_BAD_INPUT);
+
+    /* one-page segments force many boundary pads and helper map-ahead rounds */
+    eml_mmap_sink_cfg_t cfg = {.path = path, .segment_bytes = 4096, .sync_ms = 5};
+    assert_int_equal(emlog_mmap_sink_open(&cfg, &sink), EML_OK);
+
+    pthread_t th[MM_THREADS];
+    for(int i = 0; i < MM_THREADS; ++i)
+        assert_int_equal(pthread_create(&th[i], NULL, mm_writer, sink), 0);
+    for(int i = 0; i < MM_THREADS; ++i)
+        pthread_join(th[i], NULL);
+
+    /* through the logger as an ordinary writer */
+    emlog_set_writer(emlog_mmap_sink_write, sink);
+    emlog_enable_timestamps(false);
+    EML_WARN("mm", "via emlog");
+    emlog_set_writer(NULL, NULL);
+
+    /* a record larger than a segment is dropped, not split */
+    static char huge[5000];
+    memset(huge, 'h', sizeof huge);
+    assert_true(emlog_mmap_sink_write(EML_LEVEL_INFO, huge, sizeof huge, sink) < 0);
+    assert_int_equal(emlog_mmap_sink_dropped(sink), 1);
+    emlog_mmap_sink_close(sink);
+
+    struct scan r = scan_file(path);
+    assert_int_equal(r.records, MM_THREADS * MM_LINES + 1);
+    assert_int_equal(r.reserved, 0);
+    assert_int_equal(r.bad, 0);
+    assert_true(r.pads > 0);
+
+    /* reopening appends after the last record */
+    assert_int_equal(emlog_mmap_sink_open(&cfg, &sink), EML_OK);
+    assert_int_equal(emlog_mmap_sink_write(EML_LEVEL_INFO, "again", 5, sink), 6);
+    emlog_mmap_sink_close(sink);
+    r = scan_file(path);
+    assert_int_equal(r.records, MM_THREADS * MM_LINES + 2);
+
+    unlink(path);
+    rmdir(dir);
+}
+
+void emlog_mmap_sink_records(void** state)
+{
+    test_mmap_sink_records(state);
+}
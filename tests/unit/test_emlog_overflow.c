@@ -0,0 +1,355 @@
+/* tests/unit/test_emlog_overflow.c
+ * Covers short-write continuation and the overflow buffer of the default
+ * writer on a non-blocking pipe, with each drop policy.
+ */
+
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+#define LINES 400
+
+/* non-blocking pipe with the smallest capacity the kernel allows */
+static void small_pipe(int p[2])
+{
+    assert_int_equal(pipe(p), 0);
+#if defined(F_SETPIPE_SZ)
+    (void)fcntl(p[1], F_SETPIPE_SZ, 4096);
+#endif
+    assert_int_equal(fcntl(p[1], F_SETFL, fcntl(p[1], F_GETFL) | O_NONBLOCK), 0);
+}
+
+/* read until @p want newlines arrived or nothing came for a second */
+static size_t collect(int fd, char* buf, size_t cap, int want)
+{
+    size_t len   = 0;
+    int    lines = 0;
+    while(lines < want && len < cap)
+    {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        if(poll(&pfd, 1, 1000) != 1) break;
+        ssize_t n = read(fd, buf + len, cap - len);
+        if(n <= 0) break;
+        for(ssize_t i = 0; i < n; ++i)
+            lines += buf[len + (size_t)i] == '\n';
+        len += (size_t)n;
+    }
+    return len;
+}
+
+/* every line whole and increasing; returns the count, first and last */
+static int check_lines(char* buf, size_t len, int* first, int* last)
+{
+    int    count = 0;
+    int    prev  = -1;
+    size_t off   = 0;
+    while(off < len)
+    {
+        char* nl = memchr(buf + off, '\n', len - off);
+        assert_non_null(nl);
+        *nl   = '\0';
+        int i = -1;
+        assert_int_equal(sscanf(buf + off, "INF [%*u] [ovf] line %d", &i), 1);
+        assert_true(i > prev);
+        if(!count) *first = i;
+        prev = i;
+        ++count;
+        off = (size_t)(nl - buf) + 1;
+    }
+    *last = prev;
+    return count;
+}
+
+static void test_overflow_parks_and_drains(void** state)
+{
+    (void)state;
+    int p[2];
+    small_pipe(p);
+    eml_overflow_stats_t s0, s1;
+    emlog_overflow_stats(&s0);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, p[1]);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    /* far more than the pipe holds, well within the 64 KiB default */
+    for(int i = 0; i < LINES; ++i)
+        EML_INFO("ovf", "line %d of the stalled collector", i);
+    emlog_overflow_stats(&s1);
+    assert_true(s1.deferred > s0.deferred);
+    assert_int_equal(s1.dropped, s0.dropped);
+    assert_true(s1.pending > 0);
+
+    size_t cap = 1u << 20;
+    char*  buf = malloc(cap);
+    assert_non_null(buf);
+    size_t len = collect(p[0], buf, cap, LINES);
+    int    first, last;
+    assert_int_equal(check_lines(buf, len, &first, &last), LINES);
+    assert_int_equal(first, 0);
+    assert_int_equal(last, LINES - 1);
+    emlog_overflow_stats(&s1);
+    assert_int_equal(s1.pending, 0);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    close(p[0]);
+    close(p[1]);
+
+    /* lines are capped at one pipe write, but TCP with small buffers
+     * takes them in pieces: each still arrives whole */
+    int                l = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    socklen_t          alen = sizeof a;
+    int                small = 4096;
+    assert_true(l >= 0);
+    (void)setsockopt(l, SOL_SOCKET, SO_RCVBUF, &small, sizeof small);
+    assert_int_equal(bind(l, (struct sockaddr*)&a, sizeof a), 0);
+    assert_int_equal(listen(l, 1), 0);
+    assert_int_equal(getsockname(l, (struct sockaddr*)&a, &alen), 0);
+    int sv[2];
+    sv[0] = socket(AF_INET, SOCK_STREAM, 0);
+    (void)setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof small);
+    assert_int_equal(connect(sv[0], (struct sockaddr*)&a, sizeof a), 0);
+    sv[1] = accept(l, NULL, NULL);
+    assert_true(sv[1] >= 0);
+    close(l);
+    assert_int_equal(fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK), 0);
+    char big[3001];
+    memset(big, 'x', sizeof big - 1);
+    big[sizeof big - 1] = '\0';
+    emlog_set_fd(EML_LEVEL_MASK_ALL, sv[0]);
+    for(int i = 0; i < 16; ++i)
+        EML_INFO("ovf", "line %d %s", i, big);
+    emlog_overflow_stats(&s1);
+    assert_true(s1.partial > s0.partial);
+    assert_int_equal(s1.dropped, s0.dropped);
+
+    len = collect(sv[1], buf, cap, 16);
+    assert_int_equal(check_lines(buf, len, &first, &last), 16);
+    assert_int_equal(last, 15);
+    for(char* l = buf; l < buf + len; l += strlen(l) + 1)
+        assert_int_equal(strlen(strchr(l, 'x')), sizeof big - 1);
+    free(buf);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+/* log LINES lines into a stalled pipe under @p policy, then read them back */
+static void run_policy(eml_overflow_policy_t policy, int* count, int* first, int* last,
+                       eml_overflow_stats_t* delta)
+{
+    int p[2];
+    small_pipe(p);
+    eml_overflow_stats_t s0, s1;
+    emlog_overflow_stats(&s0);
+    assert_int_equal(emlog_set_overflow(2048, policy, 0), EML_OK);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, p[1]);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    for(int i = 0; i < LINES; ++i)
+        EML_INFO("ovf", "line %d of the stalled collector", i);
+    emlog_overflow_stats(&s1);
+
+    size_t cap = 1u << 16;
+    char*  buf = malloc(cap);
+    assert_non_null(buf);
+    int    want = LINES - (int)(s1.dropped - s0.dropped);
+    size_t len  = collect(p[0], buf, cap, want);
+    *count      = check_lines(buf, len, first, last);
+    free(buf);
+
+    emlog_overflow_stats(&s1);
+    delta->dropped  = s1.dropped - s0.dropped;
+    delta->deferred = s1.deferred - s0.deferred;
+    delta->pending  = s1.pending;
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    assert_int_equal(emlog_set_overflow(64u * 1024u, EML_OVERFLOW_DROP_NEWEST, 0), EML_OK);
+    close(p[0]);
+    close(p[1]);
+}
+
+struct slow_reader
+{
+    int    fd;
+    char*  buf;
+    size_t cap;
+    size_t len;
+};
+
+/* start reading only after the logger has had time to block */
+static void* slow_reader_main(void* arg)
+{
+    struct slow_reader* r = arg;
+    usleep(50 * 1000);
+    for(;;)
+    {
+        ssize_t n = read(r->fd, r->buf + r->len, r->cap - r->len);
+        if(n <= 0) break;
+        r->len += (size_t)n;
+    }
+    return NULL;
+}
+
+static void test_overflow_policies(void** state)
+{
+    (void)state;
+    assert_int_equal(emlog_set_overflow(0, (eml_overflow_policy_t)7, 0), EML_BAD_INPUT);
+
+    int                  count, first, last;
+    eml_overflow_stats_t d;
+    run_policy(EML_OVERFLOW_DROP_NEWEST, &count, &first, &last, &d);
+    assert_true(d.dropped > 0);
+    assert_int_equal(count, LINES - (int)d.dropped);
+    assert_int_equal(first, 0);
+    assert_true(last < LINES - 1);
+    assert_int_equal(d.pending, 0);
+
+    run_policy(EML_OVERFLOW_DROP_OLDEST, &count, &first, &last, &d);
+    assert_true(d.dropped > 0);
+    assert_int_equal(count, LINES - (int)d.dropped);
+    assert_int_equal(first, 0); /* already in the pipe before the buffer filled */
+    assert_int_equal(last, LINES - 1);
+
+    /* block: the logger waits for the reader and loses nothing */
+    int p[2];
+    small_pipe(p);
+    struct slow_reader r = {.fd = p[0], .cap = 1u << 16};
+    r.buf                = malloc(r.cap);
+    assert_non_null(r.buf);
+    eml_overflow_stats_t s0, s1;
+    emlog_overflow_stats(&s0);
+    assert_int_equal(emlog_set_overflow(2048, EML_OVERFLOW_BLOCK, 5000), EML_OK);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, p[1]);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    pthread_t th;
+    assert_int_equal(pthread_create(&th, NULL, slow_reader_main, &r), 0);
+    for(int i = 0; i < LINES; ++i)
+        EML_INFO("ovf", "line %d of the stalled collector", i);
+    emlog_overflow_flush();
+    emlog_overflow_stats(&s1);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    close(p[1]);
+    pthread_join(th, NULL);
+    close(p[0]);
+    assert_true(s1.blocked > s0.blocked);
+    assert_int_equal(s1.dropped, s0.dropped);
+    assert_int_equal(check_lines(r.buf, r.len, &first, &last), LINES);
+    free(r.buf);
+    assert_int_equal(emlog_set_overflow(64u * 1024u, EML_OVERFLOW_DROP_NEWEST, 0), EML_OK);
+}
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static atomic_int stalled_done;
+
+/* fill the stalled descriptor until a line blocks, then two more */
+static void* stalled_logger_main(void* arg)
+{
+    (void)arg;
+    eml_overflow_stats_t s0, s;
+    emlog_overflow_stats(&s0);
+    int i = 0;
+    do
+    {
+        EML_WARN("ovf", "line %d of the stalled collector", i++);
+        emlog_overflow_stats(&s);
+    } while(s.blocked == s0.blocked && i < 100000);
+    EML_WARN("ovf", "line %d of the stalled collector", i++);
+    EML_WARN("ovf", "line %d of the stalled collector", i++);
+    atomic_store(&stalled_done, 1);
+    return NULL;
+}
+
+static void test_overflow_block_is_bounded(void** state)
+{
+    (void)state;
+    int stalled[2];
+    int other[2];
+    small_pipe(stalled);
+    assert_int_equal(pipe(other), 0);
+    eml_overflow_stats_t s0, s1;
+    emlog_overflow_stats(&s0);
+    assert_int_equal(emlog_set_overflow(1024, EML_OVERFLOW_BLOCK, 200), EML_OK);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_fd(EML_LEVEL_MASK_FROM(EML_LEVEL_WARN), stalled[1]);
+    emlog_set_fd(EML_LEVEL_MASK(EML_LEVEL_INFO), other[1]);
+
+    atomic_store(&stalled_done, 0);
+    uint64_t  t0 = now_ms();
+    pthread_t th;
+    assert_int_equal(pthread_create(&th, NULL, stalled_logger_main, NULL), 0);
+    do
+        emlog_overflow_stats(&s1);
+    while(s1.blocked == s0.blocked && !atomic_load(&stalled_done));
+
+    /* the blocked writer holds no lock: other descriptors go right out */
+    for(int i = 0; i < 20; ++i)
+    {
+        uint64_t t = now_ms();
+        EML_INFO("ovf", "unrelated %d", i);
+        emlog_overflow_stats(&s1);
+        assert_true(now_ms() - t < 100u);
+    }
+    pthread_join(th, NULL);
+    uint64_t took = now_ms() - t0;
+    emlog_overflow_stats(&s1);
+    assert_true(s1.blocked > s0.blocked);
+    assert_true(s1.dropped > s0.dropped);
+    assert_true(took >= 200u && took < 3000u);
+
+    char    buf[4096];
+    ssize_t got = read(other[0], buf, sizeof buf - 1);
+    assert_true(got > 0);
+    buf[got] = '\0';
+    assert_non_null(strstr(buf, "unrelated 19\n"));
+
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    emlog_overflow_flush();
+    assert_int_equal(emlog_set_overflow(64u * 1024u, EML_OVERFLOW_DROP_NEWEST, 0), EML_OK);
+    close(stalled[0]);
+    close(stalled[1]);
+    close(other[0]);
+    close(other[1]);
+}
+
+void emlog_overflow_parks_and_drains(void** state)
+{
+    test_overflow_parks_and_drains(state);
+}
+
+void emlog_overflow_policies(void** state)
+{
+    test_overflow_policies(state);
+}
+
+void emlog_overflow_block_is_bounded(void** state)
+{
+    test_overflow_block_is_bounded(state);
+}
@@ -0,0 +1,242 @@
+/* tests/unit/test_emlog_pipe_splice.c
+ * Covers the vmsplice() output path for pipes and its fallbacks.
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct reader
+{
+    int    fd;
+    char*  buf;
+    size_t cap;
+    size_t len;
+};
+
+/* drain the pipe until EOF so the logger never blocks on it */
+static void* reader_main(void* arg)
+{
+    struct reader* r = arg;
+    for(;;)
+    {
+        ssize_t n = read(r->fd, r->buf + r->len, r->cap - r->len);
+        if(n <= 0) break;
+        r->len += (size_t)n;
+    }
+    return NULL;
+}
+
+static void test_pipe_splice_stream(void** state)
+{
+    (void)state;
+    int p[2];
+    assert_int_equal(pipe(p), 0);
+    struct reader r = {.fd = p[0], .cap = 8u << 20};
+    r.buf           = malloc(r.cap);
+    assert_non_null(r.buf);
+    pthread_t th;
+    assert_int_equal(pthread_create(&th, NULL, reader_main, &r), 0);
+
+    uint64_t s0, c0;
+    emlog_pipe_splice_stats(&s0, &c0);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, p[1]);
+#if defined(__linux__)
+    assert_int_equal(emlog_set_pipe_splice(p[1], 1000), EML_OK);
+#endif
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    for(int i = 0; i < 20000; ++i)
+        EML_INFO("sp", "line %d of the batch", i);
+    EML_ERROR("sp", "done");
+
+    uint64_t s1, c1;
+    emlog_pipe_splice_stats(&s1, &c1);
+#if defined(__linux__)
+    assert_int_equal(emlog_set_pipe_splice(-1, 0), EML_OK);
+#endif
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    close(p[1]);
+    pthread_join(th, NULL);
+    close(p[0]);
+
+#if defined(__linux__)
+    /* most bytes went through vmsplice, the tail through write */
+    assert_true(s1 - s0 > (uint64_t)r.len / 2);
+    assert_true(c1 > c0);
+    assert_int_equal((s1 - s0) + (c1 - c0), r.len);
+#endif
+
+    /* every line arrived whole and in order */
+    int    next = 0;
+    size_t off  = 0;
+    while(off < r.len)
+    {
+        char* nl = memchr(r.buf + off, '\n', r.len - off);
+        assert_non_null(nl);
+        *nl = '\0';
+        if(next < 20000)
+        {
+            int i = -1;
+            assert_int_equal(sscanf(r.buf + off, "INF [%*u] [sp] line %d of the batch", &i), 1);
+            assert_int_equal(i, next);
+        }
+        else
+        {
+            assert_non_null(strstr(r.buf + off, "[sp] done"));
+        }
+        ++next;
+        off = (size_t)(nl - r.buf) + 1;
+    }
+    assert_int_equal(next, 20001);
+    free(r.buf);
+}
+
+static void test_pipe_splice_fallback(void** state)
+{
+    (void)state;
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_splice_%d.log", (int)getpid());
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0600);
+    assert_true(fd >= 0);
+
+    /* not a pipe: refused, lines keep going through writev() */
+#if defined(__linux__)
+    assert_int_equal(emlog_set_pipe_splice(fd, 0), EML_BAD_INPUT);
+#else
+    assert_int_equal(emlog_set_pipe_splice(fd, 0), EML_NOT_FOUND);
+#endif
+    emlog_set_fd(EML_LEVEL_MASK_ALL, fd);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    EML_INFO("sp", "plain");
+    char    buf[256];
+    ssize_t n = pread(fd, buf, sizeof buf - 1, 0);
+    assert_true(n > 0);
+    buf[n] = '\0';
+    assert_non_null(strstr(buf, "[sp] plain\n"));
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    close(fd);
+    unlink(path);
+
+#if defined(__linux__)
+    /* a partial buffer reaches the reader once flush_ms has passed */
+    int p[2];
+    assert_int_equal(pipe(p), 0);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, p[1]);
+    assert_int_equal(emlog_set_pipe_splice(p[1], 20), EML_OK);
+    EML_INFO("sp", "quiet");
+    struct pollfd pfd = {.fd = p[0], .events = POLLIN};
+    assert_int_equal(poll(&pfd, 1, 0), 0);
+    assert_int_equal(poll(&pfd, 1, 2000), 1);
+    n = read(p[0], buf, sizeof buf - 1);
+    assert_true(n > 0);
+    buf[n] = '\0';
+    assert_non_null(strstr(buf, "[sp] quiet\n"));
+
+    assert_int_equal(emlog_set_pipe_splice(-1, 0), EML_OK);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    close(p[0]);
+    close(p[1]);
+#endif
+}
+
+static void test_pipe_splice_stall(void** state)
+{
+    (void)state;
+#if defined(__linux__)
+    int p[2];
+    assert_int_equal(pipe(p), 0);
+    assert_int_equal(fcntl(p[1], F_SETFL, fcntl(p[1], F_GETFL) | O_NONBLOCK), 0);
+    eml_overflow_stats_t s0, s1;
+    emlog_overflow_stats(&s0);
+    assert_int_equal(emlog_set_overflow(16u << 10, EML_OVERFLOW_DROP_NEWEST, 0), EML_OK);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, p[1]);
+    assert_int_equal(emlog_set_pipe_splice(p[1], 1000), EML_OK);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    /* nobody reads: the logger waits a bounded time, then parks and drops */
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(int i = 0; i < 5000; ++i)
+        EML_INFO("st", "line %d of the stalled pipe", i);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    assert_true(t1.tv_sec - t0.tv_sec < 2);
+    emlog_overflow_stats(&s1);
+    assert_true(s1.deferred > s0.deferred);
+    assert_true(s1.dropped > s0.dropped);
+
+    /* what did arrive is whole lines in order, parked ones included */
+    size_t cap = 1u << 20;
+    size_t len = 0;
+    char*  buf = malloc(cap);
+    assert_non_null(buf);
+    struct pollfd pfd = {.fd = p[0], .events = POLLIN};
+    while(len < cap && poll(&pfd, 1, 300) == 1)
+    {
+        ssize_t n = read(p[0], buf + len, cap - len);
+        if(n <= 0) break;
+        len += (size_t)n;
+    }
+    int    next  = 0;
+    int    lines = 0;
+    size_t off   = 0;
+    while(off < len)
+    {
+        char* nl = memchr(buf + off, '\n', len - off);
+        assert_non_null(nl);
+        *nl   = '\0';
+        int i = -1;
+        assert_int_equal(sscanf(buf + off, "INF [%*u] [st] line %d of the stalled pipe", &i), 1);
+        assert_true(i >= next);
+        next = i + 1;
+        ++lines;
+        off = (size_t)(nl - buf) + 1;
+    }
+    assert_true(lines > 0 && lines < 5000);
+
+    /* drained and empty: the next line is buffered for splicing again */
+    EML_INFO("st", "resumed");
+    assert_int_equal(poll(&pfd, 1, 0), 0);
+    assert_int_equal(emlog_set_pipe_splice(-1, 0), EML_OK);
+    ssize_t n = read(p[0], buf, cap);
+    assert_true(n > 0);
+    buf[n] = '\0';
+    assert_non_null(strstr(buf, "[st] resumed\n"));
+
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    assert_int_equal(emlog_set_overflow(64u << 10, EML_OVERFLOW_DROP_NEWEST, 0), EML_OK);
+    close(p[0]);
+    close(p[1]);
+    free(buf);
+#endif
+}
+
+void emlog_pipe_splice_stream(void** state)
+{
+    test_pipe_splice_stream(state);
+}
+
+void emlog_pipe_splice_fallback(void** state)
+{
+    test_pipe_splice_fallback(state);
+}
+
+void emlog_pipe_splice_stall(void** state)
+{
+    test_pipe_splice_stall(state);
+}
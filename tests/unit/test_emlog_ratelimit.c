@@ -0,0 +1,183 @@
+/* tests/unit/test_emlog_ratelimit.c
+ * Covers the per-call-site token bucket behind the EML_*_RL macros.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct capture
+{
+    char*  buf;
+    size_t cap;
+    size_t len;
+    int    lines;
+};
+
+static ssize_t capture_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct capture* c       = (struct capture*)user;
+    size_t          avail   = (c->cap > 0) ? c->cap - 1 - c->len : 0;
+    size_t          to_copy = (n < avail) ? n : avail;
+    if(to_copy > 0)
+    {
+        memcpy(c->buf + c->len, line, to_copy);
+        c->len         += to_copy;
+        c->buf[c->len]  = '\0';
+    }
+    ++c->lines;
+    return (ssize_t)n;
+}
+
+static int evaluated;
+
+static int bump(void)
+{
+    return ++evaluated;
+}
+
+static void flood(int n)
+{
+    for(int i = 0; i < n; ++i)
+        EML_WARN_RL("rl", 20, 3, "FLOOD %d", bump());
+}
+
+static void test_ratelimit_burst_and_summary(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 4096};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    /* a burst of 3 passes, the rest is dropped before argument evaluation */
+    evaluated = 0;
+    flood(50);
+    assert_int_equal(c.lines, 3);
+    assert_int_equal(evaluated, 3);
+    assert_null(strstr(c.buf, "suppressed"));
+
+    /* one interval (50 ms at 20/s) later a line passes with a summary,
+     * well before the bucket refills and the timer would claim it */
+    struct timespec pause = {0, 70 * 1000000L};
+    nanosleep(&pause, NULL);
+    c.len    = 0;
+    c.buf[0] = '\0';
+    c.lines  = 0;
+    flood(1);
+    assert_int_equal(c.lines, 2);
+    assert_non_null(strstr(c.buf, "47 messages suppressed by rate limit"));
+    assert_non_null(strstr(c.buf, "FLOOD 4"));
+
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+static void test_ratelimit_idle_summary(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 4096};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    /* the flood stops: no later line on this site claims the count */
+    for(int i = 0; i < 30; ++i)
+        EML_INFO_RL("rl", 10, 2, "IDLE %d", i);
+    struct timespec pause = {0, 500 * 1000000L};
+    nanosleep(&pause, NULL);
+
+    /* taking the writer lock orders the timer's write before the reads */
+    emlog_set_writer(NULL, NULL);
+    assert_int_equal(c.lines, 3);
+    assert_non_null(strstr(c.buf, "IDLE 1"));
+    assert_non_null(strstr(c.buf, "28 messages suppressed by rate limit"));
+    free(c.buf);
+}
+
+static void test_ratelimit_copies_component(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 4096};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    /* the timer's summary names the component the flood used, even
+     * after the caller's buffer was rewritten and freed */
+    char* comp = malloc(EMLOG_COMPONENT_NAME_MAX);
+    assert_non_null(comp);
+    strcpy(comp, "rl_heap");
+    for(int i = 0; i < 10; ++i)
+        EML_INFO_RL(comp, 10, 1, "HEAP %d", i);
+    memset(comp, 'Z', EMLOG_COMPONENT_NAME_MAX - 1);
+    comp[EMLOG_COMPONENT_NAME_MAX - 1] = '\0';
+    free(comp);
+    struct timespec pause = {0, 300 * 1000000L};
+    nanosleep(&pause, NULL);
+
+    emlog_set_writer(NULL, NULL);
+    assert_int_equal(c.lines, 2);
+    assert_non_null(strstr(c.buf, "[rl_heap] 9 messages suppressed by rate limit"));
+    assert_null(strstr(c.buf, "ZZZ"));
+    free(c.buf);
+}
+
+static void test_ratelimit_respects_level(void** state)
+{
+    (void)state;
+    struct capture c = {.cap = 1024};
+    c.buf            = calloc(1, c.cap);
+    assert_non_null(c.buf);
+    emlog_set_writer(capture_writer, &c);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    evaluated = 0;
+    for(int i = 0; i < 5; ++i)
+        EML_DBG_RL("rl", 1000, 1000, "RL_DBG %d", bump());
+    assert_int_equal(evaluated, 0);
+    assert_int_equal(c.lines, 0);
+
+    /* rate 0 disables limiting */
+    for(int i = 0; i < 5; ++i)
+        EML_INFO_RL("rl", 0, 0, "RL_INF %d", bump());
+    assert_int_equal(c.lines, 5);
+
+    emlog_set_writer(NULL, NULL);
+    free(c.buf);
+}
+
+void emlog_ratelimit_burst_and_summary(void** state)
+{
+    test_ratelimit_burst_and_summary(state);
+}
+
+void emlog_ratelimit_idle_summary(void** state)
+{
+    test_ratelimit_idle_summary(state);
+}
+
+void emlog_ratelimit_copies_component(void** state)
+{
+    test_ratelimit_copies_component(state);
+}
+
+void emlog_ratelimit_respects_level(void** state)
+{
+    test_ratelimit_respects_level(state);
+}
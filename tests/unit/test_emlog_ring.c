@@ -0,0 +1,211 @@
+/* tests/unit/test_emlog_ring.c
+ * Covers the flight recorder ring: below-level capture, wrap-around,
+ * shm extraction and the crash dump.
+ */
+
+#include <fcntl.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+/* dump the live ring through a temp file and return its text */
+static char* dump_text(size_t* n)
+{
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_ring_%d.txt", (int)getpid());
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0600);
+    assert_true(fd >= 0);
+    assert_int_equal(emlog_ring_dump(fd), EML_OK);
+    off_t sz = lseek(fd, 0, SEEK_END);
+    char* p  = malloc((size_t)sz + 1);
+    assert_non_null(p);
+    assert_int_equal(pread(fd, p, (size_t)sz, 0), sz);
+    close(fd);
+    unlink(path);
+    p[sz] = '\0';
+    *n    = (size_t)sz;
+    return p;
+}
+
+static void test_ring_records_and_wraps(void** state)
+{
+    (void)state;
+    assert_int_equal(emlog_ring_dump(1), EML_NOT_FOUND);
+    eml_ring_cfg_t bad = {.level = EML_LEVEL_DBG, .shm_name = "../x"};
+    assert_int_equal(emlog_ring_open(&bad), EML_BAD_INPUT);
+
+    /* DBG lines are recorded although the output only writes WARN+ */
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_ring_out_%d.log", (int)getpid());
+    int out = open(path, O_CREAT | O_TRUNC | O_RDWR, 0600);
+    assert_true(out >= 0);
+    emlog_set_fd(EML_LEVEL_MASK_ALL, out);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_WARN);
+    eml_ring_cfg_t cfg = {.bytes = 1, .level = EML_LEVEL_DBG};
+    assert_int_equal(emlog_ring_open(&cfg), EML_OK);
+    EML_DBG("ring", "quiet %d", 1);
+    EML_INFO("ring", "quiet %d", 2);
+    EML_WARN("ring", "loud %d", 3);
+
+    size_t n;
+    char*  text = dump_text(&n);
+    char*  a    = strstr(text, "DBG [");
+    char*  b    = strstr(text, "[ring] quiet 2");
+    char*  c    = strstr(text, "[ring] loud 3");
+    assert_non_null(a);
+    assert_non_null(b);
+    assert_non_null(c);
+    assert_true(a < b && b < c);
+    free(text);
+    char    buf[256];
+    ssize_t got = pread(out, buf, sizeof buf - 1, 0);
+    assert_true(got > 0);
+    buf[got] = '\0';
+    assert_null(strstr(buf, "quiet"));
+    assert_non_null(strstr(buf, "[ring] loud 3\n"));
+    emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+    close(out);
+    unlink(path);
+
+    /* 64 KiB minimum: 5000 lines lap it several times */
+    for(int i = 0; i < 5000; ++i)
+        EML_DBG("ring", "record %d padding padding padding", i);
+    text      = dump_text(&n);
+    int first = -1;
+    int next  = -1;
+    int lines = 0;
+    for(char* line = text; line < text + n;)
+    {
+        char* nl = strchr(line, '\n');
+        assert_non_null(nl);
+        int i = -1;
+        assert_int_equal(sscanf(line, "DBG [%*u] [ring] record %d", &i), 1);
+        if(first < 0) first = next = i;
+        assert_int_equal(i, next++);
+        ++lines;
+        line = nl + 1;
+    }
+    /* the newest lines survive whole and fill most of the ring */
+    assert_int_equal(next, 5000);
+    assert_true(first > 0);
+    assert_true(lines > 600);
+    free(text);
+
+    emlog_ring_close();
+    assert_int_equal(emlog_ring_dump(1), EML_NOT_FOUND);
+    emlog_set_level(EML_LEVEL_INFO);
+}
+
+static void test_ring_shm_extract(void** state)
+{
+    (void)state;
+    char name[32];
+    char path[64];
+    snprintf(name, sizeof name, "t%d", (int)getpid());
+    snprintf(path, sizeof path, "/dev/shm/emlog-ring.%s", name);
+    unlink(path);
+
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_ERROR);
+    eml_ring_cfg_t cfg = {.level = EML_LEVEL_INFO, .shm_name = name};
+    assert_int_equal(emlog_ring_open(&cfg), EML_OK);
+    EML_INFO("shm", "kept in /dev/shm");
+    emlog_ring_close();
+
+    /* reopening the same file keeps what it holds */
+    assert_int_equal(emlog_ring_open(&cfg), EML_OK);
+    EML_INFO("shm", "after reopen");
+    emlog_ring_close();
+
+    int fd = open(path, O_RDONLY);
+    assert_true(fd >= 0);
+    struct stat st;
+    assert_int_equal(fstat(fd, &st), 0);
+    void* image = malloc((size_t)st.st_size);
+    assert_non_null(image);
+    assert_int_equal(read(fd, image, (size_t)st.st_size), st.st_size);
+    close(fd);
+    unlink(path);
+    assert_int_equal(((eml_ring_hdr_t*)image)->pid, (uint64_t)getpid());
+
+    int p[2];
+    assert_int_equal(pipe(p), 0);
+    assert_int_equal(emlog_ring_extract(image, (size_t)st.st_size, p[1]), 2);
+    assert_int_equal(emlog_ring_extract(image, (size_t)st.st_size - 1, p[1]), -1);
+    close(p[1]);
+    char    buf[256];
+    ssize_t got = read(p[0], buf, sizeof buf - 1);
+    close(p[0]);
+    assert_true(got > 0);
+    buf[got] = '\0';
+    char* a = strstr(buf, "[shm] kept in /dev/shm\n");
+    char* b = strstr(buf, "[shm] after reopen\n");
+    assert_non_null(a);
+    assert_non_null(b);
+    assert_true(a < b);
+    free(image);
+    emlog_set_level(EML_LEVEL_INFO);
+}
+
+static void test_ring_crash_dump(void** state)
+{
+    (void)state;
+    int p[2];
+    assert_int_equal(pipe(p), 0);
+    pid_t pid = fork();
+    assert_true(pid >= 0);
+    if(pid == 0)
+    {
+        close(p[0]);
+        emlog_set_fd(EML_LEVEL_MASK_ALL, -1);
+        emlog_enable_timestamps(false);
+        emlog_set_level(EML_LEVEL_CRIT);
+        eml_ring_cfg_t cfg = {.level = EML_LEVEL_DBG, .crash_fd = p[1]};
+        if(emlog_ring_open(&cfg) != EML_OK) _exit(3);
+        EML_DBG("crash", "last words");
+        abort();
+    }
+    close(p[1]);
+    char    buf[512];
+    size_t  len = 0;
+    ssize_t got;
+    while(len < sizeof buf - 1 && (got = read(p[0], buf + len, sizeof buf - 1 - len)) > 0)
+        len += (size_t)got;
+    close(p[0]);
+    buf[len] = '\0';
+
+    /* the handler dumped, then let the default action kill the child */
+    int status = 0;
+    assert_int_equal(waitpid(pid, &status, 0), pid);
+    assert_true(WIFSIGNALED(status));
+    assert_int_equal(WTERMSIG(status), SIGABRT);
+    assert_non_null(strstr(buf, "[crash] last words\n"));
+}
+
+void emlog_ring_records_and_wraps(void** state)
+{
+    test_ring_records_and_wraps(state);
+}
+
+void emlog_ring_shm_extract(void** state)
+{
+    test_ring_shm_extract(state);
+}
+
+void emlog_ring_crash_dump(void** state)
+{
+    test_ring_crash_dump(state);
+}
@@ -0,0 +1,112 @@
+/* tests/unit/test_emlog_sampling.c
+ * Covers per-level, per-component and consistent (keyed) sampling.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static ssize_t count_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    (void)line;
+    ++*(int*)user;
+    return (ssize_t)n;
+}
+
+static void test_sampling_rates(void** state)
+{
+    (void)state;
+    int lines = 0;
+    emlog_set_writer(count_writer, &lines);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_DBG);
+
+    assert_int_equal(emlog_set_sampling((eml_level_t)42, 2), EML_BAD_INPUT);
+    assert_int_equal(emlog_set_component_sampling("", 2), EML_BAD_INPUT);
+    assert_int_equal(emlog_set_component_sampling(NULL, 2), EML_BAD_INPUT);
+
+    /* 1 in 4 INFO lines; WARN untouched */
+    assert_int_equal(emlog_set_sampling(EML_LEVEL_INFO, 4), EML_OK);
+    for(int i = 0; i < 4000; ++i)
+        EML_INFO("samp", "S %d", i);
+    assert_in_range(lines, 700, 1300);
+    lines = 0;
+    for(int i = 0; i < 100; ++i)
+        EML_WARN("samp", "W %d", i);
+    assert_int_equal(lines, 100);
+
+    /* a component rate overrides the level rate */
+    assert_int_equal(emlog_set_component_sampling("samp_all", 1000000), EML_OK);
+    lines = 0;
+    for(int i = 0; i < 1000; ++i)
+        EML_WARN("samp_all", "C %d", i);
+    assert_in_range(lines, 0, 2);
+    assert_int_equal(emlog_set_component_sampling("samp_all", 0), EML_OK);
+
+    /* rate 0 restores everything */
+    assert_int_equal(emlog_set_sampling(EML_LEVEL_INFO, 0), EML_OK);
+    lines = 0;
+    for(int i = 0; i < 100; ++i)
+        EML_INFO("samp", "S %d", i);
+    assert_int_equal(lines, 100);
+
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+}
+
+static void test_sampling_consistent_key(void** state)
+{
+    (void)state;
+    int lines = 0;
+    emlog_set_writer(count_writer, &lines);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_sampling(EML_LEVEL_INFO, 10);
+
+    int kept10[1000];
+    int total = 0;
+    for(uint64_t id = 0; id < 1000; ++id)
+    {
+        emlog_set_sample_key(id);
+        lines = 0;
+        for(int i = 0; i < 5; ++i)
+            EML_INFO("req", "step %d", i);
+        /* all lines of one request share the decision */
+        assert_true(lines == 0 || lines == 5);
+        kept10[id]  = lines != 0;
+        total      += kept10[id];
+    }
+    assert_in_range(total, 50, 160);
+
+    /* a request kept at 1-in-100 is also kept at 1-in-10 */
+    emlog_set_sampling(EML_LEVEL_INFO, 100);
+    for(uint64_t id = 0; id < 1000; ++id)
+    {
+        emlog_set_sample_key(id);
+        lines = 0;
+        EML_INFO("req", "nested");
+        if(lines) assert_true(kept10[id]);
+    }
+
+    emlog_clear_sample_key();
+    emlog_set_sampling(EML_LEVEL_INFO, 0);
+    emlog_set_writer(NULL, NULL);
+}
+
+void emlog_sampling_rates(void** state)
+{
+    test_sampling_rates(state);
+}
+
+void emlog_sampling_consistent_key(void** state)
+{
+    test_sampling_consistent_key(state);
+}
@@ -0,0 +1,112 @@
+/* tests/unit/test_emlog_shm.c
+ * Covers the shared-memory control page (emlog_shm_*).
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static ssize_t count_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    (void)line;
+    ++*(int*)user;
+    return (ssize_t)n;
+}
+
+static int wait_component_level(const char* comp, int want)
+{
+    for(int i = 0; i < 200; ++i)
+    {
+        if(emlog_get_component_level(comp) == want) return 1;
+        struct timespec pause = {0, 5 * 1000000L};
+        nanosleep(&pause, NULL);
+    }
+    return 0;
+}
+
+static void test_shm_page_updates(void** state)
+{
+    (void)state;
+    char name[32];
+    char path[64];
+    snprintf(name, sizeof name, "ut_%ld", (long)getpid());
+    snprintf(path, sizeof path, "/dev/shm/emlog.%s", name);
+
+    assert_int_equal(emlog_shm_attach("../etc"), EML_BAD_INPUT);
+    assert_int_equal(emlog_shm_attach(""), EML_BAD_INPUT);
+    assert_int_equal(emlog_shm_read("ut_missing_page", &(eml_shm_page_t){0}), EML_NOT_FOUND);
+
+    int lines = 0;
+    emlog_set_writer(count_writer, &lines);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    assert_int_equal(emlog_shm_attach_mode(name, 0400), EML_BAD_INPUT);
+    assert_int_equal(emlog_shm_attach_mode(name, 04600), EML_BAD_INPUT);
+    assert_int_equal(emlog_shm_attach(name), EML_OK);
+    assert_int_equal(emlog_shm_attach(name), EML_CONFLICT);
+
+    /* only the owner may rewrite our levels */
+    struct stat st;
+    assert_int_equal(stat(path, &st), 0);
+    assert_int_equal(st.st_mode & 0777, 0600);
+
+    /* a component raised to DBG through the page */
+    assert_int_equal(emlog_shm_set_component_level(name, "shm_net", EML_LEVEL_DBG), EML_OK);
+    assert_true(wait_component_level("shm_net", EML_LEVEL_DBG));
+    EML_DBG("shm_net", "visible");
+    assert_int_equal(lines, 1);
+
+    /* global level; a sentinel component tells us the snapshot landed */
+    assert_int_equal(emlog_shm_set_level(name, EML_LEVEL_ERROR), EML_OK);
+    assert_int_equal(emlog_shm_set_component_level(name, "shm_sync", EML_LEVEL_CRIT), EML_OK);
+    assert_true(wait_component_level("shm_sync", EML_LEVEL_CRIT));
+    EML_WARN("shm_other", "dropped at ERROR");
+    assert_int_equal(lines, 1);
+
+    eml_shm_page_t pg;
+    assert_int_equal(emlog_shm_read(name, &pg), EML_OK);
+    assert_int_equal(pg.magic, EMLOG_SHM_MAGIC);
+    assert_true(pg.flags & EMLOG_SHM_LEVEL);
+    assert_int_equal(pg.level, EML_LEVEL_ERROR);
+    assert_int_equal(pg.ncomp, 2);
+    assert_int_equal(pg.seq % 2u, 0);
+
+    /* removing an entry clears the local override */
+    assert_int_equal(emlog_shm_set_component_level(name, "shm_net", -1), EML_OK);
+    assert_true(wait_component_level("shm_net", -1));
+
+    /* after detach the page no longer drives this process */
+    emlog_shm_detach();
+    emlog_shm_detach();
+    assert_int_equal(emlog_shm_set_component_level(name, "shm_sync", EML_LEVEL_DBG), EML_OK);
+    struct timespec pause = {0, 30 * 1000000L};
+    nanosleep(&pause, NULL);
+    assert_int_equal(emlog_get_component_level("shm_sync"), EML_LEVEL_CRIT);
+
+    /* a chosen mode is applied to the existing page, whatever the umask */
+    assert_int_equal(emlog_shm_attach_mode(name, 0660), EML_OK);
+    assert_int_equal(stat(path, &st), 0);
+    assert_int_equal(st.st_mode & 0777, 0660);
+    emlog_shm_detach();
+
+    emlog_set_component_level("shm_sync", -1);
+    unlink(path);
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+}
+
+void emlog_shm_page_updates(void** state)
+{
+    test_shm_page_updates(state);
+}
@@ -0,0 +1,415 @@
+/* tests/unit/test_emlog_sinks.c
+ * Covers the sink registry: level masks, formats, async isolation, the
+ * synchronous time budget and group-commit durability.
+ */
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+struct capture
+{
+    char buf[2048];
+    int  lines;
+};
+
+static ssize_t capture_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    struct capture* c   = user;
+    size_t          off = strlen(c->buf);
+    if(off + n + 2 < sizeof c->buf)
+    {
+        memcpy(c->buf + off, line, n);
+        c->buf[off + n]     = '\n';
+        c->buf[off + n + 1] = '\0';
+    }
+    ++c->lines;
+    return (ssize_t)n;
+}
+
+static ssize_t failing_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    (void)line;
+    (void)n;
+    (void)user;
+    return -1;
+}
+
+static atomic_int gate_open;
+static atomic_int gate_calls; /* calls that reached the gate */
+
+static ssize_t gated_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    (void)line;
+    (void)user;
+    atomic_fetch_add(&gate_calls, 1);
+    while(!atomic_load(&gate_open))
+        usleep(1000);
+    return (ssize_t)n;
+}
+
+static void test_sinks_fanout(void** state)
+{
+    (void)state;
+    struct capture primary = {{0}, 0};
+    struct capture errs    = {{0}, 0};
+    struct capture msgs    = {{0}, 0};
+    emlog_set_writer(capture_writer, &primary);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_DBG);
+
+    eml_sink_cfg_t bad = {.fn = NULL};
+    int            id_err, id_msg, id_fail;
+    assert_int_equal(emlog_sink_add(&bad, &id_err), EML_BAD_INPUT);
+    bad = (eml_sink_cfg_t){.fn = capture_writer, .level_mask = 0x40u};
+    assert_int_equal(emlog_sink_add(&bad, &id_err), EML_BAD_INPUT);
+
+    eml_sink_cfg_t ce = {.fn         = capture_writer,
+                         .user       = &errs,
+                         .level_mask = EML_LEVEL_MASK(EML_LEVEL_ERROR) |
+                                       EML_LEVEL_MASK(EML_LEVEL_CRIT)};
+    eml_sink_cfg_t cm = {.fn = capture_writer, .user = &msgs, .format = EML_SINK_FMT_MSG};
+    eml_sink_cfg_t cf = {.fn = failing_writer};
+    assert_int_equal(emlog_sink_add(&ce, &id_err), EML_OK);
+    assert_int_equal(emlog_sink_add(&cm, &id_msg), EML_OK);
+    assert_int_equal(emlog_sink_add(&cf, &id_fail), EML_OK);
+
+    EML_INFO("sinks", "info %d", 1);
+    EML_ERROR("sinks", "error %d", 2);
+
+    /* sinks replace the primary writer while registered */
+    assert_int_equal(primary.lines, 0);
+    assert_int_equal(errs.lines, 1);
+    assert_non_null(strstr(errs.buf, "[sinks] error 2"));
+    assert_null(strstr(errs.buf, "info 1"));
+    assert_int_equal(msgs.lines, 2);
+    assert_string_equal(msgs.buf, "info 1\nerror 2\n");
+
+    /* a failing writer is counted and does not affect the others */
+    eml_sink_stats_t st;
+    assert_int_equal(emlog_sink_stats(id_fail, &st), EML_OK);
+    assert_int_equal(st.errors, 2);
+    assert_int_equal(st.written, 0);
+    assert_int_equal(emlog_sink_stats(id_msg, &st), EML_OK);
+    assert_int_equal(st.written, 2);
+
+    assert_int_equal(emlog_sink_remove(id_err), EML_OK);
+    assert_int_equal(emlog_sink_remove(id_msg), EML_OK);
+    assert_int_equal(emlog_sink_remove(id_fail), EML_OK);
+    assert_int_equal(emlog_sink_remove(id_fail), EML_NOT_FOUND);
+    assert_int_equal(emlog_sink_stats(id_fail, &st), EML_NOT_FOUND);
+
+    EML_INFO("sinks", "back to primary");
+    assert_int_equal(primary.lines, 1);
+
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+}
+
+static void test_sinks_async_isolation(void** state)
+{
+    (void)state;
+    struct capture fast = {{0}, 0};
+    emlog_enable_timestamps(false);
+    atomic_store(&gate_open, 0);
+
+    eml_sink_cfg_t cs = {.fn = gated_writer, .queue_len = 4};
+    eml_sink_cfg_t cf = {.fn = capture_writer, .user = &fast, .format = EML_SINK_FMT_MSG};
+    int            id_slow, id_fast;
+    assert_int_equal(emlog_sink_add(&cs, &id_slow), EML_OK);
+    assert_int_equal(emlog_sink_add(&cf, &id_fast), EML_OK);
+
+    /* the blocked sink only fills its own queue */
+    for(int i = 0; i < 100; ++i)
+        EML_INFO("sinks", "n%d", i);
+    assert_int_equal(fast.lines, 100);
+
+    eml_sink_stats_t st;
+    assert_int_equal(emlog_sink_stats(id_slow, &st), EML_OK);
+    assert_true(st.dropped >= 95);
+
+    /* once released, every line is either written or counted as dropped */
+    atomic_store(&gate_open, 1);
+    for(int i = 0; i < 2000; ++i)
+    {
+        assert_int_equal(emlog_sink_stats(id_slow, &st), EML_OK);
+        if(st.written + st.dropped == 100) break;
+        usleep(1000);
+    }
+    assert_int_equal(st.written + st.dropped, 100);
+    assert_true(st.written >= 1);
+    assert_int_equal(emlog_sink_remove(id_fast), EML_OK);
+    assert_int_equal(emlog_sink_remove(id_slow), EML_OK);
+}
+
+static atomic_int stall_ms;
+
+static ssize_t stalling_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    (void)line;
+    (void)user;
+    int ms = atomic_load(&stall_ms);
+    if(ms) usleep((useconds_t)ms * 1000u);
+    return (ssize_t)n;
+}
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static void test_sinks_sync_budget(void** state)
+{
+    (void)state;
+    struct capture fast = {{0}, 0};
+    emlog_enable_timestamps(false);
+    atomic_store(&stall_ms, 30);
+
+    eml_sink_cfg_t cs = {.fn = stalling_writer, .budget_ms = 10};
+    eml_sink_cfg_t cf = {.fn = capture_writer, .user = &fast, .format = EML_SINK_FMT_MSG};
+    int            id_slow, id_fast;
+    assert_int_equal(emlog_sink_add(&cs, &id_slow), EML_OK);
+    assert_int_equal(emlog_sink_add(&cf, &id_fast), EML_OK);
+
+    /* one overrun benches the slow sink; the rest do not wait for it */
+    uint64_t t0 = now_ms();
+    for(int i = 0; i < 50; ++i)
+        EML_INFO("sinks", "b%d", i);
+    assert_true(now_ms() - t0 < 30u * 10u);
+    assert_int_equal(fast.lines, 50);
+    eml_sink_stats_t st;
+    assert_int_equal(emlog_sink_stats(id_slow, &st), EML_OK);
+    assert_int_equal(st.written, 1);
+    assert_int_equal(st.overruns, 1);
+    assert_int_equal(st.dropped, 49);
+
+    /* after the bench it is called again */
+    atomic_store(&stall_ms, 0);
+    usleep((EMLOG_SINK_BENCH_MS + 50u) * 1000u);
+    EML_INFO("sinks", "back");
+    assert_int_equal(emlog_sink_stats(id_slow, &st), EML_OK);
+    assert_int_equal(st.written, 2);
+    assert_int_equal(st.overruns, 1);
+    assert_int_equal(emlog_sink_remove(id_fast), EML_OK);
+    assert_int_equal(emlog_sink_remove(id_slow), EML_OK);
+}
+
+static void* error_logger(void* arg)
+{
+    (void)arg;
+    EML_ERROR("sinks", "held");
+    return NULL;
+}
+
+static void test_sinks_sync_outside_lock(void** state)
+{
+    (void)state;
+    struct capture fast = {{0}, 0};
+    emlog_enable_timestamps(false);
+    atomic_store(&gate_open, 0);
+    atomic_store(&gate_calls, 0);
+
+    /* the gated sink only takes ERROR lines and holds the first one */
+    eml_sink_cfg_t cs = {.fn         = gated_writer,
+                         .level_mask = EML_LEVEL_MASK(EML_LEVEL_ERROR),
+                         .budget_ms  = 60000};
+    eml_sink_cfg_t cf = {.fn = capture_writer, .user = &fast, .format = EML_SINK_FMT_MSG};
+    int            id_slow, id_fast;
+    assert_int_equal(emlog_sink_add(&cs, &id_slow), EML_OK);
+    assert_int_equal(emlog_sink_add(&cf, &id_fast), EML_OK);
+
+    pthread_t th;
+    assert_int_equal(pthread_create(&th, NULL, error_logger, NULL), 0);
+    for(int i = 0; i < 2000 && !atomic_load(&gate_calls); ++i)
+        usleep(1000);
+    if(!atomic_load(&gate_calls)) atomic_store(&gate_open, 1); /* do not strand the thread */
+    assert_int_equal(atomic_load(&gate_calls), 1);
+
+    /* other levels, sinks and the registry do not wait for the held call */
+    eml_sink_stats_t st;
+    uint64_t         t0 = now_ms();
+    for(int i = 0; i < 20; ++i)
+        EML_INFO("sinks", "free%d", i);
+    assert_int_equal(emlog_sink_stats(id_slow, &st), EML_OK);
+    uint64_t took = now_ms() - t0;
+    int      seen = fast.lines;
+
+    atomic_store(&gate_open, 1);
+    pthread_join(th, NULL);
+    assert_true(took < 1000u);
+    assert_int_equal(seen, 20);
+    assert_int_equal(st.written, 0);
+    assert_int_equal(emlog_sink_stats(id_slow, &st), EML_OK);
+    assert_int_equal(st.written, 1);
+    assert_int_equal(st.dropped, 0);
+    assert_int_equal(emlog_sink_remove(id_fast), EML_OK);
+    assert_int_equal(emlog_sink_remove(id_slow), EML_OK);
+}
+
+/* A "disk" whose sync makes everything written so far durable. */
+struct disk
+{
+    atomic_ulong written; /* bytes handed to the writer */
+    atomic_ulong durable; /* bytes covered by a finished sync */
+    atomic_int   syncs;
+    int          slow_ms;
+};
+
+static ssize_t disk_write(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    (void)line;
+    struct disk* d = user;
+    atomic_fetch_add(&d->written, n + 1);
+    return (ssize_t)n;
+}
+
+static int disk_sync(void* user)
+{
+    struct disk*  d    = user;
+    unsigned long upto = atomic_load(&d->written);
+    if(d->slow_ms) usleep((useconds_t)d->slow_ms * 1000u);
+    atomic_store(&d->durable, upto);
+    atomic_fetch_add(&d->syncs, 1);
+    return 0;
+}
+
+static void test_sinks_durability_triggers(void** state)
+{
+    (void)state;
+    struct disk    d  = {0};
+    eml_sink_cfg_t sc = {.fn = disk_write, .user = &d, .durability = {.every_ms = 10}};
+    int            id;
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_BAD_INPUT); /* triggers, no hook */
+    sc.durability = (eml_sync_policy_t){.fn = disk_sync};
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_BAD_INPUT); /* hook, no trigger */
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    /* sync-on-level with wait: durable by the time the call returns */
+    sc.durability = (eml_sync_policy_t){.fn         = disk_sync,
+                                        .level_mask = EML_LEVEL_MASK_FROM(EML_LEVEL_ERROR),
+                                        .wait       = true};
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    EML_INFO("dur", "not urgent");
+    assert_int_equal(atomic_load(&d.syncs), 0);
+    EML_ERROR("dur", "must be on disk");
+    assert_true(atomic_load(&d.syncs) >= 1);
+    assert_int_equal(atomic_load(&d.durable), atomic_load(&d.written));
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+
+    /* every_ms: an idle dirty sink is synced after the interval */
+    memset(&d, 0, sizeof d);
+    sc.durability = (eml_sync_policy_t){.fn = disk_sync, .every_ms = 20};
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    EML_INFO("dur", "age trigger");
+    for(int i = 0; i < 200 && !atomic_load(&d.syncs); ++i)
+        usleep(10 * 1000);
+    assert_int_equal(atomic_load(&d.syncs), 1);
+    eml_sink_stats_t st;
+    assert_int_equal(emlog_sink_stats(id, &st), EML_OK);
+    assert_int_equal(st.syncs, 1);
+    assert_int_equal(st.sync_errors, 0);
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+
+    /* every_bytes: a sync once enough is unsynced; remove syncs the rest */
+    memset(&d, 0, sizeof d);
+    sc.durability = (eml_sync_policy_t){.fn = disk_sync, .every_bytes = 200};
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    for(int i = 0; i < 20; ++i)
+        EML_INFO("dur", "byte trigger %d", i);
+    for(int i = 0; i < 200 && !atomic_load(&d.syncs); ++i)
+        usleep(10 * 1000);
+    assert_true(atomic_load(&d.syncs) >= 1);
+    EML_INFO("dur", "tail");
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+    assert_int_equal(atomic_load(&d.durable), atomic_load(&d.written));
+}
+
+static struct disk group_disk;
+
+static void* group_logger(void* arg)
+{
+    (void)arg;
+    for(int i = 0; i < 10; ++i)
+    {
+        EML_ERROR("grp", "acknowledge %d", i);
+        /* our own line was counted before the sync we waited for began */
+        assert_true(atomic_load(&group_disk.durable) > 0);
+    }
+    return NULL;
+}
+
+static void test_sinks_group_commit(void** state)
+{
+    (void)state;
+    memset(&group_disk, 0, sizeof group_disk);
+    group_disk.slow_ms = 20;
+    eml_sink_cfg_t sc  = {.fn         = disk_write,
+                          .user       = &group_disk,
+                          .durability = {.fn         = disk_sync,
+                                         .level_mask = EML_LEVEL_MASK(EML_LEVEL_ERROR),
+                                         .wait       = true}};
+    int            id;
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    pthread_t th[8];
+    for(int i = 0; i < 8; ++i)
+        assert_int_equal(pthread_create(&th[i], NULL, group_logger, NULL), 0);
+    for(int i = 0; i < 8; ++i)
+        pthread_join(th[i], NULL);
+
+    /* 80 acknowledged lines, but callers shared syncs */
+    int syncs = atomic_load(&group_disk.syncs);
+    assert_true(syncs >= 1);
+    assert_true(syncs < 80);
+    assert_int_equal(atomic_load(&group_disk.durable), atomic_load(&group_disk.written));
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+}
+
+void emlog_sinks_fanout(void** state)
+{
+    test_sinks_fanout(state);
+}
+
+void emlog_sinks_async_isolation(void** state)
+{
+    test_sinks_async_isolation(state);
+}
+
+void emlog_sinks_sync_budget(void** state)
+{
+    test_sinks_sync_budget(state);
+}
+
+void emlog_sinks_sync_outside_lock(void** state)
+{
+    test_sinks_sync_outside_lock(state);
+}
+
+void emlog_sinks_durability_triggers(void** state)
+{
+    test_sinks_durability_triggers(state);
+}
+
+void emlog_sinks_group_commit(void** state)
+{
+    test_sinks_group_commit(state);
+}
@@ -0,0 +1,144 @@
+/* tests/unit/test_emlog_syslog.c
+ * Covers the RFC 5424 syslog sink against a bound datagram socket.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static int bind_daemon(const char* path)
+{
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    assert_true(fd >= 0);
+    struct sockaddr_un a = {.sun_family = AF_UNIX};
+    snprintf(a.sun_path, sizeof a.sun_path, "%s", path);
+    unlink(path);
+    assert_int_equal(bind(fd, (struct sockaddr*)&a, sizeof a), 0);
+    struct timeval tv = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    return fd;
+}
+
+static ssize_t recv_msg(int fd, char* buf, size_t cap)
+{
+    ssize_t n = recv(fd, buf, cap - 1, 0);
+    if(n >= 0) buf[n] = '\0';
+    return n;
+}
+
+static void test_syslog_format_batches(void** state)
+{
+    (void)state;
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_syslog_%d.sock", (int)getpid());
+    int srv = bind_daemon(path);
+
+    eml_syslog_sink_cfg_t bad = {.socket_path = path, .facility = 24};
+    eml_syslog_sink_t*    ss;
+    assert_int_equal(emlog_syslog_sink_open(&bad, &ss), EML_BAD_INPUT);
+
+    eml_syslog_sink_cfg_t cfg = {.socket_path = path, .hostname = "h1", .app_name = "app",
+                                 .batch = 4};
+    assert_int_equal(emlog_syslog_sink_open(&cfg, &ss), EML_OK);
+    eml_sink_cfg_t sc = {.record    = emlog_syslog_sink_record,
+                         .flush     = emlog_syslog_sink_flush,
+                         .user      = ss,
+                         .queue_len = 256};
+    int            id;
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    /* stay below the receiver's datagram queue (net.unix.max_dgram_qlen) */
+    for(int i = 0; i < 8; ++i)
+        EML_WARN("sys net", "m%d", i);
+    EML_ERROR(NULL, "last");
+
+    char buf[4096];
+    char want[128];
+    snprintf(want, sizeof want, " h1 app %d sys_net - m0", (int)getpid());
+    assert_true(recv_msg(srv, buf, sizeof buf) > 0);
+    /* facility user (1): 1 * 8 + warning (4) */
+    assert_memory_equal(buf, "<12>1 ", 6);
+    assert_non_null(strstr(buf, want));
+    assert_int_equal(buf[strlen(buf) - 1], '0');
+    for(int i = 1; i < 8; ++i)
+    {
+        char tail[16];
+        snprintf(tail, sizeof tail, " - m%d", i);
+        assert_true(recv_msg(srv, buf, sizeof buf) > 0);
+        assert_non_null(strstr(buf, tail));
+    }
+    assert_true(recv_msg(srv, buf, sizeof buf) > 0);
+    assert_memory_equal(buf, "<11>1 ", 6);
+    assert_non_null(strstr(buf, " - - last"));
+
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+    assert_int_equal(emlog_syslog_sink_sent(ss), 9);
+    assert_int_equal(emlog_syslog_sink_dropped(ss), 0);
+    emlog_syslog_sink_close(ss);
+    close(srv);
+    unlink(path);
+}
+
+static void test_syslog_reconnect(void** state)
+{
+    (void)state;
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_syslog_r%d.sock", (int)getpid());
+    int srv = bind_daemon(path);
+
+    eml_syslog_sink_cfg_t cfg = {.socket_path = path, .hostname = "h", .app_name = "a"};
+    eml_syslog_sink_t*    ss;
+    assert_int_equal(emlog_syslog_sink_open(&cfg, &ss), EML_OK);
+    eml_sink_cfg_t sc = {.record = emlog_syslog_sink_record,
+                         .flush  = emlog_syslog_sink_flush,
+                         .user   = ss};
+    int            id;
+    assert_int_equal(emlog_sink_add(&sc, &id), EML_OK);
+    emlog_set_level(EML_LEVEL_INFO);
+
+    char buf[4096];
+    EML_INFO("rc", "before");
+    assert_true(recv_msg(srv, buf, sizeof buf) > 0);
+    assert_non_null(strstr(buf, "before"));
+
+    /* daemon goes away: the line is dropped, the caller is not blocked */
+    close(srv);
+    unlink(path);
+    EML_INFO("rc", "while down");
+    assert_int_equal(emlog_syslog_sink_dropped(ss), 1);
+
+    /* daemon comes back: the next send after the back-off reconnects */
+    srv = bind_daemon(path);
+    usleep(150 * 1000);
+    EML_INFO("rc", "after");
+    assert_true(recv_msg(srv, buf, sizeof buf) > 0);
+    assert_non_null(strstr(buf, "after"));
+    assert_int_equal(emlog_syslog_sink_sent(ss), 2);
+
+    assert_int_equal(emlog_sink_remove(id), EML_OK);
+    emlog_syslog_sink_close(ss);
+    close(srv);
+    unlink(path);
+}
+
+void emlog_syslog_format_batches(void** state)
+{
+    test_syslog_format_batches(state);
+}
+
+void emlog_syslog_reconnect(void** state)
+{
+    test_syslog_reconnect(state);
+}
@@ -0,0 +1,99 @@
+/* tests/unit/test_emlog_thread_level.c
+ * Covers per-thread level overrides and the push/pop scope API.
+ */
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static int lines;
+
+static ssize_t count_writer(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    (void)line;
+    (void)user;
+    __atomic_add_fetch(&lines, 1, __ATOMIC_RELAXED);
+    return (ssize_t)n;
+}
+
+static void* other_thread(void* arg)
+{
+    (void)arg;
+    EML_DBG("tl", "other thread stays at the global level");
+    return NULL;
+}
+
+static void* exiting_thread(void* arg)
+{
+    (void)arg;
+    emlog_thread_set_level(EML_LEVEL_DBG);
+    return NULL; /* override released by the exit destructor */
+}
+
+static void test_thread_level_scopes(void** state)
+{
+    (void)state;
+    emlog_set_writer(count_writer, NULL);
+    emlog_set_level(EML_LEVEL_WARN);
+    lines = 0;
+
+    assert_int_equal(emlog_thread_get_level(), -1);
+    assert_int_equal(emlog_thread_set_level(9), EML_BAD_INPUT);
+
+    EML_DBG("tl", "dropped");
+    assert_int_equal(lines, 0);
+
+    int tok = emlog_thread_push_level(EML_LEVEL_DBG);
+    assert_int_equal(tok, -1);
+    assert_int_equal(emlog_thread_get_level(), EML_LEVEL_DBG);
+    EML_DBG("tl", "canary");
+    assert_int_equal(lines, 1);
+
+    /* other threads keep the global level */
+    pthread_t th;
+    assert_int_equal(pthread_create(&th, NULL, other_thread, NULL), 0);
+    pthread_join(th, NULL);
+    assert_int_equal(lines, 1);
+
+    /* nested scope, then unwind */
+    int tok2 = emlog_thread_push_level(EML_LEVEL_ERROR);
+    assert_int_equal(tok2, EML_LEVEL_DBG);
+    EML_WARN("tl", "quieter scope");
+    assert_int_equal(lines, 1);
+    emlog_thread_pop_level(tok2);
+    EML_INFO("tl", "back to DBG");
+    assert_int_equal(lines, 2);
+
+    /* component overrides still win over the thread level */
+    emlog_set_component_level("tl_quiet", EML_LEVEL_ERROR);
+    EML_WARN("tl_quiet", "dropped by component");
+    assert_int_equal(lines, 2);
+    emlog_set_component_level("tl_quiet", -1);
+
+    emlog_thread_pop_level(tok);
+    assert_int_equal(emlog_thread_get_level(), -1);
+    EML_DBG("tl", "dropped again");
+    assert_int_equal(lines, 2);
+    assert_int_equal(emlog__active_level, EML_LEVEL_WARN);
+
+    /* an override left at thread exit is released */
+    assert_int_equal(pthread_create(&th, NULL, exiting_thread, NULL), 0);
+    pthread_join(th, NULL);
+    assert_int_equal(emlog__active_level, EML_LEVEL_WARN);
+
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer(NULL, NULL);
+}
+
+void emlog_thread_level_scopes(void** state)
+{
+    test_thread_level_scopes(state);
+}
@@ -0,0 +1,121 @@
+/* tests/unit/test_emlog_writer_iov.c
+ * Covers the scatter-gather writer: pieces arrive uncopied, writer
+ * replacement and the file sink adapter.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <cmocka.h>
+
+#include "emlog.h"
+#include "unit_tests.h"
+
+static const char* g_msg;
+static int         g_calls;
+static int         g_cnt;
+static char        g_line[512];
+
+static ssize_t capture_iov(eml_level_t lvl, const struct iovec* iov, int iovcnt, void* user)
+{
+    (void)lvl;
+    (void)user;
+    size_t off = 0;
+    for(int i = 0; i < iovcnt; ++i)
+    {
+        memcpy(g_line + off, iov[i].iov_base, iov[i].iov_len);
+        off += iov[i].iov_len;
+    }
+    g_line[off] = '\0';
+    g_cnt       = iovcnt;
+    g_msg       = iovcnt > 1 ? (const char*)iov[iovcnt - 1].iov_base : NULL;
+    ++g_calls;
+    return (ssize_t)off;
+}
+
+static ssize_t capture_flat(eml_level_t lvl, const char* line, size_t n, void* user)
+{
+    (void)lvl;
+    (void)line;
+    (void)n;
+    (void)user;
+    ++g_calls;
+    return (ssize_t)n;
+}
+
+static void test_writer_iov_pieces(void** state)
+{
+    (void)state;
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer_iov(capture_iov, NULL);
+
+    g_calls = 0;
+    EML_INFO("iov", "value=%d", 42);
+    assert_int_equal(g_calls, 1);
+    assert_int_equal(g_cnt, 2);
+    assert_non_null(g_msg);
+    assert_int_equal(strncmp(g_msg, "value=42", 8), 0);
+    assert_non_null(strstr(g_line, "INF ["));
+    assert_non_null(strstr(g_line, "[iov] value=42"));
+    assert_null(strchr(g_line, '\n'));
+
+    /* the two kinds of writer replace each other */
+    emlog_set_writer(capture_flat, NULL);
+    g_calls = 0;
+    g_cnt   = 0;
+    EML_INFO("iov", "flat");
+    assert_int_equal(g_calls, 1);
+    assert_int_equal(g_cnt, 0);
+
+    emlog_set_writer_iov(capture_iov, NULL);
+    emlog_set_writer_iov(NULL, NULL);
+    g_calls = 0;
+    EML_INFO("iov", "back on the default writer");
+    assert_int_equal(g_calls, 0);
+    emlog_set_writer(NULL, NULL);
+}
+
+static void test_writer_iov_file_sink(void** state)
+{
+    (void)state;
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/emlog_wiov_%d.log", (int)getpid());
+    unlink(path);
+
+    eml_file_sink_cfg_t cfg = {.path = path};
+    eml_file_sink_t*    fs;
+    assert_int_equal(emlog_file_sink_open(&cfg, &fs), EML_OK);
+    emlog_enable_timestamps(false);
+    emlog_set_level(EML_LEVEL_INFO);
+    emlog_set_writer_iov(emlog_file_sink_write_iov, fs);
+    EML_INFO("iov", "first %d", 1);
+    EML_WARN("iov", "second");
+    emlog_set_writer(NULL, NULL);
+    emlog_file_sink_close(fs);
+
+    FILE* f = fopen(path, "r");
+    assert_non_null(f);
+    char buf[256];
+    assert_non_null(fgets(buf, sizeof buf, f));
+    assert_non_null(strstr(buf, "INF ["));
+    assert_non_null(strstr(buf, "[iov] first 1\n"));
+    assert_non_null(fgets(buf, sizeof buf, f));
+    assert_non_null(strstr(buf, "[iov] second\n"));
+    assert_null(fgets(buf, sizeof buf, f));
+    fclose(f);
+    unlink(path);
+}
+
+void emlog_writer_iov_pieces(void** state)
+{
+    test_writer_iov_pieces(state);
+}
+
+void emlog_writer_iov_file_sink(void** state)
+{
+    test_writer_iov_file_sink(state);
+}
@@ -23,6 +23,61 @@ extern void emlog_error_exit_codes(void** state);
 extern void emlog_log_errno_captures_context(void** state);
 extern void emlog_default_writer_stdout(void** state);
 extern void emlog_default_writer_stderr(void** state);
+extern void emlog_default_writer_set_fd(void** state);
+extern void emlog_default_writer_set_fd_bad_mask(void** state);
+extern void emlog_component_level_filters(void** state);
+extern void emlog_component_level_callsite_cache(void** state);
+extern void emlog_component_level_limits(void** state);
+extern void emlog_compile_level_strips(void** state);
+extern void emlog_fast_path_skips_arguments(void** state);
+extern void emlog_fast_path_component_overrides(void** state);
+extern void emlog_callsite_enable_by_line(void** state);
+extern void emlog_callsite_bad_specs(void** state);
+extern void emlog_ratelimit_burst_and_summary(void** state);
+extern void emlog_ratelimit_idle_summary(void** state);
+extern void emlog_ratelimit_copies_component(void** state);
+extern void emlog_ratelimit_respects_level(void** state);
+extern void emlog_dedup_collapses_runs(void** state);
+extern void emlog_dedup_window_expires(void** state);
+extern void emlog_sampling_rates(void** state);
+extern void emlog_sampling_consistent_key(void** state);
+extern void emlog_backtrace_flush_on_error(void** state);
+extern void emlog_backtrace_truncates_lines(void** state);
+extern void emlog_config_load_applies(void** state);
+extern void emlog_config_watch_reloads(void** state);
+extern void emlog_shm_page_updates(void** state);
+extern void emlog_thread_level_scopes(void** state);
+extern void emlog_file_sink_size_rotation(void** state);
+extern void emlog_file_sink_interval_no_keep(void** state);
+extern void emlog_mmap_sink_records(void** state);
+extern void emlog_sinks_fanout(void** state);
+extern void emlog_sinks_async_isolation(void** state);
+extern void emlog_sinks_sync_budget(void** state);
+extern void emlog_sinks_sync_outside_lock(void** state);
+extern void emlog_sinks_durability_triggers(void** state);
+extern void emlog_sinks_group_commit(void** state);
+extern void emlog_journal_fields(void** state);
+extern void emlog_journal_memfd_fallback(void** state);
+extern void emlog_syslog_format_batches(void** state);
+extern void emlog_syslog_reconnect(void** state);
+extern void emlog_lz_roundtrip(void** state);
+extern void emlog_lz_sink_frames(void** state);
+extern void emlog_pipe_splice_stream(void** state);
+extern void emlog_pipe_splice_fallback(void** state);
+extern void emlog_pipe_splice_stall(void** state);
+extern void emlog_direct_sink_blocks(void** state);
+extern void emlog_direct_sink_tail_flush(void** state);
+extern void emlog_writer_iov_pieces(void** state);
+extern void emlog_writer_iov_file_sink(void** state);
+extern void emlog_batch_sink_boundaries(void** state);
+extern void emlog_batch_sink_linger(void** state);
+extern void emlog_batch_sink_callback_unlocked(void** state);
+extern void emlog_overflow_parks_and_drains(void** state);
+extern void emlog_overflow_policies(void** state);
+extern void emlog_overflow_block_is_bounded(void** state);
+extern void emlog_ring_records_and_wraps(void** state);
+extern void emlog_ring_shm_extract(void** state);
+extern void emlog_ring_crash_dump(void** state);
 
 int main(void)
 {
@@ -41,6 +96,61 @@ int main(void)
         cmocka_unit_test(emlog_log_errno_captures_context),
         cmocka_unit_test(emlog_default_writer_stdout),
         cmocka_unit_test(emlog_default_writer_stderr),
+        cmocka_unit_test(emlog_default_writer_set_fd),
+        cmocka_unit_test(emlog_default_writer_set_fd_bad_mask),
+        cmocka_unit_test(emlog_component_level_filters),
+        cmocka_unit_test(emlog_component_level_callsite_cache),
+        cmocka_unit_test(emlog_component_level_limits),
+        cmocka_unit_test(emlog_compile_level_strips),
+        cmocka_unit_test(emlog_fast_path_skips_arguments),
+        cmocka_unit_test(emlog_fast_path_component_overrides),
+        cmocka_unit_test(emlog_callsite_enable_by_line),
+        cmocka_unit_test(emlog_callsite_bad_specs),
+        cmocka_unit_test(emlog_ratelimit_burst_and_summary),
+        cmocka_unit_test(emlog_ratelimit_idle_summary),
+        cmocka_unit_test(emlog_ratelimit_copies_component),
+        cmocka_unit_test(emlog_ratelimit_respects_level),
+        cmocka_unit_test(emlog_dedup_collapses_runs),
+        cmocka_unit_test(emlog_dedup_window_expires),
+        cmocka_unit_test(emlog_sampling_rates),
+        cmocka_unit_test(emlog_sampling_consistent_key),
+        cmocka_unit_test(emlog_backtrace_flush_on_error),
+        cmocka_unit_test(emlog_backtrace_truncates_lines),
+        cmocka_unit_test(emlog_config_load_applies),
+        cmocka_unit_test(emlog_config_watch_reloads),
+        cmocka_unit_test(emlog_shm_page_updates),
+        cmocka_unit_test(emlog_thread_level_scopes),
+        cmocka_unit_test(emlog_file_sink_size_rotation),
+        cmocka_unit_test(emlog_file_sink_interval_no_keep),
+        cmocka_unit_test(emlog_mmap_sink_records),
+        cmocka_unit_test(emlog_sinks_fanout),
+        cmocka_unit_test(emlog_sinks_async_isolation),
+        cmocka_unit_test(emlog_sinks_sync_budget),
+        cmocka_unit_test(emlog_sinks_sync_outside_lock),
+        cmocka_unit_test(emlog_sinks_durability_triggers),
+        cmocka_unit_test(emlog_sinks_group_commit),
+        cmocka_unit_test(emlog_journal_fields),
+        cmocka_unit_test(emlog_journal_memfd_fallback),
+        cmocka_unit_test(emlog_syslog_format_batches),
+        cmocka_unit_test(emlog_syslog_reconnect),
+        cmocka_unit_test(emlog_lz_roundtrip),
+        cmocka_unit_test(emlog_lz_sink_frames),
+        cmocka_unit_test(emlog_pipe_splice_stream),
+        cmocka_unit_test(emlog_pipe_splice_fallback),
+        cmocka_unit_test(emlog_pipe_splice_stall),
+        cmocka_unit_test(emlog_direct_sink_blocks),
+        cmocka_unit_test(emlog_direct_sink_tail_flush),
+        cmocka_unit_test(emlog_writer_iov_pieces),
+        cmocka_unit_test(emlog_writer_iov_file_sink),
+        cmocka_unit_test(emlog_batch_sink_boundaries),
+        cmocka_unit_test(emlog_batch_sink_linger),
+        cmocka_unit_test(emlog_batch_sink_callback_unlocked),
+        cmocka_unit_test(emlog_overflow_parks_and_drains),
+        cmocka_unit_test(emlog_overflow_policies),
+        cmocka_unit_test(emlog_overflow_block_is_bounded),
+        cmocka_unit_test(emlog_ring_records_and_wraps),
+        cmocka_unit_test(emlog_ring_shm_extract),
+        cmocka_unit_test(emlog_ring_crash_dump),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
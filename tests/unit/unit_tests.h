@@ -38,6 +38,107 @@ void emlog_log_errno_captures_context(void** state);
 /* default writer tests */
 void emlog_default_writer_stdout(void** state);
 void emlog_default_writer_stderr(void** state);
+void emlog_default_writer_set_fd(void** state);
+void emlog_default_writer_set_fd_bad_mask(void** state);
+
+/* component level tests */
+void emlog_component_level_filters(void** state);
+void emlog_component_level_callsite_cache(void** state);
+void emlog_component_level_limits(void** state);
+
+/* compile-time level tests */
+void emlog_compile_level_strips(void** state);
+
+/* inline fast-path tests */
+void emlog_fast_path_skips_arguments(void** state);
+void emlog_fast_path_component_overrides(void** state);
+
+/* call-site switch tests */
+void emlog_callsite_enable_by_line(void** state);
+void emlog_callsite_bad_specs(void** state);
+
+/* rate limiting tests */
+void emlog_ratelimit_burst_and_summary(void** state);
+void emlog_ratelimit_idle_summary(void** state);
+void emlog_ratelimit_copies_component(void** state);
+void emlog_ratelimit_respects_level(void** state);
+
+/* repeated-message suppression tests */
+void emlog_dedup_collapses_runs(void** state);
+void emlog_dedup_window_expires(void** state);
+
+/* sampling tests */
+void emlog_sampling_rates(void** state);
+void emlog_sampling_consistent_key(void** state);
+
+/* backtrace ring tests */
+void emlog_backtrace_flush_on_error(void** state);
+void emlog_backtrace_truncates_lines(void** state);
+
+/* configuration file tests */
+void emlog_config_load_applies(void** state);
+void emlog_config_watch_reloads(void** state);
+
+/* shared-memory control page tests */
+void emlog_shm_page_updates(void** state);
+
+/* per-thread level tests */
+void emlog_thread_level_scopes(void** state);
+
+/* rotating file sink tests */
+void emlog_file_sink_size_rotation(void** state);
+void emlog_file_sink_interval_no_keep(void** state);
+
+/* memory-mapped sink tests */
+void emlog_mmap_sink_records(void** state);
+
+/* sink registry tests */
+void emlog_sinks_fanout(void** state);
+void emlog_sinks_async_isolation(void** state);
+void emlog_sinks_sync_budget(void** state);
+void emlog_sinks_sync_outside_lock(void** state);
+void emlog_sinks_durability_triggers(void** state);
+void emlog_sinks_group_commit(void** state);
+
+/* journald sink tests */
+void emlog_journal_fields(void** state);
+void emlog_journal_memfd_fallback(void** state);
+
+/* syslog sink tests */
+void emlog_syslog_format_batches(void** state);
+void emlog_syslog_reconnect(void** state);
+
+/* compressing sink tests */
+void emlog_lz_roundtrip(void** state);
+void emlog_lz_sink_frames(void** state);
+
+/* Pipe splice output */
+void emlog_pipe_splice_stream(void** state);
+void emlog_pipe_splice_fallback(void** state);
+void emlog_pipe_splice_stall(void** state);
+
+/* Direct-I/O file sink */
+void emlog_direct_sink_blocks(void** state);
+void emlog_direct_sink_tail_flush(void** state);
+
+/* Scatter-gather writer */
+void emlog_writer_iov_pieces(void** state);
+void emlog_writer_iov_file_sink(void** state);
+
+/* batch sink tests */
+void emlog_batch_sink_boundaries(void** state);
+void emlog_batch_sink_linger(void** state);
+void emlog_batch_sink_callback_unlocked(void** state);
+
+/* default writer overflow tests */
+void emlog_overflow_parks_and_drains(void** state);
+void emlog_overflow_policies(void** state);
+void emlog_overflow_block_is_bounded(void** state);
+
+/* flight recorder ring tests */
+void emlog_ring_records_and_wraps(void** state);
+void emlog_ring_shm_extract(void** state);
+void emlog_ring_crash_dump(void** state);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,143 @@
+/* tools/emlogcat.c
+ * Decompress files written by the emlog compressing sink.
+ *
+ * Usage:
+ *   emlogcat [FILE...]
+ *
+ * Each FILE (or stdin when none is given, or for "-") is a sequence of
+ * EMLZ frames; the decompressed text is written to stdout. A frame with
+ * a bad checksum is reported and skipped; a truncated last frame (the
+ * writer crashed mid-write) is reported and ends that file.
+ */
+
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emlog.h"
+
+static uint32_t get32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+/* returns 0 when the whole file decoded cleanly */
+static int cat_stream(FILE* in, const char* name)
+{
+    unsigned char  hdr[EMLOG_LZ_HEADER];
+    unsigned char* data = NULL;
+    unsigned char* raw  = NULL;
+    size_t         dcap = 0;
+    size_t         rcap = 0;
+    unsigned long  off  = 0;
+    int            rc   = 0;
+
+    for(;;)
+    {
+        size_t got = fread(hdr, 1, sizeof hdr, in);
+        if(got == 0) break;
+        if(got < sizeof hdr)
+        {
+            fprintf(stderr, "%s: truncated frame header at offset %lu\n", name, off);
+            rc = 1;
+            break;
+        }
+        uint32_t flags = get32(hdr + 4);
+        uint32_t rlen  = get32(hdr + 8);
+        uint32_t dlen  = get32(hdr + 12);
+        if(get32(hdr) != EMLOG_LZ_MAGIC || rlen > EMLOG_LZ_BLOCK_MAX ||
+           dlen > emlog_lz_bound(EMLOG_LZ_BLOCK_MAX))
+        {
+            fprintf(stderr, "%s: not an emlog frame at offset %lu\n", name, off);
+            rc = 1;
+            break;
+        }
+        if(dlen > dcap)
+        {
+            unsigned char* nd = realloc(data, dlen);
+            if(!nd)
+            {
+                rc = 1;
+                break;
+            }
+            data = nd;
+            dcap = dlen;
+        }
+        if(rlen > rcap)
+        {
+            unsigned char* nr = realloc(raw, rlen);
+            if(!nr)
+            {
+                rc = 1;
+                break;
+            }
+            raw  = nr;
+            rcap = rlen;
+        }
+        if(fread(data, 1, dlen, in) != dlen)
+        {
+            fprintf(stderr, "%s: truncated frame at offset %lu\n", name, off);
+            rc = 1;
+            break;
+        }
+
+        ssize_t n;
+        if(flags & EMLOG_LZ_STORED)
+        {
+            n = dlen == rlen ? (ssize_t)dlen : -1;
+            if(n >= 0) memcpy(raw, data, dlen);
+        }
+        else
+        {
+            n = emlog_lz_decompress(data, dlen, raw, rlen);
+        }
+        if(n != (ssize_t)rlen || emlog_lz_check(raw, rlen) != get32(hdr + 16))
+        {
+            fprintf(stderr, "%s: corrupt frame at offset %lu, skipped\n", name, off);
+            rc = 1;
+        }
+        else
+        {
+            fwrite(raw, 1, rlen, stdout);
+        }
+        off += (unsigned long)(sizeof hdr + dlen);
+    }
+    free(data);
+    free(raw);
+    return rc;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc > 1 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")))
+    {
+        fprintf(stderr, "usage: %s [FILE...]\n", argv[0]);
+        return 2;
+    }
+    if(argc < 2) return cat_stream(stdin, "-");
+
+    int rc = 0;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-"))
+        {
+            rc |= cat_stream(stdin, "-");
+            continue;
+        }
+        FILE* f = fopen(argv[i], "rb");
+        if(!f)
+        {
+            perror(argv[i]);
+            rc = 1;
+            continue;
+        }
+        rc |= cat_stream(f, argv[i]);
+        fclose(f);
+    }
+    return rc;
+}
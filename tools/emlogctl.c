@@ -0,0 +1,132 @@
+/* tools/emlogctl.c
+ * Edit the shared emlog control page (/dev/shm/emlog.NAME).
+ *
+ * Usage:
+ *   emlogctl NAME show
+ *   emlogctl NAME level LEVEL|inherit
+ *   emlogctl NAME component COMP LEVEL|inherit
+ *   emlogctl NAME timestamps on|off|inherit
+ *
+ * Every process that called emlog_shm_attach(NAME) (or started with
+ * EMLOG_SHM=NAME) applies the change as soon as this tool returns. The
+ * page is only writable by its owner (and group, with a 0660 mode), so
+ * run this as the same user as the processes it controls.
+ */
+
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "emlog.h"
+
+static const char* const level_names[] = {"DBG", "INFO", "WARN", "ERROR", "CRIT"};
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s NAME show\n"
+            "       %s NAME level LEVEL|inherit\n"
+            "       %s NAME component COMP LEVEL|inherit\n"
+            "       %s NAME timestamps on|off|inherit\n"
+            "LEVEL is one of DBG, INFO, WARN, ERROR, CRIT or 0..4\n",
+            argv0, argv0, argv0, argv0);
+}
+
+/* returns 0..4, -1 for "inherit", -2 when unknown */
+static int parse_level_arg(const char* s)
+{
+    static const char* const aliases[] = {"debug", "inf", "warning", "err", "fatal"};
+    if(!strcasecmp(s, "inherit")) return -1;
+    if(s[0] >= '0' && s[0] <= '4' && s[1] == '\0') return s[0] - '0';
+    for(int i = 0; i < 5; ++i)
+    {
+        if(!strcasecmp(s, level_names[i]) || !strcasecmp(s, aliases[i])) return i;
+    }
+    if(!strcasecmp(s, "wrn")) return EML_LEVEL_WARN;
+    if(!strcasecmp(s, "crt")) return EML_LEVEL_CRIT;
+    return -2;
+}
+
+static const char* level_name(int lvl)
+{
+    return (lvl >= 0 && lvl <= EML_LEVEL_CRIT) ? level_names[lvl] : "?";
+}
+
+static int show(const char* name)
+{
+    eml_shm_page_t pg;
+    eml_err_t      rc = emlog_shm_read(name, &pg);
+    if(rc != EML_OK)
+    {
+        fprintf(stderr, "emlogctl: cannot read /dev/shm/emlog.%s (%d)\n", name, (int)rc);
+        return 1;
+    }
+    printf("page       /dev/shm/emlog.%s (seq %u)\n", name, pg.seq);
+    printf("level      %s\n", (pg.flags & EMLOG_SHM_LEVEL) ? level_name(pg.level) : "inherit");
+    printf("timestamps %s\n",
+           (pg.flags & EMLOG_SHM_TS) ? (pg.timestamps ? "on" : "off") : "inherit");
+    for(uint32_t i = 0; i < pg.ncomp; ++i)
+    {
+        pg.comp[i].name[EMLOG_COMPONENT_NAME_MAX - 1] = '\0';
+        printf("component  %-*s %s\n", EMLOG_COMPONENT_NAME_MAX - 1, pg.comp[i].name,
+               level_name(pg.comp[i].level));
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    const char* name = argv[1];
+    const char* cmd  = argv[2];
+    eml_err_t   rc;
+
+    if(!strcmp(cmd, "show") && argc == 3) return show(name);
+
+    if(!strcmp(cmd, "level") && argc == 4)
+    {
+        int lvl = parse_level_arg(argv[3]);
+        if(lvl < -1) goto bad;
+        rc = emlog_shm_set_level(name, lvl);
+    }
+    else if(!strcmp(cmd, "component") && argc == 5)
+    {
+        int lvl = parse_level_arg(argv[4]);
+        if(lvl < -1) goto bad;
+        rc = emlog_shm_set_component_level(name, argv[3], lvl);
+    }
+    else if(!strcmp(cmd, "timestamps") && argc == 4)
+    {
+        int on;
+        if(!strcasecmp(argv[3], "on"))
+            on = 1;
+        else if(!strcasecmp(argv[3], "off"))
+            on = 0;
+        else if(!strcasecmp(argv[3], "inherit"))
+            on = -1;
+        else
+            goto bad;
+        rc = emlog_shm_set_timestamps(name, on);
+    }
+    else
+        goto bad;
+
+    if(rc != EML_OK)
+    {
+        fprintf(stderr, "emlogctl: cannot update /dev/shm/emlog.%s (%d)\n", name, (int)rc);
+        return 1;
+    }
+    return 0;
+
+bad:
+    usage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,89 @@
+/* tools/emlogring.c
+ * Print the lines held in an emlog flight recorder ring.
+ *
+ * Usage:
+ *   emlogring FILE...
+ *
+ * Each FILE is either a ring file (/dev/shm/emlog-ring.NAME) or a core
+ * dump of a process that had a ring open; a memfd-backed ring is
+ * shared anonymous memory, which core dumps include by default. The
+ * file is scanned at page boundaries for ring headers and every ring
+ * found is written to stdout, oldest line first. Returns 1 when a file
+ * cannot be read or holds no ring.
+ */
+
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "emlog.h"
+
+#define SCAN_STEP 4096u
+
+/* returns 0 when at least one ring was printed */
+static int ring_file(const char* path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        perror(path);
+        return 1;
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(eml_ring_hdr_t))
+    {
+        fprintf(stderr, "%s: too small to hold a ring\n", path);
+        close(fd);
+        return 1;
+    }
+    size_t len = (size_t)st.st_size;
+    void*  map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        perror(path);
+        return 1;
+    }
+
+    const unsigned char* base  = map;
+    int                  found = 0;
+    for(size_t off = 0; off + sizeof(eml_ring_hdr_t) <= len; off += SCAN_STEP)
+    {
+        const eml_ring_hdr_t* h = (const eml_ring_hdr_t*)(const void*)(base + off);
+        if(h->magic != EMLOG_RING_MAGIC) continue;
+        fprintf(stderr, "%s: ring at offset %zu, %llu bytes, pid %llu\n", path, off,
+                (unsigned long long)h->size, (unsigned long long)h->pid);
+        ssize_t n = emlog_ring_extract(h, len - off, STDOUT_FILENO);
+        if(n < 0)
+        {
+            fprintf(stderr, "%s: ring at offset %zu is truncated or damaged\n", path, off);
+            continue;
+        }
+        ++found;
+        /* the data area cannot hold another header */
+        off += (size_t)((h->hdr_bytes + h->size) / SCAN_STEP - 1u) * SCAN_STEP;
+    }
+    munmap(map, len);
+    if(!found) fprintf(stderr, "%s: no emlog ring found\n", path);
+    return found ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))
+    {
+        fprintf(stderr, "usage: %s FILE...\n", argv[0]);
+        return 2;
+    }
+    int rc = 0;
+    for(int i = 1; i < argc; ++i)
+        rc |= ring_file(argv[i]);
+    return rc;
+}